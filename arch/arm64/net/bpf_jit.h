@@ -0,0 +1,132 @@
+/*
+ * Just-In-Time compiler for BPF filters on ARM64
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef PFILTER_OPCODES_ARM64_H
+#define PFILTER_OPCODES_ARM64_H
+
+#define A64_R(x)	(x)
+#define A64_FP		29
+#define A64_LR		30
+/* register 31 is sp as a base or in add/sub immediate, zr elsewhere */
+#define A64_SP		31
+#define A64_ZR		31
+
+#define A64_COND_EQ	0x0
+#define A64_COND_NE	0x1
+#define A64_COND_HS	0x2
+#define A64_COND_LO	0x3
+#define A64_COND_HI	0x8
+#define A64_COND_LS	0x9
+
+/* the inverse of a condition differs only in the lowest bit */
+#define A64_COND_INV(cond)	((cond) ^ 1)
+
+/*
+ * Data processing.  Unless the name says 64, these operate on the
+ * 32 bit W view of the registers, which zeroes the upper half of the
+ * destination.
+ */
+#define A64_ADD_R(rd, rn, rm)	(0x0b000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_SUB_R(rd, rn, rm)	(0x4b000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_AND_R(rd, rn, rm)	(0x0a000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_ORR_R(rd, rn, rm)	(0x2a000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_EOR_R(rd, rn, rm)	(0x4a000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_CMP_R(rn, rm)	(0x6b000000 | (rm) << 16 | (rn) << 5 | A64_ZR)
+#define A64_TST_R(rn, rm)	(0x6a000000 | (rm) << 16 | (rn) << 5 | A64_ZR)
+#define A64_MOV_R(rd, rm)	A64_ORR_R(rd, A64_ZR, rm)
+#define A64_NEG(rd, rm)		A64_SUB_R(rd, A64_ZR, rm)
+
+#define A64_ADD64_R(rd, rn, rm)	(0x8b000000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_CMP64_R(rn, rm)	(0xeb000000 | (rm) << 16 | (rn) << 5 | A64_ZR)
+#define A64_MOV64_R(rd, rm)	(0xaa000000 | (rm) << 16 | A64_ZR << 5 | (rd))
+
+/* imm12 is unsigned and not shifted */
+#define A64_ADD_I(rd, rn, imm)	(0x11000000 | (imm) << 10 | (rn) << 5 | (rd))
+#define A64_SUB_I(rd, rn, imm)	(0x51000000 | (imm) << 10 | (rn) << 5 | (rd))
+#define A64_CMP_I(rn, imm)	(0x71000000 | (imm) << 10 | (rn) << 5 | A64_ZR)
+#define A64_ADD64_I(rd, rn, imm) (0x91000000 | (imm) << 10 | (rn) << 5 | (rd))
+#define A64_SUB64_I(rd, rn, imm) (0xd1000000 | (imm) << 10 | (rn) << 5 | (rd))
+/* the only way to copy sp */
+#define A64_MOV64_SP(rd, rn)	A64_ADD64_I(rd, rn, 0)
+
+#define A64_MUL(rd, rn, rm)	(0x1b007c00 | (rm) << 16 | (rn) << 5 | (rd))
+/* rd = ra - rn * rm */
+#define A64_MSUB(rd, rn, rm, ra) \
+	(0x1b008000 | (rm) << 16 | (ra) << 10 | (rn) << 5 | (rd))
+#define A64_UDIV(rd, rn, rm)	(0x1ac00800 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_LSLV(rd, rn, rm)	(0x1ac02000 | (rm) << 16 | (rn) << 5 | (rd))
+#define A64_LSRV(rd, rn, rm)	(0x1ac02400 | (rm) << 16 | (rn) << 5 | (rd))
+
+#define A64_UBFM(rd, rn, immr, imms) \
+	(0x53000000 | (immr) << 16 | (imms) << 10 | (rn) << 5 | (rd))
+#define A64_UBFM64(rd, rn, immr, imms) \
+	(0xd3400000 | (immr) << 16 | (imms) << 10 | (rn) << 5 | (rd))
+#define A64_LSL_I(rd, rn, sh)	A64_UBFM(rd, rn, (32 - (sh)) & 31, 31 - (sh))
+#define A64_LSR_I(rd, rn, sh)	A64_UBFM(rd, rn, sh, 31)
+#define A64_LSL64_I(rd, rn, sh)	\
+	A64_UBFM64(rd, rn, (64 - (sh)) & 63, 63 - (sh))
+#define A64_LSR64_I(rd, rn, sh)	A64_UBFM64(rd, rn, sh, 63)
+#define A64_UBFX(rd, rn, lsb, width) \
+	A64_UBFM(rd, rn, lsb, (lsb) + (width) - 1)
+#define A64_UBFIZ(rd, rn, lsb, width) \
+	A64_UBFM(rd, rn, (32 - (lsb)) & 31, (width) - 1)
+
+#define A64_REV(rd, rn)		(0x5ac00800 | (rn) << 5 | (rd))
+#define A64_REV16(rd, rn)	(0x5ac00400 | (rn) << 5 | (rd))
+
+/* hw selects which 16 bit half word imm16 goes to */
+#define A64_MOVZ(rd, imm, hw)	(0x52800000 | (hw) << 21 | (imm) << 5 | (rd))
+#define A64_MOVN(rd, imm, hw)	(0x12800000 | (hw) << 21 | (imm) << 5 | (rd))
+#define A64_MOVK(rd, imm, hw)	(0x72800000 | (hw) << 21 | (imm) << 5 | (rd))
+#define A64_MOVZ64(rd, imm, hw)	(0xd2800000 | (hw) << 21 | (imm) << 5 | (rd))
+#define A64_MOVK64(rd, imm, hw)	(0xf2800000 | (hw) << 21 | (imm) << 5 | (rd))
+
+/* Loads and stores, immediate offsets in bytes and scaled by the size */
+#define A64_LDR_I(rt, rn, off) \
+	(0xb9400000 | ((off) >> 2) << 10 | (rn) << 5 | (rt))
+#define A64_STR_I(rt, rn, off) \
+	(0xb9000000 | ((off) >> 2) << 10 | (rn) << 5 | (rt))
+#define A64_LDRH_I(rt, rn, off) \
+	(0x79400000 | ((off) >> 1) << 10 | (rn) << 5 | (rt))
+#define A64_LDRB_I(rt, rn, off) \
+	(0x39400000 | (off) << 10 | (rn) << 5 | (rt))
+#define A64_LDR64_I(rt, rn, off) \
+	(0xf9400000 | ((off) >> 3) << 10 | (rn) << 5 | (rt))
+
+/* register offset, the W index register zero extended */
+#define A64_LDR_RW(rt, rn, rm)	(0xb8604800 | (rm) << 16 | (rn) << 5 | (rt))
+#define A64_LDRH_RW(rt, rn, rm)	(0x78604800 | (rm) << 16 | (rn) << 5 | (rt))
+#define A64_LDRB_RW(rt, rn, rm)	(0x38604800 | (rm) << 16 | (rn) << 5 | (rt))
+
+#define A64_PAIR(off)		((((off) >> 3) & 0x7f) << 15)
+#define A64_STP64(rt, rt2, rn, off) \
+	(0xa9000000 | A64_PAIR(off) | (rt2) << 10 | (rn) << 5 | (rt))
+#define A64_STP64_PRE(rt, rt2, rn, off) \
+	(0xa9800000 | A64_PAIR(off) | (rt2) << 10 | (rn) << 5 | (rt))
+#define A64_LDP64(rt, rt2, rn, off) \
+	(0xa9400000 | A64_PAIR(off) | (rt2) << 10 | (rn) << 5 | (rt))
+#define A64_LDP64_POST(rt, rt2, rn, off) \
+	(0xa8c00000 | A64_PAIR(off) | (rt2) << 10 | (rn) << 5 | (rt))
+
+/* Branches, offsets in instructions relative to the branch itself */
+#define A64_B(imm)		(0x14000000 | ((imm) & 0x03ffffff))
+#define A64_B_COND(cond, imm)	(0x54000000 | ((imm) & 0x7ffff) << 5 | (cond))
+#define A64_CBZ(rt, imm)	(0x34000000 | ((imm) & 0x7ffff) << 5 | (rt))
+#define A64_CBZ64(rt, imm)	(0xb4000000 | ((imm) & 0x7ffff) << 5 | (rt))
+#define A64_CBNZ64(rt, imm)	(0xb5000000 | ((imm) & 0x7ffff) << 5 | (rt))
+#define A64_BLR(rn)		(0xd63f0000 | (rn) << 5)
+#define A64_RET			0xd65f03c0
+
+#endif /* PFILTER_OPCODES_ARM64_H */
@@ -0,0 +1,804 @@
+/*
+ * Just-In-Time compiler for BPF filters on ARM64
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Compiles classic BPF for both socket filters and seccomp.  The layout
+ * follows the 32 bit ARM compiler: a fake pass over the program records
+ * the offset of every BPF instruction and which resources it touches,
+ * then the prologue is sized from that and the real pass writes the
+ * image.  Anything the compiler does not handle is left to the
+ * interpreter.
+ */
+
+#include <linux/bitops.h>
+#include <linux/compiler.h>
+#include <linux/errno.h>
+#include <linux/filter.h>
+#include <linux/moduleloader.h>
+#include <linux/netdevice.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/if_vlan.h>
+#include <linux/log2.h>
+#include <linux/seccomp.h>
+#include <asm/cacheflush.h>
+#include <asm/unaligned.h>
+
+#include "bpf_jit.h"
+
+/*
+ * ABI:
+ *
+ * x0		skb on entry, return value
+ * w1		offset argument of the load helpers
+ * x9, x10	scratch
+ * w19		BPF register A
+ * w20		BPF register X
+ * x21		pointer to the skb
+ * x22		skb->data
+ * w23		skb_headlen(skb)
+ *
+ * The BPF state lives in callee saved registers so that helper calls
+ * do not need to spill it.
+ */
+
+#define r_ret		A64_R(0)
+#define r_off		A64_R(1)
+#define r_scratch	A64_R(9)
+#define r_scratch2	A64_R(10)
+#define r_A		A64_R(19)
+#define r_X		A64_R(20)
+#define r_skb		A64_R(21)
+#define r_skb_data	A64_R(22)
+#define r_skb_hl	A64_R(23)
+
+/* fp, lr and x19-x24, x24 only pads the last pair */
+#define FRAME_SIZE		64
+#define SCRATCH_SIZE		(4 * BPF_MEMWORDS)
+#define SCRATCH_OFF(k)		(4 * (k))
+
+#define SEEN_MEM		((1 << BPF_MEMWORDS) - 1)
+#define SEEN_MEM_WORD(k)	(1 << (k))
+#define SEEN_X			(1 << BPF_MEMWORDS)
+#define SEEN_CALL		(1 << (BPF_MEMWORDS + 1))
+#define SEEN_SKB		(1 << (BPF_MEMWORDS + 2))
+#define SEEN_DATA		(1 << (BPF_MEMWORDS + 3))
+
+struct jit_ctx {
+	const struct sock_filter *insns;
+	unsigned int len;
+	unsigned int idx;
+	unsigned int prologue_len;
+	unsigned int epilogue_len;
+	u32 seen;
+	u32 *offsets;
+	u32 *image;
+};
+
+int bpf_jit_enable __read_mostly;
+
+/* Same as load_pointer() in net/core/filter.c */
+static inline void *jit_load_pointer(const struct sk_buff *skb, int k,
+				     unsigned int size, void *buffer)
+{
+	if (k >= 0)
+		return skb_header_pointer(skb, k, size, buffer);
+	return bpf_internal_load_pointer_neg_helper(skb, k, size);
+}
+
+/*
+ * Slow path of the packet loads, for data outside the linear area and
+ * for the negative SKF_NET_OFF and SKF_LL_OFF offsets.  A non zero upper
+ * half of the result makes the filter return 0.
+ */
+static u64 jit_get_skb_b(struct sk_buff *skb, int offset)
+{
+	u8 buf, *ptr;
+
+	ptr = jit_load_pointer(skb, offset, 1, &buf);
+	if (!ptr)
+		return 1ULL << 32;
+	return *ptr;
+}
+
+static u64 jit_get_skb_h(struct sk_buff *skb, int offset)
+{
+	u16 buf;
+	u8 *ptr;
+
+	ptr = jit_load_pointer(skb, offset, 2, &buf);
+	if (!ptr)
+		return 1ULL << 32;
+	return get_unaligned_be16(ptr);
+}
+
+static u64 jit_get_skb_w(struct sk_buff *skb, int offset)
+{
+	u32 buf;
+	u8 *ptr;
+
+	ptr = jit_load_pointer(skb, offset, 4, &buf);
+	if (!ptr)
+		return 1ULL << 32;
+	return get_unaligned_be32(ptr);
+}
+
+static inline void emit(u32 inst, struct jit_ctx *ctx)
+{
+	if (ctx->image != NULL)
+		ctx->image[ctx->idx] = inst;
+
+	ctx->idx++;
+}
+
+static void emit_mov_i(u8 rd, u32 val, struct jit_ctx *ctx)
+{
+	u16 lo = val & 0xffff;
+	u16 hi = val >> 16;
+
+	if (!hi) {
+		emit(A64_MOVZ(rd, lo, 0), ctx);
+	} else if (hi == 0xffff) {
+		emit(A64_MOVN(rd, (u16)~lo, 0), ctx);
+	} else if (!lo) {
+		emit(A64_MOVZ(rd, hi, 1), ctx);
+	} else {
+		emit(A64_MOVZ(rd, lo, 0), ctx);
+		emit(A64_MOVK(rd, hi, 1), ctx);
+	}
+}
+
+/* Always five instructions, so that both passes agree on the size */
+static void emit_call(void *func, struct jit_ctx *ctx)
+{
+	u64 addr = (u64)func;
+
+	ctx->seen |= SEEN_CALL;
+	emit(A64_MOVZ64(r_scratch, addr & 0xffff, 0), ctx);
+	emit(A64_MOVK64(r_scratch, (addr >> 16) & 0xffff, 1), ctx);
+	emit(A64_MOVK64(r_scratch, (addr >> 32) & 0xffff, 2), ctx);
+	emit(A64_MOVK64(r_scratch, (addr >> 48) & 0xffff, 3), ctx);
+	emit(A64_BLR(r_scratch), ctx);
+}
+
+/* Offset, in instructions, from the current one to BPF instruction tgt */
+static inline int b_imm(unsigned int tgt, struct jit_ctx *ctx)
+{
+	if (ctx->image == NULL)
+		return 0;
+	/*
+	 * BPF allows only forward jumps and the offset of the target is
+	 * still the one computed during the first pass.
+	 */
+	return ctx->offsets[tgt] + ctx->prologue_len - ctx->idx;
+}
+
+/* Offset to the "return 0" stub placed after the epilogue */
+static inline int ret0_imm(struct jit_ctx *ctx)
+{
+	if (ctx->image == NULL)
+		return 0;
+	return ctx->prologue_len + ctx->offsets[ctx->len] +
+	       ctx->epilogue_len - ctx->idx;
+}
+
+/* Point the forward b.cond emitted at insn 'at' to the current insn */
+static inline void fixup_b_cond(unsigned int at, u8 cond, struct jit_ctx *ctx)
+{
+	if (ctx->image != NULL)
+		ctx->image[at] = A64_B_COND(cond, ctx->idx - at);
+}
+
+static inline void fixup_b(unsigned int at, struct jit_ctx *ctx)
+{
+	if (ctx->image != NULL)
+		ctx->image[at] = A64_B(ctx->idx - at);
+}
+
+/*
+ * Fast path for a load of 1 << order bytes at w1 out of the linear data;
+ * branches to 'slow' if it does not fit.  Returns the index of the
+ * branch that has to be pointed to the slow path.
+ */
+static unsigned int emit_load_fast(u8 rd, unsigned int order,
+				   struct jit_ctx *ctx)
+{
+	unsigned int slow;
+
+	ctx->seen |= SEEN_DATA;
+	/* negative offsets zero extend to huge values and fail the test */
+	emit(A64_ADD64_I(r_scratch, r_off, 1 << order), ctx);
+	emit(A64_CMP64_R(r_scratch, r_skb_hl), ctx);
+	slow = ctx->idx;
+	emit(A64_B_COND(A64_COND_HI, 0), ctx);
+
+	switch (order) {
+	case 0:
+		emit(A64_LDRB_RW(rd, r_skb_data, r_off), ctx);
+		break;
+	case 1:
+		emit(A64_LDRH_RW(rd, r_skb_data, r_off), ctx);
+#ifdef __LITTLE_ENDIAN
+		emit(A64_REV16(rd, rd), ctx);
+#endif
+		break;
+	case 2:
+		emit(A64_LDR_RW(rd, r_skb_data, r_off), ctx);
+#ifdef __LITTLE_ENDIAN
+		emit(A64_REV(rd, rd), ctx);
+#endif
+		break;
+	}
+
+	return slow;
+}
+
+/* Slow path: w0 = load_func(skb, w1), or return 0 from the filter */
+static void emit_load_slow(void *func, struct jit_ctx *ctx)
+{
+	emit(A64_MOV64_R(A64_R(0), r_skb), ctx);
+	/* the offset is already in w1 */
+	emit_call(func, ctx);
+	emit(A64_LSR64_I(r_scratch, A64_R(0), 32), ctx);
+	emit(A64_CBNZ64(r_scratch, ret0_imm(ctx)), ctx);
+}
+
+static void build_prologue(struct jit_ctx *ctx)
+{
+	emit(A64_STP64_PRE(A64_FP, A64_LR, A64_SP, -FRAME_SIZE), ctx);
+	emit(A64_MOV64_SP(A64_FP, A64_SP), ctx);
+	emit(A64_STP64(r_A, r_X, A64_SP, 16), ctx);
+
+	if (ctx->seen & (SEEN_SKB | SEEN_DATA)) {
+		emit(A64_STP64(r_skb, r_skb_data, A64_SP, 32), ctx);
+		emit(A64_STP64(r_skb_hl, A64_R(24), A64_SP, 48), ctx);
+		emit(A64_MOV64_R(r_skb, A64_R(0)), ctx);
+	}
+
+	if (ctx->seen & SEEN_DATA) {
+		BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, data) != 8);
+		BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, len) != 4);
+		BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, data_len) != 4);
+		emit(A64_LDR64_I(r_skb_data, r_skb,
+				 offsetof(struct sk_buff, data)), ctx);
+		/* headlen = len - data_len */
+		emit(A64_LDR_I(r_skb_hl, r_skb,
+			       offsetof(struct sk_buff, len)), ctx);
+		emit(A64_LDR_I(r_scratch, r_skb,
+			       offsetof(struct sk_buff, data_len)), ctx);
+		emit(A64_SUB_R(r_skb_hl, r_skb_hl, r_scratch), ctx);
+	}
+
+	if (ctx->seen & SEEN_MEM)
+		emit(A64_SUB64_I(A64_SP, A64_SP, SCRATCH_SIZE), ctx);
+
+	emit(A64_MOVZ(r_A, 0, 0), ctx);
+	if (ctx->seen & SEEN_X)
+		emit(A64_MOVZ(r_X, 0, 0), ctx);
+}
+
+static void build_epilogue(struct jit_ctx *ctx)
+{
+	unsigned int start = ctx->idx;
+
+	if (ctx->seen & SEEN_MEM)
+		emit(A64_ADD64_I(A64_SP, A64_SP, SCRATCH_SIZE), ctx);
+
+	if (ctx->seen & (SEEN_SKB | SEEN_DATA)) {
+		emit(A64_LDP64(r_skb_hl, A64_R(24), A64_SP, 48), ctx);
+		emit(A64_LDP64(r_skb, r_skb_data, A64_SP, 32), ctx);
+	}
+	emit(A64_LDP64(r_A, r_X, A64_SP, 16), ctx);
+	emit(A64_LDP64_POST(A64_FP, A64_LR, A64_SP, FRAME_SIZE), ctx);
+	emit(A64_RET, ctx);
+
+	ctx->epilogue_len = ctx->idx - start;
+
+	/* return 0, the target of the error branches */
+	emit(A64_MOVZ(r_ret, 0, 0), ctx);
+	emit(A64_B((int)(start - ctx->idx)), ctx);
+}
+
+/* rd = rd op K, with K in the scratch register */
+static void emit_alu_k(u32 inst_r, u8 rd, u32 k, struct jit_ctx *ctx)
+{
+	emit_mov_i(r_scratch, k, ctx);
+	emit(inst_r | r_scratch << 16 | rd << 5 | rd, ctx);
+}
+
+static int build_body(struct jit_ctx *ctx)
+{
+	void *load_func[] = {jit_get_skb_b, jit_get_skb_h, jit_get_skb_w};
+	const struct sock_filter *inst;
+	unsigned int i, load_order, slow, done;
+	u8 cond;
+	u32 k;
+
+	for (i = 0; i < ctx->len; i++) {
+		inst = &ctx->insns[i];
+		k = inst->k;
+
+		/* compute offsets only in the fake pass */
+		if (ctx->image == NULL)
+			ctx->offsets[i] = ctx->idx;
+
+		switch (inst->code) {
+		case BPF_S_LD_IMM:
+			emit_mov_i(r_A, k, ctx);
+			break;
+		case BPF_S_LD_W_LEN:
+			ctx->seen |= SEEN_SKB;
+			emit(A64_LDR_I(r_A, r_skb,
+				       offsetof(struct sk_buff, len)), ctx);
+			break;
+		case BPF_S_LD_MEM:
+			/* A = scratch[k] */
+			ctx->seen |= SEEN_MEM_WORD(k);
+			emit(A64_LDR_I(r_A, A64_SP, SCRATCH_OFF(k)), ctx);
+			break;
+		case BPF_S_LD_W_ABS:
+			load_order = 2;
+			goto load;
+		case BPF_S_LD_H_ABS:
+			load_order = 1;
+			goto load;
+		case BPF_S_LD_B_ABS:
+			load_order = 0;
+load:
+			emit_mov_i(r_off, k, ctx);
+load_common:
+			ctx->seen |= SEEN_SKB;
+			slow = emit_load_fast(r_A, load_order, ctx);
+			emit(A64_B(b_imm(i + 1, ctx)), ctx);
+			fixup_b_cond(slow, A64_COND_HI, ctx);
+			emit_load_slow(load_func[load_order], ctx);
+			emit(A64_MOV_R(r_A, A64_R(0)), ctx);
+			break;
+		case BPF_S_LD_W_IND:
+			load_order = 2;
+			goto load_ind;
+		case BPF_S_LD_H_IND:
+			load_order = 1;
+			goto load_ind;
+		case BPF_S_LD_B_IND:
+			load_order = 0;
+load_ind:
+			ctx->seen |= SEEN_X;
+			if (k < 4096) {
+				emit(A64_ADD_I(r_off, r_X, k), ctx);
+			} else {
+				emit_mov_i(r_off, k, ctx);
+				emit(A64_ADD_R(r_off, r_off, r_X), ctx);
+			}
+			goto load_common;
+		case BPF_S_LDX_IMM:
+			ctx->seen |= SEEN_X;
+			emit_mov_i(r_X, k, ctx);
+			break;
+		case BPF_S_LDX_W_LEN:
+			ctx->seen |= SEEN_X | SEEN_SKB;
+			emit(A64_LDR_I(r_X, r_skb,
+				       offsetof(struct sk_buff, len)), ctx);
+			break;
+		case BPF_S_LDX_MEM:
+			ctx->seen |= SEEN_X | SEEN_MEM_WORD(k);
+			emit(A64_LDR_I(r_X, A64_SP, SCRATCH_OFF(k)), ctx);
+			break;
+		case BPF_S_LDX_B_MSH:
+			/* X = 4 * (skb[k] & 0xf) */
+			ctx->seen |= SEEN_X | SEEN_SKB;
+			emit_mov_i(r_off, k, ctx);
+			slow = emit_load_fast(r_ret, 0, ctx);
+			done = ctx->idx;
+			emit(A64_B(0), ctx);
+			fixup_b_cond(slow, A64_COND_HI, ctx);
+			emit_load_slow(jit_get_skb_b, ctx);
+			fixup_b(done, ctx);
+			emit(A64_UBFIZ(r_X, r_ret, 2, 4), ctx);
+			break;
+		case BPF_S_ST:
+			ctx->seen |= SEEN_MEM_WORD(k);
+			emit(A64_STR_I(r_A, A64_SP, SCRATCH_OFF(k)), ctx);
+			break;
+		case BPF_S_STX:
+			ctx->seen |= SEEN_X | SEEN_MEM_WORD(k);
+			emit(A64_STR_I(r_X, A64_SP, SCRATCH_OFF(k)), ctx);
+			break;
+		case BPF_S_ALU_ADD_K:
+			if (k < 4096)
+				emit(A64_ADD_I(r_A, r_A, k), ctx);
+			else
+				emit_alu_k(A64_ADD_R(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_ADD_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_ADD_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_SUB_K:
+			if (k < 4096)
+				emit(A64_SUB_I(r_A, r_A, k), ctx);
+			else
+				emit_alu_k(A64_SUB_R(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_SUB_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_SUB_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_MUL_K:
+			emit_alu_k(A64_MUL(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_MUL_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_MUL(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_DIV_K:
+			/* sk_chk_filter() rejects a zero K */
+			if (k == 1)
+				break;
+			emit_alu_k(A64_UDIV(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_DIV_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_CBZ(r_X, ret0_imm(ctx)), ctx);
+			emit(A64_UDIV(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_MOD_K:
+			/* A = A - (A / K) * K */
+			emit_mov_i(r_scratch, k, ctx);
+			emit(A64_UDIV(r_scratch2, r_A, r_scratch), ctx);
+			emit(A64_MSUB(r_A, r_scratch2, r_scratch, r_A), ctx);
+			break;
+		case BPF_S_ALU_MOD_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_CBZ(r_X, ret0_imm(ctx)), ctx);
+			emit(A64_UDIV(r_scratch, r_A, r_X), ctx);
+			emit(A64_MSUB(r_A, r_scratch, r_X, r_A), ctx);
+			break;
+		case BPF_S_ALU_AND_K:
+			emit_alu_k(A64_AND_R(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_AND_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_AND_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_OR_K:
+			emit_alu_k(A64_ORR_R(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_OR_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_ORR_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_XOR_K:
+			emit_alu_k(A64_EOR_R(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ANC_ALU_XOR_X:
+		case BPF_S_ALU_XOR_X:
+			/* A ^= X */
+			ctx->seen |= SEEN_X;
+			emit(A64_EOR_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_LSH_K:
+			/*
+			 * The interpreter shifts by K modulo 32 on this
+			 * architecture, the register forms do the same.
+			 */
+			if (k < 32)
+				emit(A64_LSL_I(r_A, r_A, k), ctx);
+			else
+				emit_alu_k(A64_LSLV(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_LSH_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_LSLV(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_RSH_K:
+			if (k < 32)
+				emit(A64_LSR_I(r_A, r_A, k), ctx);
+			else
+				emit_alu_k(A64_LSRV(0, 0, 0), r_A, k, ctx);
+			break;
+		case BPF_S_ALU_RSH_X:
+			ctx->seen |= SEEN_X;
+			emit(A64_LSRV(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_NEG:
+			emit(A64_NEG(r_A, r_A), ctx);
+			break;
+		case BPF_S_RET_K:
+			emit_mov_i(r_ret, k, ctx);
+			goto ret;
+		case BPF_S_RET_A:
+			emit(A64_MOV_R(r_ret, r_A), ctx);
+ret:
+			/* the last instruction falls through to the epilogue */
+			if (i != ctx->len - 1)
+				emit(A64_B(b_imm(ctx->len, ctx)), ctx);
+			break;
+		case BPF_S_MISC_TAX:
+			ctx->seen |= SEEN_X;
+			emit(A64_MOV_R(r_X, r_A), ctx);
+			break;
+		case BPF_S_MISC_TXA:
+			ctx->seen |= SEEN_X;
+			emit(A64_MOV_R(r_A, r_X), ctx);
+			break;
+		case BPF_S_JMP_JA:
+			/* pc += K */
+			emit(A64_B(b_imm(i + k + 1, ctx)), ctx);
+			break;
+		case BPF_S_JMP_JEQ_K:
+			/* pc += (A == K) ? pc->jt : pc->jf */
+			cond = A64_COND_EQ;
+			goto cmp_imm;
+		case BPF_S_JMP_JGT_K:
+			/* pc += (A > K) ? pc->jt : pc->jf */
+			cond = A64_COND_HI;
+			goto cmp_imm;
+		case BPF_S_JMP_JGE_K:
+			/* pc += (A >= K) ? pc->jt : pc->jf */
+			cond = A64_COND_HS;
+cmp_imm:
+			if (k < 4096) {
+				emit(A64_CMP_I(r_A, k), ctx);
+			} else {
+				emit_mov_i(r_scratch, k, ctx);
+				emit(A64_CMP_R(r_A, r_scratch), ctx);
+			}
+cond_jump:
+			if (inst->jt)
+				emit(A64_B_COND(cond, b_imm(i + inst->jt + 1,
+							    ctx)), ctx);
+			if (inst->jf)
+				emit(A64_B_COND(A64_COND_INV(cond),
+						b_imm(i + inst->jf + 1, ctx)),
+				     ctx);
+			break;
+		case BPF_S_JMP_JEQ_X:
+			/* pc += (A == X) ? pc->jt : pc->jf */
+			cond = A64_COND_EQ;
+			goto cmp_x;
+		case BPF_S_JMP_JGT_X:
+			/* pc += (A > X) ? pc->jt : pc->jf */
+			cond = A64_COND_HI;
+			goto cmp_x;
+		case BPF_S_JMP_JGE_X:
+			/* pc += (A >= X) ? pc->jt : pc->jf */
+			cond = A64_COND_HS;
+cmp_x:
+			ctx->seen |= SEEN_X;
+			emit(A64_CMP_R(r_A, r_X), ctx);
+			goto cond_jump;
+		case BPF_S_JMP_JSET_K:
+			/* pc += (A & K) ? pc->jt : pc->jf */
+			cond = A64_COND_NE;
+			emit_mov_i(r_scratch, k, ctx);
+			emit(A64_TST_R(r_A, r_scratch), ctx);
+			goto cond_jump;
+		case BPF_S_JMP_JSET_X:
+			/* pc += (A & X) ? pc->jt : pc->jf */
+			cond = A64_COND_NE;
+			ctx->seen |= SEEN_X;
+			emit(A64_TST_R(r_A, r_X), ctx);
+			goto cond_jump;
+		case BPF_S_ANC_PROTOCOL:
+			/* A = ntohs(skb->protocol) */
+			ctx->seen |= SEEN_SKB;
+			BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff,
+						  protocol) != 2);
+			emit(A64_LDRH_I(r_A, r_skb,
+					offsetof(struct sk_buff, protocol)),
+			     ctx);
+#ifdef __LITTLE_ENDIAN
+			emit(A64_REV16(r_A, r_A), ctx);
+#endif
+			break;
+		case BPF_S_ANC_CPU:
+			/* A = current_thread_info()->cpu */
+			BUILD_BUG_ON(FIELD_SIZEOF(struct thread_info, cpu) != 4);
+			emit(A64_MOV64_SP(r_scratch, A64_SP), ctx);
+			emit(A64_LSR64_I(r_scratch, r_scratch,
+					 ilog2(THREAD_SIZE)), ctx);
+			emit(A64_LSL64_I(r_scratch, r_scratch,
+					 ilog2(THREAD_SIZE)), ctx);
+			emit(A64_LDR_I(r_A, r_scratch,
+				       offsetof(struct thread_info, cpu)), ctx);
+			break;
+		case BPF_S_ANC_IFINDEX:
+		case BPF_S_ANC_HATYPE:
+			/* A = skb->dev->ifindex or skb->dev->type */
+			ctx->seen |= SEEN_SKB;
+			emit(A64_LDR64_I(r_scratch, r_skb,
+					 offsetof(struct sk_buff, dev)), ctx);
+			emit(A64_CBZ64(r_scratch, ret0_imm(ctx)), ctx);
+
+			if (inst->code == BPF_S_ANC_IFINDEX) {
+				BUILD_BUG_ON(FIELD_SIZEOF(struct net_device,
+							  ifindex) != 4);
+				emit(A64_LDR_I(r_A, r_scratch,
+					       offsetof(struct net_device,
+							ifindex)), ctx);
+			} else {
+				BUILD_BUG_ON(FIELD_SIZEOF(struct net_device,
+							  type) != 2);
+				emit(A64_LDRH_I(r_A, r_scratch,
+						offsetof(struct net_device,
+							 type)), ctx);
+			}
+			break;
+		case BPF_S_ANC_MARK:
+			ctx->seen |= SEEN_SKB;
+			BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, mark) != 4);
+			emit(A64_LDR_I(r_A, r_skb,
+				       offsetof(struct sk_buff, mark)), ctx);
+			break;
+		case BPF_S_ANC_RXHASH:
+			ctx->seen |= SEEN_SKB;
+			BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, rxhash) != 4);
+			emit(A64_LDR_I(r_A, r_skb,
+				       offsetof(struct sk_buff, rxhash)), ctx);
+			break;
+		case BPF_S_ANC_QUEUE:
+			ctx->seen |= SEEN_SKB;
+			BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff,
+						  queue_mapping) != 2);
+			emit(A64_LDRH_I(r_A, r_skb,
+					offsetof(struct sk_buff,
+						 queue_mapping)), ctx);
+			break;
+		case BPF_S_ANC_VLAN_TAG:
+		case BPF_S_ANC_VLAN_TAG_PRESENT:
+			ctx->seen |= SEEN_SKB;
+			BUILD_BUG_ON(FIELD_SIZEOF(struct sk_buff, vlan_tci) != 2);
+			BUILD_BUG_ON(VLAN_TAG_PRESENT != 0x1000);
+			emit(A64_LDRH_I(r_A, r_skb,
+					offsetof(struct sk_buff, vlan_tci)),
+			     ctx);
+			if (inst->code == BPF_S_ANC_VLAN_TAG) {
+				emit_alu_k(A64_AND_R(0, 0, 0), r_A,
+					   ~VLAN_TAG_PRESENT, ctx);
+			} else {
+				emit(A64_UBFX(r_A, r_A, 12, 1), ctx);
+			}
+			break;
+		case BPF_S_ANC_PAY_OFFSET:
+			/* A = __skb_get_poff(skb) */
+			ctx->seen |= SEEN_SKB;
+			emit(A64_MOV64_R(A64_R(0), r_skb), ctx);
+			emit_call(__skb_get_poff, ctx);
+			emit(A64_MOV_R(r_A, A64_R(0)), ctx);
+			break;
+#ifdef CONFIG_SECCOMP_FILTER
+		case BPF_S_ANC_SECCOMP_LD_W:
+			/* A = seccomp_bpf_load(K) */
+			emit_mov_i(A64_R(0), k, ctx);
+			emit_call(seccomp_bpf_load, ctx);
+			emit(A64_MOV_R(r_A, A64_R(0)), ctx);
+			break;
+#endif
+		default:
+			/* pkttype and the netlink attributes */
+			return -1;
+		}
+	}
+
+	/* compute offsets only during the first pass */
+	if (ctx->image == NULL)
+		ctx->offsets[i] = ctx->idx;
+
+	return 0;
+}
+
+/* Returns the image, or NULL to leave the program to the interpreter */
+static void *bpf_jit_build(const struct sock_filter *insns, unsigned int len,
+			   unsigned int *size)
+{
+	struct jit_ctx ctx;
+	unsigned int tmp_idx;
+	void *image = NULL;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.insns = insns;
+	ctx.len = len;
+
+	ctx.offsets = kzalloc(sizeof(u32) * (len + 1), GFP_KERNEL);
+	if (ctx.offsets == NULL)
+		return NULL;
+
+	/* fake pass to fill in the ctx->seen and the offsets */
+	if (unlikely(build_body(&ctx)))
+		goto out;
+
+	tmp_idx = ctx.idx;
+	build_prologue(&ctx);
+	ctx.prologue_len = ctx.idx - tmp_idx;
+
+	build_epilogue(&ctx);
+
+	*size = 4 * ctx.idx;
+	ctx.image = module_alloc(max(sizeof(struct work_struct),
+				     (size_t)*size));
+	if (unlikely(ctx.image == NULL))
+		goto out;
+
+	ctx.idx = 0;
+	build_prologue(&ctx);
+	build_body(&ctx);
+	build_epilogue(&ctx);
+
+	flush_icache_range((unsigned long)ctx.image,
+			   (unsigned long)(ctx.image + ctx.idx));
+
+	if (bpf_jit_enable > 1)
+		/* there are 2 passes here */
+		bpf_jit_dump(len, *size, 2, ctx.image);
+
+	image = ctx.image;
+out:
+	kfree(ctx.offsets);
+	return image;
+}
+
+void bpf_jit_compile(struct sk_filter *fp)
+{
+	unsigned int size;
+	void *image;
+
+	if (!bpf_jit_enable)
+		return;
+
+	image = bpf_jit_build(fp->insns, fp->len, &size);
+	if (image)
+		fp->bpf_func = image;
+}
+
+static void bpf_jit_free_worker(struct work_struct *work)
+{
+	module_memfree(work);
+}
+
+/* The image may be released from softirq, module_memfree() can sleep */
+static void bpf_jit_free_image(void *image)
+{
+	struct work_struct *work = image;
+
+	INIT_WORK(work, bpf_jit_free_worker);
+	schedule_work(work);
+}
+
+void bpf_jit_free(struct sk_filter *fp)
+{
+	if (fp->bpf_func != sk_run_filter)
+		bpf_jit_free_image(fp->bpf_func);
+}
+
+#ifdef CONFIG_SECCOMP_FILTER
+/*
+ * Seccomp filters have been through seccomp_check_filter(), so they only
+ * read the syscall data through BPF_S_ANC_SECCOMP_LD_W and never touch
+ * the NULL skb the image is called with.
+ */
+void *seccomp_jit_compile(const struct sock_filter *insns, unsigned int len)
+{
+	unsigned int size;
+
+	if (!bpf_jit_enable)
+		return NULL;
+
+	return bpf_jit_build(insns, len, &size);
+}
+
+void seccomp_jit_free(void *image)
+{
+	bpf_jit_free_image(image);
+}
+#endif
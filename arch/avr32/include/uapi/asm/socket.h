@@ -76,4 +76,6 @@
 
 #define SO_MAX_PACING_RATE	46
 
+#define SO_REUSEPORT_CPU	0x7000
+
 #endif /* __ASM_AVR32_SOCKET_H */
@@ -78,6 +78,8 @@
 
 #define SO_MAX_PACING_RATE	46
 
+#define SO_REUSEPORT_CPU	0x7000
+
 #endif /* _ASM_SOCKET_H */
 
 
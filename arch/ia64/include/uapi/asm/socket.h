@@ -85,4 +85,6 @@
 
 #define SO_MAX_PACING_RATE	46
 
+#define SO_REUSEPORT_CPU	0x7000
+
 #endif /* _ASM_IA64_SOCKET_H */
@@ -72,6 +72,8 @@
 
 #define SO_MAX_PACING_RATE	0x0030
 
+#define SO_REUSEPORT_CPU	0x7000
+
 /* Security levels - as per NRL IPv6 - don't actually do anything */
 #define SO_SECURITY_AUTHENTICATION		0x5001
 #define SO_SECURITY_ENCRYPTION_TRANSPORT	0x5002
@@ -87,4 +87,6 @@
 
 #define SO_MAX_PACING_RATE	46
 
+#define SO_REUSEPORT_CPU	0x7000
+
 #endif	/* _XTENSA_SOCKET_H */
@@ -1073,6 +1073,49 @@ error:
 	bio_io_error(bio);
 }
 
+/*
+ * Single page I/O without a bio, for swap-in from the fault path. The
+ * page is completed only on success; on error the caller retries with a
+ * bio, which accounts the failure.
+ */
+static int zram_rw_page(struct block_device *bdev, sector_t sector,
+			struct page *page, int rw)
+{
+	struct zram *zram = bdev->bd_disk->private_data;
+	struct bio_vec bv;
+	int offset, err;
+	u32 index;
+
+	if (unlikely(!zram_meta_get(zram)))
+		return -EIO;
+
+	if (!valid_io_request(zram, sector, PAGE_SIZE)) {
+		atomic64_inc(&zram->stats.invalid_io);
+		err = -EINVAL;
+		goto put_zram;
+	}
+
+	index = sector >> SECTORS_PER_PAGE_SHIFT;
+	offset = (sector & (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
+
+	bv.bv_page = page;
+	bv.bv_len = PAGE_SIZE;
+	bv.bv_offset = 0;
+
+	err = zram_bvec_rw(zram, &bv, index, offset, rw);
+	if (!err) {
+		if (rw == READ) {
+			SetPageUptodate(page);
+			unlock_page(page);
+		} else {
+			end_page_writeback(page);
+		}
+	}
+put_zram:
+	zram_meta_put(zram);
+	return err;
+}
+
 static void zram_slot_free_notify(struct block_device *bdev,
 				unsigned long index)
 {
@@ -1090,6 +1133,7 @@ static void zram_slot_free_notify(struct block_device *bdev,
 
 static const struct block_device_operations zram_devops = {
 	.swap_slot_free_notify = zram_slot_free_notify,
+	.rw_page = zram_rw_page,
 	.owner = THIS_MODULE
 };
 
@@ -1229,6 +1273,8 @@ static int create_device(struct zram *zram, int device_id)
 	snprintf(zram->disk->disk_name, 16, "zram%d", device_id);
 
 	__set_bit(QUEUE_FLAG_FAST, &zram->disk->queue->queue_flags);
+	/* reads complete in zram_rw_page(), swap-in may skip the swap cache */
+	__set_bit(QUEUE_FLAG_SYNCHRONOUS, &zram->disk->queue->queue_flags);
 	/* Actual capacity set using syfs (/sys/block/zram<id>/disksize */
 	set_capacity(zram->disk, 0);
 	/* zram devices sort of resembles non-rotational disks */
@@ -0,0 +1,395 @@
+/*
+ * predict.c - the residency predicting idle governor
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/module.h>
+
+#define NR_SOURCES	8
+#define NR_BINS		20
+#define MIN_SAMPLES	4
+#define HIST_LIMIT	256
+#define RESOLUTION	1024
+#define EARLY_THRESH	(RESOLUTION / 10)
+
+/*
+ * Concepts and ideas behind the predict governor
+ *
+ * The menu governor scales the next timer event by a correction factor
+ * learned from past idle periods.  Under periodic interrupts that are not
+ * timers on this CPU (display vsync, audio DMA periods, touch reports) the
+ * factor averages over wakeups from unrelated sources, so menu regularly
+ * picks a state that is exited before its target residency is reached.
+ *
+ * Instead this governor keeps, per CPU, a small table of the interrupt
+ * sources seen on that CPU.  For each source it records the time of the
+ * last event and a histogram of the intervals between events, in log2
+ * buckets of microseconds, plus a running mean and mean deviation of the
+ * interval.
+ *
+ * When selecting a state, the next timer event is a hard upper bound.  For
+ * every candidate state the governor then estimates the probability that
+ * any tracked source fires before the state's target residency has elapsed:
+ *
+ *  - a source whose intervals are regular (small deviation) is expected at
+ *    last event + mean interval, give or take twice the deviation;
+ *  - otherwise the histogram, conditioned on the time already elapsed since
+ *    the last event, gives the probability of an event in the window.
+ *
+ * The deepest state whose early wakeup probability stays below
+ * EARLY_THRESH (10%) is chosen.  Sources that have not been seen for longer
+ * than any interval in their history are considered quiet and ignored.
+ */
+
+struct predict_source {
+	unsigned int	irq;
+	unsigned int	samples;
+	u64		last_ns;
+	u32		avg_us;
+	u32		dev_us;
+	u16		total;
+	u16		hist[NR_BINS];
+};
+
+struct predict_device {
+	/* orders the irq hook against enable/disable from another CPU */
+	raw_spinlock_t	lock;
+	bool		enabled;
+	int		last_state_idx;
+	unsigned int	next_timer_us;
+	unsigned int	next_src;
+	struct predict_source src[NR_SOURCES];
+};
+
+static DEFINE_PER_CPU(struct predict_device, predict_devices);
+
+/* bin 0 holds intervals below 1us, bin b >= 1 holds [2^(b-1), 2^b) */
+static inline int interval_bin(u32 us)
+{
+	int bin = fls(us);
+
+	return bin < NR_BINS ? bin : NR_BINS - 1;
+}
+
+static inline u32 bin_low(int bin)
+{
+	return bin ? 1U << (bin - 1) : 0;
+}
+
+static inline u32 bin_high(int bin)
+{
+	return bin < NR_BINS - 1 ? 1U << bin : U32_MAX;
+}
+
+static struct predict_source *predict_find_source(struct predict_device *data,
+						  unsigned int irq)
+{
+	struct predict_source *src;
+	int i;
+
+	for (i = 0; i < NR_SOURCES; i++) {
+		src = &data->src[i];
+		if (src->samples && src->irq == irq)
+			return src;
+	}
+
+	/* evict round robin, a busy source will come back quickly */
+	src = &data->src[data->next_src];
+	data->next_src = (data->next_src + 1) % NR_SOURCES;
+	memset(src, 0, sizeof(*src));
+	src->irq = irq;
+
+	return src;
+}
+
+/**
+ * cpuidle_predict_irq - records an interrupt for the predict governor
+ * @irq: the interrupt that was handled on this CPU
+ *
+ * Called from hard interrupt context on the CPU handling @irq.
+ */
+void cpuidle_predict_irq(unsigned int irq)
+{
+	struct predict_device *data;
+	struct predict_source *src;
+	u64 now;
+	u32 interval_us, diff;
+	int i;
+
+	data = &__get_cpu_var(predict_devices);
+	raw_spin_lock(&data->lock);
+	if (!data->enabled)
+		goto out;
+
+	src = predict_find_source(data, irq);
+	now = local_clock();
+
+	if (!src->samples) {
+		src->samples = 1;
+		src->last_ns = now;
+		goto out;
+	}
+
+	interval_us = (u32)min_t(u64, div_u64(now - src->last_ns,
+					      NSEC_PER_USEC), U32_MAX);
+	src->last_ns = now;
+
+	if (src->total >= HIST_LIMIT) {
+		src->total = 0;
+		for (i = 0; i < NR_BINS; i++) {
+			src->hist[i] >>= 1;
+			src->total += src->hist[i];
+		}
+	}
+	src->hist[interval_bin(interval_us)]++;
+	src->total++;
+
+	/* running averages with a weight of 1/8 for the new sample */
+	if (src->samples == 1) {
+		src->avg_us = interval_us;
+		src->dev_us = interval_us;
+	} else {
+		diff = abs((s32)(interval_us - src->avg_us));
+		src->avg_us += (interval_us >> 3) - (src->avg_us >> 3);
+		src->dev_us += (diff >> 3) - (src->dev_us >> 3);
+	}
+
+	if (src->samples < MIN_SAMPLES)
+		src->samples++;
+out:
+	raw_spin_unlock(&data->lock);
+}
+
+/*
+ * Probability, out of RESOLUTION, that @src fires within @window_us given
+ * that @elapsed_us have passed since its last event.
+ */
+static u32 predict_source_early(struct predict_source *src, u32 elapsed_us,
+				u32 window_us)
+{
+	u32 end_us = elapsed_us + window_us;
+	u32 within = 0, beyond = 0;
+	int bin;
+
+	if (src->samples < MIN_SAMPLES)
+		return 0;
+
+	/* regular source that is not overdue: expect it on time */
+	if (src->dev_us * 8 <= src->avg_us &&
+	    elapsed_us <= src->avg_us + 2 * src->dev_us) {
+		u32 next_us = src->avg_us - min(src->avg_us, elapsed_us);
+
+		return next_us < window_us + 2 * src->dev_us ? RESOLUTION : 0;
+	}
+
+	for (bin = interval_bin(elapsed_us); bin < NR_BINS; bin++) {
+		if (bin_high(bin) <= elapsed_us)
+			continue;
+		if (bin_low(bin) < end_us)
+			within += src->hist[bin];
+		else
+			beyond += src->hist[bin];
+	}
+
+	/* nothing in the history lasts that long, the source went quiet */
+	if (!within && !beyond)
+		return 0;
+
+	return within * RESOLUTION / (within + beyond);
+}
+
+/* Probability, out of RESOLUTION, of any source firing within @window_us */
+static u32 predict_early_wakeup(struct predict_device *data, u64 now,
+				u32 window_us)
+{
+	u32 quiet = RESOLUTION;
+	u32 elapsed_us;
+	int i;
+
+	for (i = 0; i < NR_SOURCES && quiet; i++) {
+		struct predict_source *src = &data->src[i];
+
+		if (!src->samples)
+			continue;
+
+		elapsed_us = (u32)min_t(u64, div_u64(now - src->last_ns,
+						     NSEC_PER_USEC), U32_MAX);
+		quiet = quiet *
+			(RESOLUTION - predict_source_early(src, elapsed_us,
+							   window_us)) /
+			RESOLUTION;
+	}
+
+	return RESOLUTION - quiet;
+}
+
+/*
+ * Drivers that leave target_residency at 0 still need a window per
+ * state; their exit latency is the nearest bound.
+ */
+static inline unsigned int predict_residency(struct cpuidle_state *s)
+{
+	return s->target_residency ? s->target_residency : s->exit_latency;
+}
+
+/**
+ * predict_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static int predict_select(struct cpuidle_driver *drv,
+			  struct cpuidle_device *dev)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+	int latency_req = pm_qos_request_for_cpu(PM_QOS_CPU_DMA_LATENCY,
+						 dev->cpu);
+	u64 now;
+	int i;
+
+	data->last_state_idx = CPUIDLE_DRIVER_STATE_START - 1;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	data->next_timer_us = ktime_to_us(tick_nohz_get_sleep_length());
+	now = local_clock();
+
+	for (i = CPUIDLE_DRIVER_STATE_START; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+		struct cpuidle_state_usage *su = &dev->states_usage[i];
+
+		if (s->disabled || su->disable)
+			continue;
+		if (s->exit_latency > latency_req)
+			continue;
+
+		/* the shallowest usable state is the fallback */
+		if (data->last_state_idx < CPUIDLE_DRIVER_STATE_START) {
+			data->last_state_idx = i;
+			continue;
+		}
+
+		if (predict_residency(s) > data->next_timer_us)
+			continue;
+		if (predict_early_wakeup(data, now, predict_residency(s)) >
+		    EARLY_THRESH)
+			continue;
+
+		data->last_state_idx = i;
+	}
+
+	return data->last_state_idx;
+}
+
+/**
+ * predict_reflect - records the state that was actually entered
+ * @dev: the CPU
+ * @index: the index of actual entered state
+ */
+static void predict_reflect(struct cpuidle_device *dev, int index)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+
+	data->last_state_idx = index;
+}
+
+/**
+ * predict_enable_device - scans a CPU's states and does setup
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int predict_enable_device(struct cpuidle_driver *drv,
+				 struct cpuidle_device *dev)
+{
+	struct predict_device *data = &per_cpu(predict_devices, dev->cpu);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&data->lock, flags);
+	data->last_state_idx = 0;
+	data->next_timer_us = 0;
+	data->next_src = 0;
+	memset(data->src, 0, sizeof(data->src));
+	data->enabled = true;
+	raw_spin_unlock_irqrestore(&data->lock, flags);
+
+	return 0;
+}
+
+/**
+ * predict_disable_device - stops recording interrupts for a CPU
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static void predict_disable_device(struct cpuidle_driver *drv,
+				   struct cpuidle_device *dev)
+{
+	struct predict_device *data = &per_cpu(predict_devices, dev->cpu);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&data->lock, flags);
+	data->enabled = false;
+	raw_spin_unlock_irqrestore(&data->lock, flags);
+}
+
+/**
+ * cpuidle_predict_active - is the predict governor selecting for a CPU
+ * @cpu: the CPU
+ */
+bool cpuidle_predict_active(int cpu)
+{
+	return per_cpu(predict_devices, cpu).enabled;
+}
+
+static struct cpuidle_governor predict_governor = {
+	.name =		"predict",
+	.rating =	15,
+	.enable =	predict_enable_device,
+	.disable =	predict_disable_device,
+	.select =	predict_select,
+	.reflect =	predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_predict - initializes the governor
+ */
+static int __init init_predict(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		raw_spin_lock_init(&per_cpu(predict_devices, cpu).lock);
+
+	return cpuidle_register_governor(&predict_governor);
+}
+
+/**
+ * exit_predict - exits the governor
+ */
+static void __exit exit_predict(void)
+{
+	cpuidle_unregister_governor(&predict_governor);
+}
+
+MODULE_LICENSE("GPL v2");
+module_init(init_predict);
+module_exit(exit_predict);
@@ -35,6 +35,7 @@
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
+#include <linux/cpuidle.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/rpm-notifier.h>
@@ -265,6 +266,14 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		enum msm_pm_sleep_mode mode = level->mode;
 		bool allow;
 
+		/*
+		 * The predict governor's choice is the deepest level allowed,
+		 * to keep the CPU out of levels it expects an early wakeup
+		 * from.  Other governors leave the selection to us.
+		 */
+		if (cpuidle_predict_active(dev->cpu) && i > *index)
+			break;
+
 		allow = lpm_cpu_mode_allow(dev->cpu, mode, true);
 
 		if (!allow)
@@ -774,6 +783,41 @@ static int cpuidle_register_cpu(struct cpuidle_driver *drv,
 }
 #endif
 
+/*
+ * Shortest sleep for which level @idx saves energy over every shallower
+ * level, and never less than its own enter + exit time.  With the model
+ * cpu_power_select() uses, a sleep of t us at a level costs
+ * ss_power * (t - time_overhead_us) + energy_overhead.
+ */
+static uint32_t lpm_cpu_level_residency(struct lpm_cpu *cpu, int idx)
+{
+	struct power_params *pwr = &cpu->levels[idx].pwr;
+	uint32_t residency = pwr->time_overhead_us;
+	s64 fixed, prev_fixed, t;
+	int i;
+
+	fixed = (s64)pwr->energy_overhead -
+			(s64)pwr->time_overhead_us * pwr->ss_power;
+
+	for (i = 0; i < idx; i++) {
+		struct power_params *prev = &cpu->levels[i].pwr;
+
+		if (prev->ss_power <= pwr->ss_power)
+			continue;
+
+		prev_fixed = (s64)prev->energy_overhead -
+				(s64)prev->time_overhead_us * prev->ss_power;
+		if (fixed <= prev_fixed)
+			continue;
+
+		t = div_s64(fixed - prev_fixed,
+			    prev->ss_power - pwr->ss_power);
+		residency = max_t(s64, residency, min_t(s64, t, INT_MAX));
+	}
+
+	return residency;
+}
+
 static int cluster_cpuidle_register(struct lpm_cluster *cl)
 {
 	int i = 0, ret = 0;
@@ -805,7 +849,7 @@ static int cluster_cpuidle_register(struct lpm_cluster *cl)
 		st->flags = 0;
 		st->exit_latency = cpu_level->pwr.latency_us;
 		st->power_usage = cpu_level->pwr.ss_power;
-		st->target_residency = 0;
+		st->target_residency = lpm_cpu_level_residency(cl->cpu, i);
 		st->enter = lpm_cpuidle_enter;
 	}
 
@@ -955,14 +955,29 @@ static void emac_tx_map(struct emac_adapter *adpt,
 	tpbuf->skb = skb;
 }
 
+/* Tell the hardware about the descriptors produced so far */
+static void emac_tx_kick(struct emac_adapter *adpt,
+			 struct emac_tx_queue *txque)
+{
+	struct emac_hw *hw = &adpt->hw;
+	u32 prod_idx;
+
+	prod_idx = (txque->tpd.produce_idx << txque->produce_shft) &
+			txque->produce_mask;
+	wmb(); /* ensure that the descriptors are properly set */
+	emac_reg_update32(hw, EMAC, txque->produce_reg,
+			  txque->produce_mask, prod_idx);
+	wmb();
+	emac_dbg(adpt, tx_queued, "TX[%d]: prod idx 0x%x\n",
+		 txque->que_idx, txque->tpd.produce_idx);
+}
+
 /* Transmit the packet using specified transmit queue */
 static int emac_start_xmit_frame(struct emac_adapter *adpt,
 				 struct emac_tx_queue *txque,
 				 struct sk_buff *skb)
 {
-	struct emac_hw  *hw = &adpt->hw;
 	union emac_sw_tpdesc stpd;
-	u32 prod_idx;
 
 	if (TEST_FLAG(adpt, ADPT_STATE_DOWN)) {
 		dev_kfree_skb_any(skb);
@@ -970,8 +985,11 @@ static int emac_start_xmit_frame(struct emac_adapter *adpt,
 	}
 
 	if (!emac_check_num_tpdescs(txque, skb)) {
-		/* not enough descriptors, just stop queue */
+		/* not enough descriptors, just stop queue; frames deferred
+		 * by xmit_more must still reach the hardware
+		 */
 		netif_stop_queue(adpt->netdev);
+		emac_tx_kick(adpt, txque);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -979,6 +997,7 @@ static int emac_start_xmit_frame(struct emac_adapter *adpt,
 
 	if (emac_tso_csum(adpt, txque, skb, &stpd) != 0) {
 		dev_kfree_skb_any(skb);
+		emac_tx_kick(adpt, txque);
 		return NETDEV_TX_OK;
 	}
 
@@ -997,15 +1016,12 @@ static int emac_start_xmit_frame(struct emac_adapter *adpt,
 
 	netdev_sent_queue(adpt->netdev, skb->len);
 
-	/* update produce idx */
-	prod_idx = (txque->tpd.produce_idx << txque->produce_shft) &
-			txque->produce_mask;
-	wmb(); /* ensure that the descriptors are properly set */
-	emac_reg_update32(hw, EMAC, txque->produce_reg,
-			  txque->produce_mask, prod_idx);
-	wmb();
-	emac_dbg(adpt, tx_queued, "TX[%d]: prod idx 0x%x\n",
-		 txque->que_idx, txque->tpd.produce_idx);
+	/* update produce idx once the stack has nothing more for us, or
+	 * when BQL just stopped the queue and nothing more will come
+	 */
+	if (!skb->xmit_more ||
+	    netif_xmit_stopped(netdev_get_tx_queue(adpt->netdev, 0)))
+		emac_tx_kick(adpt, txque);
 
 	return NETDEV_TX_OK;
 }
@@ -27,6 +27,18 @@
 #include <linux/slab.h>
 #include <linux/cpu.h>
 #include <linux/cpu_cooling.h>
+#include <linux/pm_opp.h>
+#include <linux/rcupdate.h>
+
+/**
+ * struct power_table - frequency to power conversion
+ * @frequency:	frequency in KHz
+ * @power:	dynamic power of one cpu at @frequency and full load, in mW
+ */
+struct power_table {
+	u32 frequency;
+	u32 power;
+};
 
 /**
  * struct cpufreq_cooling_device - data for cooling device with cpufreq
@@ -39,6 +51,13 @@
  * @cpufreq_val: integer value representing the absolute value of the clipped
  *	frequency.
  * @allowed_cpus: all the cpus involved for this cpufreq_cooling_device.
+ * @last_load: sum of the load of the allowed cpus, in percent, at the last
+ *	call of get_requested_power().
+ * @time_in_idle: idle time of each allowed cpu at the last load sample.
+ * @time_in_idle_timestamp: wall time of each allowed cpu at the last sample.
+ * @dyn_power_table: power at each OPP, in ascending frequency order, or
+ *	NULL if the device was registered without a power model.
+ * @dyn_power_table_entries: number of entries in @dyn_power_table.
  *
  * This structure is required for keeping information of each
  * cpufreq_cooling_device registered. In order to prevent corruption of this a
@@ -50,6 +69,11 @@ struct cpufreq_cooling_device {
 	unsigned int cpufreq_state;
 	unsigned int cpufreq_val;
 	struct cpumask allowed_cpus;
+	u32 last_load;
+	u64 *time_in_idle;
+	u64 *time_in_idle_timestamp;
+	struct power_table *dyn_power_table;
+	int dyn_power_table_entries;
 };
 static DEFINE_IDR(cpufreq_idr);
 static DEFINE_MUTEX(cooling_cpufreq_lock);
@@ -402,6 +426,219 @@ static int cpufreq_set_cur_state(struct thermal_cooling_device *cdev,
 	return cpufreq_apply_cooling(cpufreq_device, state);
 }
 
+/* Power model, used by the power_allocator governor */
+
+/**
+ * build_dyn_power_table - create the frequency to power table from the OPPs
+ * @cpufreq_device: cpufreq_cooling_device to fill in
+ * @capacitance: dynamic power coefficient in mW/(MHz mV mV) * 10^9
+ *
+ * Dynamic power is estimated as P = C * f * V^2 for every OPP of the first
+ * allowed cpu.
+ *
+ * Return: 0 on success, an error code otherwise.
+ */
+static int build_dyn_power_table(struct cpufreq_cooling_device *cpufreq_device,
+				 u32 capacitance)
+{
+	struct power_table *power_table;
+	struct opp *opp;
+	struct device *dev;
+	unsigned long freq;
+	int num_opps, i = 0;
+
+	dev = get_cpu_device(cpumask_first(&cpufreq_device->allowed_cpus));
+	if (!dev)
+		return -ENODEV;
+
+	rcu_read_lock();
+	num_opps = dev_pm_opp_get_opp_count(dev);
+	rcu_read_unlock();
+	if (num_opps <= 0)
+		return num_opps ? num_opps : -EINVAL;
+
+	power_table = kcalloc(num_opps, sizeof(*power_table), GFP_KERNEL);
+	if (!power_table)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	for (freq = 0;
+	     i < num_opps &&
+	     !IS_ERR(opp = dev_pm_opp_find_freq_ceil(dev, &freq));
+	     freq++, i++) {
+		u64 power;
+		u32 freq_mhz = freq / 1000000;
+		u32 voltage_mv = dev_pm_opp_get_voltage(opp) / 1000;
+
+		power = (u64)capacitance * freq_mhz * voltage_mv * voltage_mv;
+		do_div(power, 1000000000);
+
+		power_table[i].frequency = freq / 1000;
+		power_table[i].power = power;
+	}
+	rcu_read_unlock();
+
+	if (!i) {
+		kfree(power_table);
+		return -EINVAL;
+	}
+
+	cpufreq_device->dyn_power_table = power_table;
+	cpufreq_device->dyn_power_table_entries = i;
+
+	return 0;
+}
+
+static u32 cpu_freq_to_power(struct cpufreq_cooling_device *cpufreq_device,
+			     u32 freq)
+{
+	struct power_table *pt = cpufreq_device->dyn_power_table;
+	int i;
+
+	for (i = 1; i < cpufreq_device->dyn_power_table_entries; i++)
+		if (freq < pt[i].frequency)
+			break;
+
+	return pt[i - 1].power;
+}
+
+static u32 cpu_power_to_freq(struct cpufreq_cooling_device *cpufreq_device,
+			     u32 power)
+{
+	struct power_table *pt = cpufreq_device->dyn_power_table;
+	int i;
+
+	for (i = 1; i < cpufreq_device->dyn_power_table_entries; i++)
+		if (power < pt[i].power)
+			break;
+
+	return pt[i - 1].frequency;
+}
+
+/**
+ * get_load - load of a cpu since the last call, in percent
+ * @cpufreq_device: cpufreq_cooling_device the cpu belongs to
+ * @cpu: the cpu
+ * @idx: index of @cpu in the allowed cpus, for the sample arrays
+ */
+static u32 get_load(struct cpufreq_cooling_device *cpufreq_device, int cpu,
+		    int idx)
+{
+	u64 now, now_idle, delta_time, delta_idle;
+	u32 load = 0;
+
+	now_idle = get_cpu_idle_time(cpu, &now, 0);
+	delta_idle = now_idle - cpufreq_device->time_in_idle[idx];
+	delta_time = now - cpufreq_device->time_in_idle_timestamp[idx];
+
+	if (delta_time > delta_idle)
+		load = div64_u64(100 * (delta_time - delta_idle), delta_time);
+
+	cpufreq_device->time_in_idle[idx] = now_idle;
+	cpufreq_device->time_in_idle_timestamp[idx] = now;
+
+	return load;
+}
+
+/**
+ * cpufreq_get_requested_power - power the cpus would use unthrottled
+ * @cdev: thermal cooling device pointer.
+ * @power: filled with the power in mW.
+ *
+ * The dynamic power at the current frequency of the cpus, scaled by their
+ * load since the last call.
+ *
+ * Return: 0 on success, an error code otherwise.
+ */
+static int cpufreq_get_requested_power(struct thermal_cooling_device *cdev,
+				       u32 *power)
+{
+	struct cpufreq_cooling_device *cpufreq_device = cdev->devdata;
+	int cpu, i = 0;
+	u32 freq, load, total_load = 0;
+
+	freq = cpufreq_quick_get(cpumask_any(&cpufreq_device->allowed_cpus));
+
+	for_each_cpu(cpu, &cpufreq_device->allowed_cpus) {
+		load = cpu_online(cpu) ? get_load(cpufreq_device, cpu, i) : 0;
+		total_load += load;
+		i++;
+	}
+
+	cpufreq_device->last_load = total_load;
+	*power = cpu_freq_to_power(cpufreq_device, freq) * total_load / 100;
+
+	return 0;
+}
+
+/**
+ * cpufreq_state2power - maximum power of the cpus in a cooling state
+ * @cdev: thermal cooling device pointer.
+ * @state: cooling state.
+ * @power: filled with the power in mW of all online allowed cpus at full
+ *	load and the frequency of @state.
+ *
+ * Return: 0 on success, an error code otherwise.
+ */
+static int cpufreq_state2power(struct thermal_cooling_device *cdev,
+			       unsigned long state, u32 *power)
+{
+	struct cpufreq_cooling_device *cpufreq_device = cdev->devdata;
+	struct cpumask online;
+	unsigned int freq;
+
+	cpumask_and(&online, &cpufreq_device->allowed_cpus, cpu_online_mask);
+	if (cpumask_empty(&online)) {
+		*power = 0;
+		return 0;
+	}
+
+	freq = get_cpu_frequency(cpumask_first(&online), state);
+	if (!freq)
+		return -EINVAL;
+
+	*power = cpu_freq_to_power(cpufreq_device, freq) *
+		cpumask_weight(&online);
+
+	return 0;
+}
+
+/**
+ * cpufreq_power2state - least throttled state within a power budget
+ * @cdev: thermal cooling device pointer.
+ * @power: the budget in mW.
+ * @state: filled with the cooling state.
+ *
+ * The budget is normalised by the load seen by the last call of
+ * get_requested_power(), so lightly loaded cpus may run at a higher
+ * frequency for the same budget.
+ *
+ * Return: 0 on success, an error code otherwise.
+ */
+static int cpufreq_power2state(struct thermal_cooling_device *cdev,
+			       u32 power, unsigned long *state)
+{
+	struct cpufreq_cooling_device *cpufreq_device = cdev->devdata;
+	unsigned int cpu = cpumask_any(&cpufreq_device->allowed_cpus);
+	u32 normalised_power, target_freq;
+	unsigned long level;
+
+	if (!cpufreq_device->last_load)
+		cpufreq_device->last_load = 100;
+
+	normalised_power = div_u64((u64)power * 100,
+				   cpufreq_device->last_load);
+	target_freq = cpu_power_to_freq(cpufreq_device, normalised_power);
+
+	level = cpufreq_cooling_get_level(cpu, target_freq);
+	if (level == THERMAL_CSTATE_INVALID)
+		return -EINVAL;
+
+	*state = level;
+
+	return 0;
+}
+
 /* Bind cpufreq callbacks to thermal cooling device ops */
 static struct thermal_cooling_device_ops const cpufreq_cooling_ops = {
 	.get_max_state = cpufreq_get_max_state,
@@ -409,27 +646,43 @@ static struct thermal_cooling_device_ops const cpufreq_cooling_ops = {
 	.set_cur_state = cpufreq_set_cur_state,
 };
 
+static struct thermal_cooling_device_ops const cpufreq_power_cooling_ops = {
+	.get_max_state = cpufreq_get_max_state,
+	.get_cur_state = cpufreq_get_cur_state,
+	.set_cur_state = cpufreq_set_cur_state,
+	.get_requested_power = cpufreq_get_requested_power,
+	.state2power = cpufreq_state2power,
+	.power2state = cpufreq_power2state,
+};
+
 /* Notifier for cpufreq policy change */
 static struct notifier_block thermal_cpufreq_notifier_block = {
 	.notifier_call = cpufreq_thermal_notifier,
 };
 
+static void cpufreq_cooling_free(struct cpufreq_cooling_device *cpufreq_dev)
+{
+	kfree(cpufreq_dev->dyn_power_table);
+	kfree(cpufreq_dev->time_in_idle);
+	kfree(cpufreq_dev);
+}
+
 /**
- * cpufreq_cooling_register - function to create cpufreq cooling device.
+ * __cpufreq_cooling_register - helper function to create cpufreq cooling device
  * @clip_cpus: cpumask of cpus where the frequency constraints will happen.
- *
- * This interface function registers the cpufreq cooling device with the name
- * "thermal-cpufreq-%x". This api can support multiple instances of cpufreq
- * cooling devices.
+ * @capacitance: dynamic power coefficient of the cpus, or 0 to register
+ *	the device without a power model.
  *
  * Return: a valid struct thermal_cooling_device pointer on success,
  * on failure, it returns a corresponding ERR_PTR().
  */
-struct thermal_cooling_device *
-cpufreq_cooling_register(const struct cpumask *clip_cpus)
+static struct thermal_cooling_device *
+__cpufreq_cooling_register(const struct cpumask *clip_cpus, u32 capacitance)
 {
 	struct thermal_cooling_device *cool_dev;
 	struct cpufreq_cooling_device *cpufreq_dev = NULL;
+	const struct thermal_cooling_device_ops *cooling_ops =
+		&cpufreq_cooling_ops;
 	unsigned int min = 0, max = 0;
 	char dev_name[THERMAL_NAME_LENGTH];
 	int ret = 0, i;
@@ -456,9 +709,28 @@ cpufreq_cooling_register(const struct cpumask *clip_cpus)
 
 	cpumask_copy(&cpufreq_dev->allowed_cpus, clip_cpus);
 
+	if (capacitance) {
+		i = cpumask_weight(clip_cpus);
+		cpufreq_dev->time_in_idle = kcalloc(2 * i, sizeof(u64),
+						    GFP_KERNEL);
+		if (!cpufreq_dev->time_in_idle) {
+			kfree(cpufreq_dev);
+			return ERR_PTR(-ENOMEM);
+		}
+		cpufreq_dev->time_in_idle_timestamp =
+			&cpufreq_dev->time_in_idle[i];
+
+		ret = build_dyn_power_table(cpufreq_dev, capacitance);
+		if (ret) {
+			cpufreq_cooling_free(cpufreq_dev);
+			return ERR_PTR(ret);
+		}
+		cooling_ops = &cpufreq_power_cooling_ops;
+	}
+
 	ret = get_idr(&cpufreq_idr, &cpufreq_dev->id);
 	if (ret) {
-		kfree(cpufreq_dev);
+		cpufreq_cooling_free(cpufreq_dev);
 		return ERR_PTR(-EINVAL);
 	}
 
@@ -466,10 +738,10 @@ cpufreq_cooling_register(const struct cpumask *clip_cpus)
 		 cpufreq_dev->id);
 
 	cool_dev = thermal_cooling_device_register(dev_name, cpufreq_dev,
-						   &cpufreq_cooling_ops);
+						   cooling_ops);
 	if (!cool_dev) {
 		release_idr(&cpufreq_idr, cpufreq_dev->id);
-		kfree(cpufreq_dev);
+		cpufreq_cooling_free(cpufreq_dev);
 		return ERR_PTR(-EINVAL);
 	}
 	cpufreq_dev->cool_dev = cool_dev;
@@ -486,8 +758,49 @@ cpufreq_cooling_register(const struct cpumask *clip_cpus)
 
 	return cool_dev;
 }
+
+/**
+ * cpufreq_cooling_register - function to create cpufreq cooling device.
+ * @clip_cpus: cpumask of cpus where the frequency constraints will happen.
+ *
+ * This interface function registers the cpufreq cooling device with the name
+ * "thermal-cpufreq-%x". This api can support multiple instances of cpufreq
+ * cooling devices.
+ *
+ * Return: a valid struct thermal_cooling_device pointer on success,
+ * on failure, it returns a corresponding ERR_PTR().
+ */
+struct thermal_cooling_device *
+cpufreq_cooling_register(const struct cpumask *clip_cpus)
+{
+	return __cpufreq_cooling_register(clip_cpus, 0);
+}
 EXPORT_SYMBOL_GPL(cpufreq_cooling_register);
 
+/**
+ * cpufreq_power_cooling_register - create cpufreq cooling device with power
+ * @clip_cpus: cpumask of cpus where the frequency constraints will happen.
+ * @capacitance: dynamic power coefficient of the cpus, in
+ *	mW/(MHz mV mV) * 10^9, used with the OPPs of the first cpu in
+ *	@clip_cpus to build the power model.
+ *
+ * Like cpufreq_cooling_register(), but the cooling device also implements
+ * the power callbacks used by the power_allocator governor.
+ *
+ * Return: a valid struct thermal_cooling_device pointer on success,
+ * on failure, it returns a corresponding ERR_PTR().
+ */
+struct thermal_cooling_device *
+cpufreq_power_cooling_register(const struct cpumask *clip_cpus,
+			       u32 capacitance)
+{
+	if (!capacitance)
+		return ERR_PTR(-EINVAL);
+
+	return __cpufreq_cooling_register(clip_cpus, capacitance);
+}
+EXPORT_SYMBOL_GPL(cpufreq_power_cooling_register);
+
 /**
  * cpufreq_cooling_unregister - function to remove cpufreq cooling device.
  * @cdev: thermal cooling device pointer.
@@ -509,6 +822,6 @@ void cpufreq_cooling_unregister(struct thermal_cooling_device *cdev)
 
 	thermal_cooling_device_unregister(cpufreq_dev->cool_dev);
 	release_idr(&cpufreq_idr, cpufreq_dev->id);
-	kfree(cpufreq_dev);
+	cpufreq_cooling_free(cpufreq_dev);
 }
 EXPORT_SYMBOL_GPL(cpufreq_cooling_unregister);
@@ -48,6 +48,7 @@
 #include <soc/qcom/msm-core.h>
 #include <linux/cpumask.h>
 #include <linux/suspend.h>
+#include <linux/cpu_cooling.h>
 
 #define CREATE_TRACE_POINTS
 #define TRACE_MSM_THERMAL
@@ -58,6 +59,8 @@
 #define TSENS_NAME_FORMAT "tsens_tz_sensor%d"
 #define THERM_SECURE_BITE_CMD 8
 #define SENSOR_SCALING_FACTOR 1
+#define POWER_ALLOC_TZ_NAME "msm_power_alloc"
+#define POWER_ALLOC_POLL_MS 1000
 #define MSM_THERMAL_NAME "msm_thermal"
 #define MSM_TSENS_PRINT  "log_tsens_temperature"
 #define CPU_BUF_SIZE 64
@@ -128,6 +131,7 @@ static bool gfx_crit_phase_ctrl_enabled;
 static bool gfx_warm_phase_ctrl_enabled;
 static bool cx_phase_ctrl_enabled;
 static bool vdd_mx_enabled;
+static bool power_alloc_enabled;
 static bool therm_reset_enabled;
 static bool online_core;
 static bool cluster_info_probed;
@@ -5795,6 +5799,228 @@ PROBE_FREQ_EXIT:
 	return ret;
 }
 
+static uint32_t power_alloc_cnt;
+static uint32_t *power_alloc_capacitance;
+static struct thermal_cooling_device **power_alloc_cdev;
+static struct thermal_zone_device *power_alloc_tz;
+static struct thermal_zone_params power_alloc_tzp;
+
+static int power_alloc_get_temp(struct thermal_zone_device *tz,
+		unsigned long *temp)
+{
+	long val = 0;
+	int ret = 0;
+
+	ret = therm_get_temp(msm_thermal_info.power_alloc_sensor_id,
+			THERM_TSENS_ID, &val);
+	if (ret)
+		return ret;
+	*temp = max(val, 0L);
+
+	return 0;
+}
+
+static int power_alloc_get_trip_type(struct thermal_zone_device *tz,
+		int trip, enum thermal_trip_type *type)
+{
+	if (trip < 0 || trip > 1)
+		return -EINVAL;
+
+	*type = THERMAL_TRIP_PASSIVE;
+	return 0;
+}
+
+static int power_alloc_get_trip_temp(struct thermal_zone_device *tz,
+		int trip, unsigned long *temp)
+{
+	switch (trip) {
+	case 0:
+		*temp = msm_thermal_info.power_alloc_switch_on_degC;
+		break;
+	case 1:
+		*temp = msm_thermal_info.power_alloc_control_degC;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct thermal_zone_device_ops power_alloc_zone_ops = {
+	.get_temp = power_alloc_get_temp,
+	.get_trip_type = power_alloc_get_trip_type,
+	.get_trip_temp = power_alloc_get_trip_temp,
+};
+
+static void power_alloc_cleanup(void)
+{
+	int i = 0;
+
+	for (i = 0; power_alloc_cdev && i < power_alloc_cnt; i++) {
+		if (!power_alloc_cdev[i])
+			continue;
+		if (power_alloc_tz) {
+			thermal_zone_unbind_cooling_device(power_alloc_tz, 0,
+				power_alloc_cdev[i]);
+			thermal_zone_unbind_cooling_device(power_alloc_tz, 1,
+				power_alloc_cdev[i]);
+		}
+		cpufreq_cooling_unregister(power_alloc_cdev[i]);
+	}
+	kfree(power_alloc_cdev);
+	power_alloc_cdev = NULL;
+	if (power_alloc_tz) {
+		thermal_zone_device_unregister(power_alloc_tz);
+		power_alloc_tz = NULL;
+	}
+}
+
+/*
+ * Register every CPU cluster as a power actor of one zone run by the
+ * power_allocator governor.  This needs the cpufreq policies and the OPP
+ * tables, so it is done from late init rather than from probe.
+ */
+static int power_alloc_init(void)
+{
+	struct thermal_cooling_device *cdev = NULL;
+	const struct cpumask *mask = NULL;
+	uint32_t cluster_cnt = 1;
+	int i = 0, trip = 0, ret = 0;
+
+	if (!power_alloc_enabled)
+		return 0;
+
+	if (core_ptr)
+		cluster_cnt = core_ptr->entity_count;
+	if (power_alloc_cnt < cluster_cnt) {
+		pr_err("%u capacitance values for %u clusters\n",
+			power_alloc_cnt, cluster_cnt);
+		ret = -EINVAL;
+		goto power_alloc_exit;
+	}
+	power_alloc_cnt = cluster_cnt;
+
+	strlcpy(power_alloc_tzp.governor_name, "power_allocator",
+		THERMAL_NAME_LENGTH);
+	power_alloc_tzp.sustainable_power =
+		msm_thermal_info.power_alloc_sustainable_mw;
+	power_alloc_tz = thermal_zone_device_register(POWER_ALLOC_TZ_NAME, 2,
+		0, NULL, &power_alloc_zone_ops, &power_alloc_tzp,
+		msm_thermal_info.poll_ms, POWER_ALLOC_POLL_MS);
+	if (IS_ERR(power_alloc_tz)) {
+		ret = PTR_ERR(power_alloc_tz);
+		power_alloc_tz = NULL;
+		goto power_alloc_exit;
+	}
+
+	power_alloc_cdev = kcalloc(power_alloc_cnt,
+		sizeof(*power_alloc_cdev), GFP_KERNEL);
+	if (!power_alloc_cdev) {
+		ret = -ENOMEM;
+		goto power_alloc_exit;
+	}
+
+	for (i = 0; i < power_alloc_cnt; i++) {
+		mask = core_ptr ? &core_ptr->child_entity_ptr[i].cluster_cores
+			: cpu_possible_mask;
+		cdev = cpufreq_power_cooling_register(mask,
+			power_alloc_capacitance[i]);
+		if (IS_ERR_OR_NULL(cdev)) {
+			ret = cdev ? PTR_ERR(cdev) : -ENODEV;
+			pr_err("Power actor for cluster:%d failed. err:%d\n",
+				i, ret);
+			goto power_alloc_exit;
+		}
+		power_alloc_cdev[i] = cdev;
+
+		for (trip = 0; trip < 2; trip++) {
+			ret = thermal_zone_bind_cooling_device(power_alloc_tz,
+				trip, cdev, THERMAL_NO_LIMIT,
+				THERMAL_NO_LIMIT);
+			if (ret)
+				goto power_alloc_exit;
+		}
+	}
+	thermal_zone_device_update(power_alloc_tz);
+
+power_alloc_exit:
+	if (ret) {
+		power_alloc_cleanup();
+		power_alloc_enabled = false;
+	}
+	return ret;
+}
+
+/*
+ * The power allocator zone takes over the CPU frequency below the KTM
+ * limit; the polling and interrupt based KTM mitigation stays in place as
+ * a backstop, so the control temperature has to be below qcom,limit-temp.
+ */
+static int probe_power_alloc(struct device_node *node,
+		struct msm_thermal_data *data,
+		struct platform_device *pdev)
+{
+	char *key = NULL;
+	int ret = 0, len = 0;
+
+	key = "qcom,power-alloc-sensor-id";
+	ret = of_property_read_u32(node, key, &data->power_alloc_sensor_id);
+	if (ret)
+		goto PROBE_POWER_ALLOC_EXIT;
+
+	key = "qcom,power-alloc-switch-on-temp";
+	ret = of_property_read_u32(node, key,
+		&data->power_alloc_switch_on_degC);
+	if (ret)
+		goto PROBE_POWER_ALLOC_EXIT;
+
+	key = "qcom,power-alloc-control-temp";
+	ret = of_property_read_u32(node, key, &data->power_alloc_control_degC);
+	if (ret)
+		goto PROBE_POWER_ALLOC_EXIT;
+	if (data->power_alloc_control_degC <=
+		data->power_alloc_switch_on_degC ||
+		data->power_alloc_control_degC >= data->limit_temp_degC) {
+		ret = -EINVAL;
+		goto PROBE_POWER_ALLOC_EXIT;
+	}
+
+	key = "qcom,power-alloc-sustainable-power";
+	ret = of_property_read_u32(node, key,
+		&data->power_alloc_sustainable_mw);
+	if (ret)
+		goto PROBE_POWER_ALLOC_EXIT;
+
+	key = "qcom,power-alloc-capacitance";
+	if (!of_get_property(node, key, &len) || len <= 0) {
+		ret = -EINVAL;
+		goto PROBE_POWER_ALLOC_EXIT;
+	}
+	power_alloc_cnt = len / sizeof(__be32);
+	power_alloc_capacitance = devm_kzalloc(&pdev->dev,
+		sizeof(uint32_t) * power_alloc_cnt, GFP_KERNEL);
+	if (!power_alloc_capacitance) {
+		ret = -ENOMEM;
+		goto PROBE_POWER_ALLOC_EXIT;
+	}
+	ret = of_property_read_u32_array(node, key, power_alloc_capacitance,
+		power_alloc_cnt);
+	if (ret)
+		goto PROBE_POWER_ALLOC_EXIT;
+
+	power_alloc_enabled = true;
+
+PROBE_POWER_ALLOC_EXIT:
+	if (ret) {
+		dev_info(&pdev->dev,
+		"%s:Failed reading node=%s, key=%s. err=%d. KTM continues\n",
+			__func__, node->full_name, key, ret);
+		power_alloc_enabled = false;
+	}
+	return ret;
+}
+
 static int msm_thermal_dev_probe(struct platform_device *pdev)
 {
 	int ret = 0;
@@ -5851,6 +6077,7 @@ static int msm_thermal_dev_probe(struct platform_device *pdev)
 	ret = probe_cx_phase_ctrl(node, &data, pdev);
 	ret = probe_gfx_phase_ctrl(node, &data, pdev);
 	ret = probe_therm_reset(node, &data, pdev);
+	ret = probe_power_alloc(node, &data, pdev);
 
 	ret = probe_vdd_mx(node, &data, pdev);
 	if (ret == -EPROBE_DEFER)
@@ -5924,6 +6151,10 @@ static int msm_thermal_dev_exit(struct platform_device *inp_dev)
 	if (msm_therm_debugfs && msm_therm_debugfs->parent)
 		debugfs_remove_recursive(msm_therm_debugfs->parent);
 	msm_thermal_ioctl_cleanup();
+	if (power_alloc_enabled) {
+		power_alloc_cleanup();
+		power_alloc_enabled = false;
+	}
 	if (thresh) {
 		if (therm_reset_enabled)
 			sensor_mgr_remove_threshold(&inp_dev->dev,
@@ -6002,6 +6233,7 @@ int __init msm_thermal_late_init(void)
 	create_cpu_topology_sysfs();
 	create_thermal_debugfs();
 	msm_thermal_add_bucket_info_nodes();
+	power_alloc_init();
 	return 0;
 }
 late_initcall(msm_thermal_late_init);
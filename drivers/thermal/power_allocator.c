@@ -0,0 +1,441 @@
+/*
+ *  power_allocator.c - A closed loop power budget thermal governor
+ *
+ *  Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ *  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+
+#include <linux/thermal.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+
+#include "thermal_core.h"
+
+/**
+ * struct power_allocator_params - per zone state of the governor
+ * @err_integral:	accumulated error of the PID controller
+ * @prev_err:		error of the previous iteration, for the derivative
+ * @trip_switch_on:	first passive trip, below which nothing is capped,
+ *			or THERMAL_TRIPS_NONE to always control
+ * @trip_control:	last passive trip, the temperature to control to
+ * @sustainable_power:	power budget at the control temperature, in mW
+ * @k_po, @k_pu, @k_i, @k_d: PID gains, see struct thermal_zone_params
+ * @num_actors:		power actors on the control trip at the last estimate
+ */
+struct power_allocator_params {
+	s64 err_integral;
+	s32 prev_err;
+	int trip_switch_on;
+	int trip_control;
+	u32 sustainable_power;
+	s32 k_po;
+	s32 k_pu;
+	s32 k_i;
+	s32 k_d;
+	int num_actors;
+};
+
+static bool cdev_is_power_actor(struct thermal_cooling_device *cdev)
+{
+	return cdev->ops->get_requested_power && cdev->ops->state2power &&
+		cdev->ops->power2state;
+}
+
+/* weight of @cdev in the zone, in percent, defaulting to 100 */
+static int get_actor_weight(struct thermal_zone_device *tz,
+			    struct thermal_cooling_device *cdev)
+{
+	const struct thermal_zone_params *tzp = tz->tzp;
+	int i;
+
+	if (!tzp || !tzp->tbp)
+		return 100;
+
+	for (i = 0; i < tzp->num_tbps; i++)
+		if (tzp->tbp[i].cdev == cdev && tzp->tbp[i].weight)
+			return tzp->tbp[i].weight;
+
+	return 100;
+}
+
+/* Sum of the power the actors consume in their most throttled state */
+static u32 estimate_sustainable_power(struct thermal_zone_device *tz,
+				      int trip)
+{
+	struct thermal_instance *instance;
+	struct thermal_cooling_device *cdev;
+	unsigned long max_state;
+	u32 power, sustainable_power = 0;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		cdev = instance->cdev;
+		if (instance->trip != trip || !cdev_is_power_actor(cdev))
+			continue;
+		if (cdev->ops->get_max_state(cdev, &max_state))
+			continue;
+		if (cdev->ops->state2power(cdev, max_state, &power))
+			continue;
+
+		sustainable_power += power;
+	}
+
+	return sustainable_power;
+}
+
+/*
+ * Derive the missing controller parameters.  The proportional term alone
+ * should take the budget from twice the sustainable power at the switch on
+ * temperature down to the sustainable power at the control temperature.
+ */
+static void estimate_pid_constants(struct thermal_zone_device *tz,
+				   struct power_allocator_params *params)
+{
+	const struct thermal_zone_params *tzp = tz->tzp;
+	unsigned long switch_on_temp, control_temp;
+	s32 temperature_threshold = 1;
+
+	params->sustainable_power = tzp ? tzp->sustainable_power : 0;
+	params->k_po = tzp ? tzp->k_po : 0;
+	params->k_pu = tzp ? tzp->k_pu : 0;
+	params->k_i = tzp ? tzp->k_i : 0;
+	params->k_d = tzp ? tzp->k_d : 0;
+
+	if (!params->sustainable_power)
+		params->sustainable_power =
+			estimate_sustainable_power(tz, params->trip_control);
+
+	if (params->trip_switch_on != THERMAL_TRIPS_NONE &&
+	    !tz->ops->get_trip_temp(tz, params->trip_switch_on,
+				    &switch_on_temp) &&
+	    !tz->ops->get_trip_temp(tz, params->trip_control, &control_temp) &&
+	    control_temp > switch_on_temp)
+		temperature_threshold = control_temp - switch_on_temp;
+
+	if (!params->k_po)
+		params->k_po = params->sustainable_power /
+			temperature_threshold;
+	if (!params->k_pu)
+		params->k_pu = 2 * params->sustainable_power /
+			temperature_threshold;
+	if (!params->k_i)
+		params->k_i = params->k_pu / 10;
+}
+
+static struct power_allocator_params *
+power_allocator_bind(struct thermal_zone_device *tz)
+{
+	struct power_allocator_params *params;
+	enum thermal_trip_type type;
+	int i, first = THERMAL_TRIPS_NONE, last = THERMAL_TRIPS_NONE;
+
+	for (i = 0; i < tz->trips; i++) {
+		if (tz->ops->get_trip_type(tz, i, &type))
+			continue;
+		if (type != THERMAL_TRIP_PASSIVE)
+			continue;
+		if (first == THERMAL_TRIPS_NONE)
+			first = i;
+		last = i;
+	}
+
+	if (last == THERMAL_TRIPS_NONE) {
+		dev_warn(&tz->device,
+			 "power_allocator: zone has no passive trip point\n");
+		return ERR_PTR(-EINVAL);
+	}
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	if (!params)
+		return ERR_PTR(-ENOMEM);
+
+	params->trip_control = last;
+	params->trip_switch_on = first != last ? first : THERMAL_TRIPS_NONE;
+	estimate_pid_constants(tz, params);
+
+	tz->governor_data = params;
+
+	return params;
+}
+
+static void power_allocator_unbind(struct thermal_zone_device *tz)
+{
+	kfree(tz->governor_data);
+	tz->governor_data = NULL;
+}
+
+/**
+ * pid_controller() - compute the power budget of the zone
+ * @tz:			thermal zone
+ * @params:		state of the governor for @tz
+ * @control_temp:	the temperature to control to
+ * @max_allocatable_power: power all actors can consume when unthrottled
+ *
+ * Return: the power budget in mW, clamped to [0, max_allocatable_power].
+ */
+static u32 pid_controller(struct thermal_zone_device *tz,
+			  struct power_allocator_params *params,
+			  unsigned long control_temp, u32 max_allocatable_power)
+{
+	const struct thermal_zone_params *tzp = tz->tzp;
+	s64 p, i, d, power_range;
+	s32 err;
+	int delay_ms = tz->passive_delay ? tz->passive_delay : 1000;
+
+	err = (s32)control_temp - tz->temperature;
+
+	p = (s64)(err < 0 ? params->k_po : params->k_pu) * err;
+
+	/*
+	 * Only integrate small errors, and stop integrating once the
+	 * integral alone would allow the maximum power (anti windup).
+	 */
+	i = (s64)params->k_i * params->err_integral;
+	if ((!tzp || !tzp->integral_cutoff || err < tzp->integral_cutoff) &&
+	    i < max_allocatable_power) {
+		params->err_integral += err;
+		i = (s64)params->k_i * params->err_integral;
+	}
+
+	d = div_s64((s64)params->k_d * (err - params->prev_err) * MSEC_PER_SEC,
+		    delay_ms);
+	params->prev_err = err;
+
+	power_range = params->sustainable_power + p + i + d;
+
+	return clamp_t(s64, power_range, 0, max_allocatable_power);
+}
+
+/**
+ * divvy_up_power() - split the budget between the actors
+ * @req_power:		power each actor requests, scaled by its weight
+ * @max_power:		power each actor can consume when unthrottled
+ * @num_actors:		number of entries in the arrays
+ * @total_req_power:	sum of @req_power
+ * @power_range:	the budget to share
+ * @granted_power:	output, the power granted to each actor
+ * @extra_actor_power:	scratch space of @num_actors entries
+ *
+ * Each actor first gets a share of the budget in proportion to what it
+ * requested.  Whatever exceeds an actor's maximum power is then given to
+ * the actors that still have headroom, in proportion to that headroom.
+ */
+static void divvy_up_power(u32 *req_power, u32 *max_power, int num_actors,
+			   u32 total_req_power, u32 power_range,
+			   u32 *granted_power, u32 *extra_actor_power)
+{
+	u32 extra_power = 0, capped_extra_power = 0;
+	int i;
+
+	if (!total_req_power)
+		extra_power = power_range;
+
+	for (i = 0; i < num_actors; i++) {
+		u64 granted = 0;
+
+		if (total_req_power)
+			granted = div_u64((u64)req_power[i] * power_range,
+					  total_req_power);
+
+		if (granted > max_power[i]) {
+			extra_power += granted - max_power[i];
+			granted = max_power[i];
+		}
+
+		granted_power[i] = granted;
+		extra_actor_power[i] = max_power[i] - granted_power[i];
+		capped_extra_power += extra_actor_power[i];
+	}
+
+	if (!extra_power || !capped_extra_power)
+		return;
+
+	extra_power = min(extra_power, capped_extra_power);
+	for (i = 0; i < num_actors; i++)
+		granted_power[i] += div_u64((u64)extra_power *
+					    extra_actor_power[i],
+					    capped_extra_power);
+}
+
+static int allocate_power(struct thermal_zone_device *tz,
+			  struct power_allocator_params *params,
+			  unsigned long control_temp)
+{
+	struct thermal_instance *instance;
+	struct thermal_cooling_device *cdev;
+	u32 *req_power, *max_power, *granted_power, *extra_actor_power;
+	u32 total_req_power = 0, max_allocatable_power = 0, power_range;
+	unsigned long state;
+	int i, num_actors = 0;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node)
+		if (instance->trip == params->trip_control &&
+		    cdev_is_power_actor(instance->cdev))
+			num_actors++;
+
+	if (!num_actors)
+		return -ENODEV;
+
+	/*
+	 * Cooling devices usually bind after the zone is registered, and
+	 * may come and go later: estimate again from the current set.
+	 */
+	if (num_actors != params->num_actors || !params->sustainable_power) {
+		params->num_actors = num_actors;
+		estimate_pid_constants(tz, params);
+	}
+
+	req_power = kcalloc(num_actors * 4, sizeof(u32), GFP_KERNEL);
+	if (!req_power)
+		return -ENOMEM;
+
+	max_power = &req_power[num_actors];
+	granted_power = &req_power[2 * num_actors];
+	extra_actor_power = &req_power[3 * num_actors];
+
+	i = 0;
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		cdev = instance->cdev;
+		if (instance->trip != params->trip_control ||
+		    !cdev_is_power_actor(cdev))
+			continue;
+
+		if (cdev->ops->get_requested_power(cdev, &req_power[i]))
+			req_power[i] = 0;
+		req_power[i] = div_u64((u64)req_power[i] *
+				       get_actor_weight(tz, cdev), 100);
+		if (cdev->ops->state2power(cdev, instance->lower,
+					   &max_power[i]))
+			max_power[i] = 0;
+
+		total_req_power += req_power[i];
+		max_allocatable_power += max_power[i];
+		i++;
+	}
+
+	power_range = pid_controller(tz, params, control_temp,
+				     max_allocatable_power);
+
+	divvy_up_power(req_power, max_power, num_actors, total_req_power,
+		       power_range, granted_power, extra_actor_power);
+
+	i = 0;
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		cdev = instance->cdev;
+		if (instance->trip != params->trip_control ||
+		    !cdev_is_power_actor(cdev))
+			continue;
+
+		if (!cdev->ops->power2state(cdev, granted_power[i], &state)) {
+			instance->target = clamp(state, instance->lower,
+						 instance->upper);
+			cdev->updated = false;
+			thermal_cdev_update(cdev);
+		}
+		i++;
+	}
+
+	kfree(req_power);
+
+	return 0;
+}
+
+static void allow_maximum_power(struct thermal_zone_device *tz,
+				struct power_allocator_params *params)
+{
+	struct thermal_instance *instance;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		if (instance->trip != params->trip_control ||
+		    !cdev_is_power_actor(instance->cdev))
+			continue;
+
+		instance->target = instance->lower;
+		instance->cdev->updated = false;
+		thermal_cdev_update(instance->cdev);
+	}
+}
+
+/**
+ * power_allocator_throttle - throttles devices associated with the given zone
+ * @tz - thermal_zone_device
+ * @trip - the trip point
+ *
+ * Throttling Logic: Below the switch on temperature nothing is capped.
+ * Above it, a PID controller turns the difference between the control
+ * temperature and the current temperature into a power budget on each
+ * poll, so the caps move smoothly instead of in steps at trip points.
+ * The budget is shared between the cooling devices bound to the control
+ * trip in proportion to their weighted requested power.
+ */
+static int power_allocator_throttle(struct thermal_zone_device *tz, int trip)
+{
+	struct power_allocator_params *params;
+	unsigned long switch_on_temp, control_temp;
+	int ret = 0;
+
+	mutex_lock(&tz->lock);
+
+	params = tz->governor_data;
+	if (!params) {
+		params = power_allocator_bind(tz);
+		if (IS_ERR(params)) {
+			ret = PTR_ERR(params);
+			goto unlock;
+		}
+	}
+
+	/* all the work is done once per update, on the control trip */
+	if (trip != params->trip_control)
+		goto unlock;
+
+	ret = tz->ops->get_trip_temp(tz, params->trip_control, &control_temp);
+	if (ret)
+		goto unlock;
+
+	if (params->trip_switch_on != THERMAL_TRIPS_NONE &&
+	    !tz->ops->get_trip_temp(tz, params->trip_switch_on,
+				    &switch_on_temp) &&
+	    tz->temperature < (long)switch_on_temp) {
+		params->err_integral = 0;
+		params->prev_err = 0;
+		tz->passive = 0;
+		allow_maximum_power(tz, params);
+		goto unlock;
+	}
+
+	/* poll at passive_delay while controlling */
+	tz->passive = 1;
+	ret = allocate_power(tz, params, control_temp);
+
+unlock:
+	mutex_unlock(&tz->lock);
+	return ret;
+}
+
+static struct thermal_governor thermal_gov_power_allocator = {
+	.name		= "power_allocator",
+	.throttle	= power_allocator_throttle,
+	.unbind_from_tz	= power_allocator_unbind,
+};
+
+int thermal_gov_power_allocator_register(void)
+{
+	return thermal_register_governor(&thermal_gov_power_allocator);
+}
+
+void thermal_gov_power_allocator_unregister(void)
+{
+	thermal_unregister_governor(&thermal_gov_power_allocator);
+}
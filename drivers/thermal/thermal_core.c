@@ -68,6 +68,17 @@ static struct thermal_governor *__find_governor(const char *name)
 	return NULL;
 }
 
+/* Must be called with thermal_governor_lock held */
+static void thermal_set_governor(struct thermal_zone_device *tz,
+				 struct thermal_governor *new_gov)
+{
+	mutex_lock(&tz->lock);
+	if (tz->governor && tz->governor->unbind_from_tz)
+		tz->governor->unbind_from_tz(tz);
+	tz->governor = new_gov;
+	mutex_unlock(&tz->lock);
+}
+
 int thermal_register_governor(struct thermal_governor *governor)
 {
 	int err;
@@ -95,7 +106,7 @@ int thermal_register_governor(struct thermal_governor *governor)
 		else
 			name = DEFAULT_THERMAL_GOVERNOR;
 		if (!strnicmp(name, governor->name, THERMAL_NAME_LENGTH))
-			pos->governor = governor;
+			thermal_set_governor(pos, governor);
 	}
 
 	mutex_unlock(&thermal_list_lock);
@@ -121,7 +132,7 @@ void thermal_unregister_governor(struct thermal_governor *governor)
 	list_for_each_entry(pos, &thermal_tz_list, node) {
 		if (!strnicmp(pos->governor->name, governor->name,
 						THERMAL_NAME_LENGTH))
-			pos->governor = NULL;
+			thermal_set_governor(pos, NULL);
 	}
 
 	mutex_unlock(&thermal_list_lock);
@@ -1175,7 +1186,8 @@ policy_store(struct device *dev, struct device_attribute *attr,
 	if (!gov)
 		goto exit;
 
-	tz->governor = gov;
+	if (gov != tz->governor)
+		thermal_set_governor(tz, gov);
 	ret = count;
 
 exit:
@@ -2248,7 +2260,9 @@ void thermal_zone_device_unregister(struct thermal_zone_device *tz)
 		device_remove_file(&tz->device, &dev_attr_mode);
 	device_remove_file(&tz->device, &dev_attr_policy);
 	remove_trip_attrs(tz);
-	tz->governor = NULL;
+	mutex_lock(&thermal_governor_lock);
+	thermal_set_governor(tz, NULL);
+	mutex_unlock(&thermal_governor_lock);
 
 	thermal_remove_hwmon_sysfs(tz);
 	flush_work(&tz->sensor.work);
@@ -2416,6 +2430,10 @@ static int __init thermal_register_governors(void)
 	if (result)
 		return result;
 
+	result = thermal_gov_power_allocator_register();
+	if (result)
+		return result;
+
 	return thermal_gov_user_space_register();
 }
 
@@ -2423,6 +2441,7 @@ static void thermal_unregister_governors(void)
 {
 	thermal_gov_step_wise_unregister();
 	thermal_gov_fair_share_unregister();
+	thermal_gov_power_allocator_unregister();
 	thermal_gov_user_space_unregister();
 }
 
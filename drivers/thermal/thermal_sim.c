@@ -0,0 +1,324 @@
+/*
+ *  thermal_sim.c - Simulated thermal zone for testing thermal governors
+ *
+ *  Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ *  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * The zone "thermal-sim" models a die with a single thermal resistance to
+ * ambient and a first order time constant.  It is heated by three simulated
+ * cooling devices standing for a little cluster, a big cluster and a GPU,
+ * each with a table of the power it consumes at full load in every cooling
+ * state.  The load of each device is set through the util module parameter
+ * and can be changed at runtime, e.g.:
+ *
+ *	insmod thermal_sim.ko util=30,100,60
+ *	cat /sys/class/thermal/thermal_zone<N>/temp
+ *	cat /sys/class/thermal/cooling_device<M>/cur_state
+ *
+ * Temperatures are in millicelsius.  The zone has a switch on and a control
+ * passive trip point and uses the power_allocator governor by default.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/thermal.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/math64.h>
+#include <linux/err.h>
+
+static int ambient = 35000;
+module_param(ambient, int, 0644);
+MODULE_PARM_DESC(ambient, "Ambient temperature (mC)");
+
+static int resistance = 15000;
+module_param(resistance, int, 0644);
+MODULE_PARM_DESC(resistance, "Thermal resistance to ambient (mC/W)");
+
+static int time_constant_ms = 4000;
+module_param(time_constant_ms, int, 0644);
+MODULE_PARM_DESC(time_constant_ms, "Thermal time constant (ms)");
+
+static int switch_on_temp = 60000;
+module_param(switch_on_temp, int, 0644);
+MODULE_PARM_DESC(switch_on_temp, "Temperature of the switch on trip (mC)");
+
+static int control_temp = 70000;
+module_param(control_temp, int, 0644);
+MODULE_PARM_DESC(control_temp, "Temperature of the control trip (mC)");
+
+static char *governor = "power_allocator";
+module_param(governor, charp, 0444);
+MODULE_PARM_DESC(governor, "Thermal governor of the zone");
+
+static int util[] = { 100, 100, 100 };
+module_param_array(util, int, NULL, 0644);
+MODULE_PARM_DESC(util, "Load of little, big and gpu, in percent");
+
+static int power_mw;
+module_param(power_mw, int, 0444);
+MODULE_PARM_DESC(power_mw, "Power consumed at the last temperature update");
+
+/* power at full load in each cooling state, in mW, state 0 unthrottled */
+static const u32 little_power[] = { 800, 650, 500, 380, 280, 200, 140 };
+static const u32 big_power[] = { 2600, 2100, 1650, 1250, 950, 700, 480, 320 };
+static const u32 gpu_power[] = { 1600, 1250, 950, 700, 500, 350 };
+
+struct sim_actor {
+	const char *name;
+	const u32 *power;
+	int num_states;
+	unsigned long state;
+	struct thermal_cooling_device *cdev;
+};
+
+static struct sim_actor actors[] = {
+	{ "sim-little", little_power, ARRAY_SIZE(little_power) },
+	{ "sim-big", big_power, ARRAY_SIZE(big_power) },
+	{ "sim-gpu", gpu_power, ARRAY_SIZE(gpu_power) },
+};
+
+static struct thermal_zone_device *sim_tz;
+static DEFINE_MUTEX(sim_lock);
+static s64 sim_temp;
+static ktime_t sim_last_update;
+
+static int actor_util(struct sim_actor *actor)
+{
+	return clamp(util[actor - actors], 0, 100);
+}
+
+static int sim_get_max_state(struct thermal_cooling_device *cdev,
+			     unsigned long *state)
+{
+	struct sim_actor *actor = cdev->devdata;
+
+	*state = actor->num_states - 1;
+	return 0;
+}
+
+static int sim_get_cur_state(struct thermal_cooling_device *cdev,
+			     unsigned long *state)
+{
+	struct sim_actor *actor = cdev->devdata;
+
+	*state = actor->state;
+	return 0;
+}
+
+static int sim_set_cur_state(struct thermal_cooling_device *cdev,
+			     unsigned long state)
+{
+	struct sim_actor *actor = cdev->devdata;
+
+	if (state >= actor->num_states)
+		return -EINVAL;
+
+	actor->state = state;
+	return 0;
+}
+
+static int sim_get_requested_power(struct thermal_cooling_device *cdev,
+				   u32 *power)
+{
+	struct sim_actor *actor = cdev->devdata;
+
+	*power = actor->power[actor->state] * actor_util(actor) / 100;
+	return 0;
+}
+
+static int sim_state2power(struct thermal_cooling_device *cdev,
+			   unsigned long state, u32 *power)
+{
+	struct sim_actor *actor = cdev->devdata;
+
+	if (state >= actor->num_states)
+		return -EINVAL;
+
+	*power = actor->power[state];
+	return 0;
+}
+
+static int sim_power2state(struct thermal_cooling_device *cdev, u32 power,
+			   unsigned long *state)
+{
+	struct sim_actor *actor = cdev->devdata;
+	int load = actor_util(actor);
+	u32 normalised_power;
+	int i;
+
+	normalised_power = load ? power * 100 / load : U32_MAX;
+	for (i = 0; i < actor->num_states - 1; i++)
+		if (actor->power[i] <= normalised_power)
+			break;
+
+	*state = i;
+	return 0;
+}
+
+static const struct thermal_cooling_device_ops sim_cooling_ops = {
+	.get_max_state = sim_get_max_state,
+	.get_cur_state = sim_get_cur_state,
+	.set_cur_state = sim_set_cur_state,
+	.get_requested_power = sim_get_requested_power,
+	.state2power = sim_state2power,
+	.power2state = sim_power2state,
+};
+
+/*
+ * Advance the model to now: the temperature moves exponentially towards
+ * the steady state temperature for the power currently consumed.
+ */
+static int sim_get_temp(struct thermal_zone_device *tz, unsigned long *temp)
+{
+	ktime_t now = ktime_get();
+	s64 dt_ms, steady;
+	u32 power = 0;
+	int i;
+
+	mutex_lock(&sim_lock);
+
+	for (i = 0; i < ARRAY_SIZE(actors); i++)
+		power += actors[i].power[actors[i].state] *
+			actor_util(&actors[i]) / 100;
+	power_mw = power;
+
+	dt_ms = ktime_to_ms(ktime_sub(now, sim_last_update));
+	sim_last_update = now;
+
+	steady = ambient + div_s64((s64)resistance * power, 1000);
+	sim_temp += div_s64((steady - sim_temp) * dt_ms,
+			    max(time_constant_ms, 1) + dt_ms);
+	*temp = sim_temp;
+
+	mutex_unlock(&sim_lock);
+
+	return 0;
+}
+
+static int sim_get_trip_type(struct thermal_zone_device *tz, int trip,
+			     enum thermal_trip_type *type)
+{
+	if (trip < 0 || trip > 1)
+		return -EINVAL;
+
+	*type = THERMAL_TRIP_PASSIVE;
+	return 0;
+}
+
+static int sim_get_trip_temp(struct thermal_zone_device *tz, int trip,
+			     unsigned long *temp)
+{
+	switch (trip) {
+	case 0:
+		*temp = switch_on_temp;
+		break;
+	case 1:
+		*temp = control_temp;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct thermal_zone_device_ops sim_zone_ops = {
+	.get_temp = sim_get_temp,
+	.get_trip_type = sim_get_trip_type,
+	.get_trip_temp = sim_get_trip_temp,
+};
+
+static struct thermal_zone_params sim_tzp;
+
+static void sim_unregister_actors(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(actors); i++) {
+		if (!actors[i].cdev)
+			continue;
+		if (sim_tz) {
+			thermal_zone_unbind_cooling_device(sim_tz, 0,
+							   actors[i].cdev);
+			thermal_zone_unbind_cooling_device(sim_tz, 1,
+							   actors[i].cdev);
+		}
+		thermal_cooling_device_unregister(actors[i].cdev);
+		actors[i].cdev = NULL;
+	}
+}
+
+static int __init thermal_sim_init(void)
+{
+	int i, trip, ret;
+
+	sim_temp = ambient;
+	sim_last_update = ktime_get();
+	strlcpy(sim_tzp.governor_name, governor, THERMAL_NAME_LENGTH);
+	/* the power that holds the die at the control temperature */
+	if (control_temp > ambient && resistance > 0)
+		sim_tzp.sustainable_power = div_u64((u64)(control_temp -
+							  ambient) * 1000,
+						    resistance);
+
+	sim_tz = thermal_zone_device_register("thermal-sim", 2, 0, NULL,
+					      &sim_zone_ops, &sim_tzp,
+					      100, 1000);
+	if (IS_ERR(sim_tz))
+		return PTR_ERR(sim_tz);
+
+	for (i = 0; i < ARRAY_SIZE(actors); i++) {
+		struct thermal_cooling_device *cdev;
+
+		cdev = thermal_cooling_device_register((char *)actors[i].name,
+						       &actors[i],
+						       &sim_cooling_ops);
+		if (IS_ERR(cdev)) {
+			ret = PTR_ERR(cdev);
+			goto err;
+		}
+		actors[i].cdev = cdev;
+
+		for (trip = 0; trip < 2; trip++) {
+			ret = thermal_zone_bind_cooling_device(sim_tz, trip,
+					cdev, THERMAL_NO_LIMIT,
+					THERMAL_NO_LIMIT);
+			if (ret)
+				goto err;
+		}
+	}
+
+	thermal_zone_device_update(sim_tz);
+
+	return 0;
+
+err:
+	sim_unregister_actors();
+	thermal_zone_device_unregister(sim_tz);
+	return ret;
+}
+
+static void __exit thermal_sim_exit(void)
+{
+	sim_unregister_actors();
+	thermal_zone_device_unregister(sim_tz);
+}
+
+module_init(thermal_sim_init);
+module_exit(thermal_sim_exit);
+
+MODULE_DESCRIPTION("Simulated thermal zone for thermal governor testing");
+MODULE_LICENSE("GPL v2");
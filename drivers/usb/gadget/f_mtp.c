@@ -30,6 +30,8 @@
 #include <linux/file.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
 
 #include <linux/usb.h>
 #include <linux/usb_usual.h>
@@ -51,9 +53,12 @@
 
 /* number of tx and rx requests to allocate */
 #define MTP_TX_REQ_MAX 8
-#define RX_REQ_MAX 2
+#define RX_REQ_MAX 4
 #define INTR_REQ_MAX 5
 
+/* file pages mapped into one tx request by the scatter-gather path */
+#define MTP_TX_SG_PAGES 16
+
 /* ID for Microsoft MTP OS String */
 #define MTP_OS_STRING_ID   0xEE
 
@@ -76,6 +81,10 @@ module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
 unsigned int mtp_tx_reqs = MTP_TX_REQ_MAX;
 module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
 
+/* send files straight from the page cache if the UDC can do SG */
+unsigned int mtp_tx_sg = 1;
+module_param(mtp_tx_sg, uint, S_IRUGO | S_IWUSR);
+
 static const char mtp_shortname[] = "mtp_usb";
 
 struct mtp_dev {
@@ -96,11 +105,14 @@ struct mtp_dev {
 
 	struct list_head tx_idle;
 	struct list_head intr_idle;
+	/* count of tx requests allocated at bind */
+	int tx_reqs;
 
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	wait_queue_head_t intr_wq;
 	struct usb_request *rx_req[RX_REQ_MAX];
+	/* count of completed rx requests */
 	int rx_done;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
@@ -344,6 +356,13 @@ struct mtp_device_status {
 	__le16	wCode;
 };
 
+/* req->context of tx requests on a gadget with sg_supported */
+struct mtp_tx_sg {
+	/* sg[0] points at the data header in req->buf */
+	int hdr;
+	struct scatterlist sg[MTP_TX_SG_PAGES + 1];
+};
+
 struct mtp_data_header {
 	/* length of packet, including this header */
 	__le32	length;
@@ -383,6 +402,7 @@ static void mtp_request_free(struct usb_request *req, struct usb_ep *ep)
 {
 	if (req) {
 		kfree(req->buf);
+		kfree(req->context);
 		usb_ep_free_request(ep, req);
 	}
 }
@@ -431,6 +451,65 @@ static struct usb_request
 	return req;
 }
 
+/* drop the file pages a tx request was sent from */
+static void mtp_tx_sg_release(struct usb_request *req)
+{
+	struct mtp_tx_sg *tx_sg = req->context;
+	struct scatterlist *sg;
+	int i;
+
+	if (!req->num_sgs)
+		return;
+
+	for_each_sg(req->sg, sg, req->num_sgs, i) {
+		if (i >= tx_sg->hdr)
+			page_cache_release(sg_page(sg));
+	}
+	req->sg = NULL;
+	req->num_sgs = 0;
+}
+
+/*
+ * Get an idle tx request.  Pages are released here rather than in
+ * mtp_complete_in() to keep page cache puts out of interrupt context.
+ */
+static struct usb_request *mtp_tx_req_get(struct mtp_dev *dev)
+{
+	struct usb_request *req = mtp_req_get(dev, &dev->tx_idle);
+
+	if (req)
+		mtp_tx_sg_release(req);
+	return req;
+}
+
+static bool mtp_tx_all_idle(struct mtp_dev *dev)
+{
+	struct usb_request *req;
+	unsigned long flags;
+	int n = 0;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	list_for_each_entry(req, &dev->tx_idle, list)
+		n++;
+	spin_unlock_irqrestore(&dev->lock, flags);
+	return n >= dev->tx_reqs;
+}
+
+/* drop the file pages of all idle tx requests */
+static void mtp_tx_sg_release_idle(struct mtp_dev *dev)
+{
+	struct usb_request *req;
+	LIST_HEAD(reqs);
+
+	while ((req = mtp_tx_req_get(dev)))
+		list_add_tail(&req->list, &reqs);
+
+	spin_lock_irq(&dev->lock);
+	list_splice_tail(&reqs, &dev->tx_idle);
+	spin_unlock_irq(&dev->lock);
+	wake_up(&dev->write_wq);
+}
+
 static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
@@ -447,7 +526,8 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
-	dev->rx_done = 1;
+	/* requests complete in queue order, see receive_file_work() */
+	dev->rx_done++;
 	if (req->status != 0)
 		dev->state = STATE_ERROR;
 
@@ -515,15 +595,20 @@ retry_tx_alloc:
 		if (!req) {
 			if (mtp_tx_req_len <= MTP_BULK_BUFFER_SIZE)
 				goto fail;
-			while ((req = mtp_req_get(dev, &dev->tx_idle)))
+			while ((req = mtp_tx_req_get(dev)))
 				mtp_request_free(req, dev->ep_in);
 			mtp_tx_req_len = MTP_BULK_BUFFER_SIZE;
 			mtp_tx_reqs = MTP_TX_REQ_MAX;
 			goto retry_tx_alloc;
 		}
 		req->complete = mtp_complete_in;
+		/* without a context the request only uses the copy path */
+		if (cdev->gadget->sg_supported)
+			req->context = kzalloc(sizeof(struct mtp_tx_sg),
+						GFP_KERNEL);
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
+	dev->tx_reqs = mtp_tx_reqs;
 
 	/*
 	 * The RX buffer should be aligned to EP max packet for
@@ -701,7 +786,7 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 		/* get an idle tx request to use */
 		req = 0;
 		ret = wait_event_interruptible(dev->write_wq,
-			((req = mtp_req_get(dev, &dev->tx_idle))
+			((req = mtp_tx_req_get(dev))
 				|| dev->state != STATE_BUSY));
 		if (!req) {
 			r = ret;
@@ -746,6 +831,95 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/*
+ * Stacked filesystems such as sdcardfs have no ->readpage and keep the
+ * data in the page cache of the lower file, so they use the copy path.
+ */
+static bool mtp_file_sg_ok(struct file *filp)
+{
+	return mtp_tx_sg && S_ISREG(file_inode(filp)->i_mode) &&
+		filp->f_mapping->a_ops->readpage &&
+		!(filp->f_flags & O_DIRECT);
+}
+
+/* get an uptodate page cache page, reading ahead up to @last */
+static struct page *mtp_file_page(struct file *filp, pgoff_t index,
+		pgoff_t last)
+{
+	struct address_space *mapping = filp->f_mapping;
+	struct page *page;
+
+	page = find_get_page(mapping, index);
+	if (!page) {
+		page_cache_sync_readahead(mapping, &filp->f_ra, filp,
+				index, last - index + 1);
+		page = find_get_page(mapping, index);
+	}
+	if (page && PageReadahead(page))
+		page_cache_async_readahead(mapping, &filp->f_ra, filp,
+				page, index, last - index + 1);
+	if (page && PageUptodate(page))
+		return page;
+
+	/* waits for a read in flight, or starts one */
+	if (page)
+		page_cache_release(page);
+	return read_mapping_page(mapping, index, filp);
+}
+
+/*
+ * Point @req at the file pages for the next part of the transfer,
+ * after the data header already in req->buf if @hdr_size is set.
+ * Returns the request length.
+ */
+static int mtp_tx_sg_map(struct mtp_dev *dev, struct usb_request *req,
+		struct file *filp, loff_t offset, int64_t count, int hdr_size)
+{
+	struct mtp_tx_sg *tx_sg = req->context;
+	unsigned poff = offset & ~PAGE_CACHE_MASK;
+	pgoff_t index = offset >> PAGE_CACHE_SHIFT;
+	struct page *page;
+	int xfer, len, n = 0;
+
+	xfer = hdr_size + MTP_TX_SG_PAGES * PAGE_CACHE_SIZE - poff;
+	/* only the last request of the transfer may be short */
+	if (count > xfer)
+		xfer -= xfer % dev->ep_in->maxpacket;
+	else
+		xfer = count;
+	len = xfer - hdr_size;
+
+	/* the file may have been truncated since the ioctl */
+	if (offset + len > i_size_read(file_inode(filp)))
+		return -EIO;
+
+	sg_init_table(tx_sg->sg, MTP_TX_SG_PAGES + 1);
+	tx_sg->hdr = hdr_size ? 1 : 0;
+	if (hdr_size)
+		sg_set_buf(&tx_sg->sg[n++], req->buf, hdr_size);
+	req->sg = tx_sg->sg;
+
+	while (len > 0) {
+		page = mtp_file_page(filp, index,
+				(offset + len - 1) >> PAGE_CACHE_SHIFT);
+		if (IS_ERR(page)) {
+			req->num_sgs = n;
+			mtp_tx_sg_release(req);
+			return PTR_ERR(page);
+		}
+		sg_set_page(&tx_sg->sg[n++], page,
+				min_t(int, len, PAGE_CACHE_SIZE - poff), poff);
+		len -= PAGE_CACHE_SIZE - poff;
+		offset += PAGE_CACHE_SIZE - poff;
+		poff = 0;
+		index++;
+	}
+	sg_mark_end(&tx_sg->sg[n - 1]);
+	req->num_sgs = n;
+	req->length = xfer;
+	return xfer;
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data)
 {
@@ -760,12 +934,14 @@ static void send_file_work(struct work_struct *data)
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
+	bool sg;
 
 	/* read our parameters */
 	smp_rmb();
 	filp = dev->xfer_file;
 	offset = dev->xfer_file_offset;
 	count = dev->xfer_file_length;
+	sg = mtp_file_sg_ok(filp);
 
 	DBG(cdev, "send_file_work(%lld %lld)\n", offset, count);
 
@@ -790,7 +966,7 @@ static void send_file_work(struct work_struct *data)
 		/* get an idle tx request to use */
 		req = 0;
 		ret = wait_event_interruptible(dev->write_wq,
-			(req = mtp_req_get(dev, &dev->tx_idle))
+			(req = mtp_tx_req_get(dev))
 			|| dev->state != STATE_BUSY);
 		if (dev->state == STATE_CANCELED) {
 			r = -ECANCELED;
@@ -816,16 +992,29 @@ static void send_file_work(struct work_struct *data)
 					__cpu_to_le32(dev->xfer_transaction_id);
 		}
 
-		ret = vfs_read(filp, req->buf + hdr_size, xfer - hdr_size,
-								&offset);
-		if (ret < 0) {
-			r = ret;
-			break;
+		if (sg && req->context && count > hdr_size) {
+			ret = mtp_tx_sg_map(dev, req, filp, offset, count,
+								hdr_size);
+			if (ret < 0) {
+				r = ret;
+				break;
+			}
+			xfer = ret;
+			offset += xfer - hdr_size;
+			hdr_size = 0;
+		} else {
+			ret = vfs_read(filp, req->buf + hdr_size,
+						xfer - hdr_size, &offset);
+			if (ret < 0) {
+				r = ret;
+				break;
+			}
+			xfer = ret + hdr_size;
+			hdr_size = 0;
+
+			req->length = xfer;
 		}
-		xfer = ret + hdr_size;
-		hdr_size = 0;
 
-		req->length = xfer;
 		ret = usb_ep_queue(dev->ep_in, req, GFP_KERNEL);
 		if (ret < 0) {
 			DBG(cdev, "send_file_work: xfer error %d\n", ret);
@@ -844,6 +1033,16 @@ static void send_file_work(struct work_struct *data)
 	if (req)
 		mtp_req_put(dev, &dev->tx_idle, req);
 
+	/*
+	 * Let the last requests complete, so that the file pages they were
+	 * sent from are not held until the requests are used again.
+	 */
+	if (sg) {
+		wait_event_interruptible(dev->write_wq,
+			mtp_tx_all_idle(dev) || dev->state != STATE_BUSY);
+		mtp_tx_sg_release_idle(dev);
+	}
+
 	DBG(cdev, "send_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
@@ -856,11 +1055,12 @@ static void receive_file_work(struct work_struct *data)
 	struct mtp_dev *dev = container_of(data, struct mtp_dev,
 						receive_file_work);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *read_req, *write_req = NULL;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
-	int ret, cur_buf = 0;
+	int64_t count, queued = 0;
+	int ret, head = 0, tail = 0, inflight = 0, depth;
+	int reaped = 0;
 	int r = 0;
 
 	/* read our parameters */
@@ -874,23 +1074,35 @@ static void receive_file_work(struct work_struct *data)
 		DBG(cdev, "%s- count(%lld) not multiple of mtu(%d)\n", __func__,
 						count, dev->ep_out->maxpacket);
 
+	/*
+	 * Keep reads queued while the last one is written to the file, but
+	 * never more than the remaining data: a read past the end would
+	 * take the next command from the host.  Without a length the end is
+	 * only known from a short packet, so one read at a time.
+	 */
+	if (count == 0xFFFFFFFF)
+		depth = 1;
+	else
+		depth = RX_REQ_MAX - 1;
+	dev->rx_done = 0;
+
 	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
+		while (inflight < depth && queued < count) {
+			read_req = dev->rx_req[tail];
+			tail = (tail + 1) % RX_REQ_MAX;
 
 			/* some h/w expects size to be aligned to ep's MTU */
 			read_req->length = mtp_rx_req_len;
 
-			dev->rx_done = 0;
 			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				if (dev->state != STATE_OFFLINE)
 					dev->state = STATE_ERROR;
-				break;
+				goto out;
 			}
+			inflight++;
+			queued += read_req->length;
 		}
 
 		if (write_req) {
@@ -902,46 +1114,66 @@ static void receive_file_work(struct work_struct *data)
 				r = -EIO;
 				if (dev->state != STATE_OFFLINE)
 					dev->state = STATE_ERROR;
-				break;
+				goto out;
 			}
 			write_req = NULL;
 		}
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED
-					|| dev->state == STATE_OFFLINE) {
-				if (dev->state == STATE_OFFLINE)
-					r = -EIO;
-				else
-					r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			/* Check if we aligned the size due to MTU constraint */
-			if (count < read_req->length)
-				read_req->actual = (read_req->actual > count ?
-						count : read_req->actual);
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
-			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/*
-				 * short packet is used to signal EOF for
-				 * sizes > 4 gig
-				 */
-				DBG(cdev, "got short packet\n");
-				count = 0;
-			}
+		/* after a short packet the reads left are dequeued below */
+		if (!count)
+			continue;
+
+		/* wait for the oldest read to complete */
+		ret = wait_event_interruptible(dev->read_wq,
+			dev->rx_done != reaped || dev->state != STATE_BUSY);
+		/*
+		 * A failed read leaves the state at STATE_ERROR and may not
+		 * be the oldest one, which can still be queued.
+		 */
+		if (dev->state != STATE_BUSY) {
+			if (dev->state == STATE_CANCELED)
+				r = -ECANCELED;
+			else
+				r = -EIO;
+			goto out;
+		}
+		if (ret < 0) {
+			r = ret;
+			goto out;
+		}
 
-			write_req = read_req;
-			read_req = NULL;
+		read_req = dev->rx_req[head];
+		head = (head + 1) % RX_REQ_MAX;
+		inflight--;
+		reaped++;
+		queued -= read_req->length;
+
+		/* Check if we aligned the size due to MTU constraint */
+		if (count < read_req->length)
+			read_req->actual = (read_req->actual > count ?
+					count : read_req->actual);
+		/* if xfer_file_length is 0xFFFFFFFF, then we read until
+		 * we get a zero length packet
+		 */
+		if (count != 0xFFFFFFFF)
+			count -= read_req->actual;
+		if (read_req->actual < read_req->length) {
+			/*
+			 * short packet is used to signal EOF for
+			 * sizes > 4 gig
+			 */
+			DBG(cdev, "got short packet\n");
+			count = 0;
 		}
+
+		write_req = read_req;
+	}
+
+out:
+	/* reads still queued after an error or an early short packet */
+	while (inflight--) {
+		usb_ep_dequeue(dev->ep_out, dev->rx_req[head]);
+		head = (head + 1) % RX_REQ_MAX;
 	}
 
 	DBG(cdev, "receive_file_work returning %d\n", r);
@@ -1349,7 +1581,7 @@ mtp_function_unbind(struct usb_configuration *c, struct usb_function *f)
 	struct usb_request *req;
 	int i;
 
-	while ((req = mtp_req_get(dev, &dev->tx_idle)))
+	while ((req = mtp_tx_req_get(dev)))
 		mtp_request_free(req, dev->ep_in);
 	for (i = 0; i < RX_REQ_MAX; i++)
 		mtp_request_free(dev->rx_req[i], dev->ep_out);
@@ -390,6 +390,29 @@ int blkdev_fsync(struct file *filp, loff_t start, loff_t end, int datasync)
 }
 EXPORT_SYMBOL(blkdev_fsync);
 
+/**
+ * bdev_read_page() - Start reading a page from a block device
+ * @bdev: The device to read the page from
+ * @sector: The offset on the device to read the page from (need not be aligned)
+ * @page: The page to read
+ *
+ * On entry, the page should be locked.  If the driver has a ->rw_page()
+ * method the read is done synchronously, and on success the page is marked
+ * uptodate and unlocked before this returns.  Any error, including the lack
+ * of a ->rw_page() method, leaves the page locked and untouched, and the
+ * caller should fall back to submitting a bio.
+ */
+int bdev_read_page(struct block_device *bdev, sector_t sector,
+			struct page *page)
+{
+	const struct block_device_operations *ops = bdev->bd_disk->fops;
+
+	if (!ops->rw_page)
+		return -EOPNOTSUPP;
+	return ops->rw_page(bdev, sector + get_start_sect(bdev), page, READ);
+}
+EXPORT_SYMBOL_GPL(bdev_read_page);
+
 /*
  * pseudo-fs
  */
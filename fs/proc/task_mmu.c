@@ -12,6 +12,10 @@
 #include <linux/swap.h>
 #include <linux/swapops.h>
 #include <linux/mm_inline.h>
+#include <linux/pagevec.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/ctype.h>
 
 #include <asm/elf.h>
 #include <asm/uaccess.h>
@@ -1207,11 +1211,62 @@ const struct file_operations proc_pagemap_operations = {
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
 #ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * A write to /proc/<pid>/reclaim is a list of words:
+ *
+ *   file | anon | all	the kind of vmas to work on
+ *   <addr> <size>	only the part of them in this range; with no kind
+ *			given, all vmas in the range
+ *   cold		only move the pages to the inactive lists, so that
+ *			they are the first to go when memory runs short
+ *   async		queue the request to the kprocreclaimd thread of the
+ *			task's node instead of running it in the writer
+ *
+ * A read reports the pages scanned, reclaimed and deactivated by all the
+ * requests made against the task's mm so far, and the requests queued.
+ */
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+struct reclaim_request {
+	struct list_head list;
+	struct mm_struct *mm;		/* holds a mm_count reference */
+	enum reclaim_type type;
+	unsigned long start;
+	unsigned long end;
+	bool cold;
+};
+
+struct reclaim_param {
+	struct vm_area_struct *vma;
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+	unsigned long nr_deactivated;
+};
+
+/* Bound on the async requests queued to a node */
+#define RECLAIM_QUEUE_MAX	64
+
+struct reclaim_queue {
+	spinlock_t lock;
+	struct list_head list;
+	unsigned int nr;
+	wait_queue_head_t wait;
+	struct task_struct *task;
+	int nid;
+};
+
+static struct reclaim_queue reclaim_queues[MAX_NUMNODES];
+
 static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
-	struct vm_area_struct *vma = walk->private;
-	pte_t *pte, ptent;
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	pte_t *orig_pte, *pte, ptent;
 	spinlock_t *ptl;
 	struct page *page;
 	LIST_HEAD(page_list);
@@ -1222,8 +1277,11 @@ static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 		return 0;
 cont:
 	isolated = 0;
-	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
 	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (isolated >= SWAP_CLUSTER_MAX)
+			break;
+
 		ptent = *pte;
 		if (!pte_present(ptent))
 			continue;
@@ -1231,6 +1289,7 @@ cont:
 		page = vm_normal_page(vma, addr, ptent);
 		if (!page)
 			continue;
+		rp->nr_scanned++;
 
 		if (isolate_lru_page(page))
 			continue;
@@ -1239,11 +1298,9 @@ cont:
 		inc_zone_page_state(page, NR_ISOLATED_ANON +
 				page_is_file_cache(page));
 		isolated++;
-		if (isolated >= SWAP_CLUSTER_MAX)
-			break;
 	}
-	pte_unmap_unlock(pte - 1, ptl);
-	reclaim_pages_from_list(&page_list);
+	pte_unmap_unlock(orig_pte, ptl);
+	rp->nr_reclaimed += reclaim_pages_from_list(&page_list);
 	if (addr != end)
 		goto cont;
 
@@ -1251,22 +1308,250 @@ cont:
 	return 0;
 }
 
-enum reclaim_type {
-	RECLAIM_FILE,
-	RECLAIM_ANON,
-	RECLAIM_ALL,
-	RECLAIM_RANGE,
-};
+/*
+ * The "cold" variant of reclaim_pte_range(): age the pages as reclaim
+ * would find them, not referenced and on the inactive list, but leave
+ * them mapped.
+ */
+static int deactivate_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	pte_t *orig_pte, *pte, ptent;
+	struct pagevec pvec;
+	spinlock_t *ptl;
+	struct page *page;
+
+	pagevec_init(&pvec, 0);
+
+	if (pmd_trans_huge_lock(pmd, vma) == 1) {
+		page = pmd_page(*pmd);
+		rp->nr_scanned += hpage_nr_pages(page);
+		pmdp_test_and_clear_young(vma, addr, pmd);
+		ClearPageReferenced(page);
+		if (PageActive(page) && !PageUnevictable(page)) {
+			page_cache_get(page);
+			pagevec_add(&pvec, page);
+		}
+		spin_unlock(&walk->mm->page_table_lock);
+		goto out;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+cont:
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (!pagevec_space(&pvec))
+			break;
+
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+		rp->nr_scanned++;
+
+		ptep_test_and_clear_young(vma, addr, pte);
+		ClearPageReferenced(page);
+		if (!PageActive(page) || PageUnevictable(page))
+			continue;
+
+		page_cache_get(page);
+		pagevec_add(&pvec, page);
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+	if (addr != end) {
+		rp->nr_deactivated += deactivate_mapped_pages(&pvec);
+		goto cont;
+	}
+out:
+	if (pagevec_count(&pvec))
+		rp->nr_deactivated += deactivate_mapped_pages(&pvec);
+
+	cond_resched();
+	return 0;
+}
+
+static void process_reclaim(struct mm_struct *mm, struct reclaim_request *req)
+{
+	struct reclaim_param rp = { NULL, };
+	struct mm_walk reclaim_walk = {
+		.pmd_entry = req->cold ? deactivate_pte_range :
+					 reclaim_pte_range,
+		.mm = mm,
+		.private = &rp,
+	};
+	struct vm_area_struct *vma;
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, req->start); vma && vma->vm_start < req->end;
+	     vma = vma->vm_next) {
+		if (is_vm_hugetlb_page(vma))
+			continue;
+
+		if (req->type == RECLAIM_ANON && vma->vm_file)
+			continue;
+		if (req->type == RECLAIM_FILE && !vma->vm_file)
+			continue;
+
+		rp.vma = vma;
+		walk_page_range(max(vma->vm_start, req->start),
+				min(vma->vm_end, req->end), &reclaim_walk);
+	}
+	flush_tlb_mm(mm);
+	up_read(&mm->mmap_sem);
+
+	atomic_long_add(rp.nr_scanned, &mm->reclaim_stat.scanned);
+	atomic_long_add(rp.nr_reclaimed, &mm->reclaim_stat.reclaimed);
+	atomic_long_add(rp.nr_deactivated, &mm->reclaim_stat.deactivated);
+}
+
+static int kprocreclaimd(void *data)
+{
+	struct reclaim_queue *q = data;
+	const struct cpumask *cpumask = cpumask_of_node(q->nid);
+	struct reclaim_request *req;
+	struct mm_struct *mm;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(q->wait, !list_empty(&q->list) ||
+					      kthread_should_stop());
+
+		spin_lock(&q->lock);
+		req = list_first_entry_or_null(&q->list,
+					       struct reclaim_request, list);
+		if (req) {
+			list_del(&req->list);
+			q->nr--;
+		}
+		spin_unlock(&q->lock);
+		if (!req)
+			continue;
+
+		/* the task may have exited while the request was queued */
+		mm = req->mm;
+		if (atomic_inc_not_zero(&mm->mm_users)) {
+			process_reclaim(mm, req);
+			mmput(mm);
+		}
+		atomic_dec(&mm->reclaim_stat.pending);
+		mmdrop(mm);
+		kfree(req);
+	}
+
+	return 0;
+}
+
+static int queue_process_reclaim(struct task_struct *task,
+				 struct mm_struct *mm,
+				 struct reclaim_request *req)
+{
+	struct reclaim_queue *q = &reclaim_queues[cpu_to_node(task_cpu(task))];
+	struct reclaim_request *new;
+
+	/* no thread for a memoryless node, do it here */
+	if (!q->task) {
+		process_reclaim(mm, req);
+		return 0;
+	}
+
+	new = kmemdup(req, sizeof(*req), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	spin_lock(&q->lock);
+	if (q->nr >= RECLAIM_QUEUE_MAX) {
+		spin_unlock(&q->lock);
+		kfree(new);
+		return -EBUSY;
+	}
+	atomic_inc(&mm->mm_count);
+	atomic_inc(&mm->reclaim_stat.pending);
+	new->mm = mm;
+	list_add_tail(&new->list, &q->list);
+	q->nr++;
+	spin_unlock(&q->lock);
+
+	wake_up(&q->wait);
+	return 0;
+}
+
+static int parse_reclaim_request(char *buf, struct reclaim_request *req,
+				 bool *async)
+{
+	bool type_set = false, range_set = false;
+	char *token;
+
+	memset(req, 0, sizeof(*req));
+	req->type = RECLAIM_ALL;
+	req->end = ~0UL;
+	*async = false;
+
+	while ((token = strsep(&buf, " \t\n")) != NULL) {
+		unsigned long start;
+		unsigned long long len;
+		char *size;
+
+		if (!*token)
+			continue;
+
+		if (!strcmp(token, "cold")) {
+			req->cold = true;
+		} else if (!strcmp(token, "async")) {
+			*async = true;
+		} else if (!type_set && !strcmp(token, "file")) {
+			req->type = RECLAIM_FILE;
+			type_set = true;
+		} else if (!type_set && !strcmp(token, "anon")) {
+			req->type = RECLAIM_ANON;
+			type_set = true;
+		} else if (!type_set && !strcmp(token, "all")) {
+			req->type = RECLAIM_ALL;
+			type_set = true;
+		} else if (!range_set && isdigit(*token)) {
+			size = strsep(&buf, " \t\n");
+			if (!size || kstrtoul(token, 0, &start) ||
+			    start & ~PAGE_MASK)
+				return -EINVAL;
+
+			len = memparse(size, &size);
+			if (*size || !len || len > ULONG_MAX - PAGE_SIZE)
+				return -EINVAL;
+			len = PAGE_ALIGN(len);
+			if (start + len < start)
+				return -EINVAL;
+
+			req->start = start;
+			req->end = start + len;
+			range_set = true;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	if (!type_set && !range_set)
+		return -EINVAL;
+
+	return 0;
+}
 
 static ssize_t reclaim_write(struct file *file, const char __user *buf,
 				size_t count, loff_t *ppos)
 {
+	struct reclaim_request req;
 	struct task_struct *task;
-	char buffer[PROC_NUMBUF];
+	char buffer[64];
 	struct mm_struct *mm;
-	struct vm_area_struct *vma;
-	enum reclaim_type type;
-	char *type_buf;
+	bool async;
+	int err;
 
 	memset(buffer, 0, sizeof(buffer));
 	if (count > sizeof(buffer) - 1)
@@ -1275,15 +1560,9 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	if (copy_from_user(buffer, buf, count))
 		return -EFAULT;
 
-	type_buf = strstrip(buffer);
-	if (!strcmp(type_buf, "file"))
-		type = RECLAIM_FILE;
-	else if (!strcmp(type_buf, "anon"))
-		type = RECLAIM_ANON;
-	else if (!strcmp(type_buf, "all"))
-		type = RECLAIM_ALL;
-	else
-		return -EINVAL;
+	err = parse_reclaim_request(buffer, &req, &async);
+	if (err)
+		return err;
 
 	task = get_proc_task(file->f_path.dentry->d_inode);
 	if (!task)
@@ -1291,39 +1570,80 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 
 	mm = get_task_mm(task);
 	if (mm) {
-		struct mm_walk reclaim_walk = {
-			.pmd_entry = reclaim_pte_range,
-			.mm = mm,
-		};
+		if (async)
+			err = queue_process_reclaim(task, mm, &req);
+		else
+			process_reclaim(mm, &req);
+		mmput(mm);
+	}
+	put_task_struct(task);
 
-		down_read(&mm->mmap_sem);
-		for (vma = mm->mmap; vma; vma = vma->vm_next) {
-			reclaim_walk.private = vma;
+	return err ? err : count;
+}
 
-			if (is_vm_hugetlb_page(vma))
-				continue;
+static ssize_t reclaim_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	struct mm_struct *mm;
+	char buffer[128];
+	size_t len;
 
-			if (type == RECLAIM_ANON && vma->vm_file)
-				continue;
-			if (type == RECLAIM_FILE && !vma->vm_file)
-				continue;
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
 
-			walk_page_range(vma->vm_start, vma->vm_end,
-					&reclaim_walk);
-		}
-		flush_tlb_mm(mm);
-		up_read(&mm->mmap_sem);
-		mmput(mm);
-	}
+	mm = get_task_mm(task);
 	put_task_struct(task);
+	if (!mm)
+		return 0;
 
-	return count;
+	len = snprintf(buffer, sizeof(buffer),
+		       "scanned %lu\nreclaimed %lu\ndeactivated %lu\npending %d\n",
+		       atomic_long_read(&mm->reclaim_stat.scanned),
+		       atomic_long_read(&mm->reclaim_stat.reclaimed),
+		       atomic_long_read(&mm->reclaim_stat.deactivated),
+		       atomic_read(&mm->reclaim_stat.pending));
+	mmput(mm);
+
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
 }
 
 const struct file_operations proc_reclaim_operations = {
+	.read		= reclaim_read,
 	.write		= reclaim_write,
 	.llseek		= noop_llseek,
 };
+
+static int __init process_reclaim_init(void)
+{
+	int nid;
+
+	for_each_node(nid) {
+		struct reclaim_queue *q = &reclaim_queues[nid];
+
+		spin_lock_init(&q->lock);
+		INIT_LIST_HEAD(&q->list);
+		init_waitqueue_head(&q->wait);
+		q->nid = nid;
+	}
+
+	for_each_node_state(nid, N_MEMORY) {
+		struct task_struct *task;
+
+		task = kthread_run(kprocreclaimd, &reclaim_queues[nid],
+				   "kprocreclaimd%d", nid);
+		if (IS_ERR(task)) {
+			pr_err("Failed to start kprocreclaimd on node %d\n",
+			       nid);
+			continue;
+		}
+		reclaim_queues[nid].task = task;
+	}
+
+	return 0;
+}
+late_initcall(process_reclaim_init);
 #endif
 
 #ifdef CONFIG_NUMA
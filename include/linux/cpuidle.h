@@ -193,6 +193,14 @@ struct cpuidle_governor {
 	struct module 		*owner;
 };
 
+#ifdef CONFIG_CPU_IDLE_GOV_PREDICT
+extern void cpuidle_predict_irq(unsigned int irq);
+extern bool cpuidle_predict_active(int cpu);
+#else
+static inline void cpuidle_predict_irq(unsigned int irq) { }
+static inline bool cpuidle_predict_active(int cpu) { return false; }
+#endif
+
 #ifdef CONFIG_CPU_IDLE
 
 extern int cpuidle_register_governor(struct cpuidle_governor *gov);
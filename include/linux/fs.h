@@ -2590,6 +2590,7 @@ extern ssize_t blkdev_aio_write(struct kiocb *iocb, const struct iovec *iov,
 				unsigned long nr_segs, loff_t pos);
 extern int blkdev_fsync(struct file *filp, loff_t start, loff_t end,
 			int datasync);
+extern int bdev_read_page(struct block_device *, sector_t, struct page *);
 extern void block_sync_page(struct page *page);
 
 /* fs/splice.c */
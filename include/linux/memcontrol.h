@@ -112,6 +112,10 @@ struct mem_cgroup *mem_cgroup_iter(struct mem_cgroup *,
 				   struct mem_cgroup_reclaim_cookie *);
 void mem_cgroup_iter_break(struct mem_cgroup *, struct mem_cgroup *);
 
+bool mem_cgroup_low(struct mem_cgroup *root, struct mem_cgroup *memcg);
+void mem_cgroup_reclaim_stat(struct mem_cgroup *memcg, unsigned long scanned,
+			     unsigned long reclaimed, bool low);
+
 /*
  * For memory reclaim.
  */
@@ -328,6 +332,18 @@ static inline void mem_cgroup_iter_break(struct mem_cgroup *root,
 {
 }
 
+static inline bool mem_cgroup_low(struct mem_cgroup *root,
+				  struct mem_cgroup *memcg)
+{
+	return false;
+}
+
+static inline void mem_cgroup_reclaim_stat(struct mem_cgroup *memcg,
+					   unsigned long scanned,
+					   unsigned long reclaimed, bool low)
+{
+}
+
 static inline bool mem_cgroup_disabled(void)
 {
 	return true;
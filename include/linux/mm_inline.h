@@ -22,12 +22,102 @@ static inline int page_is_file_cache(struct page *page)
 	return !PageSwapBacked(page);
 }
 
+#ifdef CONFIG_LRU_GEN
+/*
+ * Generation of a page on an active list, or -1.  The label is kept in
+ * page->flags as the generation + 1 and changes under the lru_lock.
+ */
+static inline int page_lru_gen(struct page *page)
+{
+	return (int)((page->flags & LRU_GEN_MASK) >> LRU_GEN_PGOFF) - 1;
+}
+
+static inline void page_set_lru_gen(struct page *page, int gen)
+{
+	unsigned long old_flags, flags;
+
+	/* other page flags are changed without the lru_lock */
+	do {
+		old_flags = flags = page->flags;
+		flags &= ~LRU_GEN_MASK;
+		flags |= ((unsigned long)(gen + 1) << LRU_GEN_PGOFF) &
+			 LRU_GEN_MASK;
+	} while (unlikely(cmpxchg(&page->flags, old_flags, flags) != old_flags));
+}
+
+/*
+ * Pages going onto an active list join the youngest generation, pages
+ * going onto any other list lose their label.
+ */
+static __always_inline void lru_gen_add_page(struct page *page,
+				struct lruvec *lruvec, enum lru_list lru)
+{
+	int gen = -1;
+
+	if (is_active_lru(lru)) {
+		int nr_pages = hpage_nr_pages(page);
+
+		gen = lru_gen_from_seq(ACCESS_ONCE(lru_gen_max_seq));
+		lruvec->lrugen.nr_pages[gen][is_file_lru(lru)] += nr_pages;
+		__mod_zone_page_state(lruvec_zone(lruvec),
+				      NR_LRU_GEN_BASE + gen, nr_pages);
+	}
+
+	if (page_lru_gen(page) != gen)
+		page_set_lru_gen(page, gen);
+}
+
+static __always_inline void lru_gen_del_page(struct page *page,
+				struct lruvec *lruvec)
+{
+	int gen = page_lru_gen(page);
+	int nr_pages;
+
+	if (gen < 0)
+		return;
+
+	nr_pages = hpage_nr_pages(page);
+	lruvec->lrugen.nr_pages[gen][page_is_file_cache(page)] -= nr_pages;
+	__mod_zone_page_state(lruvec_zone(lruvec), NR_LRU_GEN_BASE + gen,
+			      -nr_pages);
+	page_set_lru_gen(page, -1);
+}
+
+/*
+ * A tail page split off a huge page on the LRU stays in its generation,
+ * the huge page was accounted for all its subpages.
+ */
+static inline void lru_gen_split_page(struct page *page,
+				      struct page *page_tail)
+{
+	int gen = page_lru_gen(page);
+
+	if (gen >= 0)
+		page_set_lru_gen(page_tail, gen);
+}
+#else
+static inline void lru_gen_add_page(struct page *page,
+				struct lruvec *lruvec, enum lru_list lru)
+{
+}
+
+static inline void lru_gen_del_page(struct page *page, struct lruvec *lruvec)
+{
+}
+
+static inline void lru_gen_split_page(struct page *page,
+				      struct page *page_tail)
+{
+}
+#endif /* CONFIG_LRU_GEN */
+
 static __always_inline void add_page_to_lru_list(struct page *page,
 				struct lruvec *lruvec, enum lru_list lru)
 {
 	int nr_pages = hpage_nr_pages(page);
 	mem_cgroup_update_lru_size(lruvec, lru, nr_pages);
 	list_add(&page->lru, &lruvec->lists[lru]);
+	lru_gen_add_page(page, lruvec, lru);
 	__mod_zone_page_state(lruvec_zone(lruvec), NR_LRU_BASE + lru, nr_pages);
 }
 
@@ -37,6 +127,7 @@ static __always_inline void del_page_from_lru_list(struct page *page,
 	int nr_pages = hpage_nr_pages(page);
 	mem_cgroup_update_lru_size(lruvec, lru, -nr_pages);
 	list_del(&page->lru);
+	lru_gen_del_page(page, lruvec);
 	__mod_zone_page_state(lruvec_zone(lruvec), NR_LRU_BASE + lru, -nr_pages);
 }
 
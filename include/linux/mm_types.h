@@ -304,6 +304,13 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info;	/* see mm/swap_state.c */
+#endif
+#ifdef CONFIG_KSM
+	unsigned short ksm_fails;	/* unproductive ksmd scans in a row */
+	unsigned short ksm_skip;	/* ksmd scans still to skip */
+#endif
 };
 
 struct core_thread {
@@ -337,6 +344,16 @@ struct mm_rss_stat {
 	atomic_long_t count[NR_MM_COUNTERS];
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/* Totals of the /proc/<pid>/reclaim requests made against an mm */
+struct mm_reclaim_stat {
+	atomic_long_t scanned;
+	atomic_long_t reclaimed;
+	atomic_long_t deactivated;
+	atomic_t pending;		/* queued async requests */
+};
+#endif
+
 struct mm_struct {
 	struct vm_area_struct * mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
@@ -362,6 +379,9 @@ struct mm_struct {
 						 * together off init_mm.mmlist, and are protected
 						 * by mmlist_lock
 						 */
+#ifdef CONFIG_LRU_GEN
+	struct list_head lru_gen_list;		/* mms aged by the multi-gen LRU */
+#endif
 
 
 	unsigned long hiwater_rss;	/* High-watermark of RSS usage */
@@ -386,6 +406,14 @@ struct mm_struct {
 	 * page_table_lock, in other configurations by being atomic.
 	 */
 	struct mm_rss_stat rss_stat;
+#ifdef CONFIG_PROCESS_RECLAIM
+	struct mm_reclaim_stat reclaim_stat;
+#endif
+#ifdef CONFIG_KSM
+	/* Updated by ksmd only, see /proc/<pid>/ksm_stat */
+	unsigned long ksm_rmap_items;		/* rmap_items tracking this mm */
+	unsigned long ksm_merging_pages;	/* pages mapped from ksm pages */
+#endif
 
 	struct linux_binfmt *binfmt;
 
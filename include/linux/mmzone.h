@@ -116,6 +116,16 @@ struct zone_padding {
 #define ZONE_PADDING(name)
 #endif
 
+#ifdef CONFIG_LRU_GEN
+/*
+ * The multi-generational LRU sorts the pages on the active lists into up to
+ * MAX_NR_GENS generations by when they were last found accessed, see
+ * mm/vmscan.c.  Sequence numbers only grow and map to generations modulo
+ * MAX_NR_GENS.
+ */
+#define MAX_NR_GENS		4
+#endif
+
 enum zone_stat_item {
 	/* First 128 byte cacheline (assuming 64 bit words) */
 	NR_FREE_PAGES,
@@ -158,6 +168,10 @@ enum zone_stat_item {
 	NR_ANON_TRANSPARENT_HUGEPAGES,
 	NR_FREE_CMA_PAGES,
 	NR_SWAPCACHE,
+#ifdef CONFIG_LRU_GEN
+	NR_LRU_GEN_BASE,	/* active pages in each generation */
+	NR_LRU_GEN_LAST = NR_LRU_GEN_BASE + MAX_NR_GENS - 1,
+#endif
 	NR_VM_ZONE_STAT_ITEMS };
 
 /*
@@ -214,9 +228,32 @@ struct zone_reclaim_stat {
 	unsigned long		recent_scanned[2];
 };
 
+#ifdef CONFIG_LRU_GEN
+struct lru_gen_struct {
+	/*
+	 * Sequence number of the oldest generation, which is the one on
+	 * the inactive list; the active list holds the generations up to
+	 * lru_gen_max_seq.  Anon in [0], file in [1].
+	 */
+	unsigned long		min_seq[2];
+	/* active pages in each generation, anon in [0], file in [1] */
+	long			nr_pages[MAX_NR_GENS][2];
+};
+
+extern unsigned long lru_gen_max_seq;
+
+static inline int lru_gen_from_seq(unsigned long seq)
+{
+	return seq % MAX_NR_GENS;
+}
+#endif
+
 struct lruvec {
 	struct list_head lists[NR_LRU_LISTS];
 	struct zone_reclaim_stat reclaim_stat;
+#ifdef CONFIG_LRU_GEN
+	struct lru_gen_struct lrugen;
+#endif
 #ifdef CONFIG_MEMCG
 	struct zone *zone;
 #endif
@@ -250,13 +287,20 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+/*
+ * Orders up to PCP_MAX_ORDER are cached on the per-cpu lists, so that
+ * skb heads, kernel stacks and slab pages don't all take zone->lock.
+ */
+#define PCP_MAX_ORDER	PAGE_ALLOC_COSTLY_ORDER
+#define NR_PCP_LISTS	(MIGRATE_PCPTYPES * (PCP_MAX_ORDER + 1))
+
 struct per_cpu_pages {
-	int count;		/* number of pages in the list */
+	int count;		/* number of base pages in the lists */
 	int high;		/* high watermark, emptying needed */
 	int batch;		/* chunk size for buddy add/remove */
 
-	/* Lists of pages, one per migrate type stored on the pcp-lists */
-	struct list_head lists[MIGRATE_PCPTYPES];
+	/* Lists of pages, one per order and migrate type on the pcp-lists */
+	struct list_head lists[NR_PCP_LISTS];
 };
 
 struct per_cpu_pageset {
@@ -781,6 +825,10 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;	/* Protected by lock_memory_hotplug() */
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+#ifdef CONFIG_COMPACTION
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;	/* Protected by lock_memory_hotplug() */
+#endif
 #ifdef CONFIG_NUMA_BALANCING
 	/*
 	 * Lock serializing the per destination node AutoNUMA memory
@@ -74,6 +74,10 @@ struct msm_thermal_data {
 	int32_t vdd_mx_temp_degC;
 	int32_t vdd_mx_temp_hyst_degC;
 	int32_t therm_reset_temp_degC;
+	uint32_t power_alloc_sensor_id;
+	int32_t power_alloc_switch_on_degC;
+	int32_t power_alloc_control_degC;
+	uint32_t power_alloc_sustainable_mw;
 };
 
 enum sensor_id_type {
@@ -2253,7 +2253,21 @@ extern int		dev_change_carrier(struct net_device *,
 					   bool new_carrier);
 extern int		dev_hard_start_xmit(struct sk_buff *skb,
 					    struct net_device *dev,
-					    struct netdev_queue *txq);
+					    struct netdev_queue *txq,
+					    bool more);
+
+/*
+ * Hand @skb to the driver.  @more says that another skb follows right away
+ * on the same tx queue and ends up in skb->xmit_more; calling
+ * ndo_start_xmit() only through here keeps the bit from going stale.
+ */
+static inline netdev_tx_t netdev_start_xmit(struct sk_buff *skb,
+					    struct net_device *dev, bool more)
+{
+	skb->xmit_more = more ? 1 : 0;
+	return dev->netdev_ops->ndo_start_xmit(skb, dev);
+}
+
 extern int		dev_forward_skb(struct net_device *dev,
 					struct sk_buff *skb);
 
@@ -2785,6 +2799,7 @@ static inline bool net_gso_ok(netdev_features_t features, int gso_type)
 	BUILD_BUG_ON(SKB_GSO_TCP_ECN != (NETIF_F_TSO_ECN >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_TCPV6   != (NETIF_F_TSO6 >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_FCOE    != (NETIF_F_FSO >> NETIF_F_GSO_SHIFT));
+	BUILD_BUG_ON(SKB_GSO_UDP_L4  != (NETIF_F_GSO_UDP_L4 >> NETIF_F_GSO_SHIFT));
 
 	return (features & feature) == feature;
 }
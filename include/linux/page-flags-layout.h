@@ -85,4 +85,19 @@
 #define LAST_NID_NOT_IN_PAGE_FLAGS
 #endif
 
+/*
+ * The multi-generational LRU labels pages on the active lists with their
+ * generation + 1, or 0 when unlabelled, see include/linux/mm_inline.h.
+ */
+#ifdef CONFIG_LRU_GEN
+#define LRU_GEN_WIDTH 3
+#else
+#define LRU_GEN_WIDTH 0
+#endif
+
+#if SECTIONS_WIDTH+NODES_WIDTH+ZONES_WIDTH+LAST_NID_WIDTH+LRU_GEN_WIDTH \
+	> BITS_PER_LONG - NR_PAGEFLAGS
+#error "No space for the lru_gen field in page flags"
+#endif
+
 #endif /* _LINUX_PAGE_FLAGS_LAYOUT */
@@ -86,9 +86,14 @@ enum pm_qos_type {
 };
 
 /*
- * Note: The lockless read path depends on the CPU accessing target_value
- * or effective_flags atomically.  Atomic access is only guaranteed on all CPU
- * types linux supports for 32 bit quantites
+ * Note: The lockless read path depends on the CPU accessing target_value,
+ * target_per_cpu[] or effective_flags atomically.  Atomic access is only
+ * guaranteed on all CPU types linux supports for 32 bit quantites
+ *
+ * If batch_relax is set, notifications for changes that relax the aggregate
+ * constraint are deferred to notify_work and coalesced, with the affected
+ * CPUs accumulated in notify_pending.  Changes that tighten the constraint
+ * are always notified synchronously.
  */
 struct pm_qos_constraints {
 	struct plist_head list;
@@ -97,6 +102,9 @@ struct pm_qos_constraints {
 	s32 default_value;
 	enum pm_qos_type type;
 	struct blocking_notifier_head *notifiers;
+	bool batch_relax;
+	struct cpumask notify_pending;
+	struct delayed_work notify_work;
 };
 
 struct pm_qos_flags {
@@ -169,8 +169,19 @@ extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
 extern unsigned long this_cpu_load(void);
 
+/* Averages over the last nr_running poll window, all * 100 */
+struct sched_nr_avg {
+	int avg;
+	int max_avg;		/* highest average of a single cpu */
+	int big_avg;
+	int big_avg_decayed;	/* big_avg, decaying by 1/4 per poll */
+	int iowait_avg;
+};
+
 extern void sched_update_nr_prod(int cpu, long delta, bool inc);
 extern void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg);
+extern void sched_get_cpus_nr_running_avg(const struct cpumask *cpus,
+					  struct sched_nr_avg *stats);
 
 extern void calc_global_load(unsigned long ticks);
 extern void update_cpu_load_nohz(void);
@@ -1264,6 +1275,9 @@ struct task_struct {
 	/* Revert to default priority/policy when forking */
 	unsigned sched_reset_on_fork:1;
 	unsigned sched_contributes_to_load:1;
+#ifdef CONFIG_PSI
+	unsigned sched_psi_wake_requeue:1;
+#endif
 
 	unsigned long atomic_flags; /* Flags needing atomic access. */
 
@@ -1505,6 +1519,10 @@ struct task_struct {
 #ifdef	CONFIG_TASK_DELAY_ACCT
 	struct task_delay_info *delays;
 #endif
+#ifdef CONFIG_PSI
+	/* Pressure stall state */
+	unsigned int psi_flags;
+#endif
 #ifdef CONFIG_FAULT_INJECTION
 	int make_it_fail;
 #endif
@@ -1825,6 +1843,7 @@ static inline void sched_set_io_is_busy(int val) {};
 #define PF_FREEZER_SKIP	0x40000000	/* Freezer should not count it as freezable */
 #define PF_WAKE_UP_IDLE 0x80000000	/* try to wake up on an idle CPU */
 
+#define PF_MEMSTALL	0x00000001	/* stalled due to lack of memory */
 #define PF_SU		0x00000002      /* task is su */
 
 /*
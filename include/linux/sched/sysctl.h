@@ -46,6 +46,7 @@ extern unsigned int sysctl_sched_migration_fixup;
 extern unsigned int sysctl_sched_heavy_task_pct;
 extern unsigned int sysctl_sched_min_runtime;
 extern unsigned int sysctl_sched_enable_power_aware;
+extern unsigned int sysctl_sched_nr_avg;
 
 #if defined(CONFIG_SCHED_FREQ_INPUT) || defined(CONFIG_SCHED_HMP)
 extern unsigned int sysctl_sched_init_task_load_pct;
@@ -115,6 +116,10 @@ extern int sched_enable_power_aware_handler(struct ctl_table *table,
 					    int write, void __user *buffer,
 					    size_t *lenp, loff_t *ppos);
 
+extern int sched_nr_avg_handler(struct ctl_table *table, int write,
+				void __user *buffer, size_t *lenp,
+				loff_t *ppos);
+
 #ifdef CONFIG_SCHED_DEBUG
 static inline unsigned int get_sysctl_timer_migration(void)
 {
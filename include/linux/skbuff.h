@@ -107,6 +107,7 @@
  */
 
 struct net_device;
+struct napi_struct;
 struct scatterlist;
 struct pipe_inode_info;
 
@@ -319,6 +320,9 @@ enum {
 	SKB_GSO_GRE = 1 << 6,
 
 	SKB_GSO_UDP_TUNNEL = 1 << 7,
+
+	/* UDP datagrams of gso_size each, not IP fragments as with UFO */
+	SKB_GSO_UDP_L4 = 1 << 8,
 };
 
 #if BITS_PER_LONG > 32
@@ -376,6 +380,8 @@ typedef unsigned char *sk_buff_data_t;
  *	@wifi_acked_valid: wifi_acked was set
  *	@wifi_acked: whether frame was acked on wifi or not
  *	@no_fcs:  Request NIC to treat last 4 bytes as Ethernet FCS
+ *	@xmit_more: More skbs are about to be handed to this tx queue, the
+ *		driver may defer kicking the hardware unless the queue stops
  *	@dma_cookie: a cookie to one of several possible DMA operations
  *		done by skb DMA functions
  *	@secmark: security marking
@@ -485,7 +491,8 @@ struct sk_buff {
 	 * headers if needed
 	 */
 	__u8			encapsulation:1;
-	/* 7/9 bit hole (depending on ndisc_nodetype presence) */
+	__u8			xmit_more:1;
+	/* 5/7 bit hole (depending on ndisc_nodetype presence) */
 	kmemcheck_bitfield_end(flags2);
 
 #ifdef CONFIG_NET_DMA
@@ -625,12 +632,16 @@ extern void	       __kfree_skb(struct sk_buff *skb);
 extern struct kmem_cache *skbuff_head_cache;
 
 extern void kfree_skb_partial(struct sk_buff *skb, bool head_stolen);
+extern void __kfree_skb_defer(struct sk_buff *skb);
+extern void napi_skb_free_stolen_head(struct sk_buff *skb);
+extern void napi_skb_cache_flush(int cpu);
 extern bool skb_try_coalesce(struct sk_buff *to, struct sk_buff *from,
 			     bool *fragstolen, int *delta_truesize);
 
 extern struct sk_buff *__alloc_skb(unsigned int size,
 				   gfp_t priority, int flags, int node);
 extern struct sk_buff *build_skb(void *data, unsigned int frag_size);
+extern struct sk_buff *napi_build_skb(void *data, unsigned int frag_size);
 static inline struct sk_buff *alloc_skb(unsigned int size,
 					gfp_t priority)
 {
@@ -1971,6 +1982,23 @@ static inline struct sk_buff *netdev_alloc_skb(struct net_device *dev,
 	return __netdev_alloc_skb(dev, length, GFP_ATOMIC);
 }
 
+extern struct sk_buff *__napi_alloc_skb(struct napi_struct *napi,
+					unsigned int length, gfp_t gfp_mask);
+
+/**
+ *	napi_alloc_skb - allocate an skbuff for rx in a specific NAPI instance
+ *	@napi: napi instance this buffer was allocated for
+ *	@length: length to allocate
+ *
+ *	The skb head comes from a per-cpu cache that is refilled in bulk.
+ *	Must be called from softirq context, typically the NAPI poll loop.
+ */
+static inline struct sk_buff *napi_alloc_skb(struct napi_struct *napi,
+					     unsigned int length)
+{
+	return __napi_alloc_skb(napi, length, GFP_ATOMIC);
+}
+
 /* legacy helper around __netdev_alloc_skb() */
 static inline struct sk_buff *__dev_alloc_skb(unsigned int length,
 					      gfp_t gfp_mask)
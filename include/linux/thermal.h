@@ -56,6 +56,8 @@
 #define DEFAULT_THERMAL_GOVERNOR       "fair_share"
 #elif defined(CONFIG_THERMAL_DEFAULT_GOV_USER_SPACE)
 #define DEFAULT_THERMAL_GOVERNOR       "user_space"
+#elif defined(CONFIG_THERMAL_DEFAULT_GOV_POWER_ALLOCATOR)
+#define DEFAULT_THERMAL_GOVERNOR       "power_allocator"
 #endif
 
 struct thermal_zone_device;
@@ -143,10 +145,22 @@ struct thermal_zone_device_ops {
 		       enum thermal_trip_type);
 };
 
+/*
+ * The power callbacks are optional and only used by the power_allocator
+ * governor.  Power is in mW.  get_requested_power() returns the power the
+ * device would consume at its current utilization if left unthrottled,
+ * state2power() the maximum power it can consume in a cooling state, and
+ * power2state() the least throttled state that keeps it within a budget.
+ */
 struct thermal_cooling_device_ops {
 	int (*get_max_state) (struct thermal_cooling_device *, unsigned long *);
 	int (*get_cur_state) (struct thermal_cooling_device *, unsigned long *);
 	int (*set_cur_state) (struct thermal_cooling_device *, unsigned long);
+	int (*get_requested_power) (struct thermal_cooling_device *, u32 *);
+	int (*state2power) (struct thermal_cooling_device *, unsigned long,
+			    u32 *);
+	int (*power2state) (struct thermal_cooling_device *, u32,
+			    unsigned long *);
 };
 
 struct thermal_cooling_device {
@@ -209,6 +223,7 @@ struct thermal_zone_device {
 	const struct thermal_zone_device_ops *ops;
 	const struct thermal_zone_params *tzp;
 	struct thermal_governor *governor;
+	void *governor_data;
 	struct list_head thermal_instances;
 	struct idr idr;
 	struct mutex lock; /* protect thermal_instances list */
@@ -219,9 +234,14 @@ struct thermal_zone_device {
 };
 
 /* Structure that holds thermal governor information */
+/*
+ * unbind_from_tz() is called, with the zone's lock held, when a zone stops
+ * using the governor so that it can free tz->governor_data.
+ */
 struct thermal_governor {
 	char name[THERMAL_NAME_LENGTH];
 	int (*throttle)(struct thermal_zone_device *tz, int trip);
+	void (*unbind_from_tz)(struct thermal_zone_device *tz);
 	struct list_head	governor_list;
 };
 
@@ -252,6 +272,20 @@ struct thermal_zone_params {
 	char governor_name[THERMAL_NAME_LENGTH];
 	int num_tbps;	/* Number of tbp entries */
 	struct thermal_bind_params *tbp;
+
+	/*
+	 * Parameters of the power_allocator governor.  sustainable_power is
+	 * the power in mW the zone can dissipate at its control temperature.
+	 * The PID gains are in mW per temperature unit of the zone (k_i per
+	 * unit per sample, k_d per unit per second).  Zero values are
+	 * estimated from the cooling devices and trip points.
+	 */
+	u32 sustainable_power;
+	s32 k_po;	/* proportional gain above the control temperature */
+	s32 k_pu;	/* proportional gain below the control temperature */
+	s32 k_i;
+	s32 k_d;
+	s32 integral_cutoff;	/* only integrate errors below this */
 };
 
 struct thermal_genl_event {
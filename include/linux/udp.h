@@ -63,7 +63,11 @@ struct udp_sock {
 #define UDPLITE_SEND_CC  0x2  		/* set via udplite setsockopt         */
 #define UDPLITE_RECV_CC  0x4		/* set via udplite setsocktopt        */
 	__u8		 pcflag;        /* marks socket as UDP-Lite if > 0    */
-	__u8		 unused[3];
+	__u8		 unused[1];
+	/*
+	 * Payload size of each datagram a send is cut into, see UDP_SEGMENT.
+	 */
+	__u16		 gso_size;
 	/*
 	 * For encapsulation sockets.
 	 */
@@ -71,6 +75,9 @@ struct udp_sock {
 	void (*encap_destroy)(struct sock *sk);
 };
 
+/* Most datagrams a single UDP_SEGMENT send may be cut into */
+#define UDP_MAX_SEGMENTS	64
+
 static inline struct udp_sock *udp_sk(const struct sock *sk)
 {
 	return (struct udp_sock *)sk;
@@ -31,6 +31,11 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		FOR_ALL_ZONES(PGSCAN_KSWAPD),
 		FOR_ALL_ZONES(PGSCAN_DIRECT),
 		PGSCAN_DIRECT_THROTTLE,
+#ifdef CONFIG_SWAP
+		SWAP_RA,		/* pages read ahead on swap-in */
+		SWAP_RA_HIT,		/* of which used */
+		SWAP_DIRECT,		/* swap-ins that skipped the swap cache */
+#endif
 #ifdef CONFIG_NUMA
 		PGSCAN_ZONE_RECLAIM_FAILED,
 #endif
@@ -51,6 +56,9 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		COMPACTMIGRATE_SCANNED, COMPACTFREE_SCANNED,
 		COMPACTISOLATED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		KCOMPACTD_WAKE,
+		KCOMPACTD_MIGRATE_SCANNED, KCOMPACTD_FREE_SCANNED,
+		KCOMPACTD_SUCCESS, KCOMPACTD_FAIL,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -70,6 +78,13 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		THP_SPLIT,
 		THP_ZERO_PAGE_ALLOC,
 		THP_ZERO_PAGE_ALLOC_FAILED,
+#endif
+#ifdef CONFIG_LRU_GEN
+		LRU_GEN_AGING,		/* page table walks of all mms */
+		LRU_GEN_PTE_SCANNED,
+		LRU_GEN_PTE_YOUNG,
+		LRU_GEN_PROMOTED,	/* moved into the youngest generation */
+		LRU_GEN_DEMOTED,	/* moved to the inactive list */
 #endif
 		NR_VM_EVENT_ITEMS
 };
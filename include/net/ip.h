@@ -57,6 +57,7 @@ struct ipcm_cookie {
 	int			oif;
 	struct ip_options_rcu	*opt;
 	__u8			tx_flags;
+	__u16			gso_size;	/* only read by ip_make_skb() */
 };
 
 #define IPCB(skb) ((struct inet_skb_parm*)((skb)->cb))
@@ -84,8 +84,15 @@ print_tuple(struct seq_file *s, const struct nf_conntrack_tuple *tuple,
             const struct nf_conntrack_l3proto *l3proto,
             const struct nf_conntrack_l4proto *proto);
 
+/* Protects expectations, helper assignment and the SIP segment lists */
 extern spinlock_t nf_conntrack_lock ;
 
+/* Hash chains are protected by bucket % CONNTRACK_LOCKS */
+#define CONNTRACK_LOCKS 1024
+
+extern spinlock_t nf_conntrack_locks[CONNTRACK_LOCKS];
+extern void nf_conntrack_bucket_lock(spinlock_t *lock);
+
 struct sip_list {
 	struct nf_queue_entry *entry;
 	struct list_head list;
@@ -235,6 +235,7 @@ struct cg_proto;
   *	@sk_allocation: allocation mode
   *	@sk_pacing_rate: Pacing rate (if supported by transport/packet scheduler)
   *	@sk_max_pacing_rate: Maximum pacing rate (%SO_MAX_PACING_RATE)
+  *	@sk_incoming_cpu: CPU the owner last received on (%SO_REUSEPORT_CPU)
   *	@sk_sndbuf: size of send buffer in bytes
   *	@sk_flags: %SO_LINGER (l_onoff), %SO_BROADCAST, %SO_KEEPALIVE,
   *		   %SO_OOBINLINE settings, %SO_TIMESTAMPING settings
@@ -363,6 +364,7 @@ struct sock {
 	gfp_t			sk_allocation;
 	u32			sk_pacing_rate; /* bytes per second */
 	u32			sk_max_pacing_rate;
+	int			sk_incoming_cpu;
 	netdev_features_t	sk_route_caps;
 	netdev_features_t	sk_route_nocaps;
 	int			sk_gso_type;
@@ -677,6 +679,7 @@ enum sock_flags {
 		     */
 	SOCK_FILTER_LOCKED, /* Filter cannot be changed anymore */
 	SOCK_SELECT_ERR_QUEUE, /* Wake select on error queue */
+	SOCK_REUSEPORT_CPU, /* %SO_REUSEPORT_CPU setting */
 };
 
 #define SK_FLAGS_TIMESTAMP ((1UL << SOCK_TIMESTAMP) | (1UL << SOCK_TIMESTAMPING_RX_SOFTWARE))
@@ -701,6 +704,26 @@ static inline bool sock_flag(const struct sock *sk, enum sock_flags flag)
 	return test_bit(flag, &sk->sk_flags);
 }
 
+/*
+ * SO_REUSEPORT_CPU: of equally good reuseport sockets, a UDP lookup picks
+ * the one whose owner last received on the CPU doing the lookup, so that
+ * the wakeup stays on that CPU.  TCP listener lookups keep to the flow
+ * hash: the SYN and the ACK completing the handshake may be looked up on
+ * different CPUs and must still find the same listener.
+ */
+static inline void sk_reuseport_cpu_update(struct sock *sk)
+{
+	int cpu = raw_smp_processor_id();
+
+	if (sock_flag(sk, SOCK_REUSEPORT_CPU) && sk->sk_incoming_cpu != cpu)
+		sk->sk_incoming_cpu = cpu;
+}
+
+static inline bool sk_reuseport_cpu_match(const struct sock *sk)
+{
+	return sk->sk_incoming_cpu == raw_smp_processor_id();
+}
+
 #ifdef CONFIG_NET
 extern struct static_key memalloc_socks;
 static inline int sk_memalloc_socks(void)
@@ -78,4 +78,10 @@
 
 #define SO_MAX_PACING_RATE	46
 
+/*
+ * Options not taken from mainline are numbered from 0x7000 on every
+ * architecture, clear of the values mainline keeps allocating.
+ */
+#define SO_REUSEPORT_CPU	0x7000
+
 #endif /* __ASM_GENERIC_SOCKET_H */
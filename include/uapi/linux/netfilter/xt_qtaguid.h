@@ -0,0 +1,49 @@
+#ifndef _XT_QTAGUID_MATCH_H
+#define _XT_QTAGUID_MATCH_H
+
+/* For now we just replace the xt_owner.
+ * FIXME: make iptables aware of qtaguid. */
+#include <linux/types.h>
+#include <linux/if.h>
+#include <linux/netfilter/xt_owner.h>
+
+#define XT_QTAGUID_UID    XT_OWNER_UID
+#define XT_QTAGUID_GID    XT_OWNER_GID
+#define XT_QTAGUID_SOCKET XT_OWNER_SOCKET
+#define xt_qtaguid_match_info xt_owner_match_info
+
+/*
+ * Records read from /proc/net/xt_qtaguid/stats_delta, one per interface,
+ * tag and counter set, holding the same counters as the text stats file.
+ * A read from offset 0 starts a new pass, which returns only the entries
+ * whose counters changed since the previous pass on the same open file.
+ * Whatever is left unread of a pass when the next one starts is lost.
+ * The counters are totals, not differences.
+ *
+ * The first pass, and the first pass after any entry was deleted, is a
+ * full one: it starts with a record carrying XT_QTAGUID_REC_RESET and
+ * nothing else, after which every entry is returned.  A reader drops
+ * whatever it kept from earlier passes when it sees that record.
+ */
+enum {
+	XT_QTAGUID_PROTO_TCP,
+	XT_QTAGUID_PROTO_UDP,
+	XT_QTAGUID_PROTO_OTHER,
+	XT_QTAGUID_PROTOS
+};
+
+#define XT_QTAGUID_REC_RESET	(1 << 0)
+
+struct xt_qtaguid_stats_rec {
+	char iface[IFNAMSIZ];
+	__u64 acct_tag;
+	__u32 uid;
+	__u16 cnt_set;
+	__u16 flags;	/* XT_QTAGUID_REC_* */
+	__u64 rx_bytes[XT_QTAGUID_PROTOS];
+	__u64 rx_packets[XT_QTAGUID_PROTOS];
+	__u64 tx_bytes[XT_QTAGUID_PROTOS];
+	__u64 tx_packets[XT_QTAGUID_PROTOS];
+};
+
+#endif /* _XT_QTAGUID_MATCH_H */
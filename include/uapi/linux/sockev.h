@@ -17,6 +17,9 @@ enum sknetlink_groups {
 *		Socket operation messages
 ****/
 
+/* Several of these, each behind its own nlmsghdr, may arrive in one
+ * datagram on SKNLGRP_SOCKEV.
+ */
 struct sknlsockevmsg {
 	__u8 event[SOCKEV_STR_MAX];
 	__u32 pid; /* (struct task_struct*)->pid */
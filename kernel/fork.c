@@ -566,6 +566,13 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	mm->core_state = NULL;
 	mm->nr_ptes = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
+#ifdef CONFIG_PROCESS_RECLAIM
+	memset(&mm->reclaim_stat, 0, sizeof(mm->reclaim_stat));
+#endif
+#ifdef CONFIG_KSM
+	mm->ksm_rmap_items = 0;
+	mm->ksm_merging_pages = 0;
+#endif
 	spin_lock_init(&mm->page_table_lock);
 	mm_init_aio(mm);
 	mm_init_owner(mm, p);
@@ -574,6 +581,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	if (likely(!mm_alloc_pgd(mm))) {
 		mm->def_flags = 0;
 		mmu_notifier_mm_init(mm);
+		lru_gen_add_mm(mm);
 		return mm;
 	}
 
@@ -622,6 +630,7 @@ struct mm_struct *mm_alloc(void)
 void __mmdrop(struct mm_struct *mm)
 {
 	BUG_ON(mm == &init_mm);
+	lru_gen_del_mm(mm);
 	mm_free_pgd(mm);
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
@@ -887,6 +896,7 @@ fail_nocontext:
 	 * If init_new_context() failed, we cannot use mmput() to free the mm
 	 * because it calls destroy_context()
 	 */
+	lru_gen_del_mm(mm);
 	mm_free_pgd(mm);
 	free_mm(mm);
 	return NULL;
@@ -1112,7 +1122,7 @@ static void copy_flags(unsigned long clone_flags, struct task_struct *p)
 {
 	unsigned long new_flags = p->flags;
 
-	new_flags &= ~(PF_SUPERPRIV | PF_WQ_WORKER);
+	new_flags &= ~(PF_SUPERPRIV | PF_WQ_WORKER | PF_MEMSTALL);
 	new_flags |= PF_FORKNOEXEC;
 	p->flags = new_flags;
 }
@@ -11,6 +11,7 @@
  */
 
 #include <linux/irq.h>
+#include <linux/cpuidle.h>
 #include <linux/random.h>
 #include <linux/sched.h>
 #include <linux/interrupt.h>
@@ -173,6 +174,7 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 	} while (action);
 
 	add_interrupt_randomness(irq, flags);
+	cpuidle_predict_irq(irq);
 
 	if (!noirqdebug)
 		note_interrupt(irq, desc, retval);
@@ -51,6 +51,9 @@
  * locking rule: all changes to constraints or notifiers lists
  * or pm_qos_object list and pm_qos_objects need to happen with pm_qos_lock
  * held, taken with _irqsave.  One lock to rule them all
+ *
+ * Readers of the aggregated values (target_value and target_per_cpu[]) do
+ * not take the lock, as these are read from the cpuidle hot path.
  */
 struct pm_qos_object {
 	struct pm_qos_constraints *constraints;
@@ -60,6 +63,11 @@ struct pm_qos_object {
 
 static DEFINE_SPINLOCK(pm_qos_lock);
 
+/* How long relaxed constraints may go unnotified, in milliseconds */
+#define PM_QOS_RELAX_NOTIFY_DELAY_MS	10
+
+static void pm_qos_notify_work_fn(struct work_struct *work);
+
 static struct pm_qos_object null_pm_qos;
 
 static BLOCKING_NOTIFIER_HEAD(cpu_dma_lat_notifier);
@@ -71,6 +79,9 @@ static struct pm_qos_constraints cpu_dma_constraints = {
 	.default_value = PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE,
 	.type = PM_QOS_MIN,
 	.notifiers = &cpu_dma_lat_notifier,
+	.batch_relax = true,
+	.notify_work = __DELAYED_WORK_INITIALIZER(cpu_dma_constraints.notify_work,
+						  pm_qos_notify_work_fn, 0),
 };
 static struct pm_qos_object cpu_dma_pm_qos = {
 	.constraints = &cpu_dma_constraints,
@@ -152,65 +163,110 @@ static inline int pm_qos_get_value(struct pm_qos_constraints *c)
 
 s32 pm_qos_read_value(struct pm_qos_constraints *c)
 {
-	return c->target_value;
+	return ACCESS_ONCE(c->target_value);
 }
 
 static inline void pm_qos_set_value(struct pm_qos_constraints *c, s32 value)
 {
-	c->target_value = value;
+	ACCESS_ONCE(c->target_value) = value;
 }
 
-static inline void pm_qos_set_value_for_cpus(struct pm_qos_constraints *c,
-		struct cpumask *cpus)
+/* unlocked internal variant */
+static s32 pm_qos_get_value_for_cpu(struct pm_qos_constraints *c, int cpu)
 {
-	struct pm_qos_request *req = NULL;
-	int cpu;
-	s32 qos_val[NR_CPUS] = { [0 ... (NR_CPUS - 1)] = c->default_value };
+	struct pm_qos_request *req;
+	s32 val = c->default_value;
 
 	plist_for_each_entry(req, &c->list, node) {
-		for_each_cpu(cpu, &req->cpus_affine) {
-			switch (c->type) {
-			case PM_QOS_MIN:
-				if (qos_val[cpu] > req->node.prio)
-					qos_val[cpu] = req->node.prio;
-				break;
-			case PM_QOS_MAX:
-				if (req->node.prio > qos_val[cpu])
-					qos_val[cpu] = req->node.prio;
-				break;
-			default:
-				BUG();
-				break;
-			}
+		if (!cpumask_test_cpu(cpu, &req->cpus_affine))
+			continue;
+
+		switch (c->type) {
+		case PM_QOS_MIN:
+			/* the list is sorted ascending, so the first hit wins */
+			return min_t(s32, val, req->node.prio);
+		case PM_QOS_MAX:
+			val = max_t(s32, val, req->node.prio);
+			break;
+		default:
+			BUG();
+			break;
 		}
 	}
 
-	for_each_possible_cpu(cpu) {
-		if (c->target_per_cpu[cpu] != qos_val[cpu])
-			cpumask_set_cpu(cpu, cpus);
-		c->target_per_cpu[cpu] = qos_val[cpu];
+	return val;
+}
+
+/*
+ * Recompute the per-cpu aggregate for the CPUs in @affected only, which
+ * are the CPUs the changed request applies to, and record the CPUs whose
+ * value actually changed in @cpus.
+ */
+static inline void pm_qos_set_value_for_cpus(struct pm_qos_constraints *c,
+		const struct cpumask *affected, struct cpumask *cpus)
+{
+	int cpu;
+	s32 qos_val;
+
+	for_each_cpu(cpu, affected) {
+		qos_val = pm_qos_get_value_for_cpu(c, cpu);
+		if (c->target_per_cpu[cpu] == qos_val)
+			continue;
+
+		cpumask_set_cpu(cpu, cpus);
+		ACCESS_ONCE(c->target_per_cpu[cpu]) = qos_val;
 	}
 }
 
+/* true if @new is a less restrictive constraint than @old */
+static inline bool pm_qos_value_relaxed(struct pm_qos_constraints *c,
+		s32 old, s32 new)
+{
+	return c->type == PM_QOS_MIN ? new > old : new < old;
+}
+
 /**
- * pm_qos_update_target - manages the constraints list and calls the notifiers
- *  if needed
- * @c: constraints data struct
- * @req: request to add to the list, to update or to remove
- * @action: action to take on the constraints list
- * @value: value of the request to add or update
+ * pm_qos_notify_work_fn - delivers batched relax notifications
+ * @work: notify_work of the constraints that have pending notifications
  *
- * This function returns 1 if the aggregated constraint value has changed, 0
- *  otherwise.
+ * Every relaxation that happened since the work was queued is reported
+ * with a single call of the notifier chain, using the current target value
+ * and the union of the CPUs whose values changed.
  */
-int pm_qos_update_target(struct pm_qos_constraints *c,
-				struct pm_qos_request *req,
-				enum pm_qos_req_action action, int value)
+static void pm_qos_notify_work_fn(struct work_struct *work)
+{
+	struct pm_qos_constraints *c = container_of(to_delayed_work(work),
+						    struct pm_qos_constraints,
+						    notify_work);
+	unsigned long flags;
+	struct cpumask cpus;
+	s32 value;
+
+	spin_lock_irqsave(&pm_qos_lock, flags);
+	cpumask_copy(&cpus, &c->notify_pending);
+	cpumask_clear(&c->notify_pending);
+	value = c->target_value;
+	spin_unlock_irqrestore(&pm_qos_lock, flags);
+
+	if (!cpumask_empty(&cpus))
+		blocking_notifier_call_chain(c->notifiers,
+					     (unsigned long)value, &cpus);
+}
+
+/*
+ * Only the per-cpu values of the CPUs in @affected are recomputed; if it is
+ * NULL, the CPUs the request is currently affine to are used.
+ */
+static int __pm_qos_update_target(struct pm_qos_constraints *c,
+				  struct pm_qos_request *req,
+				  enum pm_qos_req_action action, int value,
+				  const struct cpumask *affected)
 {
 	unsigned long flags;
 	int prev_value, curr_value, new_value;
 	struct plist_node *node = &req->node;
 	struct cpumask cpus;
+	bool defer;
 
 	spin_lock_irqsave(&pm_qos_lock, flags);
 	prev_value = pm_qos_get_value(c);
@@ -242,18 +298,54 @@ int pm_qos_update_target(struct pm_qos_constraints *c,
 	curr_value = pm_qos_get_value(c);
 	cpumask_clear(&cpus);
 	pm_qos_set_value(c, curr_value);
-	pm_qos_set_value_for_cpus(c, &cpus);
+	pm_qos_set_value_for_cpus(c, affected ? affected : &req->cpus_affine,
+				  &cpus);
+
+	/*
+	 * A relaxed constraint only costs power until the watchers hear
+	 * about it, so coalesce those.  Anything else is notified right away
+	 * and takes the pending CPUs along.
+	 */
+	defer = c->batch_relax && prev_value != curr_value &&
+		pm_qos_value_relaxed(c, prev_value, curr_value);
+	if (defer) {
+		cpumask_or(&c->notify_pending, &c->notify_pending, &cpus);
+	} else if (c->batch_relax && prev_value != curr_value) {
+		cpumask_or(&cpus, &cpus, &c->notify_pending);
+		cpumask_clear(&c->notify_pending);
+	}
 
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
 
-	if (prev_value != curr_value) {
+	if (prev_value == curr_value)
+		return 0;
+
+	if (defer)
+		schedule_delayed_work(&c->notify_work,
+			msecs_to_jiffies(PM_QOS_RELAX_NOTIFY_DELAY_MS));
+	else
 		blocking_notifier_call_chain(c->notifiers,
 					     (unsigned long)curr_value,
 					     &cpus);
-		return 1;
-	} else {
-		return 0;
-	}
+	return 1;
+}
+
+/**
+ * pm_qos_update_target - manages the constraints list and calls the notifiers
+ *  if needed
+ * @c: constraints data struct
+ * @req: request to add to the list, to update or to remove
+ * @action: action to take on the constraints list
+ * @value: value of the request to add or update
+ *
+ * This function returns 1 if the aggregated constraint value has changed, 0
+ *  otherwise.
+ */
+int pm_qos_update_target(struct pm_qos_constraints *c,
+				struct pm_qos_request *req,
+				enum pm_qos_req_action action, int value)
+{
+	return __pm_qos_update_target(c, req, action, value, NULL);
 }
 
 /**
@@ -333,7 +425,8 @@ EXPORT_SYMBOL_GPL(pm_qos_request);
 
 int pm_qos_request_for_cpu(int pm_qos_class, int cpu)
 {
-	return pm_qos_array[pm_qos_class]->constraints->target_per_cpu[cpu];
+	return ACCESS_ONCE(
+		pm_qos_array[pm_qos_class]->constraints->target_per_cpu[cpu]);
 }
 EXPORT_SYMBOL(pm_qos_request_for_cpu);
 
@@ -343,33 +436,37 @@ int pm_qos_request_active(struct pm_qos_request *req)
 }
 EXPORT_SYMBOL_GPL(pm_qos_request_active);
 
+/*
+ * Lockless: each per-cpu value is read atomically, but the result may mix
+ * values from before and after a concurrent update.  Watchers are notified
+ * once the update is complete, so they will see the final value.
+ */
 int pm_qos_request_for_cpumask(int pm_qos_class, struct cpumask *mask)
 {
-	unsigned long irqflags;
 	int cpu;
 	struct pm_qos_constraints *c = NULL;
-	int val;
+	int val, cpu_val;
 
-	spin_lock_irqsave(&pm_qos_lock, irqflags);
 	c = pm_qos_array[pm_qos_class]->constraints;
 	val = c->default_value;
 
 	for_each_cpu(cpu, mask) {
+		cpu_val = ACCESS_ONCE(c->target_per_cpu[cpu]);
+
 		switch (c->type) {
 		case PM_QOS_MIN:
-			if (c->target_per_cpu[cpu] < val)
-				val = c->target_per_cpu[cpu];
+			if (cpu_val < val)
+				val = cpu_val;
 			break;
 		case PM_QOS_MAX:
-			if (c->target_per_cpu[cpu] > val)
-				val = c->target_per_cpu[cpu];
+			if (cpu_val > val)
+				val = cpu_val;
 			break;
 		default:
 			BUG();
 			break;
 		}
 	}
-	spin_unlock_irqrestore(&pm_qos_lock, irqflags);
 
 	return val;
 }
@@ -414,7 +511,8 @@ static void pm_qos_irq_release(struct kref *ref)
 	cpumask_setall(&req->cpus_affine);
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
 
-	pm_qos_update_target(c, req, PM_QOS_UPDATE_REQ, c->default_value);
+	__pm_qos_update_target(c, req, PM_QOS_UPDATE_REQ, c->default_value,
+			       cpu_possible_mask);
 }
 
 static void pm_qos_irq_notify(struct irq_affinity_notify *notify,
@@ -425,12 +523,16 @@ static void pm_qos_irq_notify(struct irq_affinity_notify *notify,
 					struct pm_qos_request, irq_notify);
 	struct pm_qos_constraints *c =
 				pm_qos_array[req->pm_qos_class]->constraints;
+	struct cpumask affected;
 
+	/* CPUs the IRQ moved away from need their values recomputed too */
 	spin_lock_irqsave(&pm_qos_lock, flags);
+	cpumask_or(&affected, &req->cpus_affine, mask);
 	cpumask_copy(&req->cpus_affine, mask);
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
 
-	pm_qos_update_target(c, req, PM_QOS_UPDATE_REQ, req->node.prio);
+	__pm_qos_update_target(c, req, PM_QOS_UPDATE_REQ, req->node.prio,
+			       &affected);
 }
 #endif
 
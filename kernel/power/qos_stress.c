@@ -0,0 +1,313 @@
+/*
+ * PM QoS concurrency stress test
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Writer threads add, update and remove cpu_dma_latency requests with
+ * random CPU affinity and values, while reader threads use the lockless
+ * pm_qos_request_for_cpu() and pm_qos_request_for_cpumask() and check
+ * every value is either the one from before the test or one a writer
+ * could have set.  Once the threads are stopped the per-cpu values must
+ * match the requests left behind exactly, a tightening request must be
+ * notified before pm_qos_add_request() returns, and the batched relax
+ * notification must bring the watchers back to the final value.  The
+ * results are printed to the kernel log and loading fails on purpose so
+ * that the module can be loaded again right away.
+ */
+
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/random.h>
+#include <linux/cpumask.h>
+#include <linux/pm_qos.h>
+
+#define STRESS_CLASS		PM_QOS_CPU_DMA_LATENCY
+#define STRESS_MIN_US		10
+#define STRESS_MAX_US		1000
+/* longer than PM_QOS_RELAX_NOTIFY_DELAY_MS */
+#define STRESS_RELAX_WAIT_MS	100
+
+static unsigned int writers;
+module_param(writers, uint, 0444);
+MODULE_PARM_DESC(writers, "Writer threads, default one per online CPU");
+
+static unsigned int readers;
+module_param(readers, uint, 0444);
+MODULE_PARM_DESC(readers, "Reader threads, default one per online CPU");
+
+static unsigned int requests = 4;
+module_param(requests, uint, 0444);
+MODULE_PARM_DESC(requests, "Requests owned by each writer");
+
+static unsigned int duration_ms = 2000;
+module_param(duration_ms, uint, 0444);
+MODULE_PARM_DESC(duration_ms, "Time the writers and readers run for");
+
+struct stress_writer {
+	struct task_struct *task;
+	struct pm_qos_request *reqs;
+	unsigned long ops;
+};
+
+struct stress_reader {
+	struct task_struct *task;
+	unsigned long reads;
+	unsigned long errors;
+};
+
+static s32 baseline[NR_CPUS];
+static s32 notified_value;
+static atomic_t notify_count = ATOMIC_INIT(0);
+
+static int stress_notify(struct notifier_block *nb, unsigned long value,
+			 void *data)
+{
+	ACCESS_ONCE(notified_value) = value;
+	atomic_inc(&notify_count);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block stress_nb = {
+	.notifier_call = stress_notify,
+};
+
+static s32 stress_value(void)
+{
+	return STRESS_MIN_US + prandom_u32() % (STRESS_MAX_US - STRESS_MIN_US);
+}
+
+/* a random non-empty subset of the online CPUs */
+static void stress_mask(struct cpumask *mask)
+{
+	int cpu;
+
+	cpumask_clear(mask);
+	for_each_online_cpu(cpu) {
+		if (prandom_u32() & 1)
+			cpumask_set_cpu(cpu, mask);
+	}
+	if (cpumask_empty(mask))
+		cpumask_set_cpu(cpumask_any(cpu_online_mask), mask);
+}
+
+static int stress_writer_fn(void *data)
+{
+	struct stress_writer *w = data;
+	struct pm_qos_request *req;
+
+	while (!kthread_should_stop()) {
+		req = &w->reqs[prandom_u32() % requests];
+
+		if (!pm_qos_request_active(req)) {
+			req->type = PM_QOS_REQ_AFFINE_CORES;
+			stress_mask(&req->cpus_affine);
+			pm_qos_add_request(req, STRESS_CLASS, stress_value());
+		} else if (!(prandom_u32() % 8)) {
+			pm_qos_remove_request(req);
+		} else {
+			pm_qos_update_request(req, stress_value());
+		}
+		w->ops++;
+		cond_resched();
+	}
+	return 0;
+}
+
+/* a MIN class aggregate is the baseline or one of the writers' values */
+static bool stress_value_ok(s32 val, s32 base)
+{
+	return val == base || (val >= STRESS_MIN_US && val <= STRESS_MAX_US);
+}
+
+static int stress_reader_fn(void *data)
+{
+	struct stress_reader *r = data;
+	struct cpumask mask;
+	s32 val, base;
+	int cpu;
+
+	while (!kthread_should_stop()) {
+		for_each_online_cpu(cpu) {
+			val = pm_qos_request_for_cpu(STRESS_CLASS, cpu);
+			if (!stress_value_ok(val, baseline[cpu]))
+				r->errors++;
+			r->reads++;
+		}
+
+		stress_mask(&mask);
+		base = PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE;
+		for_each_cpu(cpu, &mask)
+			base = min(base, baseline[cpu]);
+		val = pm_qos_request_for_cpumask(STRESS_CLASS, &mask);
+		if (!stress_value_ok(val, base))
+			r->errors++;
+		r->reads++;
+		cond_resched();
+	}
+	return 0;
+}
+
+/* per-cpu values with the writers stopped and their requests in place */
+static int stress_check_final(struct stress_writer *w)
+{
+	struct pm_qos_request *req;
+	int cpu, errors = 0;
+	unsigned int i, j;
+	s32 expected;
+
+	for_each_online_cpu(cpu) {
+		expected = baseline[cpu];
+		for (i = 0; i < writers; i++) {
+			for (j = 0; j < requests; j++) {
+				req = &w[i].reqs[j];
+				if (pm_qos_request_active(req) &&
+				    cpumask_test_cpu(cpu, &req->cpus_affine))
+					expected = min(expected,
+						       req->node.prio);
+			}
+		}
+		if (pm_qos_request_for_cpu(STRESS_CLASS, cpu) != expected) {
+			pr_err("qos_stress: cpu%d is %d, expected %d\n", cpu,
+			       pm_qos_request_for_cpu(STRESS_CLASS, cpu),
+			       expected);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+/* tightening is notified synchronously, relaxing after the batch delay */
+static int stress_check_notify(void)
+{
+	struct pm_qos_request req;
+	int errors = 0;
+
+	/* nothing to tighten if something else already asks for less */
+	if (pm_qos_request(STRESS_CLASS) < STRESS_MIN_US)
+		return 0;
+
+	memset(&req, 0, sizeof(req));
+	req.type = PM_QOS_REQ_ALL_CORES;
+	pm_qos_add_request(&req, STRESS_CLASS, STRESS_MIN_US - 1);
+	if (ACCESS_ONCE(notified_value) != STRESS_MIN_US - 1) {
+		pr_err("qos_stress: tightening to %d not notified\n",
+		       STRESS_MIN_US - 1);
+		errors++;
+	}
+	pm_qos_remove_request(&req);
+
+	msleep(STRESS_RELAX_WAIT_MS);
+	if (ACCESS_ONCE(notified_value) != pm_qos_request(STRESS_CLASS)) {
+		pr_err("qos_stress: last notified %d, target is %d\n",
+		       ACCESS_ONCE(notified_value),
+		       pm_qos_request(STRESS_CLASS));
+		errors++;
+	}
+	return errors;
+}
+
+static int __init qos_stress_init(void)
+{
+	struct stress_writer *w;
+	struct stress_reader *r;
+	unsigned long ops = 0, reads = 0, read_errors = 0;
+	unsigned int i, j;
+	int cpu, errors;
+	int ret = -ENOMEM;
+
+	if (!writers)
+		writers = num_online_cpus();
+	if (!readers)
+		readers = num_online_cpus();
+	if (!requests)
+		return -EINVAL;
+
+	w = kcalloc(writers, sizeof(*w), GFP_KERNEL);
+	r = kcalloc(readers, sizeof(*r), GFP_KERNEL);
+	if (!w || !r)
+		goto out;
+	for (i = 0; i < writers; i++) {
+		w[i].reqs = kcalloc(requests, sizeof(*w[i].reqs), GFP_KERNEL);
+		if (!w[i].reqs)
+			goto out;
+	}
+
+	for_each_possible_cpu(cpu)
+		baseline[cpu] = pm_qos_request_for_cpu(STRESS_CLASS, cpu);
+	notified_value = pm_qos_request(STRESS_CLASS);
+	pm_qos_add_notifier(STRESS_CLASS, &stress_nb);
+
+	for (i = 0; i < writers; i++)
+		w[i].task = kthread_run(stress_writer_fn, &w[i],
+					"qos_stress_w/%u", i);
+	for (i = 0; i < readers; i++)
+		r[i].task = kthread_run(stress_reader_fn, &r[i],
+					"qos_stress_r/%u", i);
+
+	msleep(duration_ms);
+
+	for (i = 0; i < writers; i++) {
+		if (!IS_ERR(w[i].task))
+			kthread_stop(w[i].task);
+		ops += w[i].ops;
+	}
+	for (i = 0; i < readers; i++) {
+		if (!IS_ERR(r[i].task))
+			kthread_stop(r[i].task);
+		reads += r[i].reads;
+		read_errors += r[i].errors;
+	}
+
+	errors = stress_check_final(w);
+	for (i = 0; i < writers; i++) {
+		for (j = 0; j < requests; j++) {
+			if (pm_qos_request_active(&w[i].reqs[j]))
+				pm_qos_remove_request(&w[i].reqs[j]);
+		}
+	}
+	for_each_online_cpu(cpu) {
+		if (pm_qos_request_for_cpu(STRESS_CLASS, cpu) != baseline[cpu]) {
+			pr_err("qos_stress: cpu%d not back to %d\n", cpu,
+			       baseline[cpu]);
+			errors++;
+		}
+	}
+	errors += stress_check_notify();
+
+	pm_qos_remove_notifier(STRESS_CLASS, &stress_nb);
+
+	pr_info("qos_stress: %u writers %lu ops, %u readers %lu reads, %d notifications\n",
+		writers, ops, readers, reads, atomic_read(&notify_count));
+	pr_info("qos_stress: %lu bad reads, %d bad final values: %s\n",
+		read_errors, errors, read_errors || errors ? "FAIL" : "PASS");
+	ret = -EAGAIN; /* Fail will directly unload the module */
+
+out:
+	for (i = 0; w && i < writers; i++)
+		kfree(w[i].reqs);
+	kfree(w);
+	kfree(r);
+
+	return ret;
+}
+
+static void __exit qos_stress_exit(void)
+{
+}
+
+module_init(qos_stress_init)
+module_exit(qos_stress_exit)
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("PM QoS concurrency stress test");
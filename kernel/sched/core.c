@@ -869,6 +869,7 @@ static void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_queued(p);
+	psi_enqueue(p, flags & ENQUEUE_WAKEUP);
 	p->sched_class->enqueue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 1, cpumask_bits(&p->cpus_allowed)[0]);
 }
@@ -877,6 +878,7 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_dequeued(p);
+	psi_dequeue(p, flags & DEQUEUE_SLEEP);
 	p->sched_class->dequeue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 0, cpumask_bits(&p->cpus_allowed)[0]);
 }
@@ -2267,13 +2269,35 @@ scale_load_to_freq(u64 load, unsigned int src_freq, unsigned int dst_freq)
 	return div64_u64(load * (u64)src_freq, (u64)dst_freq);
 }
 
+/*
+ * Busy time the fair tasks queued on @rq contributed to its previous
+ * window, in the units of rq->prev_runnable_sum. Tasks that have not been
+ * updated since the window rolled over still hold it in curr_window.
+ */
+static u64 rq_cfs_prev_window(struct rq *rq)
+{
+	struct task_struct *p;
+	u64 sum = 0;
+
+	list_for_each_entry(p, &rq->cfs_tasks, se.group_node) {
+		if (p->ravg.mark_start >= rq->window_start)
+			sum += p->ravg.prev_window;
+		else if (p->ravg.mark_start + sched_ravg_window >=
+			 rq->window_start)
+			sum += p->ravg.curr_window;
+	}
+
+	return min(sum, rq->prev_runnable_sum);
+}
+
 void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 {
 	unsigned long flags;
 	struct rq *rq;
 	const int cpus = cpumask_weight(query_cpus);
-	u64 load[cpus];
+	u64 load[cpus], raw_load[cpus], cfs_load[cpus];
 	unsigned int cur_freq[cpus], max_freq[cpus];
+	unsigned int util_min[cpus], util_max[cpus];
 	int notifier_sent[cpus];
 	int cpu, i = 0;
 	unsigned int window_size;
@@ -2297,6 +2321,7 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 
 		update_task_ravg(rq->curr, rq, TASK_UPDATE, sched_clock(), 0);
 		load[i] = rq->old_busy_time = rq->prev_runnable_sum;
+		raw_load[i] = load[i];
 		/*
 		 * Scale load in reference to rq->max_possible_freq.
 		 *
@@ -2309,6 +2334,10 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 		rq->notifier_sent = 0;
 		cur_freq[i] = rq->cur_freq;
 		max_freq[i] = rq->max_freq;
+		rq_uclamp(rq, &util_min[i], &util_max[i]);
+		cfs_load[i] = 0;
+		if (util_min[i] || util_max[i] < 100)
+			cfs_load[i] = rq_cfs_prev_window(rq);
 		i++;
 	}
 
@@ -2332,6 +2361,22 @@ void sched_get_cpus_busy(unsigned long *busy, const struct cpumask *query_cpus)
 						     rq->max_possible_freq);
 		}
 
+		/*
+		 * Apply the utilization clamps of the fair tasks queued on
+		 * the cpu, relative to its maximum possible frequency, to
+		 * their share of the load only. RT and irq time is never
+		 * capped.
+		 */
+		if (util_min[i] || util_max[i] < 100) {
+			u64 cfs = raw_load[i] ? div64_u64(load[i] * cfs_load[i],
+							  raw_load[i]) : 0;
+
+			load[i] -= cfs;
+			load[i] += clamp_t(u64, cfs,
+				div64_u64((u64)window_size * util_min[i], 100),
+				div64_u64((u64)window_size * util_max[i], 100));
+		}
+
 		busy[i] = div64_u64(load[i], NSEC_PER_USEC);
 
 		trace_sched_get_busy(cpu, busy[i]);
@@ -3448,6 +3493,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 	src_cpu = task_cpu(p);
 	if (src_cpu != cpu) {
 		wake_flags |= WF_MIGRATED;
+		psi_ttwu_dequeue(p);
 		set_task_cpu(p, cpu);
 	} else {
 		note_run_start(p, wallclock);
@@ -3577,6 +3623,11 @@ static void __sched_fork(struct task_struct *p)
 
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_PSI
+	p->psi_flags			= 0;
+	p->sched_psi_wake_requeue	= 0;
+#endif
+
 /*
  * Load-tracking only depends on SMP, FAIR_GROUP_SCHED dependency below may be
  * removed when useful for applications beyond shares distribution (e.g.
@@ -4159,7 +4210,7 @@ static long calc_load_fold_active(struct rq *this_rq)
 /*
  * a1 = a0 * e + a * (1 - e)
  */
-static unsigned long
+unsigned long
 calc_load(unsigned long load, unsigned long exp, unsigned long active)
 {
 	unsigned long newload;
@@ -4171,6 +4222,74 @@ calc_load(unsigned long load, unsigned long exp, unsigned long active)
 	return newload / FIXED_1;
 }
 
+/**
+ * fixed_power_int - compute: x^n, in O(log n) time
+ *
+ * @x:         base of the power
+ * @frac_bits: fractional bits of @x
+ * @n:         power to raise @x to.
+ *
+ * By exploiting the relation between the definition of the natural power
+ * function: x^n := x*x*...*x (x multiplied by itself for n times), and
+ * the binary encoding of numbers used by computers: n := \Sum n_i * 2^i,
+ * (where: n_i \elem {0, 1}, the binary vector representing n),
+ * we find: x^n := x^(\Sum n_i * 2^i) := \Prod x^(n_i * 2^i), which is
+ * of course trivially computable in O(log_2 n), the length of our binary
+ * vector.
+ */
+static unsigned long
+fixed_power_int(unsigned long x, unsigned int frac_bits, unsigned int n)
+{
+	unsigned long result = 1UL << frac_bits;
+
+	if (n) for (;;) {
+		if (n & 1) {
+			result *= x;
+			result += 1UL << (frac_bits - 1);
+			result >>= frac_bits;
+		}
+		n >>= 1;
+		if (!n)
+			break;
+		x *= x;
+		x += 1UL << (frac_bits - 1);
+		x >>= frac_bits;
+	}
+
+	return result;
+}
+
+/*
+ * a1 = a0 * e + a * (1 - e)
+ *
+ * a2 = a1 * e + a * (1 - e)
+ *    = (a0 * e + a * (1 - e)) * e + a * (1 - e)
+ *    = a0 * e^2 + a * (1 - e) * (1 + e)
+ *
+ * a3 = a2 * e + a * (1 - e)
+ *    = (a0 * e^2 + a * (1 - e) * (1 + e)) * e + a * (1 - e)
+ *    = a0 * e^3 + a * (1 - e) * (1 + e + e^2)
+ *
+ *  ...
+ *
+ * an = a0 * e^n + a * (1 - e) * (1 + e + ... + e^n-1) [1]
+ *    = a0 * e^n + a * (1 - e) * (1 - e^n)/(1 - e)
+ *    = a0 * e^n + a * (1 - e^n)
+ *
+ * [1] application of the geometric series:
+ *
+ *              n         1 - x^(n+1)
+ *     S_n := \Sum x^i = -------------
+ *             i=0          1 - x
+ */
+unsigned long
+calc_load_n(unsigned long load, unsigned long exp,
+	    unsigned long active, unsigned int n)
+{
+
+	return calc_load(load, fixed_power_int(exp, FSHIFT, n), active);
+}
+
 #ifdef CONFIG_NO_HZ_COMMON
 /*
  * Handle NO_HZ for the global load-average.
@@ -4289,74 +4408,6 @@ static long calc_load_fold_idle(void)
 	return delta;
 }
 
-/**
- * fixed_power_int - compute: x^n, in O(log n) time
- *
- * @x:         base of the power
- * @frac_bits: fractional bits of @x
- * @n:         power to raise @x to.
- *
- * By exploiting the relation between the definition of the natural power
- * function: x^n := x*x*...*x (x multiplied by itself for n times), and
- * the binary encoding of numbers used by computers: n := \Sum n_i * 2^i,
- * (where: n_i \elem {0, 1}, the binary vector representing n),
- * we find: x^n := x^(\Sum n_i * 2^i) := \Prod x^(n_i * 2^i), which is
- * of course trivially computable in O(log_2 n), the length of our binary
- * vector.
- */
-static unsigned long
-fixed_power_int(unsigned long x, unsigned int frac_bits, unsigned int n)
-{
-	unsigned long result = 1UL << frac_bits;
-
-	if (n) for (;;) {
-		if (n & 1) {
-			result *= x;
-			result += 1UL << (frac_bits - 1);
-			result >>= frac_bits;
-		}
-		n >>= 1;
-		if (!n)
-			break;
-		x *= x;
-		x += 1UL << (frac_bits - 1);
-		x >>= frac_bits;
-	}
-
-	return result;
-}
-
-/*
- * a1 = a0 * e + a * (1 - e)
- *
- * a2 = a1 * e + a * (1 - e)
- *    = (a0 * e + a * (1 - e)) * e + a * (1 - e)
- *    = a0 * e^2 + a * (1 - e) * (1 + e)
- *
- * a3 = a2 * e + a * (1 - e)
- *    = (a0 * e^2 + a * (1 - e) * (1 + e)) * e + a * (1 - e)
- *    = a0 * e^3 + a * (1 - e) * (1 + e + e^2)
- *
- *  ...
- *
- * an = a0 * e^n + a * (1 - e) * (1 + e + ... + e^n-1) [1]
- *    = a0 * e^n + a * (1 - e) * (1 - e^n)/(1 - e)
- *    = a0 * e^n + a * (1 - e^n)
- *
- * [1] application of the geometric series:
- *
- *              n         1 - x^(n+1)
- *     S_n := \Sum x^i = -------------
- *             i=0          1 - x
- */
-static unsigned long
-calc_load_n(unsigned long load, unsigned long exp,
-	    unsigned long active, unsigned int n)
-{
-
-	return calc_load(load, fixed_power_int(exp, FSHIFT, n), active);
-}
-
 /*
  * NO_HZ can leave us missing all per-cpu ticks calling
  * calc_load_account_active(), but since an idle CPU folds its delta into
@@ -9242,6 +9293,9 @@ void __init sched_init(void)
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
+#ifdef CONFIG_SCHED_HMP
+	root_task_group.util_max = 100;
+#endif
 	autogroup_init(&init_task);
 
 #endif /* CONFIG_CGROUP_SCHED */
@@ -9394,6 +9448,8 @@ void __init sched_init(void)
 #endif
 	init_sched_fair_class();
 
+	psi_init();
+
 	scheduler_running = 1;
 }
 
@@ -9579,6 +9635,10 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!tg)
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_SCHED_HMP
+	tg->util_max = 100;
+#endif
+
 	if (!alloc_fair_sched_group(tg, parent))
 		goto err;
 
@@ -10128,6 +10188,63 @@ static int cpu_upmigrate_discourage_write_u64(struct cgroup *cgrp,
 	return 0;
 }
 
+static u64 cpu_util_min_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->util_min;
+}
+
+static u64 cpu_util_max_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->util_max;
+}
+
+static DEFINE_MUTEX(uclamp_mutex);
+
+/*
+ * Set the clamps applied to the demand of the group's tasks. As with
+ * upmigrate_discourage, big/small task counts and the per-cpu clamp
+ * buckets of all runqueues are recomputed under their locks.
+ */
+static int cpu_util_write_u64(struct cgroup *cgrp, struct cftype *cft,
+			      u64 val)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	bool is_min = cft->private;
+	unsigned int util_min, util_max;
+	int i, ret = 0;
+
+	if (val > 100)
+		return -ERANGE;
+
+	mutex_lock(&uclamp_mutex);
+
+	util_min = is_min ? val : tg->util_min;
+	util_max = is_min ? tg->util_max : val;
+	if (util_min > util_max) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	if (util_min == tg->util_min && util_max == tg->util_max)
+		goto unlock;
+
+	get_online_cpus();
+	pre_big_small_task_count_change(cpu_online_mask);
+
+	tg->util_min = util_min;
+	tg->util_max = util_max;
+
+	for_each_cpu(i, cpu_online_mask)
+		fixup_rq_uclamp(i);
+
+	post_big_small_task_count_change(cpu_online_mask);
+	put_online_cpus();
+
+unlock:
+	mutex_unlock(&uclamp_mutex);
+	return ret;
+}
+
 #endif	/* CONFIG_SCHED_HMP */
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -10419,6 +10536,20 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_upmigrate_discourage_read_u64,
 		.write_u64 = cpu_upmigrate_discourage_write_u64,
 	},
+	{
+		.name = "util_min",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_util_min_read_u64,
+		.write_u64 = cpu_util_write_u64,
+		.private = 1,
+	},
+	{
+		.name = "util_max",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_util_max_read_u64,
+		.write_u64 = cpu_util_write_u64,
+		.private = 0,
+	},
 #endif
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -1020,6 +1020,105 @@ static void task_tick_numa(struct rq *rq, struct task_struct *curr)
 }
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_SCHED_HMP
+
+#ifdef CONFIG_CGROUP_SCHED
+
+static inline unsigned int task_util_min(struct task_struct *p)
+{
+	return task_group(p)->util_min;
+}
+
+static inline unsigned int task_util_max(struct task_struct *p)
+{
+	return task_group(p)->util_max;
+}
+
+#else
+
+static inline unsigned int task_util_min(struct task_struct *p)
+{
+	return 0;
+}
+
+static inline unsigned int task_util_max(struct task_struct *p)
+{
+	return 100;
+}
+
+#endif
+
+/* Clamps are rounded up to the next bucket boundary */
+static inline int uclamp_bucket(unsigned int pct)
+{
+	return DIV_ROUND_UP(pct, UCLAMP_BUCKET_PCT);
+}
+
+static inline void inc_rq_uclamp(struct rq *rq, struct task_struct *p)
+{
+	rq->uclamp_min_tasks[uclamp_bucket(task_util_min(p))]++;
+	rq->uclamp_max_tasks[uclamp_bucket(task_util_max(p))]++;
+	rq->uclamp_nr_tasks++;
+}
+
+static inline void dec_rq_uclamp(struct rq *rq, struct task_struct *p)
+{
+	rq->uclamp_min_tasks[uclamp_bucket(task_util_min(p))]--;
+	rq->uclamp_max_tasks[uclamp_bucket(task_util_max(p))]--;
+	rq->uclamp_nr_tasks--;
+}
+
+/*
+ * Recount the clamp buckets of a cpu after a cgroup changed its clamps.
+ * Called with the rq lock held.
+ */
+void fixup_rq_uclamp(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *p;
+
+	rq->uclamp_nr_tasks = 0;
+	memset(rq->uclamp_min_tasks, 0, sizeof(rq->uclamp_min_tasks));
+	memset(rq->uclamp_max_tasks, 0, sizeof(rq->uclamp_max_tasks));
+
+	list_for_each_entry(p, &rq->cfs_tasks, se.group_node)
+		inc_rq_uclamp(rq, p);
+}
+
+/*
+ * Effective clamps of a cpu, in percent: the highest util_min and the
+ * highest util_max of the fair tasks queued on it. A cpu only ends up
+ * capped when all of its tasks are, and one without fair tasks is not
+ * clamped at all. Called with the rq lock held.
+ */
+void rq_uclamp(struct rq *rq, unsigned int *util_min, unsigned int *util_max)
+{
+	int i;
+
+	*util_min = 0;
+	*util_max = 100;
+
+	if (!rq->uclamp_nr_tasks)
+		return;
+
+	for (i = UCLAMP_BUCKETS - 1; i > 0; i--)
+		if (rq->uclamp_min_tasks[i])
+			break;
+	*util_min = i * UCLAMP_BUCKET_PCT;
+
+	for (i = UCLAMP_BUCKETS - 1; i > 0; i--)
+		if (rq->uclamp_max_tasks[i])
+			break;
+	*util_max = i * UCLAMP_BUCKET_PCT;
+}
+
+#else	/* CONFIG_SCHED_HMP */
+
+static inline void inc_rq_uclamp(struct rq *rq, struct task_struct *p) { }
+static inline void dec_rq_uclamp(struct rq *rq, struct task_struct *p) { }
+
+#endif	/* CONFIG_SCHED_HMP */
+
 static void
 account_entity_enqueue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -1027,8 +1126,10 @@ account_entity_enqueue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	if (!parent_entity(se))
 		update_load_add(&rq_of(cfs_rq)->load, se->load.weight);
 #ifdef CONFIG_SMP
-	if (entity_is_task(se))
+	if (entity_is_task(se)) {
 		list_add(&se->group_node, &rq_of(cfs_rq)->cfs_tasks);
+		inc_rq_uclamp(rq_of(cfs_rq), task_of(se));
+	}
 #endif
 	cfs_rq->nr_running++;
 }
@@ -1039,8 +1140,10 @@ account_entity_dequeue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	update_load_sub(&cfs_rq->load, se->load.weight);
 	if (!parent_entity(se))
 		update_load_sub(&rq_of(cfs_rq)->load, se->load.weight);
-	if (entity_is_task(se))
+	if (entity_is_task(se)) {
 		list_del_init(&se->group_node);
+		dec_rq_uclamp(rq_of(cfs_rq), task_of(se));
+	}
 	cfs_rq->nr_running--;
 }
 
@@ -1259,12 +1362,30 @@ unsigned int __read_mostly sysctl_sched_init_task_load_pct = 15;
 unsigned int __read_mostly sysctl_sched_min_runtime = 0; /* 0 ms */
 u64 __read_mostly sched_min_runtime = 0; /* 0 ms */
 
+/*
+ * Demand of a task as seen by task placement: the tracked demand clamped
+ * to the util_min/util_max window of the task's cpu cgroup. Both clamps
+ * are in percent of max_task_load(), that is of the capacity of the most
+ * capable cpu at its maximum frequency.
+ */
 static inline unsigned int task_load(struct task_struct *p)
 {
+	unsigned int load, clamp;
+
 	if (sched_use_pelt)
-		return p->se.avg.runnable_avg_sum_scaled;
+		load = p->se.avg.runnable_avg_sum_scaled;
+	else
+		load = p->ravg.demand;
+
+	clamp = task_util_min(p);
+	if (unlikely(clamp))
+		load = max_t(unsigned int, load, pct_to_real(clamp));
 
-	return p->ravg.demand;
+	clamp = task_util_max(p);
+	if (unlikely(clamp < 100))
+		load = min_t(unsigned int, load, pct_to_real(clamp));
+
+	return load;
 }
 
 unsigned int max_task_load(void)
@@ -6,6 +6,7 @@
 #include <linux/spinlock.h>
 #include <linux/stop_machine.h>
 #include <linux/tick.h>
+#include <linux/psi.h>
 
 #include "cpupri.h"
 #include "cpuacct.h"
@@ -139,6 +140,8 @@ struct task_group {
 	bool notify_on_migrate;
 #ifdef CONFIG_SCHED_HMP
 	bool upmigrate_discouraged;
+	/* clamps on the demand of member tasks, in percent */
+	unsigned int util_min, util_max;
 #endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -246,6 +249,10 @@ struct cfs_bandwidth { };
 
 #ifdef CONFIG_SCHED_HMP
 
+/* Utilization clamps are tracked per rq with a granularity of 10% */
+#define UCLAMP_BUCKET_PCT	10
+#define UCLAMP_BUCKETS		(100 / UCLAMP_BUCKET_PCT + 1)
+
 struct hmp_sched_stats {
 	int nr_big_tasks, nr_small_tasks;
 	u64 cumulative_runnable_avg;
@@ -524,6 +531,11 @@ struct rq {
 
 	struct hmp_sched_stats hmp_stats;
 
+	/* Number of fair tasks on this rq in each utilization clamp bucket */
+	unsigned int uclamp_nr_tasks;
+	unsigned int uclamp_min_tasks[UCLAMP_BUCKETS];
+	unsigned int uclamp_max_tasks[UCLAMP_BUCKETS];
+
 	int efficiency; /* Differentiate cpus with different IPC capability */
 	int load_scale_factor;
 	int capacity;
@@ -969,6 +981,9 @@ extern unsigned int power_cost_at_freq(int cpu, unsigned int freq);
 extern void reset_all_window_stats(u64 window_start, unsigned int window_size);
 extern void boost_kick(int cpu);
 extern int sched_boost(void);
+extern void fixup_rq_uclamp(int cpu);
+extern void rq_uclamp(struct rq *rq, unsigned int *util_min,
+		      unsigned int *util_max);
 
 #else /* CONFIG_SCHED_HMP */
 
@@ -1409,6 +1424,11 @@ extern void update_max_interval(void);
 extern void init_sched_rt_class(void);
 extern void init_sched_fair_class(void);
 
+extern unsigned long calc_load(unsigned long load, unsigned long exp,
+			       unsigned long active);
+extern unsigned long calc_load_n(unsigned long load, unsigned long exp,
+				 unsigned long active, unsigned int n);
+
 extern void resched_task(struct task_struct *p);
 extern void resched_cpu(int cpu);
 
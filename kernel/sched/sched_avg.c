@@ -12,24 +12,93 @@
 
 /*
  * Scheduler hook for average runqueue determination
+ *
+ * sched_update_nr_prod() is called with the rq lock held just before
+ * rq->nr_running changes, so updates of a cpu's sums are already
+ * serialized and no lock of their own is needed.  The sums only ever
+ * grow; readers sample them under a per-cpu seqcount and keep the
+ * values seen at their previous poll to compute averages over the
+ * window in between.
  */
 #include <linux/module.h>
 #include <linux/percpu.h>
 #include <linux/hrtimer.h>
 #include <linux/sched.h>
 #include <linux/math64.h>
+#include <linux/seqlock.h>
+#include <linux/mutex.h>
 #include <trace/events/sched.h>
 
 #include "sched.h"
 
-static DEFINE_PER_CPU(u64, nr_prod_sum);
-static DEFINE_PER_CPU(u64, last_time);
-static DEFINE_PER_CPU(u64, nr_big_prod_sum);
-static DEFINE_PER_CPU(u64, nr);
+/*
+ * Can be cleared to measure the cost of the tracking. The averages then
+ * degrade to samples of the counts taken at each poll.
+ */
+unsigned int __read_mostly sysctl_sched_nr_avg = 1;
+
+struct nr_stats_s {
+	seqcount_t seq;
+	u64 last_time;
+	u64 nr_prod_sum;
+	u64 nr_big_prod_sum;
+	u64 iowait_prod_sum;
+};
+
+/* Sums seen by the last poll and the averages over its window */
+struct nr_avg_s {
+	u64 nr_prod_sum;
+	u64 nr_big_prod_sum;
+	u64 iowait_prod_sum;
+	int avg;
+	int big_avg;
+	int iowait_avg;
+	int big_avg_decayed;
+};
+
+static DEFINE_PER_CPU(struct nr_stats_s, nr_stats);
+static DEFINE_PER_CPU(struct nr_avg_s, nr_avg);
+static u64 last_get_time;
+
+/*
+ * Time spent with the tracking off, so that a poll averages the sums only
+ * over the part of its window they were kept in.  nr_avg_off_total counts
+ * the completed off periods, nr_avg_off_since starts the current one.
+ */
+static DEFINE_RAW_SPINLOCK(nr_avg_off_lock);
+static bool nr_avg_off;
+static u64 nr_avg_off_since;
+static u64 nr_avg_off_total;
+static u64 last_off_total;
+
+/* Sample the sums of @cpu, accounted up to @curr_time */
+static void read_nr_stats(int cpu, u64 curr_time, u64 *nr_sum, u64 *big_sum,
+			  u64 *iowait_sum)
+{
+	struct nr_stats_s *stats = &per_cpu(nr_stats, cpu);
+	unsigned int seq;
+	u64 diff;
+
+	do {
+		seq = read_seqcount_begin(&stats->seq);
+		diff = curr_time - min(curr_time, stats->last_time);
+		*nr_sum = stats->nr_prod_sum +
+			  cpu_rq(cpu)->nr_running * diff;
+		*big_sum = stats->nr_big_prod_sum +
+			   nr_eligible_big_tasks(cpu) * diff;
+		*iowait_sum = stats->iowait_prod_sum +
+			      nr_iowait_cpu(cpu) * diff;
+	} while (read_seqcount_retry(&stats->seq, seq));
+}
+
+/* Average * 100 over a window of @diff ns */
+static inline int window_avg(u64 sum, u64 prev_sum, u64 diff)
+{
+	if (sum <= prev_sum)
+		return 0;
 
-static DEFINE_PER_CPU(unsigned long, iowait_prod_sum);
-static DEFINE_PER_CPU(spinlock_t, nr_lock) = __SPIN_LOCK_UNLOCKED(nr_lock);
-static s64 last_get_time;
+	return (int)div64_u64((sum - prev_sum) * 100, diff);
+}
 
 /**
  * sched_get_nr_running_avg
@@ -37,7 +106,10 @@ static s64 last_get_time;
  *	    Returns the avg * 100 to return up to two decimal points
  *	    of accuracy.
  *
- * Obtains the average nr_running value since the last poll.
+ * Obtains the average nr_running value since the last poll. The per-cpu
+ * averages of the same window are kept for sched_get_cpus_nr_running_avg().
+ * A window spent entirely with the tracking off reports the counts at the
+ * time of the poll instead.
  * This function may not be called concurrently with itself
  */
 void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
@@ -46,6 +118,8 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 	u64 curr_time = sched_clock();
 	u64 diff = curr_time - last_get_time;
 	u64 tmp_avg = 0, tmp_iowait = 0, tmp_big_avg = 0;
+	u64 stats_time = curr_time, off_total, on_time;
+	unsigned long flags;
 
 	*avg = 0;
 	*iowait_avg = 0;
@@ -54,39 +128,60 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 	if (!diff)
 		return;
 
-	/* read and reset nr_running counts */
-	for_each_possible_cpu(cpu) {
-		unsigned long flags;
+	last_get_time = curr_time;
+
+	raw_spin_lock_irqsave(&nr_avg_off_lock, flags);
+	off_total = nr_avg_off_total;
+	if (nr_avg_off) {
+		/* the sums were brought up to the start of the off period */
+		stats_time = nr_avg_off_since;
+		off_total += curr_time - min(curr_time, nr_avg_off_since);
+	}
+	raw_spin_unlock_irqrestore(&nr_avg_off_lock, flags);
 
-		spin_lock_irqsave(&per_cpu(nr_lock, cpu), flags);
-		curr_time = sched_clock();
-		tmp_avg += per_cpu(nr_prod_sum, cpu);
-		tmp_avg += per_cpu(nr, cpu) *
-			(curr_time - per_cpu(last_time, cpu));
+	on_time = diff - min(diff, off_total - last_off_total);
+	last_off_total = off_total;
 
-		tmp_big_avg += per_cpu(nr_big_prod_sum, cpu);
-		tmp_big_avg += nr_eligible_big_tasks(cpu) *
-			(curr_time - per_cpu(last_time, cpu));
+	for_each_possible_cpu(cpu) {
+		struct nr_avg_s *cpu_avg = &per_cpu(nr_avg, cpu);
+		u64 nr_sum, big_sum, iowait_sum;
 
-		tmp_iowait += per_cpu(iowait_prod_sum, cpu);
-		tmp_iowait +=  nr_iowait_cpu(cpu) *
-			(curr_time - per_cpu(last_time, cpu));
+		read_nr_stats(cpu, stats_time, &nr_sum, &big_sum, &iowait_sum);
 
-		per_cpu(last_time, cpu) = curr_time;
+		if (on_time) {
+			cpu_avg->avg = window_avg(nr_sum, cpu_avg->nr_prod_sum,
+						  on_time);
+			cpu_avg->big_avg = window_avg(big_sum,
+						      cpu_avg->nr_big_prod_sum,
+						      on_time);
+			cpu_avg->iowait_avg = window_avg(iowait_sum,
+						cpu_avg->iowait_prod_sum,
+						on_time);
+		} else {
+			cpu_avg->avg = cpu_rq(cpu)->nr_running * 100;
+			cpu_avg->big_avg = nr_eligible_big_tasks(cpu) * 100;
+			cpu_avg->iowait_avg = nr_iowait_cpu(cpu) * 100;
+		}
 
-		per_cpu(nr_prod_sum, cpu) = 0;
-		per_cpu(nr_big_prod_sum, cpu) = 0;
-		per_cpu(iowait_prod_sum, cpu) = 0;
+		/* follow increases at once, decay by 1/4 per poll */
+		if (cpu_avg->big_avg >= cpu_avg->big_avg_decayed)
+			cpu_avg->big_avg_decayed = cpu_avg->big_avg;
+		else
+			cpu_avg->big_avg_decayed -= (cpu_avg->big_avg_decayed -
+						     cpu_avg->big_avg) >> 2;
 
-		spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
-	}
+		cpu_avg->nr_prod_sum = nr_sum;
+		cpu_avg->nr_big_prod_sum = big_sum;
+		cpu_avg->iowait_prod_sum = iowait_sum;
 
-	diff = curr_time - last_get_time;
-	last_get_time = curr_time;
+		tmp_avg += cpu_avg->avg;
+		tmp_big_avg += cpu_avg->big_avg;
+		tmp_iowait += cpu_avg->iowait_avg;
+	}
 
-	*avg = (int)div64_u64(tmp_avg * 100, diff);
-	*big_avg = (int)div64_u64(tmp_big_avg * 100, diff);
-	*iowait_avg = (int)div64_u64(tmp_iowait * 100, diff);
+	*avg = (int)tmp_avg;
+	*big_avg = (int)tmp_big_avg;
+	*iowait_avg = (int)tmp_iowait;
 
 	trace_sched_get_nr_running_avg(*avg, *big_avg, *iowait_avg);
 
@@ -96,6 +191,57 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 }
 EXPORT_SYMBOL(sched_get_nr_running_avg);
 
+/**
+ * sched_get_cpus_nr_running_avg
+ * @cpus: The cpus to report on, typically those of a cluster.
+ * @stats: Filled with the sums of the per-cpu averages of @cpus, and the
+ *	   highest single cpu average, all * 100.
+ *
+ * Reports on the window of the last sched_get_nr_running_avg() poll and
+ * does not sample anything itself, so it can be called at any time and
+ * by any number of users.
+ */
+void sched_get_cpus_nr_running_avg(const struct cpumask *cpus,
+				   struct sched_nr_avg *stats)
+{
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for_each_cpu(cpu, cpus) {
+		struct nr_avg_s *cpu_avg = &per_cpu(nr_avg, cpu);
+		int avg = ACCESS_ONCE(cpu_avg->avg);
+
+		stats->avg += avg;
+		stats->max_avg = max(stats->max_avg, avg);
+		stats->big_avg += ACCESS_ONCE(cpu_avg->big_avg);
+		stats->iowait_avg += ACCESS_ONCE(cpu_avg->iowait_avg);
+		stats->big_avg_decayed += ACCESS_ONCE(cpu_avg->big_avg_decayed);
+	}
+}
+EXPORT_SYMBOL(sched_get_cpus_nr_running_avg);
+
+/*
+ * Account @cpu's counts up to now, called with its rq lock held.  With
+ * @resync the time since the last update is dropped instead.
+ */
+static void update_nr_stats(int cpu, bool resync)
+{
+	struct nr_stats_s *stats = &per_cpu(nr_stats, cpu);
+	u64 curr_time = sched_clock();
+	u64 diff = curr_time - min(curr_time, stats->last_time);
+
+	if (resync)
+		diff = 0;
+
+	write_seqcount_begin(&stats->seq);
+	stats->last_time = curr_time;
+	stats->nr_prod_sum += cpu_rq(cpu)->nr_running * diff;
+	stats->nr_big_prod_sum += nr_eligible_big_tasks(cpu) * diff;
+	stats->iowait_prod_sum += nr_iowait_cpu(cpu) * diff;
+	write_seqcount_end(&stats->seq);
+}
+
 /**
  * sched_update_nr_prod
  * @cpu: The core id of the nr running driver.
@@ -103,26 +249,74 @@ EXPORT_SYMBOL(sched_get_nr_running_avg);
  * @inc: Whether we are increasing or decreasing the count
  * @return: N/A
  *
- * Update average with latest nr_running value for CPU
+ * Update average with latest nr_running value for CPU. Called with the rq
+ * lock of @cpu held, before rq->nr_running is adjusted by @delta.
  */
 void sched_update_nr_prod(int cpu, long delta, bool inc)
 {
-	int diff;
-	s64 curr_time;
-	unsigned long flags, nr_running;
-
-	spin_lock_irqsave(&per_cpu(nr_lock, cpu), flags);
-	nr_running = per_cpu(nr, cpu);
-	curr_time = sched_clock();
-	diff = curr_time - per_cpu(last_time, cpu);
-	per_cpu(last_time, cpu) = curr_time;
-	per_cpu(nr, cpu) = nr_running + (inc ? delta : -delta);
-
-	BUG_ON((s64)per_cpu(nr, cpu) < 0);
-
-	per_cpu(nr_prod_sum, cpu) += nr_running * diff;
-	per_cpu(nr_big_prod_sum, cpu) += nr_eligible_big_tasks(cpu) * diff;
-	per_cpu(iowait_prod_sum, cpu) += nr_iowait_cpu(cpu) * diff;
-	spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
+	if (!sysctl_sched_nr_avg)
+		return;
+
+	update_nr_stats(cpu, false);
 }
 EXPORT_SYMBOL(sched_update_nr_prod);
+
+static void nr_avg_update_all(bool resync)
+{
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		raw_spin_lock_irqsave(&cpu_rq(cpu)->lock, flags);
+		update_nr_stats(cpu, resync);
+		raw_spin_unlock_irqrestore(&cpu_rq(cpu)->lock, flags);
+	}
+}
+
+/*
+ * On disable every cpu's sums are brought up to now, and the poller stops
+ * extrapolating them past that point.  On enable the time spent off is
+ * dropped from the sums before updates resume, and left out of the window
+ * the next poll averages over.
+ */
+int sched_nr_avg_handler(struct ctl_table *table, int write,
+			 void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	static DEFINE_MUTEX(mutex);
+	struct ctl_table t = *table;
+	unsigned int val;
+	unsigned long flags;
+	u64 now;
+	int ret;
+
+	mutex_lock(&mutex);
+	val = sysctl_sched_nr_avg;
+	t.data = &val;
+	ret = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+	if (ret || !write || !val == !sysctl_sched_nr_avg)
+		goto out;
+
+	if (val) {
+		nr_avg_update_all(true);
+		sysctl_sched_nr_avg = val;
+		now = sched_clock();
+	} else {
+		sysctl_sched_nr_avg = val;
+		now = sched_clock();
+		nr_avg_update_all(false);
+	}
+
+	raw_spin_lock_irqsave(&nr_avg_off_lock, flags);
+	if (val) {
+		nr_avg_off_total += now - min(now, nr_avg_off_since);
+		nr_avg_off = false;
+	} else {
+		nr_avg_off_since = now;
+		nr_avg_off = true;
+	}
+	raw_spin_unlock_irqrestore(&nr_avg_off_lock, flags);
+out:
+	mutex_unlock(&mutex);
+
+	return ret;
+}
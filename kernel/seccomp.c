@@ -41,6 +41,7 @@
  *         is only needed for handling filters shared across tasks.
  * @prev: points to a previously installed, or inherited, filter
  * @len: the number of instructions in the program
+ * @bpf_func: sk_run_filter() or the image built by seccomp_jit_compile()
  * @insns: the BPF program instructions to evaluate
  *
  * seccomp_filter objects are organized in a tree linked via the @prev
@@ -57,6 +58,8 @@ struct seccomp_filter {
 	atomic_t usage;
 	struct seccomp_filter *prev;
 	unsigned short len;  /* Instruction count */
+	unsigned int (*bpf_func)(const struct sk_buff *skb,
+				 const struct sock_filter *filter);
 	struct sock_filter insns[];
 };
 
@@ -113,6 +116,21 @@ u32 seccomp_bpf_load(int off)
 	BUG();
 }
 
+/*
+ * Architectures with a BPF JIT override these to compile a checked and
+ * rewritten filter into native code.  A NULL return keeps the filter on
+ * sk_run_filter().
+ */
+void * __weak seccomp_jit_compile(const struct sock_filter *insns,
+				  unsigned int len)
+{
+	return NULL;
+}
+
+void __weak seccomp_jit_free(void *image)
+{
+}
+
 /**
  *	seccomp_check_filter - verify seccomp filter code
  *	@filter: filter to verify
@@ -218,7 +236,7 @@ static u32 seccomp_run_filters(int syscall)
 	 * value always takes priority (ignoring the DATA).
 	 */
 	for (; f; f = f->prev) {
-		u32 cur_ret = sk_run_filter(NULL, f->insns);
+		u32 cur_ret = f->bpf_func(NULL, f->insns);
 		
 		if ((cur_ret & SECCOMP_RET_ACTION) < (ret & SECCOMP_RET_ACTION))
 			ret = cur_ret;
@@ -416,6 +434,10 @@ static struct seccomp_filter *seccomp_prepare_filter(struct sock_fprog *fprog)
 	if (ret)
 		goto fail;
 
+	filter->bpf_func = seccomp_jit_compile(filter->insns, filter->len);
+	if (!filter->bpf_func)
+		filter->bpf_func = sk_run_filter;
+
 	return filter;
 
 fail:
@@ -511,6 +533,8 @@ void get_seccomp_filter(struct task_struct *tsk)
 static inline void seccomp_filter_free(struct seccomp_filter *filter)
 {
 	if (filter) {
+		if (filter->bpf_func != sk_run_filter)
+			seccomp_jit_free(filter->bpf_func);
 		kfree(filter);
 	}
 }
@@ -16,6 +16,9 @@
 #include <linux/sysfs.h>
 #include <linux/balloon_compaction.h>
 #include <linux/page-isolation.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/timer.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -332,6 +335,7 @@ isolate_fail:
 	if (blockpfn == end_pfn)
 		update_pageblock_skip(cc, valid_page, total_isolated, false);
 
+	cc->total_free_scanned += nr_scanned;
 	count_compact_events(COMPACTFREE_SCANNED, nr_scanned);
 	if (total_isolated)
 		count_compact_events(COMPACTISOLATED, total_isolated);
@@ -665,6 +669,7 @@ next_pageblock:
 
 	trace_mm_compaction_isolate_migratepages(nr_scanned, nr_isolated);
 
+	cc->total_migrate_scanned += nr_scanned;
 	count_compact_events(COMPACTMIGRATE_SCANNED, nr_scanned);
 	if (nr_isolated)
 		count_compact_events(COMPACTISOLATED, nr_isolated);
@@ -860,6 +865,72 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return ISOLATE_SUCCESS;
 }
 
+/*
+ * Proactive compaction: kcompactd compacts a node in the background when
+ * too much of its free memory is in blocks below this order, so that the
+ * order-3 and order-4 allocations of ion and jumbo skbs don't have to
+ * stall in direct compaction.  An order-4 free block also serves order 3.
+ */
+#define COMPACTION_PROACTIVE_ORDER	(PAGE_ALLOC_COSTLY_ORDER + 1)
+
+/*
+ * How often kcompactd checks the fragmentation score of its node.  The
+ * timer is deferrable, an idle cpu is not woken up just for the check.
+ */
+#define COMPACTION_PROACTIVE_INTERVAL	500	/* ms */
+
+/* Pages the migrate scanner covers in one proactive run of a node */
+#define COMPACTION_PROACTIVE_CHUNK	(32 * pageblock_nr_pages)
+
+/*
+ * Higher values start proactive compaction at a lower fragmentation score
+ * and have it compact further; 0 disables it.
+ */
+int sysctl_compaction_proactiveness = 20;
+
+static inline bool kswapd_is_running(pg_data_t *pgdat)
+{
+	return pgdat->kswapd && (pgdat->kswapd->state == TASK_RUNNING);
+}
+
+/*
+ * The fragmentation score of a zone is the percentage of its free memory
+ * unusable for a COMPACTION_PROACTIVE_ORDER allocation.  That of a node is
+ * the sum of its zones' scores, weighted by their size.
+ */
+static unsigned int fragmentation_score_zone(struct zone *zone)
+{
+	return extfrag_for_order(zone, COMPACTION_PROACTIVE_ORDER);
+}
+
+static unsigned int fragmentation_score_node(pg_data_t *pgdat)
+{
+	unsigned long score = 0;
+	int zoneid;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		score += zone->present_pages * fragmentation_score_zone(zone);
+	}
+
+	return score / (pgdat->node_present_pages + 1);
+}
+
+/*
+ * kcompactd starts compacting a node whose score is above the high
+ * watermark, and stops once it is down to the low one.
+ */
+static unsigned int fragmentation_score_wmark(bool low)
+{
+	unsigned int wmark_low;
+
+	wmark_low = max(100U - sysctl_compaction_proactiveness, 5U);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -883,6 +954,22 @@ static int compact_finished(struct zone *zone,
 		return COMPACT_COMPLETE;
 	}
 
+	/*
+	 * Proactive compaction works in bounded chunks, gives way to kswapd
+	 * and stops as soon as the zone is no longer fragmented.
+	 */
+	if (cc->proactive) {
+		if (cc->total_migrate_scanned >= COMPACTION_PROACTIVE_CHUNK ||
+		    kswapd_is_running(zone->zone_pgdat))
+			return COMPACT_PARTIAL;
+
+		if (fragmentation_score_zone(zone) <=
+		    fragmentation_score_wmark(true))
+			return COMPACT_PARTIAL;
+
+		return COMPACT_CONTINUE;
+	}
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -1225,6 +1312,24 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+int sysctl_compaction_proactiveness_handler(struct ctl_table *table,
+			int write, void __user *buffer, size_t *length,
+			loff_t *ppos)
+{
+	int rc, nid;
+
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc)
+		return rc;
+
+	if (write && sysctl_compaction_proactiveness) {
+		for_each_online_node(nid)
+			wake_up_interruptible(&NODE_DATA(nid)->kcompactd_wait);
+	}
+
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct device *dev,
 			struct device_attribute *attr,
@@ -1254,4 +1359,171 @@ void compaction_unregister_node(struct node *node)
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
+/*
+ * Leave the node alone while kswapd is at work on it, and while every cpu
+ * has something better to do than defragmenting memory ahead of need.
+ */
+static bool should_proactive_compact_node(pg_data_t *pgdat)
+{
+	if (!sysctl_compaction_proactiveness || kswapd_is_running(pgdat))
+		return false;
+
+	if (nr_running() > num_online_cpus())
+		return false;
+
+	return fragmentation_score_node(pgdat) > fragmentation_score_wmark(false);
+}
+
+static void proactive_compact_node(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = -1,
+		.sync = true,
+		.proactive = true,
+	};
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+
+	count_compact_events(KCOMPACTD_MIGRATE_SCANNED,
+			     cc.total_migrate_scanned);
+	count_compact_events(KCOMPACTD_FREE_SCANNED, cc.total_free_scanned);
+}
+
+static void kcompactd_poll(unsigned long data)
+{
+	pg_data_t *pgdat = (pg_data_t *)data;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * The background compaction daemon, started as one per node by
+ * kcompactd_run().
+ */
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	long timeout = msecs_to_jiffies(COMPACTION_PROACTIVE_INTERVAL);
+	unsigned int proactive_defer = 0;
+	struct timer_list timer;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	set_freezable();
+	set_user_nice(current, 19);
+	setup_deferrable_timer_on_stack(&timer, kcompactd_poll,
+					(unsigned long)pgdat);
+
+	while (!kthread_should_stop()) {
+		unsigned int prev_score, score;
+
+		if (!sysctl_compaction_proactiveness) {
+			wait_event_freezable(pgdat->kcompactd_wait,
+					     sysctl_compaction_proactiveness ||
+					     kthread_should_stop());
+			continue;
+		}
+
+		mod_timer(&timer, jiffies + timeout);
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     !timer_pending(&timer) ||
+				     kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		if (proactive_defer) {
+			proactive_defer--;
+			continue;
+		}
+
+		if (!should_proactive_compact_node(pgdat))
+			continue;
+
+		count_compact_event(KCOMPACTD_WAKE);
+		prev_score = fragmentation_score_node(pgdat);
+		proactive_compact_node(pgdat);
+		score = fragmentation_score_node(pgdat);
+
+		/*
+		 * A run that got nowhere is likely to be followed by others
+		 * that won't either: sit out as many intervals as a deferred
+		 * direct compaction at most would.
+		 */
+		if (score <= fragmentation_score_wmark(true)) {
+			count_compact_event(KCOMPACTD_SUCCESS);
+		} else if (score >= prev_score) {
+			count_compact_event(KCOMPACTD_FAIL);
+			proactive_defer = 1 << COMPACT_MAX_DEFER_SHIFT;
+		}
+	}
+
+	del_timer_sync(&timer);
+	destroy_timer_on_stack(&timer);
+
+	return 0;
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined. Caller must
+ * hold lock_memory_hotplug().
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+subsys_initcall(kcompactd_init)
+
 #endif /* CONFIG_COMPACTION */
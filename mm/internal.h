@@ -161,6 +161,9 @@ struct compact_control {
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
 	bool contended;			/* True if a lock was contended */
+	bool proactive;			/* kcompactd reducing fragmentation */
+	unsigned long total_migrate_scanned;
+	unsigned long total_free_scanned;
 };
 
 unsigned long
@@ -113,6 +113,10 @@ struct mm_slot {
  * @address: the next address inside that to be scanned
  * @rmap_list: link to the next rmap to be scanned in the rmap_list
  * @seqnr: count of completed full scans (needed when removing unstable node)
+ * @vma_start: start of the vma being scanned, KSM_NO_VMA between vmas
+ * @vma_merged: pages of that vma found merged so far in this scan
+ * @nr_scanned: pages scanned so far in this full scan
+ * @nr_merged: pages newly merged so far in this full scan
  *
  * There is only the one ksm_scan instance of this cursor structure.
  */
@@ -121,8 +125,14 @@ struct ksm_scan {
 	unsigned long address;
 	struct rmap_item **rmap_list;
 	unsigned long seqnr;
+	unsigned long vma_start;
+	unsigned long vma_merged;
+	unsigned long nr_scanned;
+	unsigned long nr_merged;
 };
 
+#define KSM_NO_VMA	ULONG_MAX
+
 /**
  * struct stable_node - node of the stable rbtree
  * @node: rb node of this ksm page in the stable tree
@@ -200,6 +210,7 @@ static struct mm_slot ksm_mm_head = {
 };
 static struct ksm_scan ksm_scan = {
 	.mm_slot = &ksm_mm_head,
+	.vma_start = KSM_NO_VMA,
 };
 
 static struct kmem_cache *rmap_item_cache;
@@ -227,6 +238,43 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
+/* The number of pages scanned, and skipped along with unproductive vmas */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_skipped;
+
+/*
+ * Smart scan: a vma in which ksmd found nothing merged for more than
+ * KSM_SKIP_GRACE full scans in a row is skipped by the following scans,
+ * 1, 2, 4... up to KSM_SKIP_MAX of them, until a scan finds a merged
+ * page in it again.  The grace covers the first two scans of a new vma,
+ * which can't merge anything: the first only records checksums.
+ */
+static bool ksm_smart_scan = true;
+
+#define KSM_SKIP_GRACE	2
+#define KSM_SKIP_MAX	16
+
+/*
+ * Scan advisor: with advisor_max_cpu set, ksmd sizes its batches from
+ * the cpu time the previous ones cost, so that it uses no more than
+ * that percentage of one cpu, sleeps included.  Within that budget the
+ * batch follows the merge rate of the last full scan: a scan that merged
+ * nothing drops ksmd to advisor_min_pages_to_scan, and one in which at
+ * least KSM_MERGE_RATE_FULL per mille of the pages got merged gives it
+ * the whole budget.
+ */
+static unsigned int ksm_advisor_max_cpu;
+static unsigned int ksm_advisor_min_pages = 32;
+static unsigned int ksm_advisor_max_pages = 4096;
+
+#define KSM_MERGE_RATE_FULL	10
+
+/* Pages merged per mille scanned in the last full scan */
+static unsigned long ksm_merge_rate = KSM_MERGE_RATE_FULL;
+
+/* Smoothed cpu cost of scanning one page, in ns */
+static u64 ksm_scan_cost;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -311,6 +359,7 @@ static inline struct rmap_item *alloc_rmap_item(void)
 static inline void free_rmap_item(struct rmap_item *rmap_item)
 {
 	ksm_rmap_items--;
+	rmap_item->mm->ksm_rmap_items--;
 	rmap_item->mm = NULL;	/* debug safety */
 	kmem_cache_free(rmap_item_cache, rmap_item);
 }
@@ -520,6 +569,7 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
@@ -648,6 +698,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -1421,6 +1472,9 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+
+	rmap_item->mm->ksm_merging_pages++;
+	ksm_scan.nr_merged++;
 }
 
 /*
@@ -1545,6 +1599,7 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	if (rmap_item) {
 		/* It has already been zeroed */
 		rmap_item->mm = mm_slot->mm;
+		rmap_item->mm->ksm_rmap_items++;
 		rmap_item->address = addr;
 		rmap_item->rmap_list = *rmap_list;
 		*rmap_list = rmap_item;
@@ -1552,6 +1607,69 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * ksm_vma_scanned - the scan is moving on from the vma at ksm_scan.vma_start
+ * @mm: the mm being scanned, with mmap_sem held
+ *
+ * Back off from a vma in which this scan found nothing merged, forget
+ * the back-off of one in which it did.
+ */
+static void ksm_vma_scanned(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	unsigned long start = ksm_scan.vma_start;
+
+	if (start == KSM_NO_VMA)
+		return;
+	ksm_scan.vma_start = KSM_NO_VMA;
+
+	/* It may have been unmapped, split or merged since */
+	vma = find_vma(mm, start);
+	if (!vma || vma->vm_start != start)
+		return;
+
+	if (ksm_scan.vma_merged) {
+		vma->ksm_fails = 0;
+		return;
+	}
+
+	if (vma->ksm_fails <= KSM_SKIP_GRACE + ilog2(KSM_SKIP_MAX))
+		vma->ksm_fails++;
+	if (vma->ksm_fails > KSM_SKIP_GRACE)
+		vma->ksm_skip = 1 << (vma->ksm_fails - KSM_SKIP_GRACE - 1);
+}
+
+/*
+ * ksm_vma_skip - decide whether this scan skips a vma it is about to enter
+ * @vma: the vma, ksm_scan.address is at its start
+ */
+static bool ksm_vma_skip(struct vm_area_struct *vma)
+{
+	struct rmap_item *rmap_item;
+
+	if (!ksm_smart_scan || !vma->ksm_skip)
+		return false;
+
+	vma->ksm_skip--;
+	ksm_pages_skipped += (vma->vm_end - vma->vm_start) >> PAGE_SHIFT;
+
+	/*
+	 * Step over the vma's rmap_items rather than letting the scan free
+	 * them, so that its stable pages stay merged and accounted.  The
+	 * unstable ones have to leave the tree: it was reset for this scan,
+	 * and nothing may be left in it from two scans ago.
+	 */
+	while ((rmap_item = *ksm_scan.rmap_list) &&
+	       rmap_item->address < vma->vm_end) {
+		if (rmap_item->address & UNSTABLE_FLAG)
+			remove_rmap_item_from_tree(rmap_item);
+		ksm_scan.rmap_list = &rmap_item->rmap_list;
+	}
+	ksm_scan.address = vma->vm_end;
+
+	return true;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1614,6 +1732,7 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
+		ksm_scan.vma_start = KSM_NO_VMA;
 	}
 
 	mm = slot->mm;
@@ -1626,8 +1745,15 @@ next_mm:
 	for (; vma; vma = vma->vm_next) {
 		if (!(vma->vm_flags & VM_MERGEABLE))
 			continue;
-		if (ksm_scan.address < vma->vm_start)
+		if (ksm_scan.address <= vma->vm_start) {
+			/* Entering a new vma: settle the previous one */
+			ksm_vma_scanned(mm);
 			ksm_scan.address = vma->vm_start;
+			if (ksm_vma_skip(vma))
+				continue;
+			ksm_scan.vma_start = vma->vm_start;
+			ksm_scan.vma_merged = 0;
+		}
 		if (!vma->anon_vma)
 			ksm_scan.address = vma->vm_end;
 
@@ -1664,7 +1790,9 @@ next_mm:
 	if (ksm_test_exit(mm)) {
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
-	}
+		ksm_scan.vma_start = KSM_NO_VMA;
+	} else
+		ksm_vma_scanned(mm);
 	/*
 	 * Nuke all the rmap_items that are above this current rmap:
 	 * because there were no VM_MERGEABLE vmas with such addresses.
@@ -1702,6 +1830,13 @@ next_mm:
 	if (slot != &ksm_mm_head)
 		goto next_mm;
 
+	/* The first full scan only records checksums, it can't merge */
+	if (ksm_scan.seqnr && ksm_scan.nr_scanned)
+		ksm_merge_rate = ksm_scan.nr_merged * 1000 /
+				 ksm_scan.nr_scanned;
+	ksm_scan.nr_scanned = 0;
+	ksm_scan.nr_merged = 0;
+
 	ksm_scan.seqnr++;
 	return NULL;
 }
@@ -1721,10 +1856,50 @@ static void ksm_do_scan(unsigned int scan_npages)
 		if (!rmap_item)
 			return;
 		cmp_and_merge_page(page, rmap_item);
+		if (rmap_item->address & STABLE_FLAG)
+			ksm_scan.vma_merged++;
+		ksm_scan.nr_scanned++;
+		ksm_pages_scanned++;
 		put_page(page);
 	}
 }
 
+/*
+ * ksm_advisor - size the next batch
+ * @cpu_ns: cpu time the last batch took
+ * @scanned: pages it scanned
+ */
+static void ksm_advisor(u64 cpu_ns, unsigned long scanned)
+{
+	unsigned int min_pages = ksm_advisor_min_pages;
+	unsigned int max_pages = ksm_advisor_max_pages;
+	unsigned int max_cpu = ksm_advisor_max_cpu;
+	u64 cost, pages;
+
+	if (!max_cpu || !scanned)
+		return;
+
+	cost = div64_u64(cpu_ns, scanned) ?: 1;
+	ksm_scan_cost = ksm_scan_cost ? (3 * ksm_scan_cost + cost) / 4 : cost;
+
+	if (max_cpu >= 100) {
+		pages = max_pages;
+	} else {
+		u64 sleep_ns = (u64)ksm_thread_sleep_millisecs * NSEC_PER_MSEC;
+
+		/* cpu / (cpu + sleep) <= max_cpu% */
+		pages = div64_u64(div_u64(sleep_ns * max_cpu, 100 - max_cpu),
+				  ksm_scan_cost);
+	}
+
+	if (pages > min_pages && ksm_merge_rate < KSM_MERGE_RATE_FULL)
+		pages = min_pages + div_u64((pages - min_pages) *
+				ksm_merge_rate, KSM_MERGE_RATE_FULL);
+
+	ksm_thread_pages_to_scan = clamp_t(u64, pages, min_pages,
+					   max(min_pages, max_pages));
+}
+
 static void process_timeout(unsigned long __data)
 {
 	wake_up_process((struct task_struct *)__data);
@@ -1773,8 +1948,14 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
+		if (ksmd_should_run()) {
+			u64 start = task_sched_runtime(current);
+			unsigned long scanned = ksm_pages_scanned;
+
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_advisor(task_sched_runtime(current) - start,
+				    ksm_pages_scanned - scanned);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -2228,6 +2409,19 @@ static void wait_while_offlining(void)
 }
 #endif /* CONFIG_MEMORY_HOTREMOVE */
 
+/*
+ * ksm_process_profit - memory saved by merging the pages of an mm
+ * @mm: the mm
+ *
+ * Pages mapped from ksm pages, less the rmap_items ksmd keeps to track
+ * the mm: can be negative for an mm in which little merges.
+ */
+long ksm_process_profit(struct mm_struct *mm)
+{
+	return mm->ksm_merging_pages * PAGE_SIZE -
+		mm->ksm_rmap_items * sizeof(struct rmap_item);
+}
+
 #ifdef CONFIG_SYSFS
 /*
  * This all compiles without CONFIG_SYSFS, but is a waste of space.
@@ -2456,6 +2650,124 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t general_profit_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	long general_profit;
+
+	general_profit = ksm_pages_sharing * PAGE_SIZE -
+				ksm_rmap_items * sizeof(struct rmap_item);
+
+	return sprintf(buf, "%ld\n", general_profit);
+}
+KSM_ATTR_RO(general_profit);
+
+static ssize_t smart_scan_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_smart_scan);
+}
+
+static ssize_t smart_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_smart_scan = enable;
+
+	return count;
+}
+KSM_ATTR(smart_scan);
+
+static ssize_t advisor_max_cpu_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_advisor_max_cpu);
+}
+
+static ssize_t advisor_max_cpu_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long percent;
+	int err;
+
+	err = kstrtoul(buf, 10, &percent);
+	if (err || percent > 100)
+		return -EINVAL;
+
+	ksm_advisor_max_cpu = percent;
+
+	return count;
+}
+KSM_ATTR(advisor_max_cpu);
+
+static ssize_t advisor_min_pages_to_scan_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_advisor_min_pages);
+}
+
+static ssize_t advisor_min_pages_to_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long nr_pages;
+	int err;
+
+	err = kstrtoul(buf, 10, &nr_pages);
+	if (err || !nr_pages || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_advisor_min_pages = nr_pages;
+
+	return count;
+}
+KSM_ATTR(advisor_min_pages_to_scan);
+
+static ssize_t advisor_max_pages_to_scan_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_advisor_max_pages);
+}
+
+static ssize_t advisor_max_pages_to_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long nr_pages;
+	int err;
+
+	err = kstrtoul(buf, 10, &nr_pages);
+	if (err || !nr_pages || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_advisor_max_pages = nr_pages;
+
+	return count;
+}
+KSM_ATTR(advisor_max_pages_to_scan);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -2466,6 +2778,13 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&general_profit_attr.attr,
+	&smart_scan_attr.attr,
+	&advisor_max_cpu_attr.attr,
+	&advisor_min_pages_to_scan_attr.attr,
+	&advisor_max_pages_to_scan_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
@@ -113,6 +113,10 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_PGPGOUT,	/* # of pages paged out */
 	MEM_CGROUP_EVENTS_PGFAULT,	/* # of page-faults */
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	/* # of major page-faults */
+	MEM_CGROUP_EVENTS_PGSCAN,	/* # of pages scanned by reclaim */
+	MEM_CGROUP_EVENTS_PGSTEAL,	/* # of pages reclaimed */
+	MEM_CGROUP_EVENTS_LOW,		/* # of reclaims below memory.low */
+	MEM_CGROUP_EVENTS_HIGH,		/* # of charges above memory.high */
 	MEM_CGROUP_EVENTS_NSTATS,
 };
 
@@ -121,6 +125,10 @@ static const char * const mem_cgroup_events_names[] = {
 	"pgpgout",
 	"pgfault",
 	"pgmajfault",
+	"pgscan",
+	"pgsteal",
+	"low",
+	"high",
 };
 
 static const char * const mem_cgroup_lru_names[] = {
@@ -307,6 +315,16 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	int	swappiness;
+
+	/*
+	 * Best-effort protection: reclaim skips the group while its usage
+	 * and that of its ancestors are below their low boundaries, and
+	 * only dips into it when nothing else is left.
+	 */
+	unsigned long long low;
+	/* Charges above this are throttled by direct reclaim */
+	unsigned long long high;
+
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -1308,6 +1326,52 @@ out:
 }
 EXPORT_SYMBOL(__mem_cgroup_count_vm_event);
 
+/**
+ * mem_cgroup_low - check if memory consumption is below the low boundary
+ * @root: the highest ancestor to consider
+ * @memcg: the memory cgroup to check
+ *
+ * Returns %true if memory consumption of @memcg, and that of all its
+ * ancestors up to (but not including) @root, is below the low boundary.
+ * Reclaim should leave such a group alone as long as there is anything
+ * else to reclaim.
+ */
+bool mem_cgroup_low(struct mem_cgroup *root, struct mem_cgroup *memcg)
+{
+	if (mem_cgroup_disabled())
+		return false;
+
+	if (!root)
+		root = root_mem_cgroup;
+	if (memcg == root || mem_cgroup_is_root(memcg))
+		return false;
+
+	for (; memcg && memcg != root; memcg = parent_mem_cgroup(memcg)) {
+		if (res_counter_read_u64(&memcg->res, RES_USAGE) >= memcg->low)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * mem_cgroup_reclaim_stat - account reclaim done on a memory cgroup
+ * @memcg: the memory cgroup that was scanned
+ * @scanned: pages scanned on its LRU lists
+ * @reclaimed: pages reclaimed from them
+ * @low: the group was below its low boundary
+ */
+void mem_cgroup_reclaim_stat(struct mem_cgroup *memcg, unsigned long scanned,
+			     unsigned long reclaimed, bool low)
+{
+	if (mem_cgroup_disabled())
+		return;
+
+	this_cpu_add(memcg->stat->events[MEM_CGROUP_EVENTS_PGSCAN], scanned);
+	this_cpu_add(memcg->stat->events[MEM_CGROUP_EVENTS_PGSTEAL], reclaimed);
+	if (low)
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_LOW]);
+}
+
 /**
  * mem_cgroup_zone_lruvec - get the lru list vector for a zone and memcg
  * @zone: zone of the wanted lruvec
@@ -2661,6 +2725,24 @@ static int mem_cgroup_do_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 	return CHARGE_NOMEM;
 }
 
+/*
+ * Throttle a charge that took @memcg or one of its ancestors above
+ * memory.high: the charging task reclaims a batch from every group in
+ * excess before going on.  Unlike the limit, high never fails a charge.
+ */
+static void mem_cgroup_reclaim_high(struct mem_cgroup *memcg, gfp_t gfp_mask)
+{
+	if (!(gfp_mask & __GFP_WAIT))
+		return;
+
+	for (; memcg; memcg = parent_mem_cgroup(memcg)) {
+		if (res_counter_read_u64(&memcg->res, RES_USAGE) <= memcg->high)
+			continue;
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_HIGH]);
+		try_to_free_mem_cgroup_pages(memcg, gfp_mask, false);
+	}
+}
+
 /*
  * __mem_cgroup_try_charge() does
  * 1. detect memcg to be charged against from passed *mm and *ptr,
@@ -2797,6 +2879,7 @@ again:
 
 	if (batch > nr_pages)
 		refill_stock(memcg, batch - nr_pages);
+	mem_cgroup_reclaim_high(memcg, gfp_mask);
 	css_put(&memcg->css);
 done:
 	*ptr = memcg;
@@ -5280,6 +5363,68 @@ static int mem_cgroup_write(struct cgroup *cont, struct cftype *cft,
 	return ret;
 }
 
+static u64 mem_cgroup_low_read(struct cgroup *cont, struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cont)->low;
+}
+
+static int mem_cgroup_low_write(struct cgroup *cont, struct cftype *cft,
+				const char *buffer)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cont);
+	unsigned long long val;
+	int ret;
+
+	ret = res_counter_memparse_write_strategy(buffer, &val);
+	if (ret)
+		return ret;
+	memcg->low = val;
+	return 0;
+}
+
+static u64 mem_cgroup_high_read(struct cgroup *cont, struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cont)->high;
+}
+
+static int mem_cgroup_high_write(struct cgroup *cont, struct cftype *cft,
+				 const char *buffer)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cont);
+	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+	bool drained = false;
+	unsigned long long val;
+	int ret;
+
+	ret = res_counter_memparse_write_strategy(buffer, &val);
+	if (ret)
+		return ret;
+	memcg->high = val;
+
+	/*
+	 * Bring the group down to the new boundary right away, giving up
+	 * on a signal or once reclaim stops making progress.
+	 */
+	while (res_counter_read_u64(&memcg->res, RES_USAGE) > val) {
+		unsigned long progress;
+
+		if (signal_pending(current))
+			break;
+
+		if (!drained) {
+			drain_all_stock_sync(memcg);
+			drained = true;
+			continue;
+		}
+
+		progress = try_to_free_mem_cgroup_pages(memcg, GFP_KERNEL,
+							false);
+		if (!progress && !nr_retries--)
+			break;
+	}
+	return 0;
+}
+
 static void memcg_get_hierarchical_limit(struct mem_cgroup *memcg,
 		unsigned long long *mem_limit, unsigned long long *memsw_limit)
 {
@@ -5958,6 +6103,18 @@ static struct cftype mem_cgroup_files[] = {
 		.write_string = mem_cgroup_write,
 		.read = mem_cgroup_read,
 	},
+	{
+		.name = "low",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.write_string = mem_cgroup_low_write,
+		.read_u64 = mem_cgroup_low_read,
+	},
+	{
+		.name = "high",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.write_string = mem_cgroup_high_write,
+		.read_u64 = mem_cgroup_high_read,
+	},
 	{
 		.name = "failcnt",
 		.private = MEMFILE_PRIVATE(_MEM, RES_FAILCNT),
@@ -6277,6 +6434,7 @@ mem_cgroup_css_alloc(struct cgroup *cont)
 	}
 
 	memcg->last_scanned_node = MAX_NUMNODES;
+	memcg->high = RESOURCE_MAX;
 	INIT_LIST_HEAD(&memcg->oom_notify);
 	atomic_set(&memcg->refcnt, 1);
 	memcg->move_charge_at_immigrate = 0;
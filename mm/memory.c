@@ -49,6 +49,7 @@
 #include <linux/rmap.h>
 #include <linux/export.h>
 #include <linux/delayacct.h>
+#include <linux/psi.h>
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/writeback.h>
@@ -3031,6 +3032,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	int locked;
 	struct mem_cgroup *ptr;
 	int exclusive = 0;
+	bool direct = false;
+	unsigned long pflags;
 	int ret = 0;
 
 	if (!pte_unmap_same(mm, pmd, page_table, orig_pte))
@@ -3059,10 +3062,15 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	psi_memstall_enter(&pflags);
+	page = lookup_swap_cache(entry, vma, address);
 	if (!page) {
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swapin_direct(entry, GFP_HIGHUSER_MOVABLE, vma, address);
+		if (page)
+			direct = true;
+		else
+			page = swapin_vma_readahead(entry, GFP_HIGHUSER_MOVABLE,
+						    vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -3072,6 +3080,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 			if (likely(pte_same(*page_table, orig_pte)))
 				ret = VM_FAULT_OOM;
 			delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+			psi_memstall_leave(&pflags);
 			goto unlock;
 		}
 
@@ -3086,6 +3095,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		 */
 		ret = VM_FAULT_HWPOISON;
 		delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+		psi_memstall_leave(&pflags);
 		swapcache = page;
 		goto out_release;
 	}
@@ -3094,6 +3104,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	locked = lock_page_or_retry(page, mm, flags);
 
 	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+	psi_memstall_leave(&pflags);
 	if (!locked) {
 		ret |= VM_FAULT_RETRY;
 		goto out_release;
@@ -3104,8 +3115,11 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	 * release the swapcache from under us.  The page pin, and pte_same
 	 * test below, are not enough to exclude that.  Even if it is still
 	 * swapcache, we need to check that the page's swap has not changed.
+	 * A page read by swapin_direct() was never in the swap cache, its
+	 * entry is pinned by SWAP_HAS_CACHE instead.
 	 */
-	if (unlikely(!PageSwapCache(page) || page_private(page) != entry.val))
+	if (unlikely(!direct && (!PageSwapCache(page) ||
+				 page_private(page) != entry.val)))
 		goto out_page;
 
 	page = ksm_might_need_to_copy(page, vma, address);
@@ -3157,14 +3171,16 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	}
 	flush_icache_page(vma, page);
 	set_pte_at(mm, address, page_table, pte);
-	if (page == swapcache)
+	if (page == swapcache && !direct)
 		do_page_add_anon_rmap(page, vma, address, exclusive);
-	else /* ksm created a completely new copy */
+	else /* ksm or swapin_direct created a completely new page */
 		page_add_new_anon_rmap(page, vma, address);
 	/* It's better to call commit-charge after rmap is established */
 	mem_cgroup_commit_charge_swapin(page, ptr);
 
 	swap_free(entry);
+	if (direct)
+		swapcache_free(entry, NULL);
 	if ((PageSwapCache(page) && vm_swap_full(page_swap_info(page))) ||
 		(vma->vm_flags & VM_LOCKED) || PageMlocked(page))
 		try_to_free_swap(page);
@@ -3206,6 +3222,8 @@ out_release:
 		unlock_page(swapcache);
 		page_cache_release(swapcache);
 	}
+	if (direct)
+		swapcache_free(entry, NULL);
 	return ret;
 }
 
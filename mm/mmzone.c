@@ -95,6 +95,12 @@ void lruvec_init(struct lruvec *lruvec)
 
 	for_each_lru(lru)
 		INIT_LIST_HEAD(&lruvec->lists[lru]);
+
+#ifdef CONFIG_LRU_GEN
+	/* start out with the youngest generation only */
+	lruvec->lrugen.min_seq[0] = ACCESS_ONCE(lru_gen_max_seq) - 1;
+	lruvec->lrugen.min_seq[1] = lruvec->lrugen.min_seq[0];
+#endif
 }
 
 #if defined(CONFIG_NUMA_BALANCING) && !defined(LAST_NID_NOT_IN_PAGE_FLAGS)
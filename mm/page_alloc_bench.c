@@ -0,0 +1,159 @@
+/*
+ * Page allocator benchmark
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Allocates and frees batches of pages of each order from 0 to
+ * PCP_MAX_ORDER, first on one cpu and then on all online cpus at the same
+ * time.  The gap between the two shows how much the allocations contend
+ * on zone->lock rather than staying on the per-cpu lists.  The results go
+ * to the kernel log, and loading fails on purpose so that the module can
+ * be loaded again right away.
+ */
+
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+
+#define BENCH_MAX_BATCH	64
+
+static unsigned int loops = 10000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Batches each cpu allocates and frees per order");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Pages held at once, up to 64");
+
+struct bench_ctl {
+	unsigned int order;
+	struct completion start;
+	struct completion done;
+	atomic_t running;
+	atomic_t failed;
+	atomic64_t total_ns;
+};
+
+static int bench_thread(void *data)
+{
+	struct bench_ctl *ctl = data;
+	struct page *pages[BENCH_MAX_BATCH];
+	unsigned int order = ctl->order;
+	unsigned int i, j;
+	ktime_t start;
+
+	wait_for_completion(&ctl->start);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; j < batch; j++) {
+			pages[j] = alloc_pages(GFP_KERNEL, order);
+			if (!pages[j])
+				atomic_inc(&ctl->failed);
+		}
+		for (j = 0; j < batch; j++) {
+			if (pages[j])
+				__free_pages(pages[j], order);
+		}
+		cond_resched();
+	}
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &ctl->total_ns);
+
+	if (atomic_dec_and_test(&ctl->running))
+		complete(&ctl->done);
+	return 0;
+}
+
+/* Returns the mean ns per allocation and free, 0 if no thread ran */
+static u64 bench_run(unsigned int order, const struct cpumask *cpus,
+		     unsigned int *nr_cpus, unsigned int *failed)
+{
+	struct bench_ctl ctl;
+	struct task_struct *t;
+	unsigned int nr = 0;
+	int cpu;
+
+	ctl.order = order;
+	init_completion(&ctl.start);
+	init_completion(&ctl.done);
+	atomic_set(&ctl.running, cpumask_weight(cpus));
+	atomic_set(&ctl.failed, 0);
+	atomic64_set(&ctl.total_ns, 0);
+
+	for_each_cpu(cpu, cpus) {
+		t = kthread_create(bench_thread, &ctl, "page_alloc_bench/%d",
+				   cpu);
+		if (IS_ERR(t)) {
+			atomic_dec(&ctl.running);
+			continue;
+		}
+		kthread_bind(t, cpu);
+		wake_up_process(t);
+		nr++;
+	}
+	if (!nr)
+		return 0;
+
+	complete_all(&ctl.start);
+	wait_for_completion(&ctl.done);
+
+	*nr_cpus = nr;
+	*failed = atomic_read(&ctl.failed);
+	return div64_u64(atomic64_read(&ctl.total_ns),
+			 (u64)nr * loops * batch);
+}
+
+static int __init page_alloc_bench_init(void)
+{
+	unsigned int order;
+	int first_cpu;
+
+	if (!loops || !batch || batch > BENCH_MAX_BATCH)
+		return -EINVAL;
+
+	pr_info("page_alloc_bench: %u batches of %u pages, ns per alloc+free\n",
+		loops, batch);
+
+	get_online_cpus();
+	first_cpu = cpumask_first(cpu_online_mask);
+	for (order = 0; order <= PCP_MAX_ORDER; order++) {
+		unsigned int one_cpus = 0, all_cpus = 0;
+		unsigned int one_failed = 0, all_failed = 0;
+		u64 one, all;
+
+		one = bench_run(order, cpumask_of(first_cpu),
+				&one_cpus, &one_failed);
+		all = bench_run(order, cpu_online_mask, &all_cpus, &all_failed);
+
+		pr_info("page_alloc_bench: order %u: 1 cpu %llu, %u cpus %llu, failed %u/%u\n",
+			order, (unsigned long long)one, all_cpus,
+			(unsigned long long)all, one_failed, all_failed);
+	}
+	put_online_cpus();
+
+	return -EAGAIN; /* Fail will directly unload the module */
+}
+
+static void __exit page_alloc_bench_exit(void)
+{
+}
+
+module_init(page_alloc_bench_init)
+module_exit(page_alloc_bench_exit)
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Page allocator per-cpu list benchmark");
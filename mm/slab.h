@@ -92,6 +92,10 @@ __kmem_cache_alias(struct mem_cgroup *memcg, const char *name, size_t size,
 
 int __kmem_cache_shutdown(struct kmem_cache *);
 
+/* Object at a time versions for allocators without a batched fast path */
+int __kmem_cache_alloc_bulk(struct kmem_cache *, gfp_t, size_t, void **);
+void __kmem_cache_free_bulk(struct kmem_cache *, size_t, void **);
+
 struct seq_file;
 struct file;
 
@@ -0,0 +1,117 @@
+/*
+ * Slab bulk allocation benchmark
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Allocates and frees objects of a private cache the size of an sk_buff,
+ * once one object at a time and then through kmem_cache_alloc_bulk() and
+ * kmem_cache_free_bulk() for batch sizes from 1 to 64, and prints the
+ * cycles spent per object.  Loading fails on purpose so that the module
+ * can be loaded again right away.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/skbuff.h>
+#include <linux/timex.h>
+
+#define BENCH_MAX_BATCH	64
+
+static unsigned int loops = 100000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Batches allocated and freed per measurement");
+
+static const unsigned int batches[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+/* Cycles per object, or 0 if an allocation failed */
+static unsigned long long bench_single(struct kmem_cache *s,
+				       unsigned int batch)
+{
+	void *objs[BENCH_MAX_BATCH];
+	cycles_t start, cycles;
+	unsigned int i, j;
+
+	start = get_cycles();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; j < batch; j++) {
+			objs[j] = kmem_cache_alloc(s, GFP_KERNEL);
+			if (!objs[j])
+				goto fail;
+		}
+		for (j = 0; j < batch; j++)
+			kmem_cache_free(s, objs[j]);
+		cond_resched();
+	}
+	cycles = get_cycles() - start;
+	return div64_u64(cycles, (u64)loops * batch);
+
+fail:
+	while (j--)
+		kmem_cache_free(s, objs[j]);
+	return 0;
+}
+
+static unsigned long long bench_bulk(struct kmem_cache *s, unsigned int batch)
+{
+	void *objs[BENCH_MAX_BATCH];
+	cycles_t start, cycles;
+	unsigned int i;
+
+	start = get_cycles();
+	for (i = 0; i < loops; i++) {
+		if (!kmem_cache_alloc_bulk(s, GFP_KERNEL, batch, objs))
+			return 0;
+		kmem_cache_free_bulk(s, batch, objs);
+		cond_resched();
+	}
+	cycles = get_cycles() - start;
+	return div64_u64(cycles, (u64)loops * batch);
+}
+
+static int __init slab_bulk_bench_init(void)
+{
+	struct kmem_cache *s;
+	unsigned int i;
+
+	if (!loops)
+		return -EINVAL;
+
+	s = kmem_cache_create("slab_bulk_bench", sizeof(struct sk_buff), 0,
+			      SLAB_HWCACHE_ALIGN, NULL);
+	if (!s)
+		return -ENOMEM;
+
+	pr_info("slab_bulk_bench: %u batches of %zu byte objects, cycles per object\n",
+		loops, sizeof(struct sk_buff));
+	for (i = 0; i < ARRAY_SIZE(batches); i++) {
+		unsigned long long single, bulk;
+
+		single = bench_single(s, batches[i]);
+		bulk = bench_bulk(s, batches[i]);
+		pr_info("slab_bulk_bench: batch %2u: single %llu, bulk %llu\n",
+			batches[i], single, bulk);
+	}
+
+	kmem_cache_destroy(s);
+
+	return -EAGAIN; /* Fail will directly unload the module */
+}
+
+static void __exit slab_bulk_bench_exit(void)
+{
+}
+
+module_init(slab_bulk_bench_init)
+module_exit(slab_bulk_bench_exit)
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Slab bulk allocation benchmark");
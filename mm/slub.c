@@ -2648,6 +2648,109 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk free: the objects that belong to the cpu slab are chained onto its
+ * freelist with interrupts disabled instead of one cmpxchg each, the rest
+ * go through __slab_free().
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	struct kmem_cache_cpu *c;
+	struct page *page;
+	unsigned long flags;
+	size_t i;
+
+	if (kmem_cache_debug(s) || memcg_kmem_enabled()) {
+		__kmem_cache_free_bulk(s, size, p);
+		return;
+	}
+
+	for (i = 0; i < size; i++)
+		slab_free_hook(s, p[i]);
+
+	local_irq_save(flags);
+	c = this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void *object = p[i];
+
+		page = virt_to_head_page(object);
+		if (likely(page == c->page)) {
+			set_freepointer(s, object, c->freelist);
+			c->freelist = object;
+			stat(s, FREE_FASTPATH);
+			continue;
+		}
+
+		c->tid = next_tid(c->tid);
+		local_irq_restore(flags);
+		__slab_free(s, page, object, _RET_IP_);
+		local_irq_save(flags);
+		c = this_cpu_ptr(s->cpu_slab);
+	}
+	c->tid = next_tid(c->tid);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
+/*
+ * Bulk allocation: the objects are taken from the cpu slab's freelist with
+ * interrupts disabled, and __slab_alloc() refills it whenever it runs dry.
+ * Bumping the tid before and after keeps the lockless fast paths of
+ * interrupted or preempted callers from using a stale freelist.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long irqflags;
+	size_t i;
+
+	if (kmem_cache_debug(s))
+		return __kmem_cache_alloc_bulk(s, flags, size, p);
+
+	if (slab_pre_alloc_hook(s, flags))
+		return 0;
+
+	s = memcg_kmem_get_cache(s, flags);
+
+	local_irq_save(irqflags);
+	c = this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void *object = c->freelist;
+
+		if (unlikely(!object)) {
+			c->tid = next_tid(c->tid);
+			p[i] = __slab_alloc(s, flags, NUMA_NO_NODE, _RET_IP_, c);
+			if (unlikely(!p[i]))
+				goto error;
+			/* __slab_alloc() may have enabled interrupts */
+			c = this_cpu_ptr(s->cpu_slab);
+			continue;
+		}
+		c->freelist = get_freepointer(s, object);
+		p[i] = object;
+		stat(s, ALLOC_FASTPATH);
+	}
+	c->tid = next_tid(c->tid);
+	local_irq_restore(irqflags);
+
+	for (i = 0; i < size; i++) {
+		if (unlikely(flags & __GFP_ZERO))
+			memset(p[i], 0, s->object_size);
+		slab_post_alloc_hook(s, flags, p[i]);
+	}
+	return i;
+
+error:
+	local_irq_restore(irqflags);
+	size = i;
+	for (i = 0; i < size; i++)
+		slab_post_alloc_hook(s, flags, p[i]);
+	__kmem_cache_free_bulk(s, size, p);
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
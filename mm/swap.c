@@ -440,6 +440,44 @@ static void __activate_page(struct page *page, struct lruvec *lruvec,
 	}
 }
 
+#ifdef CONFIG_LRU_GEN
+static void __lru_gen_promote_page(struct page *page, struct lruvec *lruvec,
+				   void *arg)
+{
+	int *pgpromoted = arg;
+
+	if (PageLRU(page) && !PageUnevictable(page)) {
+		int file = page_is_file_cache(page);
+		int lru = page_lru_base_type(page);
+
+		if (PageActive(page)) {
+			del_page_from_lru_list(page, lruvec, lru + LRU_ACTIVE);
+		} else {
+			del_page_from_lru_list(page, lruvec, lru);
+			SetPageActive(page);
+			__count_vm_event(PGACTIVATE);
+		}
+		add_page_to_lru_list(page, lruvec, lru + LRU_ACTIVE);
+
+		update_page_reclaim_stat(lruvec, file, 1);
+		*pgpromoted += hpage_nr_pages(page);
+	}
+}
+
+/*
+ * Move pages the lru_gen page table walk found accessed into the youngest
+ * generation, at the head of their active list.  Drops the references the
+ * walk took on the pages.
+ */
+void lru_gen_promote_pages(struct pagevec *pvec)
+{
+	int pgpromoted = 0;
+
+	pagevec_lru_move_fn(pvec, __lru_gen_promote_page, &pgpromoted);
+	count_vm_events(LRU_GEN_PROMOTED, pgpromoted);
+}
+#endif
+
 #ifdef CONFIG_SMP
 static DEFINE_PER_CPU(struct pagevec, activate_page_pvecs);
 
@@ -626,6 +664,45 @@ static void lru_deactivate_fn(struct page *page, struct lruvec *lruvec,
 	update_page_reclaim_stat(lruvec, file, 0);
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+static void __deactivate_mapped_page(struct page *page, struct lruvec *lruvec,
+				     void *arg)
+{
+	int *pgdeactivated = arg;
+	int lru, file;
+
+	if (!PageLRU(page) || !PageActive(page) || PageUnevictable(page))
+		return;
+
+	file = page_is_file_cache(page);
+	lru = page_lru_base_type(page);
+
+	del_page_from_lru_list(page, lruvec, lru + LRU_ACTIVE);
+	ClearPageActive(page);
+	ClearPageReferenced(page);
+	add_page_to_lru_list(page, lruvec, lru);
+
+	update_page_reclaim_stat(lruvec, file, 0);
+	*pgdeactivated += hpage_nr_pages(page);
+}
+
+/*
+ * Move active pages to the head of their inactive list, mapped or not,
+ * for a process reclaim request that only asks for its memory to be
+ * aged. Drops the references the caller took on the pages and returns
+ * the number of pages moved.
+ */
+unsigned long deactivate_mapped_pages(struct pagevec *pvec)
+{
+	int pgdeactivated = 0;
+
+	pagevec_lru_move_fn(pvec, __deactivate_mapped_page, &pgdeactivated);
+	count_vm_events(PGDEACTIVATE, pgdeactivated);
+
+	return pgdeactivated;
+}
+#endif
+
 /*
  * Drain pages out of the cpu's pagevecs.
  * Either "cpu" is the current CPU, and preemption has already been
@@ -817,9 +894,10 @@ void lru_add_page_tail(struct page *page, struct page *page_tail,
 		lru = LRU_UNEVICTABLE;
 	}
 
-	if (likely(PageLRU(page)))
+	if (likely(PageLRU(page))) {
 		list_add_tail(&page_tail->lru, &page->lru);
-	else if (list) {
+		lru_gen_split_page(page, page_tail);
+	} else if (list) {
 		/* page reclaim is reclaiming a huge page */
 		get_page(page_tail);
 		list_add_tail(&page_tail->lru, list);
@@ -277,37 +277,92 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * Readahead state of a vma: the address of its last swap-in fault, the
+ * readahead window used then, and the readahead pages hit since.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((unsigned long)(win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) | \
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* The vma readahead window is read from a copy of the ptes on the stack */
+#if PAGE_SHIFT / 2 > 5
+#define SWAP_RA_ORDER_CEILING	5
+#else
+#define SWAP_RA_ORDER_CEILING	(PAGE_SHIFT / 2)
+#endif
+
+static bool enable_vma_readahead __read_mostly = true;
+static bool enable_swap_direct __read_mostly = true;
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * A page brought in by readahead counts as a readahead hit of @vma, if
+ * given, or of the swap device otherwise.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(swap_address_space(entry), entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			struct swap_info_struct *si = swp_swap_info(entry);
+
+			count_vm_event(SWAP_RA_HIT);
+			atomic_long_inc(&si->ra_used);
+			if (vma) {
+				unsigned long ra_val;
+				int hits;
+
+				ra_val = atomic_long_read(&vma->swap_readahead_info);
+				hits = min_t(int, SWAP_RA_HITS(ra_val) + 1,
+					     SWAP_RA_HITS_MAX);
+				atomic_long_set(&vma->swap_readahead_info,
+						SWAP_RA_VAL(SWAP_RA_ADDR(ra_val),
+							    SWAP_RA_WIN(ra_val),
+							    hits));
+			} else {
+				atomic_inc(&si->ra_hits);
+			}
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
 }
 
-/* 
- * Locate a page of swap in physical memory, reserving swap cache space
- * and reading the disk if it is not already cached.
- * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
+/*
+ * Locate a page of swap in physical memory, or add a new locked page for
+ * it to the swap cache and set *@new_page_allocated, leaving the read to
+ * the caller.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool *new_page_allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_allocated = false;
+
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -370,11 +425,8 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		err = __add_to_swap_cache(new_page, entry);
 		if (likely(!err)) {
 			radix_tree_preload_end();
-			/*
-			 * Initiate read into locked page and return.
-			 */
 			lru_cache_add_anon(new_page);
-			swap_readpage(new_page);
+			*new_page_allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -392,6 +444,89 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/*
+ * Locate a page of swap in physical memory, reserving swap cache space
+ * and reading the disk if it is not already cached.
+ * A failure return means that either the page allocation failed or that
+ * the swap entry is no longer in use.
+ */
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool page_was_allocated;
+	struct page *page;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &page_was_allocated);
+	if (page_was_allocated)
+		swap_readpage(page);
+
+	return page;
+}
+
+/* Start the read of a page allocated for readahead, not for the fault */
+static void swap_readahead_page(struct page *page, swp_entry_t entry)
+{
+	SetPageReadahead(page);
+	count_vm_event(SWAP_RA);
+	atomic_long_inc(&swp_swap_info(entry)->ra_pages);
+	swap_readpage(page);
+}
+
+/*
+ * Size the readahead window of a swap-in from the readahead hits since the
+ * previous one: without hits, only read ahead of what looks sequential.
+ * On a fast device such as zram there is no seek to save and every page
+ * read ahead in vain costs a decompression, so an unused window is dropped
+ * at once; elsewhere it is halved at most per swap-in.
+ */
+static unsigned int __swapin_nr_pages(unsigned long prev_offset,
+				      unsigned long offset, int hits,
+				      int max_pages, int prev_win, bool fast)
+{
+	unsigned int pages, last_ra;
+
+	pages = hits + 2;
+	if (pages == 2) {
+		if (offset != prev_offset + 1 && offset != prev_offset - 1)
+			pages = 1;
+	} else {
+		unsigned int roundup = 4;
+
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	last_ra = fast ? 0 : prev_win / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+
+	return pages;
+}
+
+static unsigned long swapin_nr_pages(struct swap_info_struct *si,
+				     unsigned long offset)
+{
+	unsigned int hits, pages, max_pages;
+
+	max_pages = 1 << ACCESS_ONCE(page_cluster);
+	if (max_pages <= 1)
+		return 1;
+
+	hits = atomic_xchg(&si->ra_hits, 0);
+	pages = __swapin_nr_pages(ACCESS_ONCE(si->ra_prev_offset), offset,
+				  hits, max_pages, ACCESS_ONCE(si->ra_win),
+				  si->flags & SWP_FAST);
+	ACCESS_ONCE(si->ra_win) = pages;
+	ACCESS_ONCE(si->ra_prev_offset) = offset;
+
+	return pages;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -402,9 +537,10 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
  * Returns the struct page for entry and addr, after queueing swapin.
  *
  * Primitive swap readahead code. We simply read an aligned block of
- * (1 << page_cluster) entries in the swap area. This method is chosen
- * because it doesn't cost us any seek time.  We also make sure to queue
- * the 'original' request together with the readahead ones...
+ * entries in the swap area, sized by swapin_nr_pages() up to
+ * (1 << page_cluster). This method is chosen because it doesn't cost us
+ * any seek time.  We also make sure to queue the 'original' request
+ * together with the readahead ones...
  *
  * This has been extended to use the NUMA policies from the mm triggering
  * the readahead.
@@ -415,13 +551,18 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	struct page *page;
-	unsigned long offset = swp_offset(entry);
+	unsigned long entry_offset = swp_offset(entry);
+	unsigned long offset = entry_offset;
 	unsigned long start_offset, end_offset;
-	unsigned long mask = is_swap_fast(entry) ? 0 :
-				(1UL << page_cluster) - 1;
+	unsigned long mask;
 	struct blk_plug plug;
+	bool page_allocated;
+
+	mask = swapin_nr_pages(swp_swap_info(entry), offset) - 1;
+	if (!mask)
+		goto skip;
 
-	/* Read a page_cluster sized and aligned cluster around offset. */
+	/* Read a swapin_nr_pages() sized and aligned cluster around offset. */
 	start_offset = offset & ~mask;
 	end_offset = offset | mask;
 	if (!start_offset)	/* First page is swap header. */
@@ -429,15 +570,276 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 
 	blk_start_plug(&plug);
 	for (offset = start_offset; offset <= end_offset ; offset++) {
+		swp_entry_t ra_entry = swp_entry(swp_type(entry), offset);
+
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
+		page = __read_swap_cache_async(ra_entry, gfp_mask, vma, addr,
+					       &page_allocated);
 		if (!page)
 			continue;
+		if (page_allocated) {
+			if (offset != entry_offset)
+				swap_readahead_page(page, ra_entry);
+			else
+				swap_readpage(page);
+		}
 		page_cache_release(page);
 	}
 	blk_finish_plug(&plug);
 
 	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Readahead window of the pfns around @faddr, limited to the vma and to
+ * the page table of @faddr.
+ */
+static void swap_ra_clamp_pfn(struct vm_area_struct *vma, unsigned long faddr,
+			      unsigned long lpfn, unsigned long rpfn,
+			      unsigned long *start, unsigned long *end)
+{
+	*start = max3(lpfn, PFN_DOWN(vma->vm_start),
+		      PFN_DOWN(faddr & PMD_MASK));
+	*end = min3(rpfn, PFN_DOWN(vma->vm_end),
+		    PFN_DOWN((faddr & PMD_MASK) + PMD_SIZE));
+}
+
+/**
+ * swapin_vma_readahead - swap in pages around the faulting address
+ * @fentry: swap entry of the faulting pte
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the fault is in
+ * @faddr: faulting address
+ * @pmd: pmd mapping the page table of @faddr
+ *
+ * Returns the struct page for @fentry, after queueing swapin.
+ *
+ * Reads ahead the swap entries of the ptes next to the fault rather than
+ * the neighbours of its swap slot, which need not be related once swap
+ * has been in use for a while.  The window follows the direction of
+ * consecutive faults in the vma and is sized from its readahead hits.
+ * Swap on rotating disks keeps using swapin_readahead(), where slots
+ * being adjacent on disk matters more.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long faddr,
+			pmd_t *pmd)
+{
+	struct swap_info_struct *si = swp_swap_info(fentry);
+	pte_t ptes[1 << SWAP_RA_ORDER_CEILING];
+	unsigned long ra_val, fpfn, pfn, start, end, left, i;
+	unsigned int max_win, win, prev_win, hits;
+	struct blk_plug plug;
+	bool page_allocated;
+	struct page *page;
+	pte_t *pte;
+
+	if (!ACCESS_ONCE(enable_vma_readahead) ||
+	    !(si->flags & (SWP_SOLIDSTATE | SWP_FAST)))
+		return swapin_readahead(fentry, gfp_mask, vma, faddr);
+
+	max_win = 1 << min_t(unsigned int, ACCESS_ONCE(page_cluster),
+			     SWAP_RA_ORDER_CEILING);
+
+	faddr &= PAGE_MASK;
+	fpfn = PFN_DOWN(faddr);
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	pfn = PFN_DOWN(SWAP_RA_ADDR(ra_val));
+	prev_win = SWAP_RA_WIN(ra_val);
+	hits = SWAP_RA_HITS(ra_val);
+	win = max_win > 1 ? __swapin_nr_pages(pfn, fpfn, hits, max_win,
+					      prev_win, si->flags & SWP_FAST) : 1;
+	atomic_long_set(&vma->swap_readahead_info,
+			SWAP_RA_VAL(faddr, win, 0));
+	ACCESS_ONCE(si->ra_win) = win;
+
+	if (win == 1)
+		goto skip;
+
+	if (fpfn == pfn + 1) {
+		swap_ra_clamp_pfn(vma, faddr, fpfn, fpfn + win, &start, &end);
+	} else if (pfn == fpfn + 1) {
+		swap_ra_clamp_pfn(vma, faddr, fpfn - win + 1, fpfn + 1,
+				  &start, &end);
+	} else {
+		left = (win - 1) / 2;
+		swap_ra_clamp_pfn(vma, faddr, fpfn - left, fpfn + win - left,
+				  &start, &end);
+	}
+
+	/* copy the ptes, the page table may go away once we sleep */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < end - start; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < end - start; i++) {
+		unsigned long addr = (start + i) << PAGE_SHIFT;
+		swp_entry_t entry;
+
+		if (pte_none(ptes[i]) || pte_present(ptes[i]) ||
+		    pte_file(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+
+		page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+					       &page_allocated);
+		if (!page)
+			continue;
+		if (page_allocated) {
+			if (addr != faddr)
+				swap_readahead_page(page, entry);
+			else
+				swap_readpage(page);
+		}
+		page_cache_release(page);
+	}
+	blk_finish_plug(&plug);
+
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(fentry, gfp_mask, vma, faddr);
+}
+
+/**
+ * swapin_direct - swap in a page without going through the swap cache
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: target address for mempolicy
+ *
+ * On a device with synchronous reads, a page referenced by a single pte
+ * gains nothing from the swap cache: nobody else can look it up, and
+ * readahead is pointless when the read costs no more than a lookup. Read
+ * it into a private page instead, saving the radix tree insertion and
+ * deletion and the bio round trip.
+ *
+ * Returns NULL if @entry does not qualify or on allocation failure, and
+ * the caller should fall back to the swap cache. Otherwise the page is
+ * returned locked, or unlocked and uptodate if the read completed already,
+ * and SWAP_HAS_CACHE is held on @entry as if the page were in the swap
+ * cache. A racing fault then waits in read_swap_cache_async() until the
+ * caller drops it with swapcache_free() once the pte is settled, instead
+ * of reading the slot itself and letting the device free it under us.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_direct(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct swap_info_struct *si = swp_swap_info(entry);
+	struct page *page;
+
+	if (!ACCESS_ONCE(enable_swap_direct) ||
+	    !(si->flags & SWP_SYNCHRONOUS_IO) ||
+	    __swap_count(si, entry) != 1)
+		return NULL;
+
+	/* somebody else is reading it into the swap cache, use that */
+	if (swapcache_prepare(entry))
+		return NULL;
+
+	page = alloc_page_vma(gfp_mask, vma, addr);
+	if (!page) {
+		swapcache_free(entry, NULL);
+		return NULL;
+	}
+
+	__set_page_locked(page);
+	set_page_private(page, entry.val);
+	swap_readpage(page);
+	set_page_private(page, 0);
+	count_vm_event(SWAP_DIRECT);
+
+	return page;
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t vma_ra_enabled_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", enable_vma_readahead);
+}
+
+static ssize_t vma_ra_enabled_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enabled;
+	int err;
+
+	err = kstrtoul(buf, 10, &enabled);
+	if (err || enabled > 1)
+		return -EINVAL;
+
+	enable_vma_readahead = enabled;
+
+	return count;
+}
+static struct kobj_attribute vma_ra_enabled_attr =
+	__ATTR(vma_ra_enabled, 0644, vma_ra_enabled_show,
+	       vma_ra_enabled_store);
+
+static ssize_t direct_enabled_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", enable_swap_direct);
+}
+
+static ssize_t direct_enabled_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enabled;
+	int err;
+
+	err = kstrtoul(buf, 10, &enabled);
+	if (err || enabled > 1)
+		return -EINVAL;
+
+	enable_swap_direct = enabled;
+
+	return count;
+}
+static struct kobj_attribute direct_enabled_attr =
+	__ATTR(direct_enabled, 0644, direct_enabled_show,
+	       direct_enabled_store);
+
+static struct attribute *swap_attrs[] = {
+	&vma_ra_enabled_attr.attr,
+	&direct_enabled_attr.attr,
+	NULL,
+};
+
+static struct attribute_group swap_attr_group = {
+	.attrs = swap_attrs,
+};
+
+static int __init swap_init_sysfs(void)
+{
+	struct kobject *swap_kobj;
+	int err;
+
+	swap_kobj = kobject_create_and_add("swap", mm_kobj);
+	if (!swap_kobj) {
+		pr_err("failed to create swap kobject\n");
+		return -ENOMEM;
+	}
+
+	err = sysfs_create_group(swap_kobj, &swap_attr_group);
+	if (err) {
+		pr_err("failed to register swap group\n");
+		kobject_put(swap_kobj);
+	}
+
+	return err;
+}
+subsys_initcall(swap_init_sysfs);
+#endif
@@ -93,6 +93,11 @@ bool is_swap_fast(swp_entry_t entry)
 	return false;
 }
 
+struct swap_info_struct *swp_swap_info(swp_entry_t entry)
+{
+	return swap_info[swp_type(entry)];
+}
+
 /* returns 1 if swap entry is freed */
 static int
 __try_to_reclaim_swap(struct swap_info_struct *si, unsigned long offset)
@@ -694,6 +699,15 @@ int page_swapcount(struct page *page)
 	return count;
 }
 
+/*
+ * How many references to @entry are currently swapped out? Read without
+ * the swap lock, so only a hint unless the caller pins the entry.
+ */
+int __swap_count(struct swap_info_struct *si, swp_entry_t entry)
+{
+	return swap_count(ACCESS_ONCE(si->swap_map[swp_offset(entry)]));
+}
+
 /*
  * How many references to @entry are currently swapped out?
  * This considers COUNT_CONTINUED so it returns exact answer.
@@ -1889,9 +1903,50 @@ static const struct file_operations proc_swaps_operations = {
 	.poll		= swaps_poll,
 };
 
+static int swap_ra_show(struct seq_file *swap, void *v)
+{
+	struct swap_info_struct *si = v;
+	struct file *file;
+	int len;
+
+	if (si == SEQ_START_TOKEN) {
+		seq_puts(swap, "Filename\t\t\t\tWindow\tReadahead\tUsed\n");
+		return 0;
+	}
+
+	file = si->swap_file;
+	len = seq_path(swap, &file->f_path, " \t\n\\");
+	seq_printf(swap, "%*s%u\t%lu\t\t%lu\n",
+			len < 40 ? 40 - len : 1, " ",
+			ACCESS_ONCE(si->ra_win),
+			atomic_long_read(&si->ra_pages),
+			atomic_long_read(&si->ra_used));
+	return 0;
+}
+
+static const struct seq_operations swap_ra_op = {
+	.start =	swap_start,
+	.next =		swap_next,
+	.stop =		swap_stop,
+	.show =		swap_ra_show
+};
+
+static int swap_ra_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &swap_ra_op);
+}
+
+static const struct file_operations proc_swap_ra_operations = {
+	.open		= swap_ra_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static int __init procswaps_init(void)
 {
 	proc_create("swaps", 0, NULL, &proc_swaps_operations);
+	proc_create("swap_readahead", 0, NULL, &proc_swap_ra_operations);
 	return 0;
 }
 __initcall(procswaps_init);
@@ -1946,6 +2001,11 @@ static struct swap_info_struct *alloc_swap_info(void)
 	INIT_LIST_HEAD(&p->first_swap_extent.list);
 	p->flags = SWP_USED;
 	p->next = -1;
+	p->ra_win = 0;
+	p->ra_prev_offset = 0;
+	atomic_set(&p->ra_hits, 0);
+	atomic_long_set(&p->ra_pages, 0);
+	atomic_long_set(&p->ra_used, 0);
 	spin_unlock(&swap_lock);
 	spin_lock_init(&p->lock);
 
@@ -2206,6 +2266,9 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_DISCARDABLE;
 		if (blk_queue_fast(bdev_get_queue(p->bdev)))
 			p->flags |= SWP_FAST;
+		if (blk_queue_synchronous(bdev_get_queue(p->bdev)) &&
+		    p->bdev->bd_disk->fops->rw_page)
+			p->flags |= SWP_SYNCHRONOUS_IO;
 	}
 
 	mutex_lock(&swapon_mutex);
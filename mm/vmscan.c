@@ -17,6 +17,8 @@
 #include <linux/kernel_stat.h>
 #include <linux/swap.h>
 #include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/hugetlb.h>
 #include <linux/init.h>
 #include <linux/highmem.h>
 #include <linux/vmpressure.h>
@@ -40,6 +42,7 @@
 #include <linux/freezer.h>
 #include <linux/memcontrol.h>
 #include <linux/delayacct.h>
+#include <linux/psi.h>
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
@@ -90,6 +93,12 @@ struct scan_control {
 	 */
 	struct mem_cgroup *target_mem_cgroup;
 
+	/* Can cgroups below their memory.low be reclaimed? */
+	int may_thrash;
+
+	/* A cgroup was skipped for being below its memory.low */
+	int memcg_low_skipped;
+
 	/*
 	 * Nodemask of nodes allowed by the caller. If NULL, all nodes
 	 * are scanned.
@@ -1152,28 +1161,12 @@ unsigned long reclaim_clean_pages_from_list(struct zone *zone,
 }
 
 #ifdef CONFIG_PROCESS_RECLAIM
-static unsigned long shrink_page(struct page *page,
-					struct zone *zone,
-					struct scan_control *sc,
-					enum ttu_flags ttu_flags,
-					unsigned long *ret_nr_dirty,
-					unsigned long *ret_nr_writeback,
-					bool force_reclaim,
-					struct list_head *ret_pages)
-{
-	int reclaimed;
-	LIST_HEAD(page_list);
-	list_add(&page->lru, &page_list);
-
-	reclaimed = shrink_page_list(&page_list, zone, sc, ttu_flags,
-				ret_nr_dirty, ret_nr_writeback,
-				force_reclaim);
-	if (!reclaimed)
-		list_splice(&page_list, ret_pages);
-
-	return reclaimed;
-}
-
+/*
+ * Reclaim pages that process reclaim isolated from the page tables of a
+ * task. The pages may come from any zone, so the isolation counts are
+ * dropped up front instead of per zone after the fact; the pages that
+ * could not be reclaimed are put back.
+ */
 unsigned long reclaim_pages_from_list(struct list_head *page_list)
 {
 	struct scan_control sc = {
@@ -1183,27 +1176,23 @@ unsigned long reclaim_pages_from_list(struct list_head *page_list)
 		.may_unmap = 1,
 		.may_swap = 1,
 	};
-
-	LIST_HEAD(ret_pages);
-	struct page *page;
 	unsigned long dummy1, dummy2, dummy3, dummy4, dummy5;
-	unsigned long nr_reclaimed = 0;
-
-	while (!list_empty(page_list)) {
-		page = lru_to_page(page_list);
-		list_del(&page->lru);
+	unsigned long nr_reclaimed;
+	struct page *page;
 
+	list_for_each_entry(page, page_list, lru) {
+		dec_zone_page_state(page, NR_ISOLATED_ANON +
+				page_is_file_cache(page));
 		ClearPageActive(page);
-		nr_reclaimed += shrink_page(page, page_zone(page), &sc,
+	}
+
+	nr_reclaimed = shrink_page_list(page_list, NULL, &sc,
 			TTU_UNMAP|TTU_IGNORE_ACCESS,
 			&dummy1, &dummy2, &dummy3, &dummy4, &dummy5, true);
-	}
 
-	while (!list_empty(&ret_pages)) {
-		page = lru_to_page(&ret_pages);
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
 		list_del(&page->lru);
-		dec_zone_page_state(page, NR_ISOLATED_ANON +
-				page_is_file_cache(page));
 		putback_lru_page(page);
 	}
 
@@ -1328,6 +1317,7 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 			nr_pages = hpage_nr_pages(page);
 			mem_cgroup_update_lru_size(lruvec, lru, -nr_pages);
 			list_move(&page->lru, dst);
+			lru_gen_del_page(page, lruvec);
 			nr_taken += nr_pages;
 			break;
 
@@ -1702,6 +1692,7 @@ static void move_active_pages_to_lru(struct lruvec *lruvec,
 		nr_pages = hpage_nr_pages(page);
 		mem_cgroup_update_lru_size(lruvec, lru, nr_pages);
 		list_move(&page->lru, &lruvec->lists[lru]);
+		lru_gen_add_page(page, lruvec, lru);
 		pgmoved += nr_pages;
 
 		if (put_page_testzero(page)) {
@@ -1896,11 +1887,424 @@ static int inactive_list_is_low(struct lruvec *lruvec, enum lru_list lru)
 		return inactive_anon_is_low(lruvec);
 }
 
+#ifdef CONFIG_LRU_GEN
+/*
+ * Multi-generational LRU
+ *
+ * The pages on the active lists are sorted into generations by when they
+ * were last found accessed.  A page going onto an active list, by fault,
+ * activation or a rotation in reclaim, is labelled with the youngest
+ * generation, lru_gen_max_seq, so each active list is ordered from the
+ * youngest generation at its head to the oldest at its tail.  The
+ * inactive list is the oldest generation of all, min_seq of the lruvec,
+ * and is reclaimed as before.
+ *
+ * Aging opens a new youngest generation and walks the page tables of all
+ * mms to promote the pages found accessed since the last walk into it.
+ * Pages not found accessed stay behind in their older generations, and
+ * when reclaim runs low on inactive pages it demotes the oldest of them to
+ * the inactive list instead of scanning and rotating the active list.
+ *
+ * The sequence numbers of the generations on the active list are in
+ * (min_seq, max_seq], so 1 <= max_seq - min_seq <= MAX_NR_GENS and at most
+ * MAX_NR_GENS - 1 are labelled at any time.  The labels are maintained
+ * whether or not the mode is enabled; /sys/kernel/mm/lru_gen/enabled
+ * switches reclaim between it and the classic active list scanning.
+ */
+unsigned long lru_gen_max_seq = MAX_NR_GENS;
+
+static unsigned int lru_gen_on __read_mostly =
+	IS_ENABLED(CONFIG_LRU_GEN_ENABLED);
+
+static DEFINE_MUTEX(lru_gen_aging_mutex);
+static LIST_HEAD(lru_gen_mm_list);
+static DEFINE_SPINLOCK(lru_gen_mm_lock);
+
+static inline bool lru_gen_enabled(void)
+{
+	return ACCESS_ONCE(lru_gen_on);
+}
+
+void lru_gen_add_mm(struct mm_struct *mm)
+{
+	spin_lock(&lru_gen_mm_lock);
+	list_add_tail(&mm->lru_gen_list, &lru_gen_mm_list);
+	spin_unlock(&lru_gen_mm_lock);
+}
+
+void lru_gen_del_mm(struct mm_struct *mm)
+{
+	spin_lock(&lru_gen_mm_lock);
+	list_del_init(&mm->lru_gen_list);
+	spin_unlock(&lru_gen_mm_lock);
+}
+
+/*
+ * Move up to @nr_to_scan pages of the oldest generation on the active list
+ * of @file to the inactive list, and retire the generation once it is
+ * empty.  Younger pages found on the way are rotated.  The youngest
+ * generation is never demoted.  Called with the lru_lock held.
+ */
+static unsigned long lru_gen_demote(struct lruvec *lruvec, int file,
+				    unsigned long nr_to_scan)
+{
+	struct lru_gen_struct *lrugen = &lruvec->lrugen;
+	enum lru_list lru = file ? LRU_INACTIVE_FILE : LRU_INACTIVE_ANON;
+	struct list_head *src = &lruvec->lists[lru + LRU_ACTIVE];
+	unsigned long seq = lrugen->min_seq[file] + 1;
+	int gen = lru_gen_from_seq(seq);
+	unsigned long scan, nr_moved = 0;
+	struct zone *zone = lruvec_zone(lruvec);
+
+	if (seq >= ACCESS_ONCE(lru_gen_max_seq))
+		return 0;
+
+	for (scan = 0; scan < nr_to_scan && !list_empty(src); scan++) {
+		struct page *page;
+		int nr_pages;
+
+		if (!lrugen->nr_pages[gen][file])
+			break;
+
+		page = lru_to_page(src);
+		if (page_lru_gen(page) != gen) {
+			list_move(&page->lru, src);
+			continue;
+		}
+
+		nr_pages = hpage_nr_pages(page);
+		lru_gen_del_page(page, lruvec);
+		ClearPageActive(page);
+		list_move(&page->lru, &lruvec->lists[lru]);
+		mem_cgroup_update_lru_size(lruvec, lru + LRU_ACTIVE, -nr_pages);
+		mem_cgroup_update_lru_size(lruvec, lru, nr_pages);
+		nr_moved += nr_pages;
+	}
+
+	if (!lrugen->nr_pages[gen][file])
+		lrugen->min_seq[file] = seq;
+
+	__mod_zone_page_state(zone, NR_LRU_BASE + lru + LRU_ACTIVE, -nr_moved);
+	__mod_zone_page_state(zone, NR_LRU_BASE + lru, nr_moved);
+	__count_vm_events(PGDEACTIVATE, nr_moved);
+	__count_vm_events(LRU_GEN_DEMOTED, nr_moved);
+
+	return scan;
+}
+
+/*
+ * Demote the oldest generation of every lruvec that has no sequence number
+ * left for a new one.
+ */
+static void lru_gen_make_room(void)
+{
+	struct mem_cgroup *memcg;
+	struct zone *zone;
+	int file;
+
+	memcg = mem_cgroup_iter(NULL, NULL, NULL);
+	do {
+		for_each_populated_zone(zone) {
+			struct lruvec *lruvec = mem_cgroup_zone_lruvec(zone, memcg);
+			struct lru_gen_struct *lrugen = &lruvec->lrugen;
+
+			spin_lock_irq(&zone->lru_lock);
+			for (file = 0; file < 2; file++) {
+				/* no page needs to be seen more than twice */
+				long budget = 2 * get_lru_size(lruvec,
+					LRU_ACTIVE + file * LRU_FILE) +
+					SWAP_CLUSTER_MAX;
+
+				while (lru_gen_max_seq - lrugen->min_seq[file] >=
+				       MAX_NR_GENS) {
+					unsigned long min_seq = lrugen->min_seq[file];
+					unsigned long scan;
+					int gen;
+
+					scan = lru_gen_demote(lruvec, file,
+							      SWAP_CLUSTER_MAX);
+					budget -= scan;
+					if (lrugen->min_seq[file] == min_seq &&
+					    (!scan || budget < 0)) {
+						/* the count went wrong */
+						WARN_ON_ONCE(1);
+						gen = lru_gen_from_seq(min_seq + 1);
+						lrugen->nr_pages[gen][file] = 0;
+						lrugen->min_seq[file]++;
+					}
+
+					spin_unlock_irq(&zone->lru_lock);
+					cond_resched();
+					spin_lock_irq(&zone->lru_lock);
+				}
+			}
+			spin_unlock_irq(&zone->lru_lock);
+		}
+		memcg = mem_cgroup_iter(NULL, memcg, NULL);
+	} while (memcg);
+}
+
+struct lru_gen_walk {
+	struct vm_area_struct *vma;
+	struct pagevec pvec;
+	unsigned long nr_scanned;
+	unsigned long nr_young;
+	bool flush;
+};
+
+/* Queue a page found accessed for promotion, returns false once full */
+static bool lru_gen_young_page(struct lru_gen_walk *gw, struct page *page)
+{
+	gw->nr_young++;
+	gw->flush = true;
+
+	if (!page || !PageLRU(page) || PageUnevictable(page))
+		return true;
+	if (PageActive(page) &&
+	    page_lru_gen(page) == lru_gen_from_seq(lru_gen_max_seq))
+		return true;
+	if (!get_page_unless_zero(page))
+		return true;
+
+	return pagevec_add(&gw->pvec, page);
+}
+
+static int lru_gen_pmd_entry(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct lru_gen_walk *gw = walk->private;
+	struct vm_area_struct *vma = gw->vma;
+	pte_t *pte, *orig_pte;
+	spinlock_t *ptl;
+	bool full;
+
+	if (pmd_trans_huge_lock(pmd, vma) == 1) {
+		gw->nr_scanned++;
+		full = false;
+		if (pmdp_test_and_clear_young(vma, addr, pmd))
+			full = !lru_gen_young_page(gw, pmd_page(*pmd));
+		spin_unlock(&walk->mm->page_table_lock);
+		if (full)
+			lru_gen_promote_pages(&gw->pvec);
+		return 0;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	while (addr != end) {
+		full = false;
+		orig_pte = pte = pte_offset_map_lock(walk->mm, pmd, addr, &ptl);
+		for (; addr != end && !full; pte++, addr += PAGE_SIZE) {
+			if (!pte_present(*pte))
+				continue;
+
+			gw->nr_scanned++;
+			if (!ptep_test_and_clear_young(vma, addr, pte))
+				continue;
+
+			full = !lru_gen_young_page(gw,
+					vm_normal_page(vma, addr, *pte));
+		}
+		pte_unmap_unlock(orig_pte, ptl);
+
+		if (full)
+			lru_gen_promote_pages(&gw->pvec);
+	}
+
+	cond_resched();
+	return 0;
+}
+
+static void lru_gen_walk_mm(struct mm_struct *mm, struct lru_gen_walk *gw)
+{
+	struct vm_area_struct *vma;
+	struct mm_walk walk = {
+		.pmd_entry = lru_gen_pmd_entry,
+		.mm = mm,
+		.private = gw,
+	};
+
+	/* never wait for a writer, the mm is seen again at the next aging */
+	if (!down_read_trylock(&mm->mmap_sem))
+		return;
+
+	gw->flush = false;
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma->vm_flags & (VM_SPECIAL | VM_LOCKED) ||
+		    is_vm_hugetlb_page(vma))
+			continue;
+
+		gw->vma = vma;
+		walk_page_range(vma->vm_start, vma->vm_end, &walk);
+	}
+
+	if (gw->flush)
+		flush_tlb_mm(mm);
+	up_read(&mm->mmap_sem);
+
+	if (pagevec_count(&gw->pvec))
+		lru_gen_promote_pages(&gw->pvec);
+}
+
+/*
+ * Open a new youngest generation and promote the pages accessed since the
+ * last aging into it.  Returns false if another task is aging already.
+ */
+static bool lru_gen_age(void)
+{
+	struct lru_gen_walk gw = { };
+	int nr_mms = 0;
+	struct mm_struct *mm;
+
+	if (!mutex_trylock(&lru_gen_aging_mutex))
+		return false;
+
+	lru_gen_make_room();
+	ACCESS_ONCE(lru_gen_max_seq) = lru_gen_max_seq + 1;
+
+	pagevec_init(&gw.pvec, 0);
+
+	spin_lock(&lru_gen_mm_lock);
+	list_for_each_entry(mm, &lru_gen_mm_list, lru_gen_list)
+		nr_mms++;
+	spin_unlock(&lru_gen_mm_lock);
+
+	/* rotate the list so that mms added meanwhile are not walked twice */
+	while (nr_mms--) {
+		spin_lock(&lru_gen_mm_lock);
+		if (list_empty(&lru_gen_mm_list)) {
+			spin_unlock(&lru_gen_mm_lock);
+			break;
+		}
+		mm = list_first_entry(&lru_gen_mm_list, struct mm_struct,
+				      lru_gen_list);
+		list_move_tail(&mm->lru_gen_list, &lru_gen_mm_list);
+		if (!atomic_inc_not_zero(&mm->mm_users)) {
+			spin_unlock(&lru_gen_mm_lock);
+			continue;
+		}
+		spin_unlock(&lru_gen_mm_lock);
+
+		lru_gen_walk_mm(mm, &gw);
+		mmput(mm);
+		cond_resched();
+	}
+
+	count_vm_event(LRU_GEN_AGING);
+	count_vm_events(LRU_GEN_PTE_SCANNED, gw.nr_scanned);
+	count_vm_events(LRU_GEN_PTE_YOUNG, gw.nr_young);
+
+	mutex_unlock(&lru_gen_aging_mutex);
+	return true;
+}
+
+/*
+ * Used in place of shrink_active_list(): once the inactive list, which is
+ * the oldest generation, runs low, demote the next oldest generation to
+ * it, aging first if only the youngest generation is left.
+ *
+ * Aging walks every mm, so global direct reclaim leaves it to kswapd and
+ * carries on with the inactive list it has.  Limit reclaim of a memcg has
+ * no kswapd to lean on and ages itself, unless a walk is already running.
+ */
+static void lru_gen_shrink_active(unsigned long nr_to_scan,
+				  struct lruvec *lruvec,
+				  struct scan_control *sc,
+				  enum lru_list lru)
+{
+	struct zone *zone = lruvec_zone(lruvec);
+	int file = is_file_lru(lru);
+	unsigned long inactive, active;
+
+	inactive = get_lru_size(lruvec, lru - LRU_ACTIVE);
+	active = get_lru_size(lruvec, lru);
+	if (inactive >= max_t(unsigned long, SWAP_CLUSTER_MAX,
+			      (inactive + active) >> sc->priority))
+		return;
+
+	if (ACCESS_ONCE(lru_gen_max_seq) - lruvec->lrugen.min_seq[file] <= 1) {
+		if (global_reclaim(sc) && !current_is_kswapd()) {
+			wakeup_kswapd(zone, sc->order, zone_idx(zone));
+			return;
+		}
+		lru_add_drain();
+		if (!lru_gen_age())
+			return;
+	}
+
+	spin_lock_irq(&zone->lru_lock);
+	lru_gen_demote(lruvec, file, nr_to_scan);
+	spin_unlock_irq(&zone->lru_lock);
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr,
+			    char *buf)
+{
+	return sprintf(buf, "%u\n", lru_gen_on);
+}
+
+static ssize_t enabled_store(struct kobject *kobj, struct kobj_attribute *attr,
+			     const char *buf, size_t count)
+{
+	unsigned long enabled;
+	int err;
+
+	err = kstrtoul(buf, 10, &enabled);
+	if (err || enabled > 1)
+		return -EINVAL;
+
+	lru_gen_on = enabled;
+
+	return count;
+}
+static struct kobj_attribute enabled_attr =
+	__ATTR(enabled, 0644, enabled_show, enabled_store);
+
+static struct attribute *lru_gen_attrs[] = {
+	&enabled_attr.attr,
+	NULL,
+};
+
+static struct attribute_group lru_gen_attr_group = {
+	.attrs = lru_gen_attrs,
+	.name = "lru_gen",
+};
+
+static int __init lru_gen_init(void)
+{
+	int err;
+
+	err = sysfs_create_group(mm_kobj, &lru_gen_attr_group);
+	if (err)
+		pr_err("lru_gen: register sysfs failed\n");
+
+	return err;
+}
+late_initcall(lru_gen_init);
+#endif /* CONFIG_SYSFS */
+#else
+static inline bool lru_gen_enabled(void)
+{
+	return false;
+}
+
+static inline void lru_gen_shrink_active(unsigned long nr_to_scan,
+					 struct lruvec *lruvec,
+					 struct scan_control *sc,
+					 enum lru_list lru)
+{
+}
+#endif /* CONFIG_LRU_GEN */
+
 static unsigned long shrink_list(enum lru_list lru, unsigned long nr_to_scan,
 				 struct lruvec *lruvec, struct scan_control *sc)
 {
 	if (is_active_lru(lru)) {
-		if (inactive_list_is_low(lruvec, lru))
+		if (lru_gen_enabled())
+			lru_gen_shrink_active(nr_to_scan, lruvec, sc, lru);
+		else if (inactive_list_is_low(lruvec, lru))
 			shrink_active_list(nr_to_scan, lruvec, sc, lru);
 		return 0;
 	}
@@ -2222,7 +2626,7 @@ static void shrink_lruvec(struct lruvec *lruvec, struct scan_control *sc)
 	 * Even if we did not try to evict anon pages at all, we want to
 	 * rebalance the anon lru active/inactive ratio.
 	 */
-	if (inactive_anon_is_low(lruvec))
+	if (!lru_gen_enabled() && inactive_anon_is_low(lruvec))
 		shrink_active_list(SWAP_CLUSTER_MAX, lruvec,
 				   sc, LRU_ACTIVE_ANON);
 
@@ -2321,12 +2725,29 @@ static void shrink_zone(struct zone *zone, struct scan_control *sc)
 
 		memcg = mem_cgroup_iter(root, NULL, &reclaim);
 		do {
+			unsigned long scanned = sc->nr_scanned;
+			unsigned long reclaimed = sc->nr_reclaimed;
 			struct lruvec *lruvec;
+			bool low;
+
+			/*
+			 * Groups below their memory.low are left alone
+			 * until reclaim found nothing anywhere else.
+			 */
+			low = mem_cgroup_low(root, memcg);
+			if (low && !sc->may_thrash) {
+				sc->memcg_low_skipped = 1;
+				continue;
+			}
 
 			lruvec = mem_cgroup_zone_lruvec(zone, memcg);
 
 			shrink_lruvec(lruvec, sc);
 
+			mem_cgroup_reclaim_stat(memcg,
+						sc->nr_scanned - scanned,
+						sc->nr_reclaimed - reclaimed, low);
+
 			/*
 			 * Direct reclaim and kswapd have to scan all memory
 			 * cgroups to fulfill the overall scan target for the
@@ -2342,8 +2763,7 @@ static void shrink_zone(struct zone *zone, struct scan_control *sc)
 				mem_cgroup_iter_break(root, memcg);
 				break;
 			}
-			memcg = mem_cgroup_iter(root, memcg, &reclaim);
-		} while (memcg);
+		} while ((memcg = mem_cgroup_iter(root, memcg, &reclaim)));
 
 		vmpressure(sc->gfp_mask, sc->target_mem_cgroup,
 			   sc->nr_scanned - nr_scanned,
@@ -2521,6 +2941,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	struct zoneref *z;
 	struct zone *zone;
 	unsigned long writeback_threshold;
+	int initial_priority = sc->priority;
 	bool aborted_reclaim;
 
 	delayacct_freepages_start();
@@ -2528,6 +2949,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	if (global_reclaim(sc))
 		count_vm_event(ALLOCSTALL);
 
+retry:
 	do {
 		vmpressure_prio(sc->gfp_mask, sc->target_mem_cgroup,
 				sc->priority);
@@ -2583,6 +3005,17 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	} while (--sc->priority >= 0 && !aborted_reclaim);
 
 out:
+	/*
+	 * Nothing reclaimable outside of the groups protected by
+	 * memory.low: go through them as well before giving up.
+	 */
+	if (!sc->nr_reclaimed && !aborted_reclaim && sc->memcg_low_skipped &&
+	    !sc->may_thrash) {
+		sc->priority = initial_priority;
+		sc->may_thrash = 1;
+		goto retry;
+	}
+
 	delayacct_freepages_end();
 
 	if (sc->nr_reclaimed)
@@ -2818,6 +3251,7 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 {
 	struct zonelist *zonelist;
 	unsigned long nr_reclaimed;
+	unsigned long pflags;
 	int nid;
 	struct scan_control sc = {
 		.may_writepage = !laptop_mode,
@@ -2848,7 +3282,9 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 					    sc.may_writepage,
 					    sc.gfp_mask);
 
+	psi_memstall_enter(&pflags);
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc, &shrink);
+	psi_memstall_leave(&pflags);
 
 	trace_mm_vmscan_memcg_reclaim_end(nr_reclaimed);
 
@@ -2860,7 +3296,7 @@ static void age_active_anon(struct zone *zone, struct scan_control *sc)
 {
 	struct mem_cgroup *memcg;
 
-	if (!total_swap_pages)
+	if (!total_swap_pages || lru_gen_enabled())
 		return;
 
 	memcg = mem_cgroup_iter(NULL, NULL, NULL);
@@ -3099,6 +3535,9 @@ static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
 		.order = order,
 		.target_mem_cgroup = NULL,
 	};
+	unsigned long pflags;
+
+	psi_memstall_enter(&pflags);
 	count_vm_event(PAGEOUTRUN);
 
 	do {
@@ -3272,6 +3711,7 @@ out:
 	 * was awake, order will remain at the higher level
 	 */
 	*classzone_idx = end_zone;
+	psi_memstall_leave(&pflags);
 	return order;
 }
 
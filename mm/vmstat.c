@@ -619,6 +619,24 @@ int fragmentation_index(struct zone *zone, unsigned int order)
 	fill_contig_page_info(zone, order, &info);
 	return __fragmentation_index(order, &info);
 }
+
+/*
+ * Percentage of the free memory of a zone that is in blocks too small
+ * for an allocation of the given order: unlike the fragmentation index,
+ * it is meaningful whether or not such an allocation would succeed.
+ */
+unsigned int extfrag_for_order(struct zone *zone, unsigned int order)
+{
+	struct contig_page_info info;
+
+	fill_contig_page_info(zone, order, &info);
+	if (info.free_pages == 0)
+		return 0;
+
+	return div_u64((info.free_pages -
+			(info.free_blocks_suitable << order)) * 100,
+			info.free_pages);
+}
 #endif
 
 #if defined(CONFIG_PROC_FS) || defined(CONFIG_COMPACTION)
@@ -743,6 +761,12 @@ const char * const vmstat_text[] = {
 	"nr_anon_transparent_hugepages",
 	"nr_free_cma",
 	"nr_swapcache",
+#ifdef CONFIG_LRU_GEN
+	"nr_lru_gen_age0",
+	"nr_lru_gen_age1",
+	"nr_lru_gen_age2",
+	"nr_lru_gen_age3",
+#endif
 
 	/* enum writeback_stat_item counters */
 	"nr_dirty_threshold",
@@ -770,6 +794,12 @@ const char * const vmstat_text[] = {
 	TEXTS_FOR_ZONES("pgscan_direct")
 	"pgscan_direct_throttle",
 
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+	"swap_direct",
+#endif
+
 #ifdef CONFIG_NUMA
 	"zone_reclaim_failed",
 #endif
@@ -801,6 +831,11 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
+	"compact_daemon_migrate_scanned",
+	"compact_daemon_free_scanned",
+	"compact_daemon_success",
+	"compact_daemon_fail",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -824,6 +859,13 @@ const char * const vmstat_text[] = {
 	"thp_zero_page_alloc",
 	"thp_zero_page_alloc_failed",
 #endif
+#ifdef CONFIG_LRU_GEN
+	"lru_gen_aging",
+	"lru_gen_pte_scanned",
+	"lru_gen_pte_young",
+	"lru_gen_promoted",
+	"lru_gen_demoted",
+#endif
 
 #endif /* CONFIG_VM_EVENTS_COUNTERS */
 };
@@ -1097,6 +1139,25 @@ static const struct file_operations pagetypeinfo_file_ops = {
 	.release	= seq_release,
 };
 
+#ifdef CONFIG_LRU_GEN
+/* The generation counters are shown by age, youngest first */
+static int lru_gen_stat_item(int item)
+{
+	if (item >= NR_LRU_GEN_BASE && item <= NR_LRU_GEN_LAST) {
+		unsigned long seq = ACCESS_ONCE(lru_gen_max_seq) -
+				    (item - NR_LRU_GEN_BASE);
+
+		return NR_LRU_GEN_BASE + lru_gen_from_seq(seq);
+	}
+	return item;
+}
+#else
+static inline int lru_gen_stat_item(int item)
+{
+	return item;
+}
+#endif
+
 static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 							struct zone *zone)
 {
@@ -1122,7 +1183,7 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 
 	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
 		seq_printf(m, "\n    %-12s %lu", vmstat_text[i],
-				zone_page_state(zone, i));
+				zone_page_state(zone, lru_gen_stat_item(i)));
 
 	seq_printf(m,
 		   "\n        protection: (%lu",
@@ -1215,7 +1276,7 @@ static void *vmstat_start(struct seq_file *m, loff_t *pos)
 	if (!v)
 		return ERR_PTR(-ENOMEM);
 	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
-		v[i] = global_page_state(i);
+		v[i] = global_page_state(lru_gen_stat_item(i));
 	v += NR_VM_ZONE_STAT_ITEMS;
 
 	global_dirty_limits(v + NR_DIRTY_BG_THRESHOLD,
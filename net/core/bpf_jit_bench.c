@@ -0,0 +1,361 @@
+/*
+ * BPF JIT equivalence test and benchmark
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Runs a set of classic BPF socket filters over linear, paged and VLAN
+ * tagged packets, once through sk_run_filter() and once through the
+ * image the JIT built for them, reports any difference in the results
+ * and prints the nanoseconds spent per run for both.  Set
+ * net.core.bpf_jit_enable to 1 before loading, otherwise only the
+ * interpreter is measured.  Loading fails on purpose so that the
+ * module can be loaded again right away.
+ */
+
+#include <linux/module.h>
+#include <linux/filter.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/if_ether.h>
+#include <linux/if_vlan.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/ktime.h>
+#include <net/net_namespace.h>
+
+#define BENCH_HDR_LEN	(ETH_HLEN + sizeof(struct iphdr) + \
+			 sizeof(struct tcphdr))
+#define BENCH_PAY_LEN	512
+
+static unsigned int loops = 1000000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Runs of each filter per measurement");
+
+/* tcpdump -dd "ip and tcp dst port 22" */
+static struct sock_filter prog_ssh[] = {
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 8),
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 0, 6),
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+	BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 4, 0),
+	BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0x40000),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+/* Every ALU operation and the scratch memory */
+static struct sock_filter prog_alu[] = {
+	BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 26),
+	BPF_STMT(BPF_ST, 0),
+	BPF_STMT(BPF_LDX | BPF_IMM, 3),
+	BPF_STMT(BPF_ALU | BPF_MUL | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 100000),
+	BPF_STMT(BPF_ALU | BPF_SUB | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 7),
+	BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 3),
+	BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, 1000003),
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),
+	BPF_STMT(BPF_LD | BPF_MEM, 0),
+	BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffff0f0f),
+	BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_XOR | BPF_K, 0x5a5a5a5a),
+	BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 3),
+	BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 5),
+	BPF_STMT(BPF_ALU | BPF_NEG, 0),
+	BPF_STMT(BPF_STX, 15),
+	BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+	BPF_STMT(BPF_LDX | BPF_MEM, 15),
+	BPF_STMT(BPF_ALU | BPF_MOD | BPF_X, 0),
+	BPF_STMT(BPF_LDX | BPF_IMM, 7),
+	BPF_STMT(BPF_ALU | BPF_LSH | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_AND | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 0x12345),
+	BPF_STMT(BPF_ALU | BPF_RSH | BPF_X, 0),
+	BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 0x10000, 0, 1),
+	BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1),
+	BPF_JUMP(BPF_JMP | BPF_JGE | BPF_X, 0, 1, 0),
+	BPF_STMT(BPF_MISC | BPF_TXA, 0),
+	BPF_STMT(BPF_RET | BPF_A, 0),
+};
+
+/* Ancillary data folded together */
+#define ANC(field)						\
+	BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + (field)),	\
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),				\
+	BPF_STMT(BPF_LD | BPF_MEM, 0),					\
+	BPF_STMT(BPF_LD | BPF_W | BPF_ABS,				\
+		 SKF_AD_OFF + SKF_AD_ALU_XOR_X),			\
+	BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 1),				\
+	BPF_STMT(BPF_ST, 0)
+
+static struct sock_filter prog_anc[] = {
+	BPF_STMT(BPF_LD | BPF_IMM, 0),
+	BPF_STMT(BPF_ST, 0),
+	ANC(SKF_AD_PROTOCOL),
+	ANC(SKF_AD_IFINDEX),
+	ANC(SKF_AD_MARK),
+	ANC(SKF_AD_QUEUE),
+	ANC(SKF_AD_HATYPE),
+	ANC(SKF_AD_RXHASH),
+	ANC(SKF_AD_VLAN_TAG),
+	ANC(SKF_AD_VLAN_TAG_PRESENT),
+	ANC(SKF_AD_PAY_OFFSET),
+	BPF_STMT(BPF_LD | BPF_MEM, 0),
+	BPF_STMT(BPF_RET | BPF_A, 0),
+};
+
+/* Loads relative to the network and link layer headers */
+static struct sock_filter prog_neg[] = {
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF + 9),
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_LL_OFF + 12),
+	BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),
+	BPF_STMT(BPF_LD | BPF_W | BPF_IND, SKF_NET_OFF + 12),
+	BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+	BPF_STMT(BPF_RET | BPF_A, 0),
+};
+
+/* The last bytes of the packet, then a load past its end */
+static struct sock_filter prog_tail[] = {
+	BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+	BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 4),
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),
+	BPF_STMT(BPF_LD | BPF_W | BPF_IND, 0),
+	BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80000000, 1, 0),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, 100),
+	BPF_STMT(BPF_RET | BPF_A, 0),
+};
+
+struct bench_prog {
+	const char *name;
+	struct sock_filter *insns;
+	unsigned int len;
+};
+
+#define BENCH_PROG(p) { #p, p, ARRAY_SIZE(p) }
+
+static struct bench_prog progs[] = {
+	BENCH_PROG(prog_ssh),
+	BENCH_PROG(prog_alu),
+	BENCH_PROG(prog_anc),
+	BENCH_PROG(prog_neg),
+	BENCH_PROG(prog_tail),
+};
+
+static void bench_fill_hdr(u8 *p)
+{
+	struct ethhdr *eth = (struct ethhdr *)p;
+	struct iphdr *iph = (struct iphdr *)(eth + 1);
+	struct tcphdr *th = (struct tcphdr *)(iph + 1);
+
+	memset(p, 0, BENCH_HDR_LEN);
+	memset(eth->h_dest, 0x02, ETH_ALEN);
+	memset(eth->h_source, 0x04, ETH_ALEN);
+	eth->h_proto = htons(ETH_P_IP);
+	iph->version = 4;
+	iph->ihl = 5;
+	iph->ttl = 64;
+	iph->protocol = IPPROTO_TCP;
+	iph->tot_len = htons(BENCH_HDR_LEN - ETH_HLEN + BENCH_PAY_LEN);
+	iph->saddr = htonl(0xc0a80001);
+	iph->daddr = htonl(0xc0a80002);
+	th->source = htons(40000);
+	th->dest = htons(22);
+	th->doff = 5;
+	th->ack = 1;
+}
+
+static void bench_set_meta(struct sk_buff *skb)
+{
+	skb->protocol = htons(ETH_P_IP);
+	skb->dev = init_net.loopback_dev;
+	skb->mark = 0x1234;
+	skb->rxhash = 0xdeadbeef;
+	skb_set_queue_mapping(skb, 3);
+	skb_reset_mac_header(skb);
+	skb_set_network_header(skb, ETH_HLEN);
+	skb_set_transport_header(skb, ETH_HLEN + sizeof(struct iphdr));
+}
+
+/* Headers and payload all in the linear area */
+static struct sk_buff *bench_linear_skb(void)
+{
+	struct sk_buff *skb;
+	u8 *p;
+	int i;
+
+	skb = alloc_skb(BENCH_HDR_LEN + BENCH_PAY_LEN, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+	p = skb_put(skb, BENCH_HDR_LEN + BENCH_PAY_LEN);
+	bench_fill_hdr(p);
+	for (i = BENCH_HDR_LEN; i < BENCH_HDR_LEN + BENCH_PAY_LEN; i++)
+		p[i] = i;
+	bench_set_meta(skb);
+	return skb;
+}
+
+/* Only the link and IP headers linear, so that TCP loads take the slow path */
+static struct sk_buff *bench_paged_skb(void)
+{
+	unsigned int lin = ETH_HLEN + sizeof(struct iphdr);
+	unsigned int frag = BENCH_HDR_LEN + BENCH_PAY_LEN - lin;
+	struct sk_buff *skb;
+	struct page *page;
+	u8 hdr[BENCH_HDR_LEN], *p;
+	int i;
+
+	skb = alloc_skb(lin, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		kfree_skb(skb);
+		return NULL;
+	}
+
+	bench_fill_hdr(hdr);
+	memcpy(skb_put(skb, lin), hdr, lin);
+	p = page_address(page);
+	memcpy(p, hdr + lin, BENCH_HDR_LEN - lin);
+	for (i = BENCH_HDR_LEN - lin; i < frag; i++)
+		p[i] = i;
+
+	skb_fill_page_desc(skb, 0, page, 0, frag);
+	skb->len += frag;
+	skb->data_len += frag;
+	skb->truesize += PAGE_SIZE;
+	bench_set_meta(skb);
+	return skb;
+}
+
+static struct sk_buff *bench_vlan_skb(void)
+{
+	struct sk_buff *skb = bench_linear_skb();
+
+	if (skb)
+		__vlan_hwaccel_put_tag(skb, htons(ETH_P_8021Q), 100);
+	return skb;
+}
+
+static const struct {
+	const char *name;
+	struct sk_buff *(*alloc)(void);
+} skbs[] = {
+	{ "linear", bench_linear_skb },
+	{ "paged", bench_paged_skb },
+	{ "vlan", bench_vlan_skb },
+};
+
+/* Nanoseconds per run */
+static u64 bench_run(const struct sk_filter *fp, const struct sk_buff *skb,
+		     bool jit, u32 *res)
+{
+	ktime_t start;
+	unsigned int i;
+	u32 ret = 0;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		if (jit)
+			ret = SK_RUN_FILTER(fp, skb);
+		else
+			ret = sk_run_filter(skb, fp->insns);
+	}
+	*res = ret;
+	return div_u64(ktime_to_ns(ktime_sub(ktime_get(), start)), loops);
+}
+
+static int bench_prog(const struct bench_prog *bp, unsigned int *failed)
+{
+	struct sock_fprog fprog = { .len = bp->len, .filter = bp->insns };
+	struct sk_filter *fp;
+	unsigned int i;
+	bool jit;
+	int err;
+
+	err = sk_unattached_filter_create(&fp, &fprog);
+	if (err) {
+		pr_err("bpf_jit_bench: %s: filter rejected: %d\n",
+		       bp->name, err);
+		return err;
+	}
+	jit = fp->bpf_func != sk_run_filter;
+
+	for (i = 0; i < ARRAY_SIZE(skbs); i++) {
+		struct sk_buff *skb = skbs[i].alloc();
+		u32 interp_ret, jit_ret = 0;
+		u64 interp_ns, jit_ns = 0;
+
+		if (!skb) {
+			err = -ENOMEM;
+			break;
+		}
+
+		/* the cpu is part of the result of some filters */
+		preempt_disable();
+		interp_ns = bench_run(fp, skb, false, &interp_ret);
+		if (jit)
+			jit_ns = bench_run(fp, skb, true, &jit_ret);
+		preempt_enable();
+
+		if (!jit) {
+			pr_info("bpf_jit_bench: %-10s %-7s ret %#x interp %llu ns, not jitted\n",
+				bp->name, skbs[i].name, interp_ret, interp_ns);
+		} else if (jit_ret != interp_ret) {
+			(*failed)++;
+			pr_err("bpf_jit_bench: %-10s %-7s MISMATCH interp %#x jit %#x\n",
+			       bp->name, skbs[i].name, interp_ret, jit_ret);
+		} else {
+			pr_info("bpf_jit_bench: %-10s %-7s ret %#x interp %llu ns, jit %llu ns\n",
+				bp->name, skbs[i].name, interp_ret,
+				interp_ns, jit_ns);
+		}
+		kfree_skb(skb);
+		cond_resched();
+	}
+
+	sk_unattached_filter_destroy(fp);
+	return err;
+}
+
+static int __init bpf_jit_bench_init(void)
+{
+	unsigned int i, failed = 0;
+	int err;
+
+	if (!loops)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(progs); i++) {
+		err = bench_prog(&progs[i], &failed);
+		if (err)
+			return err;
+	}
+	pr_info("bpf_jit_bench: %u mismatches\n", failed);
+
+	return -EAGAIN; /* Fail will directly unload the module */
+}
+
+static void __exit bpf_jit_bench_exit(void)
+{
+}
+
+module_init(bpf_jit_bench_init)
+module_exit(bpf_jit_bench_exit)
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("BPF JIT equivalence test and benchmark");
@@ -82,7 +82,6 @@ static void queue_process(struct work_struct *work)
 
 	while ((skb = skb_dequeue(&npinfo->txq))) {
 		struct net_device *dev = skb->dev;
-		const struct net_device_ops *ops = dev->netdev_ops;
 		struct netdev_queue *txq;
 
 		if (!netif_device_present(dev) || !netif_running(dev)) {
@@ -95,7 +94,7 @@ static void queue_process(struct work_struct *work)
 		local_irq_save(flags);
 		__netif_tx_lock(txq, smp_processor_id());
 		if (netif_xmit_frozen_or_stopped(txq) ||
-		    ops->ndo_start_xmit(skb, dev) != NETDEV_TX_OK) {
+		    netdev_start_xmit(skb, dev, false) != NETDEV_TX_OK) {
 			skb_queue_head(&npinfo->txq, skb);
 			__netif_tx_unlock(txq);
 			local_irq_restore(flags);
@@ -397,7 +396,8 @@ void netpoll_send_skb_on_dev(struct netpoll *np, struct sk_buff *skb,
 						skb->vlan_tci = 0;
 					}
 
-					status = ops->ndo_start_xmit(skb, dev);
+					status = netdev_start_xmit(skb, dev,
+								   false);
 					if (status == NETDEV_TX_OK)
 						txq_trans_update(txq);
 				}
@@ -296,16 +296,12 @@ EXPORT_SYMBOL(__alloc_skb);
  *  before giving packet to stack.
  *  RX rings only contains data buffers, not full skbs.
  */
-struct sk_buff *build_skb(void *data, unsigned int frag_size)
+static void __build_skb_around(struct sk_buff *skb, void *data,
+			       unsigned int frag_size)
 {
 	struct skb_shared_info *shinfo;
-	struct sk_buff *skb;
 	unsigned int size = frag_size ? : ksize(data);
 
-	skb = kmem_cache_alloc(skbuff_head_cache, GFP_ATOMIC);
-	if (!skb)
-		return NULL;
-
 	size -= SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 
 	memset(skb, 0, offsetof(struct sk_buff, tail));
@@ -326,11 +322,97 @@ struct sk_buff *build_skb(void *data, unsigned int frag_size)
 	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
 	atomic_set(&shinfo->dataref, 1);
 	kmemcheck_annotate_variable(shinfo->destructor_arg);
+}
 
+struct sk_buff *build_skb(void *data, unsigned int frag_size)
+{
+	struct sk_buff *skb;
+
+	skb = kmem_cache_alloc(skbuff_head_cache, GFP_ATOMIC);
+	if (!skb)
+		return NULL;
+
+	__build_skb_around(skb, data, frag_size);
 	return skb;
 }
 EXPORT_SYMBOL(build_skb);
 
+/*
+ * Per-cpu cache of sk_buff heads for the NAPI receive and transmit
+ * completion paths. It is refilled and drained through the slab bulk
+ * interface, so the cost of the cache_cpu round trips is shared by a
+ * batch of skbs. Only touched from softirq context.
+ */
+#define NAPI_SKB_CACHE_SIZE	64
+#define NAPI_SKB_CACHE_BULK	16
+#define NAPI_SKB_CACHE_HALF	(NAPI_SKB_CACHE_SIZE / 2)
+
+struct napi_alloc_cache {
+	unsigned int	skb_count;
+	void		*skb_cache[NAPI_SKB_CACHE_SIZE];
+};
+static DEFINE_PER_CPU(struct napi_alloc_cache, napi_alloc_cache);
+
+static struct sk_buff *napi_skb_cache_get(void)
+{
+	struct napi_alloc_cache *nc = &__get_cpu_var(napi_alloc_cache);
+
+	if (unlikely(!nc->skb_count))
+		nc->skb_count = kmem_cache_alloc_bulk(skbuff_head_cache,
+						      GFP_ATOMIC,
+						      NAPI_SKB_CACHE_BULK,
+						      nc->skb_cache);
+	if (unlikely(!nc->skb_count))
+		return NULL;
+
+	return nc->skb_cache[--nc->skb_count];
+}
+
+static void napi_skb_cache_put(struct sk_buff *skb)
+{
+	struct napi_alloc_cache *nc = &__get_cpu_var(napi_alloc_cache);
+
+	nc->skb_cache[nc->skb_count++] = skb;
+	if (unlikely(nc->skb_count == NAPI_SKB_CACHE_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, NAPI_SKB_CACHE_HALF,
+				     nc->skb_cache + NAPI_SKB_CACHE_HALF);
+		nc->skb_count = NAPI_SKB_CACHE_HALF;
+	}
+}
+
+/**
+ *	napi_skb_cache_flush - release the skb heads cached by a cpu
+ *	@cpu: cpu that went offline
+ */
+void napi_skb_cache_flush(int cpu)
+{
+	struct napi_alloc_cache *nc = &per_cpu(napi_alloc_cache, cpu);
+
+	kmem_cache_free_bulk(skbuff_head_cache, nc->skb_count, nc->skb_cache);
+	nc->skb_count = 0;
+}
+
+/**
+ * napi_build_skb - build a network buffer from NAPI context
+ * @data: data buffer provided by caller
+ * @frag_size: size of fragment, or 0 if head was kmalloced
+ *
+ * Same as build_skb(), but the sk_buff comes from the per-cpu NAPI cache.
+ * Must be called from softirq context.
+ */
+struct sk_buff *napi_build_skb(void *data, unsigned int frag_size)
+{
+	struct sk_buff *skb;
+
+	skb = napi_skb_cache_get();
+	if (unlikely(!skb))
+		return NULL;
+
+	__build_skb_around(skb, data, frag_size);
+	return skb;
+}
+EXPORT_SYMBOL(napi_build_skb);
+
 struct netdev_alloc_cache {
 	struct page_frag	frag;
 	/* we maintain a pagecount bias, so that we dont dirty cache line
@@ -443,6 +525,52 @@ struct sk_buff *__netdev_alloc_skb(struct net_device *dev,
 }
 EXPORT_SYMBOL(__netdev_alloc_skb);
 
+/**
+ *	__napi_alloc_skb - allocate an skbuff for rx in a specific NAPI instance
+ *	@napi: napi instance this buffer was allocated for
+ *	@length: length to allocate
+ *	@gfp_mask: get_free_pages mask, passed to alloc_skb
+ *
+ *	Like __netdev_alloc_skb(), but the head comes from the per-cpu NAPI
+ *	cache and NET_IP_ALIGN is reserved as well. Must be called from
+ *	softirq context.
+ *
+ *	%NULL is returned if there is no free memory.
+ */
+struct sk_buff *__napi_alloc_skb(struct napi_struct *napi,
+				 unsigned int length, gfp_t gfp_mask)
+{
+	struct sk_buff *skb = NULL;
+	unsigned int fragsz;
+
+	length += NET_SKB_PAD + NET_IP_ALIGN;
+	fragsz = SKB_DATA_ALIGN(length) +
+		 SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	if (fragsz <= PAGE_SIZE && !(gfp_mask & (__GFP_WAIT | GFP_DMA))) {
+		void *data;
+
+		if (sk_memalloc_socks())
+			gfp_mask |= __GFP_MEMALLOC;
+
+		data = __netdev_alloc_frag(fragsz, gfp_mask);
+
+		if (likely(data)) {
+			skb = napi_build_skb(data, fragsz);
+			if (unlikely(!skb))
+				put_page(virt_to_head_page(data));
+		}
+	} else {
+		skb = __alloc_skb(length, gfp_mask, SKB_ALLOC_RX, NUMA_NO_NODE);
+	}
+	if (likely(skb)) {
+		skb_reserve(skb, NET_SKB_PAD + NET_IP_ALIGN);
+		skb->dev = napi->dev;
+	}
+	return skb;
+}
+EXPORT_SYMBOL(__napi_alloc_skb);
+
 void skb_add_rx_frag(struct sk_buff *skb, int i, struct page *page, int off,
 		     int size, unsigned int truesize)
 {
@@ -593,6 +721,35 @@ void __kfree_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(__kfree_skb);
 
+/**
+ *	__kfree_skb_defer - free an sk_buff from softirq context
+ *	@skb: buffer
+ *
+ *	Like __kfree_skb(), but a head from skbuff_head_cache goes back to
+ *	the per-cpu NAPI cache instead of the slab.
+ */
+void __kfree_skb_defer(struct sk_buff *skb)
+{
+	skb_release_all(skb);
+	if (skb->fclone == SKB_FCLONE_UNAVAILABLE)
+		napi_skb_cache_put(skb);
+	else
+		kfree_skbmem(skb);
+}
+
+/**
+ *	napi_skb_free_stolen_head - free an sk_buff whose data was stolen
+ *	@skb: buffer
+ *
+ *	Used by GRO once the head of @skb was merged into another buffer;
+ *	only the sk_buff itself is left and goes to the per-cpu NAPI cache.
+ */
+void napi_skb_free_stolen_head(struct sk_buff *skb)
+{
+	skb_dst_drop(skb);
+	napi_skb_cache_put(skb);
+}
+
 /**
  *	kfree_skb - free an sk_buff
  *	@skb: buffer to free
@@ -732,6 +889,7 @@ static struct sk_buff *__skb_clone(struct sk_buff *n, struct sk_buff *skb)
 	n->hdr_len = skb->nohdr ? skb_headroom(skb) : skb->hdr_len;
 	n->cloned = 1;
 	n->nohdr = 0;
+	n->xmit_more = 0;
 	n->destructor = NULL;
 	C(tail);
 	C(end);
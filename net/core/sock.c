@@ -951,6 +951,17 @@ set_rcvbuf:
 					 sk->sk_max_pacing_rate);
 		break;
 
+	case SO_REUSEPORT_CPU:
+		/* only datagram lookups honour it, see sk_reuseport_cpu_match */
+		if (sk->sk_type != SOCK_DGRAM) {
+			ret = -ENOPROTOOPT;
+			break;
+		}
+		sock_valbool_flag(sk, SOCK_REUSEPORT_CPU, valbool);
+		/* until the first receive, assume the owner stays here */
+		sk->sk_incoming_cpu = valbool ? raw_smp_processor_id() : -1;
+		break;
+
 	default:
 		ret = -ENOPROTOOPT;
 		break;
@@ -1212,6 +1223,10 @@ int sock_getsockopt(struct socket *sock, int level, int optname,
 		v.val = sk->sk_max_pacing_rate;
 		break;
 
+	case SO_REUSEPORT_CPU:
+		v.val = sock_flag(sk, SOCK_REUSEPORT_CPU);
+		break;
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -2343,6 +2358,7 @@ void sock_init_data(struct socket *sock, struct sock *sk)
 	sk->sk_pacing_rate = ~0U;
 
 	sk->sk_max_pacing_rate = ~0U;
+	sk->sk_incoming_cpu = -1;
 	/*
 	 * Before updating sk_refcnt, we must commit prior changes to memory
 	 * (Documentation/RCU/rculist_nulls.txt for details)
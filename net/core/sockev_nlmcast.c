@@ -13,17 +13,52 @@
  *
  * Default SOCKEV client implementation
  *
+ * Events are not sent from the syscall that raises them.  They are
+ * recorded in a per-CPU queue and a delayed work on that CPU sends what
+ * has been queued, one netlink message per event, in a single multicast
+ * skb.  Only a syscall that finds its queue full pays for a send.
+ * Events not set in the event_mask parameter are dropped before anything
+ * is recorded.
+ *
  */
 
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/export.h>
 #include <linux/netlink.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 #include <linux/sockev.h>
+#include <net/netlink.h>
 #include <net/sock.h>
 
+/* events per CPU sent in one skb */
+#define SOCKEV_BATCH	16
+#define SOCKEV_BATCH_SIZE \
+	(SOCKEV_BATCH * NLMSG_ALIGN(nlmsg_msg_size(sizeof(struct sknlsockevmsg))))
+
+struct sockev_queue {
+	spinlock_t lock;
+	unsigned int count;
+	unsigned int dropped;
+	int cpu;
+	struct delayed_work work;
+	struct sknlsockevmsg msgs[SOCKEV_BATCH];
+	u8 events[SOCKEV_BATCH];
+};
+
 static int registration_status;
 static struct sock *socknlmsgsk;
+static DEFINE_PER_CPU(struct sockev_queue, sockev_queues);
+
+/* bit n set sends event n, the default is what this client always sent */
+static unsigned int event_mask = BIT(SOCKEV_BIND) | BIT(SOCKEV_LISTEN);
+module_param(event_mask, uint, 0644);
+MODULE_PARM_DESC(event_mask, "Bitmask of SOCKEV_* events to multicast");
+
+static unsigned int flush_ms = 10;
+module_param(flush_ms, uint, 0644);
+MODULE_PARM_DESC(flush_ms, "Longest time an event waits to be sent");
 
 static void sockev_skmsg_recv(struct sk_buff *skb)
 {
@@ -60,40 +95,93 @@ static void _sockev_event(unsigned long event, __u8 *evstr, int buflen)
 	}
 }
 
+/*
+ * Send everything queued on q in one skb.  The skb is allocated before
+ * taking the lock so the queue is never held across a sleeping
+ * allocation.  Returns nonzero if the skb could not be allocated.
+ */
+static int sockev_flush(struct sockev_queue *q)
+{
+	struct sk_buff *skb;
+	struct nlmsghdr *nlh;
+	unsigned int i, dropped;
+
+	skb = alloc_skb(SOCKEV_BATCH_SIZE, GFP_KERNEL);
+	if (skb == NULL)
+		return -ENOMEM;
+
+	spin_lock(&q->lock);
+	for (i = 0; i < q->count; i++) {
+		nlh = nlmsg_put(skb, 0, 0, q->events[i],
+				sizeof(struct sknlsockevmsg), 0);
+		memcpy(nlmsg_data(nlh), &q->msgs[i],
+		       sizeof(struct sknlsockevmsg));
+	}
+	q->count = 0;
+	dropped = q->dropped;
+	q->dropped = 0;
+	spin_unlock(&q->lock);
+
+	if (dropped)
+		pr_debug("%s(): %u events dropped on cpu %d\n", __func__,
+			 dropped, q->cpu);
+
+	if (!skb->len) {
+		kfree_skb(skb);
+		return 0;
+	}
+
+	NETLINK_CB(skb).dst_group = SKNLGRP_SOCKEV;
+	nlmsg_notify(socknlmsgsk, skb, 0, SKNLGRP_SOCKEV, 0, GFP_KERNEL);
+	return 0;
+}
+
+static void sockev_flush_work(struct work_struct *work)
+{
+	struct sockev_queue *q = container_of(to_delayed_work(work),
+					      struct sockev_queue, work);
+
+	sockev_flush(q);
+}
+
 static int sockev_client_cb(struct notifier_block *nb,
 			    unsigned long event, void *data)
 {
 
-	struct sk_buff *skb;
-	struct nlmsghdr *nlh;
+	struct sockev_queue *q;
 	struct sknlsockevmsg *smsg;
 	struct socket *sock;
 
-	sock = (struct socket *)data;
-	if (socknlmsgsk == 0)
+	/* filter before touching anything */
+	if (event >= BITS_PER_BYTE * sizeof(event_mask) ||
+	    !(ACCESS_ONCE(event_mask) & BIT(event)))
 		goto done;
+
+	sock = (struct socket *)data;
 	if ((socknlmsgsk == NULL) || (sock == NULL) || (sock->sk == NULL))
 		goto done;
 
 	if (sock->sk->sk_family != AF_INET && sock->sk->sk_family != AF_INET6)
 		goto done;
 
-	if (event != SOCKEV_BIND && event != SOCKEV_LISTEN)
-		goto done;
-
-	skb = nlmsg_new(sizeof(struct sknlsockevmsg), GFP_KERNEL);
-	if (skb == NULL)
-		goto done;
-
-	nlh = nlmsg_put(skb, 0, 0, event, sizeof(struct sknlsockevmsg), 0);
-	if (nlh == NULL) {
-		kfree_skb(skb);
-		goto done;
+	/* Any queue will do, being preempted only costs locality */
+	q = __this_cpu_ptr(&sockev_queues);
+	spin_lock(&q->lock);
+	if (q->count == SOCKEV_BATCH) {
+		/* the work has not kept up, send from here */
+		spin_unlock(&q->lock);
+		sockev_flush(q);
+		spin_lock(&q->lock);
+		if (q->count == SOCKEV_BATCH) {
+			q->dropped++;
+			spin_unlock(&q->lock);
+			goto done;
+		}
 	}
 
-	NETLINK_CB(skb).dst_group = SKNLGRP_SOCKEV;
-
-	smsg = nlmsg_data(nlh);
+	q->events[q->count] = event;
+	smsg = &q->msgs[q->count++];
+	memset(smsg, 0, sizeof(*smsg));
 	smsg->pid = current->pid;
 	_sockev_event(event, smsg->event, sizeof(smsg->event));
 	smsg->skfamily = sock->sk->sk_family;
@@ -102,7 +190,12 @@ static int sockev_client_cb(struct notifier_block *nb,
 	smsg->sktype = sock->sk->sk_type;
 	smsg->skflags = sock->sk->sk_flags;
 
-	nlmsg_notify(socknlmsgsk, skb, 0, SKNLGRP_SOCKEV, 0, GFP_KERNEL);
+	if (q->count == 1)
+		schedule_delayed_work_on(q->cpu, &q->work,
+					 msecs_to_jiffies(flush_ms));
+	else if (q->count == SOCKEV_BATCH / 2)
+		mod_delayed_work_on(q->cpu, system_wq, &q->work, 0);
+	spin_unlock(&q->lock);
 done:
 	return 0;
 }
@@ -117,7 +210,16 @@ static struct notifier_block sockev_notifier_client = {
 
 static int __init sockev_client_init(void)
 {
-	int rc;
+	struct sockev_queue *q;
+	int rc, cpu;
+
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(sockev_queues, cpu);
+		spin_lock_init(&q->lock);
+		q->cpu = cpu;
+		INIT_DELAYED_WORK(&q->work, sockev_flush_work);
+	}
+
 	registration_status = 1;
 	rc = sockev_register_notify(&sockev_notifier_client);
 	if (rc != 0) {
@@ -136,8 +238,12 @@ static int __init sockev_client_init(void)
 }
 static void __exit sockev_client_exit(void)
 {
+	int cpu;
+
 	if (registration_status)
 		sockev_unregister_notify(&sockev_notifier_client);
+	for_each_possible_cpu(cpu)
+		cancel_delayed_work_sync(&per_cpu(sockev_queues, cpu).work);
 }
 module_init(sockev_client_init)
 module_exit(sockev_client_exit)
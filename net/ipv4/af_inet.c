@@ -1307,7 +1307,7 @@ static struct sk_buff *inet_gso_segment(struct sk_buff *skb,
 	int ihl;
 	int id;
 	unsigned int offset = 0;
-	bool tunnel;
+	bool tunnel, udpfrag;
 
 	if (unlikely(skb_shinfo(skb)->gso_type &
 		     ~(SKB_GSO_TCPV4 |
@@ -1317,6 +1317,7 @@ static struct sk_buff *inet_gso_segment(struct sk_buff *skb,
 		       SKB_GSO_GRE |
 		       SKB_GSO_TCPV6 |
 		       SKB_GSO_UDP_TUNNEL |
+		       SKB_GSO_UDP_L4 |
 		       0)))
 		goto out;
 
@@ -1340,6 +1341,10 @@ static struct sk_buff *inet_gso_segment(struct sk_buff *skb,
 	proto = iph->protocol;
 	segs = ERR_PTR(-EPROTONOSUPPORT);
 
+	/* UFO sends IP fragments, UDP_SEGMENT whole datagrams */
+	udpfrag = !tunnel && proto == IPPROTO_UDP &&
+		  !(skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4);
+
 	rcu_read_lock();
 	ops = rcu_dereference(inet_offloads[proto]);
 	if (likely(ops && ops->callbacks.gso_segment))
@@ -1352,7 +1357,7 @@ static struct sk_buff *inet_gso_segment(struct sk_buff *skb,
 	skb = segs;
 	do {
 		iph = ip_hdr(skb);
-		if (!tunnel && proto == IPPROTO_UDP) {
+		if (udpfrag) {
 			iph->id = htons(id);
 			iph->frag_off = htons(offset >> 3);
 			if (skb->next != NULL)
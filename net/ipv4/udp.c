@@ -421,6 +421,7 @@ static struct sock *udp4_lib_lookup2(struct net *net,
 	struct sock *sk, *result;
 	struct hlist_nulls_node *node;
 	int score, badness, matches = 0, reuseport = 0;
+	bool cpu_match = false;
 	u32 hash = 0;
 
 begin:
@@ -437,10 +438,12 @@ begin:
 				hash = inet_ehashfn(net, daddr, hnum,
 						    saddr, htons(sport));
 				matches = 1;
+				cpu_match = sk_reuseport_cpu_match(sk);
 			}
-		} else if (score == badness && reuseport) {
+		} else if (score == badness && reuseport && !cpu_match) {
+			cpu_match = sk_reuseport_cpu_match(sk);
 			matches++;
-			if (((u64)hash * matches) >> 32 == 0)
+			if (cpu_match || ((u64)hash * matches) >> 32 == 0)
 				result = sk;
 			hash = next_pseudo_random32(hash);
 		}
@@ -477,6 +480,7 @@ struct sock *__udp4_lib_lookup(struct net *net, __be32 saddr,
 	unsigned int hash2, slot2, slot = udp_hashfn(net, hnum, udptable->mask);
 	struct udp_hslot *hslot2, *hslot = &udptable->hash[slot];
 	int score, badness, matches = 0, reuseport = 0;
+	bool cpu_match = false;
 	u32 hash = 0;
 
 	rcu_read_lock();
@@ -518,10 +522,12 @@ begin:
 				hash = inet_ehashfn(net, daddr, hnum,
 						    saddr, htons(sport));
 				matches = 1;
+				cpu_match = sk_reuseport_cpu_match(sk);
 			}
-		} else if (score == badness && reuseport) {
+		} else if (score == badness && reuseport && !cpu_match) {
+			cpu_match = sk_reuseport_cpu_match(sk);
 			matches++;
-			if (((u64)hash * matches) >> 32 == 0)
+			if (cpu_match || ((u64)hash * matches) >> 32 == 0)
 				result = sk;
 			hash = next_pseudo_random32(hash);
 		}
@@ -746,7 +752,7 @@ static void udp4_hwcsum(struct sk_buff *skb, __be32 src, __be32 dst)
 	}
 }
 
-static int udp_send_skb(struct sk_buff *skb, struct flowi4 *fl4)
+static int udp_send_skb(struct sk_buff *skb, struct flowi4 *fl4, u16 gso_size)
 {
 	struct sock *sk = skb->sk;
 	struct inet_sock *inet = inet_sk(sk);
@@ -755,6 +761,7 @@ static int udp_send_skb(struct sk_buff *skb, struct flowi4 *fl4)
 	int is_udplite = IS_UDPLITE(sk);
 	int offset = skb_transport_offset(skb);
 	int len = skb->len - offset;
+	int datalen = len - sizeof(*uh);
 	__wsum csum = 0;
 
 	/*
@@ -766,6 +773,30 @@ static int udp_send_skb(struct sk_buff *skb, struct flowi4 *fl4)
 	uh->len = htons(len);
 	uh->check = 0;
 
+	if (gso_size && datalen > gso_size) {
+		const int hlen = skb_network_header_len(skb) + sizeof(*uh);
+
+		/* The datagrams are cut out and checksummed in
+		 * __udp4_gso_segment(), see UDP_SEGMENT.
+		 */
+		if (hlen + gso_size > dst_mtu(skb_dst(skb)) ||
+		    datalen > gso_size * UDP_MAX_SEGMENTS) {
+			kfree_skb(skb);
+			return -EINVAL;
+		}
+		if (skb->ip_summed != CHECKSUM_PARTIAL || is_udplite ||
+		    dst_xfrm(skb_dst(skb))) {
+			kfree_skb(skb);
+			return -EIO;
+		}
+
+		skb_shinfo(skb)->gso_size = gso_size;
+		skb_shinfo(skb)->gso_type = SKB_GSO_UDP_L4;
+		skb_shinfo(skb)->gso_segs = DIV_ROUND_UP(datalen, gso_size);
+		udp4_hwcsum(skb, fl4->saddr, fl4->daddr);
+		goto send;
+	}
+
 	if (is_udplite)  				 /*     UDP-Lite      */
 		csum = udplite_csum(skb);
 
@@ -817,7 +848,7 @@ int udp_push_pending_frames(struct sock *sk)
 	if (!skb)
 		goto out;
 
-	err = udp_send_skb(skb, fl4);
+	err = udp_send_skb(skb, fl4, 0);
 
 out:
 	up->len = 0;
@@ -826,6 +857,28 @@ out:
 }
 EXPORT_SYMBOL(udp_push_pending_frames);
 
+static int udp_cmsg_send(struct msghdr *msg, u16 *gso_size)
+{
+	struct cmsghdr *cmsg;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (!CMSG_OK(msg, cmsg))
+			return -EINVAL;
+		if (cmsg->cmsg_level != SOL_UDP)
+			continue;
+		switch (cmsg->cmsg_type) {
+		case UDP_SEGMENT:
+			if (cmsg->cmsg_len != CMSG_LEN(sizeof(__u16)))
+				return -EINVAL;
+			*gso_size = *(__u16 *)CMSG_DATA(cmsg);
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
 int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 		size_t len)
 {
@@ -859,6 +912,7 @@ int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 
 	ipc.opt = NULL;
 	ipc.tx_flags = 0;
+	ipc.gso_size = up->gso_size;
 
 	getfrag = is_udplite ? udplite_getfrag : ip_generic_getfrag;
 
@@ -913,6 +967,9 @@ int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 	sock_tx_timestamp(sk, &ipc.tx_flags);
 
 	if (msg->msg_controllen) {
+		err = udp_cmsg_send(msg, &ipc.gso_size);
+		if (err)
+			return err;
 		err = ip_cmsg_send(sock_net(sk), msg, &ipc);
 		if (err)
 			return err;
@@ -920,6 +977,11 @@ int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 			free = 1;
 		connected = 0;
 	}
+	/* segmentation offload needs the whole send in one skb */
+	if (ipc.gso_size && corkreq) {
+		err = -EINVAL;
+		goto out;
+	}
 	if (!ipc.opt) {
 		struct ip_options_rcu *inet_opt;
 
@@ -1004,7 +1066,7 @@ back_from_confirm:
 				  msg->msg_flags);
 		err = PTR_ERR(skb);
 		if (!IS_ERR_OR_NULL(skb))
-			err = udp_send_skb(skb, fl4);
+			err = udp_send_skb(skb, fl4, ipc.gso_size);
 		goto out;
 	}
 
@@ -1220,6 +1282,8 @@ int udp_recvmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 	if (flags & MSG_ERRQUEUE)
 		return ip_recv_error(sk, msg, len, addr_len);
 
+	sk_reuseport_cpu_update(sk);
+
 try_again:
 	skb = __skb_recv_datagram(sk, flags | (noblock ? MSG_DONTWAIT : 0),
 				  &peeked, &off, &err);
@@ -1816,6 +1880,15 @@ int udp_lib_setsockopt(struct sock *sk, int level, int optname,
 		}
 		break;
 
+	case UDP_SEGMENT:
+		/* only the IPv4 UDP send path cuts datagrams out of a send */
+		if (sk->sk_family != AF_INET || is_udplite)
+			return -ENOPROTOOPT;
+		if (val < 0 || val > USHRT_MAX)
+			return -EINVAL;
+		up->gso_size = val;
+		break;
+
 	case UDP_ENCAP:
 		switch (val) {
 		case 0:
@@ -1915,6 +1988,10 @@ int udp_lib_getsockopt(struct sock *sk, int level, int optname,
 		val = up->encap_type;
 		break;
 
+	case UDP_SEGMENT:
+		val = up->gso_size;
+		break;
+
 	/* The following two cannot be changed on UDP sockets, the return is
 	 * always 0 (which corresponds to the full checksum coverage of UDP). */
 	case UDPLITE_SEND_CSCOV:
@@ -2376,11 +2453,70 @@ out:
 	return segs;
 }
 
+static struct sk_buff *__udp4_gso_segment(struct sk_buff *gso_skb,
+		netdev_features_t features)
+{
+	struct sk_buff *segs, *skb;
+	unsigned int mss = skb_shinfo(gso_skb)->gso_size;
+	struct udphdr *uh;
+	struct iphdr *iph;
+	unsigned int len;
+	__wsum csum;
+
+	if (unlikely(!pskb_may_pull(gso_skb, sizeof(*uh))))
+		return ERR_PTR(-EINVAL);
+
+	if (skb_gso_ok(gso_skb, features | NETIF_F_GSO_ROBUST)) {
+		/* Packet is from an untrusted source, reset gso_segs. */
+		skb_shinfo(gso_skb)->gso_segs = DIV_ROUND_UP(gso_skb->len -
+							     sizeof(*uh), mss);
+		return NULL;
+	}
+
+	__skb_pull(gso_skb, sizeof(*uh));
+	segs = skb_segment(gso_skb, features);
+	if (IS_ERR_OR_NULL(segs))
+		return segs;
+
+	/* Every segment is a complete datagram with its own checksum.
+	 * Nothing checksums the segments after this, so do it here when
+	 * the device cannot.
+	 */
+	for (skb = segs; skb; skb = skb->next) {
+		uh = udp_hdr(skb);
+		iph = ip_hdr(skb);
+		len = skb->len - skb_transport_offset(skb);
+		uh->len = htons(len);
+		uh->check = 0;
+
+		if (features & NETIF_F_V4_CSUM) {
+			uh->check = ~csum_tcpudp_magic(iph->saddr, iph->daddr,
+						       len, IPPROTO_UDP, 0);
+			skb->csum_start = skb_transport_header(skb) - skb->head;
+			skb->csum_offset = offsetof(struct udphdr, check);
+			skb->ip_summed = CHECKSUM_PARTIAL;
+		} else {
+			csum = skb_checksum(skb, skb_transport_offset(skb),
+					    len, 0);
+			uh->check = csum_tcpudp_magic(iph->saddr, iph->daddr,
+						      len, IPPROTO_UDP, csum);
+			if (uh->check == 0)
+				uh->check = CSUM_MANGLED_0;
+			skb->ip_summed = CHECKSUM_NONE;
+		}
+	}
+	return segs;
+}
+
 struct sk_buff *udp4_ufo_fragment(struct sk_buff *skb,
 	netdev_features_t features)
 {
 	struct sk_buff *segs = ERR_PTR(-EINVAL);
 	unsigned int mss;
+
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4)
+		return __udp4_gso_segment(skb, features);
+
 	mss = skb_shinfo(skb)->gso_size;
 	if (unlikely(skb->len <= mss))
 		goto out;
@@ -205,6 +205,7 @@ static struct sock *udp6_lib_lookup2(struct net *net,
 	struct sock *sk, *result;
 	struct hlist_nulls_node *node;
 	int score, badness, matches = 0, reuseport = 0;
+	bool cpu_match = false;
 	u32 hash = 0;
 
 begin:
@@ -221,11 +222,13 @@ begin:
 				hash = inet6_ehashfn(net, daddr, hnum,
 						     saddr, sport);
 				matches = 1;
+				cpu_match = sk_reuseport_cpu_match(sk);
 			} else if (score == SCORE2_MAX)
 				goto exact_match;
-		} else if (score == badness && reuseport) {
+		} else if (score == badness && reuseport && !cpu_match) {
+			cpu_match = sk_reuseport_cpu_match(sk);
 			matches++;
-			if (((u64)hash * matches) >> 32 == 0)
+			if (cpu_match || ((u64)hash * matches) >> 32 == 0)
 				result = sk;
 			hash = next_pseudo_random32(hash);
 		}
@@ -262,6 +265,7 @@ struct sock *__udp6_lib_lookup(struct net *net,
 	unsigned int hash2, slot2, slot = udp_hashfn(net, hnum, udptable->mask);
 	struct udp_hslot *hslot2, *hslot = &udptable->hash[slot];
 	int score, badness, matches = 0, reuseport = 0;
+	bool cpu_match = false;
 	u32 hash = 0;
 
 	rcu_read_lock();
@@ -302,10 +306,12 @@ begin:
 				hash = inet6_ehashfn(net, daddr, hnum,
 						     saddr, sport);
 				matches = 1;
+				cpu_match = sk_reuseport_cpu_match(sk);
 			}
-		} else if (score == badness && reuseport) {
+		} else if (score == badness && reuseport && !cpu_match) {
+			cpu_match = sk_reuseport_cpu_match(sk);
 			matches++;
-			if (((u64)hash * matches) >> 32 == 0)
+			if (cpu_match || ((u64)hash * matches) >> 32 == 0)
 				result = sk;
 			hash = next_pseudo_random32(hash);
 		}
@@ -380,6 +386,8 @@ int udpv6_recvmsg(struct kiocb *iocb, struct sock *sk,
 	if (np->rxpmtu && np->rxopt.bits.rxpmtu)
 		return ipv6_recv_rxpmtu(sk, msg, len, addr_len);
 
+	sk_reuseport_cpu_update(sk);
+
 try_again:
 	skb = __skb_recv_datagram(sk, flags | (noblock ? MSG_DONTWAIT : 0),
 				  &peeked, &off, &err);
@@ -22,6 +22,7 @@
 #include <linux/ratelimit.h>
 #include <linux/seq_file.h>
 #include <linux/skbuff.h>
+#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 #include <net/addrconf.h>
 #include <net/sock.h>
@@ -55,6 +56,18 @@ static struct proc_dir_entry *xt_qtaguid_stats_file;
 static unsigned int proc_stats_perms = S_IRUGO;
 module_param_named(stats_perms, proc_stats_perms, uint, S_IRUGO | S_IWUSR);
 
+static struct proc_dir_entry *xt_qtaguid_stats_delta_file;
+/*
+ * Advanced by every stats_delta pass. A tag_stat records its value each
+ * time its counters change, under the iface tag_stat_list_lock.
+ */
+static atomic64_t tag_stat_gen = ATOMIC64_INIT(1);
+/*
+ * Bumped after ctrl_delete erases tag_stats, so that every open
+ * stats_delta file makes its next pass a full one.
+ */
+static atomic_t tag_stat_deletes = ATOMIC_INIT(0);
+
 static struct proc_dir_entry *xt_qtaguid_ctrl_file;
 
 /* Everybody can write. But proc_ctrl_write_limited is true by default which
@@ -1250,6 +1263,7 @@ static void tag_stat_update(struct tag_stat *tag_entry,
 			enum ifs_tx_rx direction, int proto, int bytes)
 {
 	int active_set;
+	u64 gen = atomic64_read(&tag_stat_gen);
 	active_set = get_active_counter_set(tag_entry->tn.tag);
 	MT_DEBUG("qtaguid: tag_stat_update(tag=0x%llx (uid=%u) set=%d "
 		 "dir=%d proto=%d bytes=%d)\n",
@@ -1257,9 +1271,14 @@ static void tag_stat_update(struct tag_stat *tag_entry,
 		 active_set, direction, proto, bytes);
 	data_counters_update(&tag_entry->counters, active_set, direction,
 			     proto, bytes);
-	if (tag_entry->parent_counters)
+	tag_entry->gen = gen;
+	if (tag_entry->parent_counters) {
 		data_counters_update(tag_entry->parent_counters, active_set,
 				     direction, proto, bytes);
+		/* The parent is the {0, uid_tag} tag_stat on the same iface */
+		container_of(tag_entry->parent_counters, struct tag_stat,
+			     counters)->gen = gen;
+	}
 }
 
 /*
@@ -1984,6 +2003,7 @@ static int ctrl_cmd_delete(const char *input)
 	struct sock_tag *st_entry;
 	struct rb_root st_to_free_tree = RB_ROOT;
 	struct tag_stat *ts_entry;
+	bool ts_deleted = false;
 	struct tag_counter_set *tcs_entry;
 	struct tag_ref *tr_entry;
 	struct uid_tag_data *utd_entry;
@@ -2097,11 +2117,14 @@ static int ctrl_cmd_delete(const char *input)
 				rb_erase(&ts_entry->tn.node,
 					 &iface_entry->tag_stat_tree);
 				kfree(ts_entry);
+				ts_deleted = true;
 			}
 		}
 		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
 	}
 	spin_unlock_bh(&iface_stat_list_lock);
+	if (ts_deleted)
+		atomic_inc(&tag_stat_deletes);
 
 	/* Cleanup the uid_tag_data */
 	spin_lock_bh(&uid_tag_data_tree_lock);
@@ -2727,6 +2750,171 @@ static int qtaguid_stats_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+/*------------------------------------------*/
+struct proc_stats_delta_info {
+	struct mutex lock;
+	/* tag_stat_gen at the start of the previous pass, 0 before the first */
+	u64 since;
+	/* tag_stat_deletes at the start of the previous pass */
+	int deletes;
+	struct xt_qtaguid_stats_rec *recs;
+	size_t len;
+	size_t size;
+};
+
+static void qtaguid_stats_delta_fill(struct xt_qtaguid_stats_rec *rec,
+				     const char *ifname,
+				     struct tag_stat *ts_entry, int cnt_set)
+{
+	struct byte_packet_counters *bpc;
+	int proto;
+
+	BUILD_BUG_ON(IFS_MAX_PROTOS != XT_QTAGUID_PROTOS);
+
+	memset(rec, 0, sizeof(*rec));
+	strlcpy(rec->iface, ifname, sizeof(rec->iface));
+	rec->acct_tag = get_atag_from_tag(ts_entry->tn.tag);
+	rec->uid = get_uid_from_tag(ts_entry->tn.tag);
+	rec->cnt_set = cnt_set;
+	for (proto = 0; proto < IFS_MAX_PROTOS; proto++) {
+		bpc = &ts_entry->counters.bpc[cnt_set][IFS_RX][proto];
+		rec->rx_bytes[proto] = bpc->bytes;
+		rec->rx_packets[proto] = bpc->packets;
+		bpc = &ts_entry->counters.bpc[cnt_set][IFS_TX][proto];
+		rec->tx_bytes[proto] = bpc->bytes;
+		rec->tx_packets[proto] = bpc->packets;
+	}
+}
+
+/*
+ * Copy the entries changed since info->since into info->recs, or all of
+ * them after a reset record when @full.
+ * Returns the number of records needed, which is more than fit when the
+ * buffer is too small.
+ */
+static size_t qtaguid_stats_delta_collect(struct proc_stats_delta_info *info,
+					  bool full)
+{
+	size_t max = info->size / sizeof(*info->recs);
+	struct iface_stat *iface_entry;
+	struct tag_stat *ts_entry;
+	struct rb_node *node;
+	size_t n = 0;
+	int cnt_set;
+
+	if (full) {
+		if (n < max) {
+			memset(&info->recs[n], 0, sizeof(info->recs[n]));
+			info->recs[n].flags = XT_QTAGUID_REC_RESET;
+		}
+		n++;
+	}
+
+	spin_lock_bh(&iface_stat_list_lock);
+	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+		spin_lock_bh(&iface_entry->tag_stat_list_lock);
+		for (node = rb_first(&iface_entry->tag_stat_tree); node;
+		     node = rb_next(node)) {
+			ts_entry = rb_entry(node, struct tag_stat, tn.node);
+			if ((!full && ts_entry->gen < info->since) ||
+			    !can_read_other_uid_stats(
+					get_uid_from_tag(ts_entry->tn.tag)))
+				continue;
+			for (cnt_set = 0; cnt_set < IFS_MAX_COUNTER_SETS;
+			     cnt_set++, n++) {
+				if (n < max)
+					qtaguid_stats_delta_fill(&info->recs[n],
+							iface_entry->ifname,
+							ts_entry, cnt_set);
+			}
+		}
+		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
+	}
+	spin_unlock_bh(&iface_stat_list_lock);
+	return n;
+}
+
+static int qtaguid_stats_delta_pass(struct proc_stats_delta_info *info)
+{
+	bool full;
+	int deletes;
+	size_t n;
+	u64 gen;
+
+	/*
+	 * A delete that is not done by now bumps tag_stat_deletes after
+	 * this, which makes the next pass a full one.
+	 */
+	deletes = atomic_read(&tag_stat_deletes);
+	full = !info->since || deletes != info->deletes;
+
+	/*
+	 * Anything that changes after this is stamped with gen or later,
+	 * and reported again by the next pass even if this one sees it.
+	 */
+	gen = atomic64_inc_return(&tag_stat_gen);
+
+	while ((n = qtaguid_stats_delta_collect(info, full)) *
+	       sizeof(*info->recs) > info->size) {
+		vfree(info->recs);
+		/* leave room for entries changing while we allocate */
+		info->size = (n + 16) * sizeof(*info->recs);
+		info->recs = vmalloc(info->size);
+		if (!info->recs) {
+			info->size = 0;
+			info->len = 0;
+			return -ENOMEM;
+		}
+	}
+
+	info->len = n * sizeof(*info->recs);
+	info->since = gen;
+	info->deletes = deletes;
+	return 0;
+}
+
+static ssize_t qtaguid_stats_delta_read(struct file *file, char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	struct proc_stats_delta_info *info = file->private_data;
+	ssize_t ret;
+
+	if (unlikely(module_passive))
+		return 0;
+
+	mutex_lock(&info->lock);
+	if (*ppos == 0) {
+		ret = qtaguid_stats_delta_pass(info);
+		if (ret)
+			goto out;
+	}
+	ret = simple_read_from_buffer(buf, count, ppos, info->recs, info->len);
+out:
+	mutex_unlock(&info->lock);
+	return ret;
+}
+
+static int qtaguid_stats_delta_open(struct inode *inode, struct file *file)
+{
+	struct proc_stats_delta_info *info;
+
+	info = kzalloc(sizeof(*info), GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+	mutex_init(&info->lock);
+	file->private_data = info;
+	return 0;
+}
+
+static int qtaguid_stats_delta_release(struct inode *inode, struct file *file)
+{
+	struct proc_stats_delta_info *info = file->private_data;
+
+	vfree(info->recs);
+	kfree(info);
+	return 0;
+}
+
 /*------------------------------------------*/
 static int qtudev_open(struct inode *inode, struct file *file)
 {
@@ -2930,6 +3118,13 @@ static const struct file_operations proc_qtaguid_stats_fops = {
 	.release	= seq_release_private,
 };
 
+static const struct file_operations proc_qtaguid_stats_delta_fops = {
+	.open		= qtaguid_stats_delta_open,
+	.read		= qtaguid_stats_delta_read,
+	.llseek		= default_llseek,
+	.release	= qtaguid_stats_delta_release,
+};
+
 /*------------------------------------------*/
 static int __init qtaguid_proc_register(struct proc_dir_entry **res_procdir)
 {
@@ -2962,12 +3157,26 @@ static int __init qtaguid_proc_register(struct proc_dir_entry **res_procdir)
 		ret = -ENOMEM;
 		goto no_stats_entry;
 	}
+
+	xt_qtaguid_stats_delta_file = proc_create_data("stats_delta",
+						       proc_stats_perms,
+						       *res_procdir,
+						       &proc_qtaguid_stats_delta_fops,
+						       NULL);
+	if (!xt_qtaguid_stats_delta_file) {
+		pr_err("qtaguid: failed to create xt_qtaguid/stats_delta "
+			"file\n");
+		ret = -ENOMEM;
+		goto no_stats_delta_entry;
+	}
 	/*
 	 * TODO: add support counter hacking
 	 * xt_qtaguid_stats_file->write_proc = qtaguid_stats_proc_write;
 	 */
 	return 0;
 
+no_stats_delta_entry:
+	remove_proc_entry("stats", *res_procdir);
 no_stats_entry:
 	remove_proc_entry("ctrl", *res_procdir);
 no_ctrl_entry:
@@ -212,6 +212,8 @@ struct tag_stat {
 	 * matching parent uid_tag.
 	 */
 	struct data_counters *parent_counters;
+	/* tag_stat_gen when the counters last changed, see stats_delta */
+	u64 gen;
 };
 
 struct iface_stat {
@@ -24,6 +24,7 @@
 #include "rmnet_data_config.h"
 #include "rmnet_data_handlers.h"
 #include "rmnet_data_vnd.h"
+#include "rmnet_map.h"
 #include "rmnet_data_private.h"
 #include "rmnet_data_trace.h"
 
@@ -710,6 +711,7 @@ int rmnet_unassociate_network_device(struct net_device *dev)
 	if (!config)
 		return RMNET_CONFIG_UNKNOWN_ERROR;
 
+	rmnet_map_agg_exit(config);
 	kfree(config);
 
 	netdev_rx_handler_unregister(dev);
@@ -837,7 +839,7 @@ int rmnet_associate_network_device(struct net_device *dev)
 
 	memset(config, 0, sizeof(struct rmnet_phys_ep_conf_s));
 	config->dev = dev;
-	spin_lock_init(&config->agg_lock);
+	rmnet_map_agg_init(config);
 
 	rc = netdev_rx_handler_register(dev, rmnet_rx_handler, config);
 
@@ -16,6 +16,8 @@
 
 #include <linux/types.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
+#include <linux/interrupt.h>
 #include <linux/spinlock.h>
 
 #ifndef _RMNET_DATA_CONFIG_H_
@@ -58,8 +60,10 @@ struct rmnet_logical_ep_conf_s {
  *                  Smaller of the two parameters above are chosen for
  *                  aggregation
  * @tail_spacing: Guaranteed padding (bytes) when de-aggregating ingress frames
- * @agg_time: Wall clock time when aggregated frame was created
+ * @agg_timer: Flushes the aggregation buffer once its hold time expired
+ * @agg_time: Monotonic time when aggregated frame was created
  * @agg_last: Last time the aggregation routing was invoked
+ * @agg_gap: Moving average of the time between packets (ns)
  */
 struct rmnet_phys_ep_conf_s {
 	struct net_device *dev;
@@ -80,8 +84,10 @@ struct rmnet_phys_ep_conf_s {
 	struct sk_buff *agg_skb;
 	uint8_t agg_state;
 	uint8_t agg_count;
-	struct timespec agg_time;
-	struct timespec agg_last;
+	struct tasklet_hrtimer agg_timer;
+	ktime_t agg_time;
+	ktime_t agg_last;
+	uint32_t agg_gap;
 };
 
 int rmnet_config_init(void);
@@ -194,7 +194,7 @@ static rx_handler_result_t __rmnet_deliver_skb(struct sk_buff *skb,
 
 		case RX_HANDLER_PASS:
 			skb->pkt_type = PACKET_HOST;
-			netif_receive_skb(skb);
+			rmnet_vnd_rx_deliver(skb, skb->dev);
 			return RX_HANDLER_CONSUMED;
 		}
 		return RX_HANDLER_PASS;
@@ -304,7 +304,7 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 
 	/* Subtract MAP header */
 	skb_pull(skb, sizeof(struct rmnet_map_header_s));
-	skb_trim(skb, len);
+	pskb_trim(skb, len);
 	__rmnet_data_set_skb_proto(skb);
 
 	return __rmnet_deliver_skb(skb, ep);
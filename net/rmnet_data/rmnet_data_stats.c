@@ -47,11 +47,32 @@ unsigned long int deagg_count[RMNET_STATS_AGG_MAX];
 module_param_array(deagg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(deagg_count, "SKBs De-aggregated");
 
+static DEFINE_SPINLOCK(rmnet_deagg_share_count);
+unsigned long int deagg_share[RMNET_STATS_DEAGG_SHARE_MAX];
+module_param_array(deagg_share, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(deagg_share, "De-aggregated SKBs copied and zero copy");
+
 static DEFINE_SPINLOCK(rmnet_agg_count);
 unsigned long int agg_count[RMNET_STATS_AGG_MAX];
 module_param_array(agg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(agg_count, "SKBs Aggregated");
 
+/* Power of two buckets, the last one takes everything above */
+#define RMNET_STATS_AGG_HIST_MAX 8
+/* The first hold time bucket is below 2^14 ns, about 16 us */
+#define RMNET_STATS_AGG_HOLD_SHIFT 14
+
+static DEFINE_SPINLOCK(rmnet_agg_hist);
+unsigned long int agg_size_hist[RMNET_STATS_AGG_HIST_MAX];
+module_param_array(agg_size_hist, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(agg_size_hist,
+		 "Packets per uplink aggregate: 1, 2-3, 4-7 ... 128+");
+
+unsigned long int agg_hold_hist[RMNET_STATS_AGG_HIST_MAX];
+module_param_array(agg_hold_hist, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(agg_hold_hist,
+		 "Uplink aggregate hold time: <16us, 16-32us ... 1ms+");
+
 static DEFINE_SPINLOCK(rmnet_checksum_dl_stats);
 unsigned long int checksum_dl_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_dl_stats, ulong, 0, S_IRUGO);
@@ -101,6 +122,25 @@ void rmnet_stats_agg_pkts(int aggcount)
 	spin_unlock_irqrestore(&rmnet_agg_count, flags);
 }
 
+void rmnet_stats_agg_flush(unsigned int aggcount, s64 hold_ns)
+{
+	unsigned long flags;
+	unsigned int size, hold;
+
+	size = aggcount ? fls(aggcount) - 1 : 0;
+	if (size >= RMNET_STATS_AGG_HIST_MAX)
+		size = RMNET_STATS_AGG_HIST_MAX - 1;
+
+	hold = hold_ns > 0 ? fls64(hold_ns >> RMNET_STATS_AGG_HOLD_SHIFT) : 0;
+	if (hold >= RMNET_STATS_AGG_HIST_MAX)
+		hold = RMNET_STATS_AGG_HIST_MAX - 1;
+
+	spin_lock_irqsave(&rmnet_agg_hist, flags);
+	agg_size_hist[size]++;
+	agg_hold_hist[hold]++;
+	spin_unlock_irqrestore(&rmnet_agg_hist, flags);
+}
+
 void rmnet_stats_deagg_pkts(int aggcount)
 {
 	unsigned long flags;
@@ -111,6 +151,18 @@ void rmnet_stats_deagg_pkts(int aggcount)
 	spin_unlock_irqrestore(&rmnet_deagg_count, flags);
 }
 
+void rmnet_stats_deagg_share(unsigned int mode)
+{
+	unsigned long flags;
+
+	if (mode >= RMNET_STATS_DEAGG_SHARE_MAX)
+		return;
+
+	spin_lock_irqsave(&rmnet_deagg_share_count, flags);
+	deagg_share[mode]++;
+	spin_unlock_irqrestore(&rmnet_deagg_share_count, flags);
+}
+
 void rmnet_stats_dl_checksum(unsigned int rc)
 {
 	unsigned long flags;
@@ -39,6 +39,8 @@ enum rmnet_skb_free_e {
 	RMNET_STATS_SKBFREE_DEAGG_UNKOWN_IP_TYP,
 	RMNET_STATS_SKBFREE_DEAGG_DATA_LEN_0,
 	RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM,
+	RMNET_STATS_SKBFREE_VND_GRO_BACKLOG,
+	RMNET_STATS_SKBFREE_AGG_EXIT,
 	RMNET_STATS_SKBFREE_MAX
 };
 
@@ -52,10 +54,18 @@ enum rmnet_queue_xmit_e {
 	RMNET_STATS_QUEUE_XMIT_MAX
 };
 
+enum rmnet_deagg_share_e {
+	RMNET_STATS_DEAGG_COPIED,
+	RMNET_STATS_DEAGG_SHARED,
+	RMNET_STATS_DEAGG_SHARE_MAX
+};
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason);
 void rmnet_stats_queue_xmit(int rc, unsigned int reason);
 void rmnet_stats_deagg_pkts(int aggcount);
+void rmnet_stats_deagg_share(unsigned int mode);
 void rmnet_stats_agg_pkts(int aggcount);
+void rmnet_stats_agg_flush(unsigned int aggcount, s64 hold_ns);
 void rmnet_stats_dl_checksum(unsigned int rc);
 void rmnet_stats_ul_checksum(unsigned int rc);
 #endif /* _RMNET_DATA_STATS_H_ */
@@ -21,6 +21,7 @@
 #include <linux/etherdevice.h>
 #include <linux/if_arp.h>
 #include <linux/spinlock.h>
+#include <linux/ethtool.h>
 #include <net/pkt_sched.h>
 #include <linux/atomic.h>
 #include <linux/net_map.h>
@@ -55,6 +56,33 @@ struct rmnet_map_flow_mapping_s {
 	atomic_t v6_seq;
 };
 
+#define RMNET_VND_NAPI_WEIGHT 64
+
+/* Counters of the GRO receive context, exported through ethtool -S */
+struct rmnet_vnd_gro_stats_s {
+	uint64_t rx_queued;
+	uint64_t rx_backlog_drop;
+	uint64_t rx_unshared;
+	uint64_t polls;
+	uint64_t gro_normal;
+	uint64_t gro_held;
+	uint64_t gro_merged;
+	uint64_t gro_drop;
+};
+
+static const char rmnet_vnd_gro_stat_strings[][ETH_GSTRING_LEN] = {
+	"gro_rx_queued",
+	"gro_rx_backlog_drop",
+	"gro_rx_unshared",
+	"gro_polls",
+	"gro_normal",
+	"gro_held",
+	"gro_merged",
+	"gro_drop",
+};
+
+#define RMNET_VND_GRO_STATS_LEN ARRAY_SIZE(rmnet_vnd_gro_stat_strings)
+
 struct rmnet_vnd_private_s {
 	uint32_t qos_version;
 	struct rmnet_logical_ep_conf_s local_ep;
@@ -62,8 +90,15 @@ struct rmnet_vnd_private_s {
 	rwlock_t flow_map_lock;
 	struct list_head flow_head;
 	struct rmnet_map_flow_mapping_s root_flow;
+
+	/* GRO receive context, fed by the ingress handler */
+	struct napi_struct napi;
+	struct sk_buff_head rx_queue;
+	struct rmnet_vnd_gro_stats_s gro_stats;
 };
 
+static const struct net_device_ops rmnet_data_vnd_ops;
+
 #define RMNET_VND_FC_QUEUED      0
 #define RMNET_VND_FC_NOT_ENABLED 1
 #define RMNET_VND_FC_KMALLOC_ERR 2
@@ -129,6 +164,160 @@ int rmnet_vnd_rx_fixup(struct sk_buff *skb, struct net_device *dev)
 	return RX_HANDLER_PASS;
 }
 
+/**
+ * rmnet_vnd_rx_unshare() - Copies a cloned ingress packet for GRO
+ * @skb:        Packet sharing its data with the MAP aggregate
+ * @dev:        Virtual network device
+ *
+ * The data is copied into an skb allocated from the per-cpu page fragment
+ * cache with GFP_ATOMIC, and @skb is released. If the allocation fails, @skb
+ * is delivered right away instead.
+ *
+ * Return:
+ *      - Private copy of @skb
+ *      - 0 (null) if @skb was delivered without GRO
+ */
+static struct sk_buff *rmnet_vnd_rx_unshare(struct sk_buff *skb,
+					    struct net_device *dev)
+{
+	struct sk_buff *skbn;
+
+	skbn = netdev_alloc_skb(dev, skb->len);
+	if (!skbn) {
+		netif_receive_skb(skb);
+		return 0;
+	}
+
+	skb_copy_bits(skb, 0, skb_put(skbn, skb->len), skb->len);
+	skb_reset_transport_header(skbn);
+	skb_reset_network_header(skbn);
+	skbn->protocol = skb->protocol;
+	skbn->pkt_type = skb->pkt_type;
+	skbn->ip_summed = skb->ip_summed;
+	skbn->priority = skb->priority;
+	skbn->mark = skb->mark;
+	consume_skb(skb);
+
+	return skbn;
+}
+
+/**
+ * rmnet_vnd_rx_gro() - Whether ingress packets of a device go through GRO
+ * @dev:        Device the packets are demuxed to
+ *
+ * Return:
+ *      - 1 if rmnet_vnd_rx_deliver() queues packets of @dev for GRO
+ *      - 0 otherwise
+ */
+int rmnet_vnd_rx_gro(struct net_device *dev)
+{
+	return dev->netdev_ops == &rmnet_data_vnd_ops &&
+	       (dev->features & NETIF_F_GRO) && netif_running(dev);
+}
+
+/**
+ * rmnet_vnd_rx_deliver() - Hand an ingress packet to the network stack
+ * @skb:        Packet, already fixed up by rmnet_vnd_rx_fixup()
+ * @dev:        Virtual network device
+ *
+ * With GRO enabled on the device, the packet is queued to the device's NAPI
+ * context and goes up through napi_gro_receive() from rmnet_vnd_poll(), so
+ * consecutive segments of a flow coming out of one or more MAP aggregates
+ * are coalesced before the stack sees them. GRO rewrites the headers of the
+ * packets it merges into and can only steal a page fragment head, so
+ * rmnet_map_deaggregate() copies rather than clones frames headed here. A
+ * clone that still shows up, because GRO was turned on in between, is copied
+ * into a private skb by rmnet_vnd_rx_unshare(). Otherwise, or when @dev is
+ * not demuxed to a virtual device, it is delivered right away.
+ */
+void rmnet_vnd_rx_deliver(struct sk_buff *skb, struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+
+	if (!rmnet_vnd_rx_gro(dev)) {
+		netif_receive_skb(skb);
+		return;
+	}
+
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+
+	if (skb_cloned(skb)) {
+		skb = rmnet_vnd_rx_unshare(skb, dev);
+		if (!skb)
+			return;
+		dev_conf->gro_stats.rx_unshared++;
+	}
+
+	/* We run in BH context */
+	spin_lock(&dev_conf->rx_queue.lock);
+	if (skb_queue_len(&dev_conf->rx_queue) > netdev_max_backlog) {
+		dev_conf->gro_stats.rx_backlog_drop++;
+		spin_unlock(&dev_conf->rx_queue.lock);
+		dev->stats.rx_dropped++;
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_VND_GRO_BACKLOG);
+		return;
+	}
+
+	__skb_queue_tail(&dev_conf->rx_queue, skb);
+	dev_conf->gro_stats.rx_queued++;
+	if (skb_queue_len(&dev_conf->rx_queue) == 1)
+		napi_schedule(&dev_conf->napi);
+	spin_unlock(&dev_conf->rx_queue.lock);
+}
+
+/**
+ * rmnet_vnd_poll() - NAPI poll callback of the GRO receive context
+ * @napi:       NAPI context of the virtual network device
+ * @budget:     Maximum number of packets to process
+ *
+ * Return:
+ *      - Number of packets handed to GRO
+ */
+static int rmnet_vnd_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	struct rmnet_vnd_gro_stats_s *stats;
+	struct sk_buff *skb;
+	int work_done = 0;
+
+	dev_conf = container_of(napi, struct rmnet_vnd_private_s, napi);
+	stats = &dev_conf->gro_stats;
+	stats->polls++;
+
+	spin_lock(&dev_conf->rx_queue.lock);
+	while (work_done < budget) {
+		skb = __skb_dequeue(&dev_conf->rx_queue);
+		if (!skb)
+			break;
+		spin_unlock(&dev_conf->rx_queue.lock);
+
+		switch (napi_gro_receive(napi, skb)) {
+		case GRO_NORMAL:
+			stats->gro_normal++;
+			break;
+		case GRO_HELD:
+			stats->gro_held++;
+			break;
+		case GRO_MERGED:
+		case GRO_MERGED_FREE:
+			stats->gro_merged++;
+			break;
+		case GRO_DROP:
+			stats->gro_drop++;
+			break;
+		}
+		work_done++;
+
+		spin_lock(&dev_conf->rx_queue.lock);
+	}
+
+	if (work_done < budget)
+		napi_complete(napi);
+	spin_unlock(&dev_conf->rx_queue.lock);
+
+	return work_done;
+}
+
 /**
  * rmnet_vnd_tx_fixup() - Virtual Network Device transmic fixup hook
  * @skb:      Socket buffer ("packet") to modify
@@ -210,6 +399,96 @@ static int rmnet_vnd_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+/**
+ * rmnet_vnd_open() - Open NDO callback
+ * @dev:         Virtual network device
+ *
+ * Enables the GRO receive context.
+ *
+ * Return:
+ *      - 0 in all cases
+ */
+static int rmnet_vnd_open(struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+
+	napi_enable(&dev_conf->napi);
+	return 0;
+}
+
+/**
+ * rmnet_vnd_stop() - Stop NDO callback
+ * @dev:         Virtual network device
+ *
+ * Disables the GRO receive context and drops whatever it still held.
+ *
+ * Return:
+ *      - 0 in all cases
+ */
+static int rmnet_vnd_stop(struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+
+	napi_disable(&dev_conf->napi);
+	skb_queue_purge(&dev_conf->rx_queue);
+	return 0;
+}
+
+/**
+ * rmnet_vnd_uninit() - Uninit NDO callback
+ * @dev:         Virtual network device
+ *
+ * Packets queued while the device was going down are freed here, the NAPI
+ * context itself goes away with the net_device.
+ */
+static void rmnet_vnd_uninit(struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+
+	skb_queue_purge(&dev_conf->rx_queue);
+}
+
+/* ***************** Ethtool Operations ************************************* */
+
+static int rmnet_vnd_get_sset_count(struct net_device *dev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return RMNET_VND_GRO_STATS_LEN;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void rmnet_vnd_get_strings(struct net_device *dev, uint32_t sset,
+				  uint8_t *data)
+{
+	if (sset == ETH_SS_STATS)
+		memcpy(data, rmnet_vnd_gro_stat_strings,
+		       sizeof(rmnet_vnd_gro_stat_strings));
+}
+
+static void rmnet_vnd_get_ethtool_stats(struct net_device *dev,
+					struct ethtool_stats *stats,
+					uint64_t *data)
+{
+	struct rmnet_vnd_private_s *dev_conf;
+	dev_conf = (struct rmnet_vnd_private_s *) netdev_priv(dev);
+
+	BUILD_BUG_ON(sizeof(struct rmnet_vnd_gro_stats_s) !=
+		     RMNET_VND_GRO_STATS_LEN * sizeof(uint64_t));
+	memcpy(data, &dev_conf->gro_stats, sizeof(dev_conf->gro_stats));
+}
+
+static const struct ethtool_ops rmnet_vnd_ethtool_ops = {
+	.get_sset_count = rmnet_vnd_get_sset_count,
+	.get_strings = rmnet_vnd_get_strings,
+	.get_ethtool_stats = rmnet_vnd_get_ethtool_stats,
+};
+
 #ifdef CONFIG_RMNET_DATA_FC
 static int _rmnet_vnd_do_qos_ioctl(struct net_device *dev,
 				   struct ifreq *ifr,
@@ -464,6 +743,9 @@ static int rmnet_vnd_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 
 static const struct net_device_ops rmnet_data_vnd_ops = {
 	.ndo_init = 0,
+	.ndo_uninit = rmnet_vnd_uninit,
+	.ndo_open = rmnet_vnd_open,
+	.ndo_stop = rmnet_vnd_stop,
 	.ndo_start_xmit = rmnet_vnd_start_xmit,
 	.ndo_do_ioctl = rmnet_vnd_ioctl,
 	.ndo_change_mtu = rmnet_vnd_change_mtu,
@@ -490,6 +772,7 @@ static void rmnet_vnd_setup(struct net_device *dev)
 	memset(dev_conf, 0, sizeof(struct rmnet_vnd_private_s));
 
 	dev->netdev_ops = &rmnet_data_vnd_ops;
+	dev->ethtool_ops = &rmnet_vnd_ethtool_ops;
 	dev->mtu = RMNET_DATA_DFLT_PACKET_SIZE;
 	dev->needed_headroom = RMNET_DATA_NEEDED_HEADROOM;
 	random_ether_addr(dev->dev_addr);
@@ -505,6 +788,11 @@ static void rmnet_vnd_setup(struct net_device *dev)
 	/* Flow control */
 	rwlock_init(&dev_conf->flow_map_lock);
 	INIT_LIST_HEAD(&dev_conf->flow_head);
+
+	/* GRO receive context; GRO itself is on by default */
+	skb_queue_head_init(&dev_conf->rx_queue);
+	netif_napi_add(dev, &dev_conf->napi, rmnet_vnd_poll,
+		       RMNET_VND_NAPI_WEIGHT);
 }
 
 /* ***************** Exposed API ******************************************** */
@@ -145,6 +145,8 @@ rx_handler_result_t rmnet_map_command(struct sk_buff *skb,
 				      struct rmnet_phys_ep_conf_s *config);
 void rmnet_map_aggregate(struct sk_buff *skb,
 			 struct rmnet_phys_ep_conf_s *config);
+void rmnet_map_agg_init(struct rmnet_phys_ep_conf_s *config);
+void rmnet_map_agg_exit(struct rmnet_phys_ep_conf_s *config);
 
 int rmnet_map_checksum_downlink_packet(struct sk_buff *skb);
 int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
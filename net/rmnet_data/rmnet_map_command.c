@@ -128,7 +128,7 @@ static void rmnet_map_send_ack(struct sk_buff *skb,
 	cmd->cmd_type = type & 0x03;
 
 	spin_lock_irqsave(&(skb->dev->tx_global_lock), flags);
-	xmit_status = skb->dev->netdev_ops->ndo_start_xmit(skb, skb->dev);
+	xmit_status = netdev_start_xmit(skb, skb->dev, false);
 	spin_unlock_irqrestore(&(skb->dev->tx_global_lock), flags);
 }
 
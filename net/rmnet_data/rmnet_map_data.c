@@ -20,7 +20,8 @@
 #include <linux/netdevice.h>
 #include <linux/rmnet_data.h>
 #include <linux/spinlock.h>
-#include <linux/workqueue.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 #include <linux/time.h>
 #include <linux/net_map.h>
 #include <linux/ip.h>
@@ -36,6 +37,7 @@
 #include "rmnet_data_private.h"
 #include "rmnet_data_stats.h"
 #include "rmnet_data_trace.h"
+#include "rmnet_data_vnd.h"
 
 RMNET_LOG_MODULE(RMNET_DATA_LOGMASK_MAPD);
 
@@ -49,11 +51,21 @@ long agg_bypass_time __read_mostly = 10000000L;
 module_param(agg_bypass_time, long, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(agg_bypass_time, "Skip agg when apart spaced more than this");
 
+long agg_hold_min __read_mostly = 50000L;
+module_param(agg_hold_min, long, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(agg_hold_min, "Minimum time packets sit in the agg buf");
 
-struct agg_work {
-	struct delayed_work work;
-	struct rmnet_phys_ep_conf_s *config;
-};
+bool deagg_zero_copy __read_mostly = true;
+module_param(deagg_zero_copy, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(deagg_zero_copy, "Deaggregate onto the aggregate's buffers");
+
+/* Bytes copied to the linear part of zero copy packets: MAP, IPv6 and TCP */
+#define RMNET_MAP_DEAGG_HDR_LEN 128
+
+/* The average packet gap moves by 1/8th of each new gap */
+#define RMNET_MAP_AGG_GAP_SHIFT 3
+/* Average packet gaps past the last packet an aggregation buffer waits for */
+#define RMNET_MAP_AGG_HOLD_GAPS 2
 
 /******************************************************************************/
 
@@ -120,15 +132,201 @@ done:
 	return map_header;
 }
 
+/**
+ * rmnet_map_deagg_share() - Builds a MAP frame skb on the aggregate's buffers
+ * @skb:        Source socket buffer, with the MAP frame at the front
+ * @packet_len: Length of the MAP frame, including the MAP header
+ * @in_place:   The frame is parsed in place and has to stay linear
+ * @gro:        The frame goes to a device that hands it to GRO
+ *
+ * A frame of a linear aggregate, such as the kmalloc'd aggregates IPA
+ * delivers, is cloned and the clone trimmed to it, unless it goes to GRO,
+ * which would have to copy the clone anyway. Otherwise the first
+ * RMNET_MAP_DEAGG_HDR_LEN bytes are copied, so that the MAP, IP and
+ * transport headers are linear, and the rest of the frame is attached as page
+ * fragments which take a reference on the pages of the source skb. This needs
+ * the part of the frame past the copied headers to be in page fragments or a
+ * page fragment head. Either way the new skb is charged for the bytes it
+ * references: the buffers stay pinned only until the last packet of the
+ * aggregate has been consumed.
+ *
+ * Return:
+ *     - Pointer to new skb
+ *     - 0 (null) if the frame cannot be shared or allocation failed, in which
+ *       case the caller should copy it
+ */
+static struct sk_buff *rmnet_map_deagg_share(struct sk_buff *skb,
+					     uint32_t packet_len,
+					     bool in_place, bool gro)
+{
+	struct sk_buff *skbn;
+	unsigned int headlen = skb_headlen(skb);
+	unsigned int offset = RMNET_MAP_DEAGG_HDR_LEN;
+	unsigned int len, size;
+	int i;
+
+	if (!skb_is_nonlinear(skb) &&
+	    (in_place || !skb->head_frag ||
+	     packet_len <= RMNET_MAP_DEAGG_HDR_LEN)) {
+		if (gro)
+			return 0;
+
+		skbn = skb_clone(skb, GFP_ATOMIC);
+		if (!skbn)
+			return 0;
+
+		LOGD("Trimming to %d bytes", packet_len);
+		skb_trim(skbn, packet_len);
+		return skbn;
+	}
+
+	if (in_place || packet_len <= RMNET_MAP_DEAGG_HDR_LEN ||
+	    (!skb->head_frag && headlen > RMNET_MAP_DEAGG_HDR_LEN))
+		return 0;
+
+	skbn = netdev_alloc_skb(skb->dev, RMNET_MAP_DEAGG_HDR_LEN);
+	if (!skbn)
+		return 0;
+
+	skb_copy_bits(skb, 0, skb_put(skbn, RMNET_MAP_DEAGG_HDR_LEN),
+		      RMNET_MAP_DEAGG_HDR_LEN);
+	len = packet_len - RMNET_MAP_DEAGG_HDR_LEN;
+
+	/* Only reached with a page fragment head, see above */
+	if (offset < headlen) {
+		unsigned char *data = skb->data + offset;
+		struct page *page = virt_to_head_page(data);
+
+		size = min(len, headlen - offset);
+		get_page(page);
+		skb_add_rx_frag(skbn, 0, page,
+				data - (unsigned char *)page_address(page),
+				size, size);
+		len -= size;
+		offset = headlen;
+	}
+
+	offset -= headlen;
+	for (i = 0; len && i < skb_shinfo(skb)->nr_frags; i++) {
+		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+
+		size = skb_frag_size(frag);
+		if (offset >= size) {
+			offset -= size;
+			continue;
+		}
+		if (skb_shinfo(skbn)->nr_frags == MAX_SKB_FRAGS)
+			break;
+
+		size = min(len, size - offset);
+		skb_frag_ref(skb, i);
+		skb_add_rx_frag(skbn, skb_shinfo(skbn)->nr_frags,
+				skb_frag_page(frag), frag->page_offset + offset,
+				size, size);
+		len -= size;
+		offset = 0;
+	}
+
+	if (len) {
+		kfree_skb(skbn);
+		return 0;
+	}
+
+	skbn->protocol = skb->protocol;
+	return skbn;
+}
+
+/**
+ * rmnet_map_deagg_pull() - Removes a MAP frame from the front of an aggregate
+ * @skb:        Source socket buffer
+ * @len:        Length of the MAP frame
+ *
+ * pskb_pull() would copy the paged part of the frame into the linear area
+ * first. When the aggregate is not shared, the fragments the frame used are
+ * dropped or trimmed in place instead.
+ *
+ * Return:
+ *     - 0 on success
+ *     - -ENOMEM if pskb_pull() failed
+ */
+static int rmnet_map_deagg_pull(struct sk_buff *skb, uint32_t len)
+{
+	struct skb_shared_info *shinfo = skb_shinfo(skb);
+	unsigned int eat;
+	int i, k;
+
+	if (len <= skb_headlen(skb) || skb_cloned(skb) ||
+	    skb_has_frag_list(skb))
+		return pskb_pull(skb, len) ? 0 : -ENOMEM;
+
+	eat = len - skb_headlen(skb);
+	__skb_pull(skb, skb_headlen(skb));
+	skb->data_len -= eat;
+	skb->len -= eat;
+
+	k = 0;
+	for (i = 0; i < shinfo->nr_frags; i++) {
+		unsigned int size = skb_frag_size(&shinfo->frags[i]);
+
+		if (size <= eat) {
+			skb_frag_unref(skb, i);
+			eat -= size;
+		} else {
+			shinfo->frags[k] = shinfo->frags[i];
+			if (eat) {
+				shinfo->frags[k].page_offset += eat;
+				skb_frag_size_sub(&shinfo->frags[k], eat);
+				eat = 0;
+			}
+			k++;
+		}
+	}
+	shinfo->nr_frags = k;
+
+	return 0;
+}
+
+/**
+ * rmnet_map_deagg_gro() - Whether a MAP frame is headed for GRO
+ * @maph:       MAP header of the frame
+ * @config:     Physical endpoint configuration of the ingress device
+ *
+ * Return:
+ *     - true if the frame is demuxed to a virtual device with GRO enabled
+ *     - false otherwise
+ */
+static bool rmnet_map_deagg_gro(struct rmnet_map_header_s *maph,
+				struct rmnet_phys_ep_conf_s *config)
+{
+	struct rmnet_logical_ep_conf_s *ep;
+
+	if (maph->cd_bit || maph->mux_id >= RMNET_DATA_MAX_LOGICAL_EP ||
+	    !(config->ingress_data_format & RMNET_INGRESS_FORMAT_DEMUXING))
+		return false;
+
+	ep = &config->muxed_ep[maph->mux_id];
+	return ep->refcount && ep->rmnet_mode == RMNET_EPMODE_VND &&
+	       ep->egress_dev && rmnet_vnd_rx_gro(ep->egress_dev);
+}
+
 /**
  * rmnet_map_deaggregate() - Deaggregates a single packet
  * @skb:        Source socket buffer containing multiple MAP frames
  * @config:     Physical endpoint configuration of the ingress device
  *
- * Source skb is cloned with skb_clone(). The new skb data and tail pointers are
- * modified to contain a single MAP frame. Clone happens with GFP_ATOMIC flags
- * set. User should keep calling deaggregate() on the source skb until 0 is
- * returned, indicating that there are no more packets to deaggregate.
+ * The MAP frame at the front of the source skb is moved into a new skb of its
+ * own, which shares the aggregate's buffers through rmnet_map_deagg_share():
+ * a clone for a frame of a linear aggregate, page fragment references for a
+ * paged frame. Frames that need to be parsed in place (MAP commands, MAP
+ * checksum trailers) are only shared by a clone. A frame that cannot be
+ * shared, or any frame with deagg_zero_copy off, is copied into an skb
+ * allocated from the per-cpu page fragment cache. So is a frame of a linear
+ * aggregate that goes to a device with GRO enabled: GRO cannot take a clone,
+ * so with GRO on, only paged aggregates are deaggregated without a copy, and
+ * the copy is counted as such. Allocations are made
+ * with GFP_ATOMIC. User should keep calling deaggregate() on the source skb
+ * until 0 is returned, indicating that there are no more packets to
+ * deaggregate.
  *
  * Return:
  *     - Pointer to new skb
@@ -137,15 +335,18 @@ done:
 struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 				      struct rmnet_phys_ep_conf_s *config)
 {
-	struct sk_buff *skbn;
-	struct rmnet_map_header_s *maph;
+	struct sk_buff *skbn = 0;
+	struct rmnet_map_header_s *maph, maph_buf;
 	uint32_t packet_len;
 	uint8_t ip_byte;
 
 	if (skb->len == 0)
 		return 0;
 
-	maph = (struct rmnet_map_header_s *) skb->data;
+	maph = skb_header_pointer(skb, 0, sizeof(maph_buf), &maph_buf);
+	if (!maph)
+		return 0;
+
 	packet_len = ntohs(maph->pkt_len) + sizeof(struct rmnet_map_header_s);
 
 	if ((config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_CKSUMV3) ||
@@ -157,15 +358,33 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 		return 0;
 	}
 
-	skbn = skb_clone(skb, GFP_ATOMIC);
-	if (!skbn)
-		return 0;
+	if (deagg_zero_copy) {
+		LOGD("Sharing %d bytes", packet_len);
+		skbn = rmnet_map_deagg_share(skb, packet_len, maph->cd_bit ||
+			(config->ingress_data_format &
+			 (RMNET_INGRESS_FORMAT_MAP_CKSUMV3 |
+			  RMNET_INGRESS_FORMAT_MAP_CKSUMV4)),
+			rmnet_map_deagg_gro(maph, config));
+		if (skbn)
+			rmnet_stats_deagg_share(RMNET_STATS_DEAGG_SHARED);
+	}
 
-	LOGD("Trimming to %d bytes", packet_len);
-	LOGD("before skbn->len = %d", skbn->len);
-	skb_trim(skbn, packet_len);
-	skb_pull(skb, packet_len);
-	LOGD("after skbn->len = %d", skbn->len);
+	if (!skbn) {
+		skbn = netdev_alloc_skb(skb->dev, packet_len);
+		if (!skbn)
+			return 0;
+
+		LOGD("Copying %d bytes", packet_len);
+		skb_copy_bits(skb, 0, skb_put(skbn, packet_len), packet_len);
+		skbn->protocol = skb->protocol;
+		rmnet_stats_deagg_share(RMNET_STATS_DEAGG_COPIED);
+	}
+
+	maph = (struct rmnet_map_header_s *) skbn->data;
+	if (rmnet_map_deagg_pull(skb, packet_len)) {
+		rmnet_kfree_skb(skbn, RMNET_STATS_SKBFREE_DEAGG_MALFORMED);
+		return 0;
+	}
 
 	/* Some hardware can send us empty frames. Catch them */
 	if (ntohs(maph->pkt_len) == 0) {
@@ -185,39 +404,80 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 	return skbn;
 }
 
+/**
+ * rmnet_map_agg_hold() - Time to keep an aggregation buffer open for
+ * @config:     Physical endpoint configuration of the egress device
+ *
+ * The average gap between packets says how soon the next one is likely. The
+ * buffer is held for RMNET_MAP_AGG_HOLD_GAPS of those gaps past the last
+ * packet, and at least agg_hold_min: a bulk upload keeps filling its buffer up
+ * to agg_time_limit, while a short burst of a sparse flow is sent as soon as it
+ * is over rather than after the full limit. Must be called with agg_lock held.
+ *
+ * Return:
+ *      - Expiry time of the aggregation buffer
+ */
+static ktime_t rmnet_map_agg_hold(struct rmnet_phys_ep_conf_s *config)
+{
+	ktime_t limit, expires;
+	u64 hold;
+
+	limit = ktime_add_ns(config->agg_time, agg_time_limit);
+	hold = (u64)config->agg_gap * RMNET_MAP_AGG_HOLD_GAPS;
+	if (hold < agg_hold_min)
+		hold = agg_hold_min;
+
+	expires = ktime_add_ns(config->agg_last, hold);
+	return ktime_compare(expires, limit) < 0 ? expires : limit;
+}
+
 /**
  * rmnet_map_flush_packet_queue() - Transmits aggregeted frame on timeout
- * @work:        struct agg_work containing delayed work and skb to flush
+ * @t:           hrtimer of the tasklet_hrtimer in the endpoint configuration
  *
- * This function is scheduled to run in a specified number of jiffies after
- * the last frame transmitted by the network stack. When run, the buffer
- * containing aggregated packets is finally transmitted on the underlying link.
+ * This function runs from a tasklet once the hold time of the aggregation
+ * buffer has expired. Packets that arrived meanwhile push the expiry forward,
+ * in which case the timer is restarted rather than reprogrammed on every
+ * packet. When run past the expiry, the buffer containing aggregated packets
+ * is finally transmitted on the underlying link.
  *
+ * Return:
+ *      - HRTIMER_RESTART if the buffer should be held longer
+ *      - HRTIMER_NORESTART otherwise
  */
-static void rmnet_map_flush_packet_queue(struct work_struct *work)
+static enum hrtimer_restart rmnet_map_flush_packet_queue(struct hrtimer *t)
 {
-	struct agg_work *real_work;
 	struct rmnet_phys_ep_conf_s *config;
 	unsigned long flags;
 	struct sk_buff *skb;
+	ktime_t expires, now;
 	int rc, agg_count = 0;
 
 	skb = 0;
-	real_work = (struct agg_work *)work;
-	config = real_work->config;
-	LOGD("%s", "Entering flush thread");
+	config = container_of(t, struct rmnet_phys_ep_conf_s, agg_timer.timer);
+	LOGD("%s", "Entering flush timer");
 	spin_lock_irqsave(&config->agg_lock, flags);
 	if (likely(config->agg_state == RMNET_MAP_TXFER_SCHEDULED)) {
 		/* Buffer may have already been shipped out */
 		if (likely(config->agg_skb)) {
+			now = ktime_get();
+			expires = rmnet_map_agg_hold(config);
+			if (ktime_compare(now, expires) < 0) {
+				hrtimer_set_expires(t, expires);
+				spin_unlock_irqrestore(&config->agg_lock, flags);
+				return HRTIMER_RESTART;
+			}
+
 			rmnet_stats_agg_pkts(config->agg_count);
+			rmnet_stats_agg_flush(config->agg_count,
+				ktime_to_ns(ktime_sub(now, config->agg_time)));
 			if (config->agg_count > 1)
 				LOGL("Agg count: %d", config->agg_count);
 			skb = config->agg_skb;
 			agg_count = config->agg_count;
 			config->agg_skb = 0;
 			config->agg_count = 0;
-			memset(&(config->agg_time), 0, sizeof(struct timespec));
+			config->agg_time = ktime_set(0, 0);
 		}
 		config->agg_state = RMNET_MAP_AGG_IDLE;
 	} else {
@@ -232,7 +492,7 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
 		rc = dev_queue_xmit(skb);
 		rmnet_stats_queue_xmit(rc, RMNET_STATS_QUEUE_XMIT_AGG_TIMEOUT);
 	}
-	kfree(work);
+	return HRTIMER_NORESTART;
 }
 
 /**
@@ -243,14 +503,18 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
  * Aggregates multiple SKBs into a single large SKB for transmission. MAP
  * protocol is used to separate the packets in the buffer. This funcion consumes
  * the argument SKB and should not be further processed by any other function.
+ *
+ * The gap between packets is averaged per device. Packets that arrive after a
+ * gap of more than agg_bypass_time are sent right away, and the open buffer is
+ * held for a time that follows the average gap, see rmnet_map_agg_hold().
  */
 void rmnet_map_aggregate(struct sk_buff *skb,
 			 struct rmnet_phys_ep_conf_s *config) {
 	uint8_t *dest_buff;
-	struct agg_work *work;
 	unsigned long flags;
 	struct sk_buff *agg_skb;
-	struct timespec diff, last;
+	ktime_t last;
+	s64 diff;
 	int size, rc, agg_count = 0;
 
 
@@ -266,20 +530,24 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 new_packet:
 	spin_lock_irqsave(&config->agg_lock, flags);
 
-	memcpy(&last, &(config->agg_last), sizeof(struct timespec));
-	getnstimeofday(&(config->agg_last));
+	last = config->agg_last;
+	config->agg_last = ktime_get();
+	diff = ktime_to_ns(ktime_sub(config->agg_last, last));
+	if (diff > agg_bypass_time)
+		diff = agg_bypass_time;
+	config->agg_gap = config->agg_gap -
+			  (config->agg_gap >> RMNET_MAP_AGG_GAP_SHIFT) +
+			  (diff >> RMNET_MAP_AGG_GAP_SHIFT);
 
 	if (!config->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
-		 * sparse, don't aggregate. We will need to tune this later
+		 * sparse, don't aggregate.
 		 */
-		diff = timespec_sub(config->agg_last, last);
-
-		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time)) {
+		if (diff >= agg_bypass_time) {
 			spin_unlock_irqrestore(&config->agg_lock, flags);
-			LOGL("delta t: %ld.%09lu\tcount: bypass", diff.tv_sec,
-			     diff.tv_nsec);
+			LOGL("delta t: %lld\tcount: bypass", diff);
 			rmnet_stats_agg_pkts(1);
+			rmnet_stats_agg_flush(1, 0);
 			trace_rmnet_map_aggregate(skb, 0);
 			rc = dev_queue_xmit(skb);
 			rmnet_stats_queue_xmit(rc,
@@ -291,9 +559,10 @@ new_packet:
 		if (!config->agg_skb) {
 			config->agg_skb = 0;
 			config->agg_count = 0;
-			memset(&(config->agg_time), 0, sizeof(struct timespec));
+			config->agg_time = ktime_set(0, 0);
 			spin_unlock_irqrestore(&config->agg_lock, flags);
 			rmnet_stats_agg_pkts(1);
+			rmnet_stats_agg_flush(1, 0);
 			trace_rmnet_map_aggregate(skb, 0);
 			rc = dev_queue_xmit(skb);
 			rmnet_stats_queue_xmit(rc,
@@ -301,25 +570,25 @@ new_packet:
 			return;
 		}
 		config->agg_count = 1;
-		getnstimeofday(&(config->agg_time));
+		config->agg_time = config->agg_last;
 		trace_rmnet_start_aggregation(skb);
 		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_AGG_CPY_EXPAND);
 		goto schedule;
 	}
-	diff = timespec_sub(config->agg_last, config->agg_time);
+	diff = ktime_to_ns(ktime_sub(config->agg_last, config->agg_time));
 
 	if (skb->len > (config->egress_agg_size - config->agg_skb->len)
 	    || (config->agg_count >= config->egress_agg_count)
-	    ||  (diff.tv_sec > 0) || (diff.tv_nsec > agg_time_limit)) {
+	    || (diff > agg_time_limit)) {
 		rmnet_stats_agg_pkts(config->agg_count);
+		rmnet_stats_agg_flush(config->agg_count, diff);
 		agg_skb = config->agg_skb;
 		agg_count = config->agg_count;
 		config->agg_skb = 0;
 		config->agg_count = 0;
-		memset(&(config->agg_time), 0, sizeof(struct timespec));
+		config->agg_time = ktime_set(0, 0);
 		spin_unlock_irqrestore(&config->agg_lock, flags);
-		LOGL("delta t: %ld.%09lu\tcount: %d", diff.tv_sec,
-		     diff.tv_nsec, agg_count);
+		LOGL("delta t: %lld\tcount: %d", diff, agg_count);
 		trace_rmnet_map_aggregate(skb, agg_count);
 		rc = dev_queue_xmit(agg_skb);
 		rmnet_stats_queue_xmit(rc,
@@ -333,26 +602,52 @@ new_packet:
 	rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_AGG_INTO_BUFF);
 
 schedule:
+	/* A running timer picks the new expiry up when it fires */
 	if (config->agg_state != RMNET_MAP_TXFER_SCHEDULED) {
-		work = (struct agg_work *)
-			kmalloc(sizeof(struct agg_work), GFP_ATOMIC);
-		if (!work) {
-			LOGE("Failed to allocate work item for packet %s",
-			     "transfer. DATA PATH LIKELY BROKEN!");
-			config->agg_state = RMNET_MAP_AGG_IDLE;
-			spin_unlock_irqrestore(&config->agg_lock, flags);
-			return;
-		}
-		INIT_DELAYED_WORK((struct delayed_work *)work,
-				  rmnet_map_flush_packet_queue);
-		work->config = config;
 		config->agg_state = RMNET_MAP_TXFER_SCHEDULED;
-		schedule_delayed_work((struct delayed_work *)work, 1);
+		tasklet_hrtimer_start(&config->agg_timer,
+				      rmnet_map_agg_hold(config),
+				      HRTIMER_MODE_ABS);
 	}
 	spin_unlock_irqrestore(&config->agg_lock, flags);
 	return;
 }
 
+/**
+ * rmnet_map_agg_init() - Sets up the aggregation state of a device
+ * @config:     Physical endpoint configuration of the device
+ */
+void rmnet_map_agg_init(struct rmnet_phys_ep_conf_s *config)
+{
+	spin_lock_init(&config->agg_lock);
+	tasklet_hrtimer_init(&config->agg_timer, rmnet_map_flush_packet_queue,
+			     CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+}
+
+/**
+ * rmnet_map_agg_exit() - Tears down the aggregation state of a device
+ * @config:     Physical endpoint configuration of the device
+ *
+ * Stops the flush timer and drops the packets still held in the aggregation
+ * buffer. Must be called before the configuration is freed.
+ */
+void rmnet_map_agg_exit(struct rmnet_phys_ep_conf_s *config)
+{
+	unsigned long flags;
+	struct sk_buff *skb;
+
+	tasklet_hrtimer_cancel(&config->agg_timer);
+
+	spin_lock_irqsave(&config->agg_lock, flags);
+	skb = config->agg_skb;
+	config->agg_skb = 0;
+	config->agg_count = 0;
+	config->agg_state = RMNET_MAP_AGG_IDLE;
+	spin_unlock_irqrestore(&config->agg_lock, flags);
+
+	if (skb)
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_AGG_EXIT);
+}
 
 /* ***************** Checksum Offload ************************************** */
 
@@ -40,17 +40,85 @@
  * - updates to tree and tree walking are only done under the rtnl mutex.
  */
 
+/*
+ * A requeued skb may head a chain built by try_bulk_dequeue_skb().  A GSO
+ * skb is only ever the last one of such a chain, since its own ->next
+ * holds the segments dev_hard_start_xmit() has not sent yet.
+ */
+static unsigned int requeued_skb_count(struct sk_buff *skb)
+{
+	unsigned int n = 0;
+
+	for (; skb; skb = skb->next) {
+		n++;
+		if (skb_is_gso(skb))
+			break;
+	}
+	return n;
+}
+
+static void kfree_requeued_skb(struct sk_buff *skb)
+{
+	/* the GSO destructor frees the unsent segments */
+	if (skb && skb_is_gso(skb))
+		kfree_skb(skb);
+	else
+		kfree_skb_list(skb);
+}
+
 static inline int dev_requeue_skb(struct sk_buff *skb, struct Qdisc *q)
 {
-	skb_dst_force(skb);
+	struct sk_buff *p;
+
+	for (p = skb; p; p = p->next) {
+		skb_dst_force(p);
+		if (skb_is_gso(p))
+			break;
+	}
 	q->gso_skb = skb;
 	q->qstats.requeues++;
-	q->q.qlen++;	/* it's still part of the queue */
+	/* it's still part of the queue */
+	q->q.qlen += requeued_skb_count(skb);
 	__netif_schedule(q);
 
 	return 0;
 }
 
+static inline int qdisc_avail_bulklimit(const struct netdev_queue *txq)
+{
+#ifdef CONFIG_BQL
+	/* drivers without BQL never raise the limit above 0 */
+	return dql_avail(&txq->dql);
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Chain up to as many bytes as BQL lets the driver take right now behind
+ * skb, so they all go out under one tx lock and the driver is told by
+ * xmit_more that it can batch the doorbell.
+ */
+static void try_bulk_dequeue_skb(struct Qdisc *q, struct sk_buff *skb,
+				 const struct netdev_queue *txq)
+{
+	int bytelimit = qdisc_avail_bulklimit(txq) - skb->len;
+	struct sk_buff *nskb;
+
+	while (bytelimit > 0) {
+		nskb = q->dequeue(q);
+		if (!nskb)
+			break;
+
+		bytelimit -= nskb->len;
+		skb->next = nskb;
+		skb = nskb;
+		if (skb_is_gso(nskb))
+			break;
+	}
+	skb->next = NULL;
+}
+
 static inline struct sk_buff *dequeue_skb(struct Qdisc *q)
 {
 	struct sk_buff *skb = q->gso_skb;
@@ -61,12 +129,17 @@ static inline struct sk_buff *dequeue_skb(struct Qdisc *q)
 		txq = netdev_get_tx_queue(txq->dev, skb_get_queue_mapping(skb));
 		if (!netif_xmit_frozen_or_stopped(txq)) {
 			q->gso_skb = NULL;
-			q->q.qlen--;
+			q->q.qlen -= requeued_skb_count(skb);
 		} else
 			skb = NULL;
 	} else {
-		if (!(q->flags & TCQ_F_ONETXQUEUE) || !netif_xmit_frozen_or_stopped(txq))
+		if (!(q->flags & TCQ_F_ONETXQUEUE) || !netif_xmit_frozen_or_stopped(txq)) {
 			skb = q->dequeue(q);
+			/* every skb of a chain must map to the same txq */
+			if (skb && (q->flags & TCQ_F_ONETXQUEUE) &&
+			    !skb_is_gso(skb))
+				try_bulk_dequeue_skb(q, skb, txq);
+		}
 	}
 
 	return skb;
@@ -85,7 +158,7 @@ static inline int handle_dev_cpu_collision(struct sk_buff *skb,
 		 * detect it by checking xmit owner and drop the packet when
 		 * deadloop is detected. Return OK to try the next skb.
 		 */
-		kfree_skb(skb);
+		kfree_requeued_skb(skb);
 		net_warn_ratelimited("Dead loop on netdevice %s, fix it urgently!\n",
 				     dev_queue->dev->name);
 		ret = qdisc_qlen(q);
@@ -102,7 +175,45 @@ static inline int handle_dev_cpu_collision(struct sk_buff *skb,
 }
 
 /*
- * Transmit one skb, and handle the return status as required. Holding the
+ * Hand a chain of skbs to the driver one at a time, with xmit_more set on
+ * all but the last.  On return *skbp is what is left unsent, if anything.
+ */
+static int sch_xmit_list(struct sk_buff **skbp, struct net_device *dev,
+			 struct netdev_queue *txq)
+{
+	struct sk_buff *skb = *skbp, *next;
+	int rc = NETDEV_TX_OK;
+
+	while (skb) {
+		/* a GSO skb is last, its ->next belongs to the segments */
+		if (skb_is_gso(skb)) {
+			next = NULL;
+		} else {
+			next = skb->next;
+			skb->next = NULL;
+		}
+
+		rc = dev_hard_start_xmit(skb, dev, txq, next != NULL);
+		if (unlikely(!dev_xmit_complete(rc))) {
+			if (!skb_is_gso(skb))
+				skb->next = next;
+			break;
+		}
+
+		skb = next;
+		if (skb && netif_xmit_frozen_or_stopped(txq)) {
+			rc = NETDEV_TX_BUSY;
+			break;
+		}
+	}
+
+	*skbp = skb;
+	return rc;
+}
+
+/*
+ * Transmit one skb, or a chain of them from try_bulk_dequeue_skb(), and
+ * handle the return status as required. Holding the
  * __QDISC_STATE_RUNNING bit guarantees that only one CPU can execute this
  * function.
  *
@@ -121,7 +232,7 @@ int sch_direct_xmit(struct sk_buff *skb, struct Qdisc *q,
 
 	HARD_TX_LOCK(dev, txq, smp_processor_id());
 	if (!netif_xmit_frozen_or_stopped(txq))
-		ret = dev_hard_start_xmit(skb, dev, txq);
+		ret = sch_xmit_list(&skb, dev, txq);
 
 	HARD_TX_UNLOCK(dev, txq);
 
@@ -599,7 +710,7 @@ void qdisc_reset(struct Qdisc *qdisc)
 		ops->reset(qdisc);
 
 	if (qdisc->gso_skb) {
-		kfree_skb(qdisc->gso_skb);
+		kfree_requeued_skb(qdisc->gso_skb);
 		qdisc->gso_skb = NULL;
 		qdisc->q.qlen = 0;
 	}
@@ -635,7 +746,7 @@ void qdisc_destroy(struct Qdisc *qdisc)
 	module_put(ops->owner);
 	dev_put(qdisc_dev(qdisc));
 
-	kfree_skb(qdisc->gso_skb);
+	kfree_requeued_skb(qdisc->gso_skb);
 	/*
 	 * gen_estimator est_timer() might access qdisc->q.lock,
 	 * wait a RCU grace period before freeing qdisc.
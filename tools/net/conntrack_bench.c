@@ -0,0 +1,391 @@
+/*
+ * conntrack_bench.c - connection tracking setup rate over a veth pair
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * One thread per cpu, each pinned to its cpu, sends single byte UDP
+ * datagrams with a new destination address and port every time out of
+ * one end of a veth pair, so that every datagram creates, confirms and
+ * eventually expires a conntrack entry, and comes back in on the other
+ * end to be looked up again.  Runs go over 1, 2, 4 ... cpus up to all of
+ * them and report the conntrack entries inserted per second, with the
+ * insertions that lost a race, the packets dropped for lack of a free
+ * entry and the CPU time spent per new connection over all cpus.  The
+ * UDP timeout is lowered for the runs so that the table keeps turning
+ * over; it, the table limit and the veth pair are restored on exit.
+ * Needs root, iproute2, CONFIG_VETH and nf_conntrack_ipv4.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define VETH		"ctbench0"
+#define VETH_PEER	"ctbench1"
+#define VETH_ADDR	"198.51.100.1"
+#define GW_ADDR		"198.51.100.2"
+#define GW_LLADDR	"02:00:5e:00:53:02"
+#define DST_NET		0xc6120000	/* 198.18.0.0/15 */
+#define DST_MASK	0x1ffff
+
+#define CT_STAT		"/proc/net/stat/nf_conntrack"
+#define CT_MAX		"/proc/sys/net/netfilter/nf_conntrack_max"
+#define CT_UDP_TIMEOUT	"/proc/sys/net/netfilter/nf_conntrack_udp_timeout"
+#define PEER_FORWARDING	"/proc/sys/net/ipv4/conf/" VETH_PEER "/forwarding"
+
+static int secs = 5;
+static int udp_timeout = 1;
+static long ct_max;
+
+static long saved_max = -1, saved_timeout = -1;
+static int configured;
+
+enum { ST_INSERT, ST_INSERT_FAILED, ST_DROP, ST_EARLY_DROP, ST_MAX };
+static const char * const st_names[ST_MAX] = {
+	"insert", "insert_failed", "drop", "early_drop",
+};
+
+struct result {
+	int cpus;
+	double secs;
+	unsigned long long st[ST_MAX];
+	unsigned long long busy;
+};
+
+struct sender {
+	pthread_t thread;
+	int cpu;
+	int fd;
+	uint32_t seed;
+};
+
+static volatile int running;
+
+/* ***************** Setup and teardown ************************************* */
+
+static long sysctl_get(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	long val;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%ld", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int sysctl_set(const char *path, long val)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%ld\n", val);
+	return fclose(f);
+}
+
+static int ip(const char *cmd)
+{
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "ip %s", cmd);
+	return system(buf);
+}
+
+static void setup(void)
+{
+	configured = 1;
+	if (ip("link add " VETH " type veth peer name " VETH_PEER) ||
+	    ip("link set " VETH_PEER " address " GW_LLADDR) ||
+	    ip("addr add " VETH_ADDR "/24 dev " VETH) ||
+	    ip("link set " VETH " up") ||
+	    ip("link set " VETH_PEER " up") ||
+	    ip("neigh replace " GW_ADDR " lladdr " GW_LLADDR
+	       " nud permanent dev " VETH) ||
+	    ip("route add 198.18.0.0/15 via " GW_ADDR " dev " VETH)) {
+		fprintf(stderr, "veth setup failed\n");
+		exit(1);
+	}
+	/* what comes back in stops after the conntrack lookup */
+	sysctl_set(PEER_FORWARDING, 0);
+
+	if (sysctl_set(CT_UDP_TIMEOUT, udp_timeout) ||
+	    (ct_max && sysctl_set(CT_MAX, ct_max))) {
+		fprintf(stderr, "cannot set conntrack limits\n");
+		exit(1);
+	}
+}
+
+static void teardown(void)
+{
+	if (saved_timeout >= 0)
+		sysctl_set(CT_UDP_TIMEOUT, saved_timeout);
+	if (saved_max >= 0)
+		sysctl_set(CT_MAX, saved_max);
+	if (!configured)
+		return;
+	configured = 0;
+	ip("link del " VETH " 2>/dev/null");
+}
+
+static void on_signal(int sig)
+{
+	teardown();
+	_exit(1);
+}
+
+/* ***************** Counters *********************************************** */
+
+/* Sums the per-cpu columns of CT_STAT that are named in st_names */
+static int ct_stats(unsigned long long *st)
+{
+	int col[ST_MAX], nr_cols = 0, i, j;
+	char line[1024], *tok, *save;
+	FILE *f = fopen(CT_STAT, "r");
+
+	memset(st, 0, sizeof(*st) * ST_MAX);
+	if (!f)
+		return -1;
+	for (i = 0; i < ST_MAX; i++)
+		col[i] = -1;
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return -1;
+	}
+	for (tok = strtok_r(line, " \n", &save); tok;
+	     tok = strtok_r(NULL, " \n", &save), nr_cols++)
+		for (i = 0; i < ST_MAX; i++)
+			if (!strcmp(tok, st_names[i]))
+				col[i] = nr_cols;
+
+	while (fgets(line, sizeof(line), f)) {
+		for (j = 0, tok = strtok_r(line, " \n", &save); tok;
+		     tok = strtok_r(NULL, " \n", &save), j++)
+			for (i = 0; i < ST_MAX; i++)
+				if (col[i] == j)
+					st[i] += strtoull(tok, NULL, 16);
+	}
+	fclose(f);
+	return col[ST_INSERT] < 0 ? -1 : 0;
+}
+
+/* Time all cpus spent outside of idle and iowait, from /proc/stat */
+static unsigned long long busy_ns(void)
+{
+	unsigned long long v[8] = { 0 }, busy;
+	FILE *f = fopen("/proc/stat", "r");
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+		   &v[7]) < 7) {
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	busy = v[0] + v[1] + v[2] + v[5] + v[6] + v[7];
+	return busy * (1000000000ULL / sysconf(_SC_CLK_TCK));
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ***************** Senders ************************************************ */
+
+static void *send_flows(void *arg)
+{
+	struct sender *s = arg;
+	struct sockaddr_in sin;
+	uint32_t host = s->seed;
+	uint16_t port = 1;
+	char byte = 0;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(s->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	while (running) {
+		/* every datagram is a tuple no other thread uses */
+		sin.sin_addr.s_addr = htonl(DST_NET | (host & DST_MASK));
+		sin.sin_port = htons(port);
+		sendto(s->fd, &byte, 1, MSG_DONTWAIT,
+		       (struct sockaddr *)&sin, sizeof(sin));
+		if (!++port) {
+			port = 1;
+			host++;
+		}
+	}
+	return NULL;
+}
+
+static void run(const int *cpus, int nr, struct result *r)
+{
+	unsigned long long st0[ST_MAX], st1[ST_MAX], busy0;
+	struct sender *s;
+	double t0;
+	int i;
+
+	s = calloc(nr, sizeof(*s));
+	if (!s) {
+		perror("calloc");
+		exit(1);
+	}
+	for (i = 0; i < nr; i++) {
+		s[i].cpu = cpus[i];
+		s[i].seed = (uint32_t)i << 12;
+		s[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (s[i].fd < 0) {
+			perror("socket");
+			exit(1);
+		}
+	}
+
+	/* let the previous run's entries time out */
+	sleep(udp_timeout + 1);
+
+	ct_stats(st0);
+	busy0 = busy_ns();
+	t0 = now();
+	running = 1;
+	for (i = 0; i < nr; i++) {
+		if (pthread_create(&s[i].thread, NULL, send_flows, &s[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+	sleep(secs);
+	running = 0;
+	for (i = 0; i < nr; i++)
+		pthread_join(s[i].thread, NULL);
+	r->secs = now() - t0;
+	r->busy = busy_ns() - busy0;
+	ct_stats(st1);
+
+	r->cpus = nr;
+	for (i = 0; i < ST_MAX; i++)
+		r->st[i] = st1[i] - st0[i];
+
+	for (i = 0; i < nr; i++)
+		close(s[i].fd);
+	free(s);
+}
+
+static void print(struct result *r)
+{
+	printf("%4d %12.0f %10.0f %10.0f %10.0f %10.0f\n", r->cpus,
+	       r->st[ST_INSERT] / r->secs, r->st[ST_INSERT_FAILED] / r->secs,
+	       r->st[ST_DROP] / r->secs,
+	       r->st[ST_EARLY_DROP] / r->secs,
+	       r->st[ST_INSERT] ? (double)r->busy / r->st[ST_INSERT] : 0);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-t secs] [-c cpus] [-u secs] [-m entries]\n"
+		"  -t secs    duration of each run (default 5)\n"
+		"  -c cpus    most cpus to send from (default all)\n"
+		"  -u secs    UDP conntrack timeout during the runs (default 1)\n"
+		"  -m entries nf_conntrack_max during the runs (default unchanged)\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long st[ST_MAX];
+	int cpus[CPU_SETSIZE], nr_cpus = 0, max_cpus = 0, opt, i, n;
+	struct result r;
+	cpu_set_t set;
+
+	while ((opt = getopt(argc, argv, "t:c:u:m:h")) != -1) {
+		switch (opt) {
+		case 't':
+			secs = atoi(optarg);
+			break;
+		case 'c':
+			max_cpus = atoi(optarg);
+			break;
+		case 'u':
+			udp_timeout = atoi(optarg);
+			break;
+		case 'm':
+			ct_max = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (secs <= 0 || max_cpus < 0 || udp_timeout <= 0 || ct_max < 0)
+		usage(argv[0]);
+
+	if (sched_getaffinity(0, sizeof(set), &set)) {
+		perror("sched_getaffinity");
+		return 1;
+	}
+	for (i = 0; i < CPU_SETSIZE; i++)
+		if (CPU_ISSET(i, &set))
+			cpus[nr_cpus++] = i;
+	if (max_cpus && max_cpus < nr_cpus)
+		nr_cpus = max_cpus;
+
+	if (ct_stats(st)) {
+		fprintf(stderr, "cannot read %s, is nf_conntrack_ipv4 loaded?\n",
+			CT_STAT);
+		return 1;
+	}
+	saved_timeout = sysctl_get(CT_UDP_TIMEOUT);
+	saved_max = sysctl_get(CT_MAX);
+	if (saved_timeout < 0 || saved_max < 0) {
+		fprintf(stderr, "cannot read the conntrack sysctls\n");
+		return 1;
+	}
+	atexit(teardown);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	setup();
+
+	printf("new UDP flows over %s, %d s per run, %d s timeout, max %ld\n",
+	       VETH, secs, udp_timeout, ct_max ? ct_max : saved_max);
+	printf("%4s %12s %10s %10s %10s %10s\n", "cpus", "new conn/s",
+	       "failed/s", "drop/s", "evicted/s", "cpu ns/conn");
+	for (n = 1; ; n = n * 2 < nr_cpus ? n * 2 : nr_cpus) {
+		run(cpus, n, &r);
+		print(&r);
+		if (n == nr_cpus)
+			break;
+	}
+
+	return 0;
+}
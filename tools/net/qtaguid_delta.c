@@ -0,0 +1,228 @@
+/*
+ * qtaguid_delta.c - read and check /proc/net/xt_qtaguid/stats_delta
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Keeps the stats_delta file open and runs a pass every interval, the
+ * way a collector would, merging the records into a table of its own.
+ * Every pass is checked against the format in xt_qtaguid.h: whole
+ * records only, a reset record first on the first pass and nowhere but
+ * first later, sane interface names, counter sets and flags, and no
+ * counter going backwards between two passes without a reset in
+ * between.  Prints one line per pass and exits non-zero on the first
+ * violation.  Build after "make headers_install" in the kernel tree.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <linux/netfilter/xt_qtaguid.h>
+
+/* the kernel's IFS_MAX_COUNTER_SETS */
+#define MAX_COUNTER_SETS	2
+
+static const char *path = "/proc/net/xt_qtaguid/stats_delta";
+static unsigned int interval = 5;
+static int passes = -1;
+
+static struct xt_qtaguid_stats_rec *table;
+static size_t table_len, table_size;
+
+static void fail(int pass, size_t i, const char *what)
+{
+	fprintf(stderr, "pass %d record %zu: %s\n", pass, i, what);
+	exit(1);
+}
+
+static struct xt_qtaguid_stats_rec *
+lookup(const struct xt_qtaguid_stats_rec *rec)
+{
+	size_t i;
+
+	for (i = 0; i < table_len; i++) {
+		if (table[i].acct_tag == rec->acct_tag &&
+		    table[i].uid == rec->uid &&
+		    table[i].cnt_set == rec->cnt_set &&
+		    !strncmp(table[i].iface, rec->iface, IFNAMSIZ))
+			return &table[i];
+	}
+	return NULL;
+}
+
+static int went_backwards(const struct xt_qtaguid_stats_rec *old,
+			  const struct xt_qtaguid_stats_rec *rec)
+{
+	int proto;
+
+	for (proto = 0; proto < XT_QTAGUID_PROTOS; proto++) {
+		if (rec->rx_bytes[proto] < old->rx_bytes[proto] ||
+		    rec->rx_packets[proto] < old->rx_packets[proto] ||
+		    rec->tx_bytes[proto] < old->tx_bytes[proto] ||
+		    rec->tx_packets[proto] < old->tx_packets[proto])
+			return 1;
+	}
+	return 0;
+}
+
+static void merge(int pass, size_t i, const struct xt_qtaguid_stats_rec *rec)
+{
+	struct xt_qtaguid_stats_rec *old;
+
+	if (rec->flags)
+		fail(pass, i, rec->flags & XT_QTAGUID_REC_RESET ?
+		     "reset record not first in pass" : "unknown flags");
+	if (!rec->iface[0] || memchr(rec->iface, 0, IFNAMSIZ) == NULL)
+		fail(pass, i, "bad interface name");
+	if (rec->cnt_set >= MAX_COUNTER_SETS)
+		fail(pass, i, "bad counter set");
+
+	old = lookup(rec);
+	if (old) {
+		if (went_backwards(old, rec))
+			fail(pass, i, "counter went backwards without reset");
+		*old = *rec;
+		return;
+	}
+
+	if (table_len == table_size) {
+		table_size = table_size ? table_size * 2 : 256;
+		table = realloc(table, table_size * sizeof(*table));
+		if (!table) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	table[table_len++] = *rec;
+}
+
+/* Read a whole pass into *bufp, returns its length in bytes */
+static size_t read_pass(int fd, char **bufp, size_t *sizep)
+{
+	size_t len = 0;
+	ssize_t n;
+
+	if (lseek(fd, 0, SEEK_SET) < 0) {
+		perror("lseek");
+		exit(1);
+	}
+	for (;;) {
+		if (len == *sizep) {
+			*sizep = *sizep ? *sizep * 2 : 64 * 1024;
+			*bufp = realloc(*bufp, *sizep);
+			if (!*bufp) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		n = read(fd, *bufp + len, *sizep - len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("read");
+			exit(1);
+		}
+		if (!n)
+			return len;
+		len += n;
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-f file] [-i seconds] [-n passes]\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const struct xt_qtaguid_stats_rec *recs;
+	unsigned long long rx, tx;
+	size_t size = 0, len, nr, i;
+	char *buf = NULL;
+	int opt, fd, pass, full, proto;
+
+	while ((opt = getopt(argc, argv, "f:i:n:")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'n':
+			passes = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+
+	for (pass = 0; passes < 0 || pass < passes; pass++) {
+		if (pass)
+			sleep(interval);
+
+		len = read_pass(fd, &buf, &size);
+		if (len % sizeof(*recs)) {
+			fprintf(stderr, "pass %d: %zu bytes is not a whole "
+				"number of %zu byte records\n",
+				pass, len, sizeof(*recs));
+			return 1;
+		}
+		recs = (const struct xt_qtaguid_stats_rec *)buf;
+		nr = len / sizeof(*recs);
+
+		full = nr && (recs[0].flags & XT_QTAGUID_REC_RESET);
+		if (!pass && !full)
+			fail(pass, 0, "first pass does not start with a reset");
+		if (full) {
+			if (recs[0].flags != XT_QTAGUID_REC_RESET ||
+			    recs[0].iface[0] || recs[0].acct_tag ||
+			    recs[0].uid || recs[0].cnt_set)
+				fail(pass, 0, "reset record carries data");
+			table_len = 0;
+		}
+		for (i = full; i < nr; i++)
+			merge(pass, i, &recs[i]);
+
+		/* the acct_tag 0 entries are the per-uid totals */
+		rx = tx = 0;
+		for (i = 0; i < table_len; i++) {
+			if (table[i].acct_tag)
+				continue;
+			for (proto = 0; proto < XT_QTAGUID_PROTOS; proto++) {
+				rx += table[i].rx_bytes[proto];
+				tx += table[i].tx_bytes[proto];
+			}
+		}
+		printf("pass %d: %-5s %6zu records %6zu entries "
+		       "rx %llu tx %llu bytes\n", pass,
+		       full ? "full" : "delta", nr - full, table_len, rx, tx);
+		fflush(stdout);
+	}
+
+	close(fd);
+	free(buf);
+	free(table);
+	return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * reuseport_bench.c - SO_REUSEPORT receive locality over loopback
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Runs one UDP server thread per CPU, each pinned to its CPU with its
+ * own SO_REUSEPORT socket on a shared port, and one client thread per
+ * CPU doing request/response over 127.0.0.1.  Loopback receives on the
+ * sending CPU, so a request served by the server thread of another CPU
+ * is a cross-CPU wakeup.  This is measured once with the default hash
+ * selection and once with SO_REUSEPORT_CPU set on the server sockets,
+ * printing requests per second and the share of cross-CPU requests.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT		15
+#endif
+#ifndef SO_REUSEPORT_CPU
+#define SO_REUSEPORT_CPU	0x7000
+#endif
+
+#define MAX_CPUS	64
+
+struct request {
+	int cpu;
+	unsigned int seq;
+};
+
+struct worker {
+	pthread_t thread;
+	int cpu;
+	int fd;
+	unsigned long served;
+	unsigned long cross;
+	unsigned long done;
+};
+
+static struct worker servers[MAX_CPUS], clients[MAX_CPUS];
+static pthread_barrier_t barrier;
+static volatile int stop;
+static int cpu_affine;
+static int setup_failed;
+static int ncpus;
+static int duration = 3;
+static unsigned short port;
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static int server_socket(void)
+{
+	struct sockaddr_in addr;
+	struct timeval tv = { 0, 100000 };
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+		goto err;
+	/* the option records the CPU it is set on, so set it once pinned */
+	if (cpu_affine &&
+	    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT_CPU, &one, sizeof(one)))
+		goto err;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		goto err;
+	return fd;
+err:
+	close(fd);
+	return -1;
+}
+
+static void *serve(void *arg)
+{
+	struct worker *w = arg;
+	struct sockaddr_in peer;
+	struct request req;
+	socklen_t len;
+	ssize_t n;
+
+	pin(w->cpu);
+	w->fd = server_socket();
+	if (w->fd < 0)
+		setup_failed = errno;
+	pthread_barrier_wait(&barrier);
+	if (w->fd < 0)
+		return NULL;
+
+	while (!stop) {
+		len = sizeof(peer);
+		n = recvfrom(w->fd, &req, sizeof(req), 0,
+			     (struct sockaddr *)&peer, &len);
+		if (n != sizeof(req))
+			continue;
+		w->served++;
+		if (req.cpu != sched_getcpu())
+			w->cross++;
+		sendto(w->fd, &req, sizeof(req), 0,
+		       (struct sockaddr *)&peer, len);
+	}
+	close(w->fd);
+	return NULL;
+}
+
+static void *request(void *arg)
+{
+	struct worker *w = arg;
+	struct sockaddr_in addr;
+	struct timeval tv = { 0, 100000 };
+	struct request req, resp;
+	unsigned int seq = 0;
+
+	pin(w->cpu);
+	w->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (w->fd < 0 || connect(w->fd, (struct sockaddr *)&addr,
+				 sizeof(addr)))
+		setup_failed = errno;
+	setsockopt(w->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	pthread_barrier_wait(&barrier);
+	if (setup_failed)
+		return NULL;
+
+	while (!stop) {
+		req.cpu = sched_getcpu();
+		req.seq = ++seq;
+		if (send(w->fd, &req, sizeof(req), 0) != sizeof(req))
+			continue;
+		/* a timeout just means the request was lost, send another */
+		while (recv(w->fd, &resp, sizeof(resp), 0) == sizeof(resp)) {
+			if (resp.seq == seq) {
+				w->done++;
+				break;
+			}
+		}
+	}
+	close(w->fd);
+	return NULL;
+}
+
+static int run(int affine)
+{
+	unsigned long done = 0, served = 0, cross = 0;
+	int i;
+
+	cpu_affine = affine;
+	stop = 0;
+	setup_failed = 0;
+	memset(servers, 0, sizeof(servers));
+	memset(clients, 0, sizeof(clients));
+	pthread_barrier_init(&barrier, NULL, 2 * ncpus + 1);
+
+	for (i = 0; i < ncpus; i++) {
+		servers[i].cpu = clients[i].cpu = i;
+		pthread_create(&servers[i].thread, NULL, serve, &servers[i]);
+	}
+	for (i = 0; i < ncpus; i++)
+		pthread_create(&clients[i].thread, NULL, request, &clients[i]);
+
+	pthread_barrier_wait(&barrier);
+	if (!setup_failed)
+		sleep(duration);
+	stop = 1;
+	for (i = 0; i < ncpus; i++) {
+		pthread_join(clients[i].thread, NULL);
+		pthread_join(servers[i].thread, NULL);
+		done += clients[i].done;
+		served += servers[i].served;
+		cross += servers[i].cross;
+	}
+	pthread_barrier_destroy(&barrier);
+
+	if (setup_failed) {
+		printf("%-16s setup failed: %s\n",
+		       affine ? "SO_REUSEPORT_CPU" : "hash",
+		       strerror(setup_failed));
+		return -1;
+	}
+	printf("%-16s %10.0f requests/s %6.2f%% cross-CPU\n",
+	       affine ? "SO_REUSEPORT_CPU" : "hash",
+	       (double)done / duration,
+	       served ? 100.0 * cross / served : 0.0);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-c cpus] [-p port] [-t seconds]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	port = 8053;
+	while ((opt = getopt(argc, argv, "c:p:t:")) != -1) {
+		switch (opt) {
+		case 'c':
+			ncpus = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 't':
+			duration = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (ncpus <= 0 || duration <= 0 || !port)
+		usage(argv[0]);
+	if (ncpus > MAX_CPUS)
+		ncpus = MAX_CPUS;
+
+	printf("%d CPUs, %d s each\n", ncpus, duration);
+	run(0);
+	run(1);
+	return 0;
+}
@@ -0,0 +1,681 @@
+/*
+ * rmnet_map_inject.c - synthetic MAP downlink for the rmnet_data driver
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A tun device stands in for the modem: rmnet_data is associated with it
+ * over its netlink interface, with MAP deaggregation and demuxing to a
+ * virtual device of its own.  Aggregated MAP frames, each carrying a run
+ * of in-sequence segments of one TCP flow, are then written to the tun
+ * device as fast as possible and go through the same ingress path as a
+ * real downlink.  The runs alternate between GRO off and on for the
+ * virtual device, or with -z between copying and zero copy deaggregation
+ * with GRO on, and report the packets per second received, the buffers
+ * the stack had to process after GRO, the packets deaggregated by copy
+ * and by sharing the aggregate's pages, and the CPU time spent per KB
+ * over all cpus.  The aggregates are written with a virtio_net_hdr
+ * asking for a short linear part, so that tun puts the rest in pages as
+ * a DMA ring would.  The segments go to -d, which is dropped by routing
+ * unless it is given to the virtual device.  Everything is torn down and
+ * the deaggregation setting restored on exit.  Needs root and CONFIG_TUN.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_tun.h>
+#include <linux/virtio_net.h>
+#include <linux/netlink.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include "../../include/uapi/linux/rmnet_data.h"
+
+#ifndef ETH_P_MAP
+#define ETH_P_MAP	0xDA1A
+#endif
+#define RMNET_DATA_MAX_VND	32	/* net/rmnet_data/rmnet_data_private.h */
+#define MAP_HDR_LEN	4
+#define IP_HDR_LEN	20
+#define TCP_HDR_LEN	20
+#define MAX_AGG		(64 * 1024)
+#define VND_NAME	"rmnet_inj_vnd"
+#define ZC_KNOB		"/sys/module/rmnet_data/parameters/deagg_zero_copy"
+#define ZC_STATS	"/sys/module/rmnet_data/parameters/deagg_share"
+
+/* struct tun_pi and struct virtio_net_hdr ahead of each aggregate */
+#define PREFIX_LEN	(4 + sizeof(struct virtio_net_hdr))
+/* what tun is asked to keep linear, the rest goes to page fragments */
+#define LINEAR_LEN	64
+
+static int nr_pkts = 16;
+static int payload = 1400;
+static int secs = 5;
+static int mux_id = 1;
+static int vnd_id = RMNET_DATA_MAX_VND - 1;
+static const char *dst = "192.0.2.1";
+
+static char tun_name[IFNAMSIZ];
+static int tun_fd = -1, nl_fd = -1, ctl_fd = -1;
+static uint32_t nl_seq;
+static int configured;
+static int saved_zc = -1;
+
+struct result {
+	unsigned long aggs;
+	unsigned long pkts;
+	unsigned long stack_pkts;	/* buffers left after GRO */
+	unsigned long bytes;
+	unsigned long copied;
+	unsigned long shared;
+	unsigned long long busy_ns;	/* over all cpus */
+	double secs;
+};
+
+/* ***************** rmnet_data configuration ******************************* */
+
+static int rmnet_cmd(struct rmnet_nl_msg_s *msg)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct rmnet_nl_msg_s msg;
+	} req, resp;
+	struct sockaddr_nl addr;
+	socklen_t alen = sizeof(addr);
+
+	if (getsockname(nl_fd, (struct sockaddr *)&addr, &alen))
+		return -1;
+
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = sizeof(req);
+	req.nh.nlmsg_flags = NLM_F_REQUEST;
+	req.nh.nlmsg_seq = ++nl_seq;
+	req.nh.nlmsg_pid = addr.nl_pid;
+	req.msg = *msg;
+	req.msg.crd = RMNET_NETLINK_MSG_COMMAND;
+
+	if (send(nl_fd, &req, sizeof(req), 0) < 0 ||
+	    recv(nl_fd, &resp, sizeof(resp), 0) < (ssize_t)sizeof(resp.nh))
+		return -1;
+	return resp.msg.return_code;
+}
+
+static int rmnet_dev_cmd(int type, const char *dev)
+{
+	struct rmnet_nl_msg_s msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.message_type = type;
+	snprintf((char *)msg.data, RMNET_MAX_STR_LEN, "%s", dev);
+	return rmnet_cmd(&msg);
+}
+
+static int rmnet_ingress_format(const char *dev, uint32_t flags)
+{
+	struct rmnet_nl_msg_s msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.message_type = RMNET_NETLINK_SET_LINK_INGRESS_DATA_FORMAT;
+	snprintf((char *)msg.data_format.dev, RMNET_MAX_STR_LEN, "%s", dev);
+	msg.data_format.flags = flags;
+	return rmnet_cmd(&msg);
+}
+
+static int rmnet_vnd(int type, int id, const char *name)
+{
+	struct rmnet_nl_msg_s msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.message_type = type;
+	msg.vnd.id = id;
+	if (name)
+		snprintf((char *)msg.vnd.vnd_name, RMNET_MAX_STR_LEN, "%s", name);
+	return rmnet_cmd(&msg);
+}
+
+static int rmnet_ep(int type, const char *dev, int ep, const char *next)
+{
+	struct rmnet_nl_msg_s msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.message_type = type;
+	snprintf((char *)msg.local_ep_config.dev, RMNET_MAX_STR_LEN, "%s", dev);
+	msg.local_ep_config.ep_id = ep;
+	msg.local_ep_config.operating_mode = RMNET_EPMODE_VND;
+	if (next)
+		snprintf((char *)msg.local_ep_config.next_dev,
+			 RMNET_MAX_STR_LEN, "%s", next);
+	return rmnet_cmd(&msg);
+}
+
+static int link_up(const char *dev)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, dev, IFNAMSIZ - 1);
+	if (ioctl(ctl_fd, SIOCGIFFLAGS, &ifr))
+		return -1;
+	ifr.ifr_flags |= IFF_UP;
+	return ioctl(ctl_fd, SIOCSIFFLAGS, &ifr);
+}
+
+static void setup(void)
+{
+	struct sockaddr_nl addr;
+	struct ifreq ifr;
+	int rc;
+
+	ctl_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	nl_fd = socket(AF_NETLINK, SOCK_RAW, RMNET_NETLINK_PROTO);
+	tun_fd = open("/dev/net/tun", O_RDWR);
+	if (ctl_fd < 0 || nl_fd < 0 || tun_fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	if (bind(nl_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		perror("bind");
+		exit(1);
+	}
+
+	/* with packet information, so that the MAP frames keep ETH_P_MAP */
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TUN | IFF_VNET_HDR;
+	strncpy(ifr.ifr_name, "rmnet_inj%d", IFNAMSIZ - 1);
+	if (ioctl(tun_fd, TUNSETIFF, &ifr)) {
+		perror("TUNSETIFF");
+		exit(1);
+	}
+	memcpy(tun_name, ifr.ifr_name, IFNAMSIZ);
+
+	configured = 1;
+	rc = rmnet_dev_cmd(RMNET_NETLINK_ASSOCIATE_NETWORK_DEVICE, tun_name);
+	if (!rc)
+		rc = rmnet_ingress_format(tun_name, RMNET_INGRESS_FORMAT_MAP |
+					  RMNET_INGRESS_FORMAT_DEAGGREGATION |
+					  RMNET_INGRESS_FORMAT_DEMUXING);
+	if (!rc)
+		rc = rmnet_vnd(RMNET_NETLINK_NEW_VND_WITH_NAME, vnd_id,
+			       VND_NAME);
+	if (!rc)
+		rc = rmnet_ep(RMNET_NETLINK_SET_LOGICAL_EP_CONFIG, tun_name,
+			      mux_id, VND_NAME);
+	if (rc) {
+		fprintf(stderr, "rmnet_data configuration failed: %d\n", rc);
+		exit(1);
+	}
+	if (link_up(tun_name) || link_up(VND_NAME)) {
+		perror("SIOCSIFFLAGS");
+		exit(1);
+	}
+}
+
+static int zc_get(void)
+{
+	FILE *f = fopen(ZC_KNOB, "r");
+	char val = 0;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, " %c", &val) != 1)
+		val = 0;
+	fclose(f);
+	return val == 'Y' ? 1 : val == 'N' ? 0 : -1;
+}
+
+static int zc_set(int val)
+{
+	FILE *f = fopen(ZC_KNOB, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", val);
+	return fclose(f);
+}
+
+static void teardown(void)
+{
+	if (saved_zc >= 0)
+		zc_set(saved_zc);
+	if (!configured)
+		return;
+	configured = 0;
+	rmnet_ep(RMNET_NETLINK_UNSET_LOGICAL_EP_CONFIG, tun_name, mux_id,
+		 NULL);
+	rmnet_vnd(RMNET_NETLINK_FREE_VND, vnd_id, NULL);
+	rmnet_dev_cmd(RMNET_NETLINK_UNASSOCIATE_NETWORK_DEVICE, tun_name);
+	close(tun_fd);
+}
+
+static void on_signal(int sig)
+{
+	teardown();
+	_exit(1);
+}
+
+/* ***************** Counters *********************************************** */
+
+static int set_gro(int on)
+{
+	struct ethtool_value ev = { .cmd = ETHTOOL_SGRO, .data = on };
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, VND_NAME, IFNAMSIZ - 1);
+	ifr.ifr_data = (void *)&ev;
+	return ioctl(ctl_fd, SIOCETHTOOL, &ifr);
+}
+
+/* One of the counters shown by ethtool -S, 0 if it is not there */
+static unsigned long long ethtool_stat(const char *name)
+{
+	struct {
+		struct ethtool_sset_info hdr;
+		uint32_t len;
+	} sset = { .hdr = { .cmd = ETHTOOL_GSSET_INFO,
+			    .sset_mask = 1ULL << ETH_SS_STATS } };
+	struct ethtool_gstrings *strings = NULL;
+	struct ethtool_stats *stats = NULL;
+	unsigned long long val = 0;
+	struct ifreq ifr;
+	uint32_t i, n;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, VND_NAME, IFNAMSIZ - 1);
+	ifr.ifr_data = (void *)&sset;
+	if (ioctl(ctl_fd, SIOCETHTOOL, &ifr) || !sset.hdr.sset_mask)
+		return 0;
+	n = sset.len;
+
+	strings = calloc(1, sizeof(*strings) + n * ETH_GSTRING_LEN);
+	stats = calloc(1, sizeof(*stats) + n * sizeof(uint64_t));
+	if (!strings || !stats)
+		goto out;
+	strings->cmd = ETHTOOL_GSTRINGS;
+	strings->string_set = ETH_SS_STATS;
+	strings->len = n;
+	ifr.ifr_data = (void *)strings;
+	if (ioctl(ctl_fd, SIOCETHTOOL, &ifr))
+		goto out;
+	stats->cmd = ETHTOOL_GSTATS;
+	stats->n_stats = n;
+	ifr.ifr_data = (void *)stats;
+	if (ioctl(ctl_fd, SIOCETHTOOL, &ifr))
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		if (!strncmp((char *)strings->data + i * ETH_GSTRING_LEN,
+			     name, ETH_GSTRING_LEN)) {
+			val = stats->data[i];
+			break;
+		}
+	}
+out:
+	free(strings);
+	free(stats);
+	return val;
+}
+
+static unsigned long long dev_stat(const char *dev, const char *name)
+{
+	unsigned long long val = 0;
+	char path[128];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s",
+		 dev, name);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	if (fscanf(f, "%llu", &val) != 1)
+		val = 0;
+	fclose(f);
+	return val;
+}
+
+/* Packets deaggregated by copy and by sharing the aggregate's pages */
+static void share_stats(unsigned long *copied, unsigned long *shared)
+{
+	FILE *f = fopen(ZC_STATS, "r");
+
+	*copied = *shared = 0;
+	if (!f)
+		return;
+	if (fscanf(f, "%lu,%lu", copied, shared) != 2)
+		*copied = *shared = 0;
+	fclose(f);
+}
+
+/* Time all cpus spent outside of idle and iowait, from /proc/stat */
+static unsigned long long busy_ns(void)
+{
+	unsigned long long v[8] = { 0 }, busy;
+	FILE *f = fopen("/proc/stat", "r");
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+		   &v[7]) < 7) {
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	busy = v[0] + v[1] + v[2] + v[5] + v[6] + v[7];
+	return busy * (1000000000ULL / sysconf(_SC_CLK_TCK));
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ***************** MAP frames ********************************************* */
+
+static uint32_t csum_add(uint32_t sum, const void *buf, int len)
+{
+	const uint8_t *p = buf;
+
+	for (; len > 1; len -= 2, p += 2)
+		sum += (p[0] << 8) | p[1];
+	if (len)
+		sum += p[0] << 8;
+	return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+struct flow {
+	uint32_t saddr, daddr;
+	uint32_t seq;
+	uint16_t id;
+	uint32_t payload_sum;
+};
+
+static void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	put16(p, v >> 16);
+	put16(p + 2, v);
+}
+
+/*
+ * Fills an aggregate of nr_pkts segments that carry on where the previous
+ * one stopped: in-sequence TCP, incrementing IP ids, DF set and no PSH,
+ * which is what GRO needs to merge them.
+ */
+static size_t build_aggregate(uint8_t *buf, struct flow *fl)
+{
+	int ip_len = IP_HDR_LEN + TCP_HDR_LEN + payload;
+	int pad = (4 - ip_len % 4) % 4;
+	struct virtio_net_hdr *vh = (struct virtio_net_hdr *)(buf + 4);
+	size_t off = PREFIX_LEN;
+	uint32_t sum;
+	int i;
+
+	put16(buf, 0);
+	put16(buf + 2, ETH_P_MAP);
+	memset(vh, 0, sizeof(*vh));
+	vh->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+	vh->hdr_len = LINEAR_LEN;
+
+	for (i = 0; i < nr_pkts; i++) {
+		uint8_t *map = buf + off;
+		uint8_t *ip = map + MAP_HDR_LEN;
+		uint8_t *tcp = ip + IP_HDR_LEN;
+
+		map[0] = pad;	/* cd bit clear: data */
+		map[1] = mux_id;
+		put16(map + 2, ip_len + pad);
+
+		memset(ip, 0, IP_HDR_LEN);
+		ip[0] = 0x45;
+		put16(ip + 2, ip_len);
+		put16(ip + 4, fl->id++);
+		put16(ip + 6, 0x4000);	/* DF */
+		ip[8] = 64;
+		ip[9] = IPPROTO_TCP;
+		put32(ip + 12, fl->saddr);
+		put32(ip + 16, fl->daddr);
+		put16(ip + 10, csum_fold(csum_add(0, ip, IP_HDR_LEN)));
+
+		memset(tcp, 0, TCP_HDR_LEN);
+		put16(tcp, 5001);
+		put16(tcp + 2, 5001);
+		put32(tcp + 4, fl->seq);
+		put32(tcp + 8, 1);
+		tcp[12] = (TCP_HDR_LEN / 4) << 4;
+		tcp[13] = 0x10;	/* ACK */
+		put16(tcp + 14, 65535);
+		fl->seq += payload;
+
+		/* the payload was filled once, its sum does not change */
+		sum = fl->payload_sum;
+		sum = csum_add(sum, ip + 12, 8);
+		sum += IPPROTO_TCP + TCP_HDR_LEN + payload;
+		sum = csum_add(sum, tcp, TCP_HDR_LEN);
+		put16(tcp + 16, csum_fold(sum));
+
+		memset(tcp + TCP_HDR_LEN + payload, 0, pad);
+		off += MAP_HDR_LEN + ip_len + pad;
+	}
+	return off;
+}
+
+static void init_payload(uint8_t *buf, struct flow *fl)
+{
+	int ip_len = IP_HDR_LEN + TCP_HDR_LEN + payload;
+	int pad = (4 - ip_len % 4) % 4;
+	size_t off = PREFIX_LEN + MAP_HDR_LEN + IP_HDR_LEN + TCP_HDR_LEN;
+	int i, j;
+
+	for (i = 0; i < nr_pkts; i++) {
+		for (j = 0; j < payload; j++)
+			buf[off + j] = j;
+		off += payload + pad + MAP_HDR_LEN + IP_HDR_LEN + TCP_HDR_LEN;
+	}
+	off = PREFIX_LEN + MAP_HDR_LEN + IP_HDR_LEN + TCP_HDR_LEN;
+	fl->payload_sum = csum_add(0, buf + off, payload);
+}
+
+/* ***************** Runs *************************************************** */
+
+/* zc < 0 leaves the deaggregation setting alone */
+static void run(int gro, int zc, uint8_t *buf, struct flow *fl,
+		struct result *r)
+{
+	unsigned long long rx, merged, busy;
+	unsigned long copied, shared, c, s;
+	double start, end;
+	size_t len;
+
+	if (set_gro(gro)) {
+		perror("ETHTOOL_SGRO");
+		exit(1);
+	}
+	if (zc >= 0 && zc_set(zc)) {
+		fprintf(stderr, "cannot write %s\n", ZC_KNOB);
+		exit(1);
+	}
+
+	share_stats(&copied, &shared);
+	rx = dev_stat(VND_NAME, "rx_packets");
+	merged = ethtool_stat("gro_merged");
+	busy = busy_ns();
+	start = now();
+	end = start + secs;
+
+	do {
+		int i;
+
+		for (i = 0; i < 64; i++) {
+			len = build_aggregate(buf, fl);
+			if (write(tun_fd, buf, len) < 0) {
+				perror("write");
+				exit(1);
+			}
+			r->aggs++;
+		}
+	} while (now() < end);
+
+	/* let the backlog and the GRO context drain */
+	usleep(100000);
+	r->secs += now() - start;
+	r->busy_ns += busy_ns() - busy;
+	rx = dev_stat(VND_NAME, "rx_packets") - rx;
+	merged = ethtool_stat("gro_merged") - merged;
+	share_stats(&c, &s);
+	r->copied += c - copied;
+	r->shared += s - shared;
+	r->pkts += rx;
+	r->stack_pkts += rx - merged;
+	r->bytes += rx * (IP_HDR_LEN + TCP_HDR_LEN + payload);
+}
+
+static void print(const char *name, struct result *r)
+{
+	printf("%-5s %10.0f %10.0f %10.0f %10.0f %10.0f %8.1f %10.1f\n", name,
+	       r->aggs / r->secs, r->pkts / r->secs, r->stack_pkts / r->secs,
+	       r->copied / r->secs, r->shared / r->secs,
+	       r->bytes * 8 / r->secs / 1e6,
+	       r->bytes ? (double)r->busy_ns * 1024 / r->bytes : 0);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-z] [-n pkts] [-s bytes] [-t secs] [-r runs] [-m mux] [-i id] [-d addr]\n"
+		"  -z       compare copying and zero copy deaggregation, GRO on\n"
+		"  -n pkts  segments per MAP aggregate (default 16)\n"
+		"  -s bytes TCP payload per segment (default 1400)\n"
+		"  -t secs  duration of each run (default 5)\n"
+		"  -r runs  runs per setting (default 1)\n"
+		"  -m mux   MAP mux id (default 1)\n"
+		"  -i id    rmnet_data virtual device id (default %d)\n"
+		"  -d addr  IPv4 destination of the segments (default %s)\n",
+		prog, RMNET_DATA_MAX_VND - 1, dst);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct result off = { 0 }, on = { 0 };
+	struct flow fl = { 0 };
+	struct in_addr addr;
+	int runs = 1, zc = 0, opt, i;
+	uint8_t *buf;
+
+	while ((opt = getopt(argc, argv, "zn:s:t:r:m:i:d:h")) != -1) {
+		switch (opt) {
+		case 'z':
+			zc = 1;
+			break;
+		case 'n':
+			nr_pkts = atoi(optarg);
+			break;
+		case 's':
+			payload = atoi(optarg);
+			break;
+		case 't':
+			secs = atoi(optarg);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		case 'm':
+			mux_id = atoi(optarg);
+			break;
+		case 'i':
+			vnd_id = atoi(optarg);
+			break;
+		case 'd':
+			dst = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (nr_pkts <= 0 || payload <= 0 || payload > 16000 || secs <= 0 ||
+	    runs <= 0 || mux_id < 0 || mux_id > 254 || vnd_id < 0 ||
+	    vnd_id >= RMNET_DATA_MAX_VND || !inet_aton(dst, &addr) ||
+	    PREFIX_LEN + (size_t)nr_pkts * (MAP_HDR_LEN + IP_HDR_LEN + TCP_HDR_LEN +
+				   payload + 3) > MAX_AGG)
+		usage(argv[0]);
+
+	buf = calloc(1, MAX_AGG);
+	if (!buf) {
+		perror("calloc");
+		return 1;
+	}
+	fl.saddr = 0xc6336401;	/* 198.51.100.1 */
+	fl.daddr = ntohl(addr.s_addr);
+	init_payload(buf, &fl);
+
+	if (zc) {
+		saved_zc = zc_get();
+		if (saved_zc < 0) {
+			fprintf(stderr, "cannot read %s\n", ZC_KNOB);
+			return 1;
+		}
+	}
+	atexit(teardown);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	setup();
+
+	for (i = 0; i < runs; i++) {
+		if (zc) {
+			run(1, 0, buf, &fl, &off);
+			run(1, 1, buf, &fl, &on);
+		} else {
+			run(0, -1, buf, &fl, &off);
+			run(1, -1, buf, &fl, &on);
+		}
+	}
+
+	printf("%d segments of %d bytes per aggregate, %d s per run, %d runs\n",
+	       nr_pkts, payload, secs, runs);
+	printf("%-5s %10s %10s %10s %10s %10s %8s %10s\n", zc ? "deagg" : "gro",
+	       "aggs/s", "pkts/s", "stack/s", "copied/s", "shared/s",
+	       "Mbit/s", "cpu ns/KB");
+	print(zc ? "copy" : "off", &off);
+	print(zc ? "zc" : "on", &on);
+
+	return 0;
+}
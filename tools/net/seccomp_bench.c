@@ -0,0 +1,293 @@
+/*
+ * seccomp_bench.c - seccomp filter cost with and without the BPF JIT
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Installs an application style allow list, with getppid() at its very
+ * end and a syscall whose errno is computed from its arguments, in a
+ * child process once with no filter, once with net.core.bpf_jit_enable
+ * at 0 and once at 1, since the filter is compiled when it is attached.
+ * Each child reports the errno returned for a set of argument vectors,
+ * which must match between the interpreter and the JIT, and the time
+ * per getppid() call.  The sysctl is restored on exit.  Needs root and
+ * CONFIG_SECCOMP_FILTER.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS	38
+#endif
+
+#define JIT_ENABLE	"/proc/sys/net/core/bpf_jit_enable"
+
+/* never actually runs, the filter answers it from its arguments */
+#define NR_TARGET	__NR_sethostname
+
+#define ARG_LO(n)	(offsetof(struct seccomp_data, args[n]) + LO_OFF)
+#define ARG_HI(n)	(offsetof(struct seccomp_data, args[n]) + HI_OFF)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define LO_OFF	0
+#define HI_OFF	4
+#else
+#define LO_OFF	4
+#define HI_OFF	0
+#endif
+
+static const int allowed[] = {
+	__NR_read, __NR_write, __NR_close, __NR_fstat, __NR_mmap,
+	__NR_mprotect, __NR_munmap, __NR_brk, __NR_rt_sigaction,
+	__NR_rt_sigprocmask, __NR_rt_sigreturn, __NR_ioctl, __NR_pread64,
+	__NR_pwrite64, __NR_readv, __NR_writev, __NR_sched_yield,
+	__NR_mremap, __NR_msync, __NR_madvise, __NR_dup, __NR_nanosleep,
+	__NR_getpid, __NR_socket, __NR_connect, __NR_sendto, __NR_recvfrom,
+	__NR_sendmsg, __NR_recvmsg, __NR_clone, __NR_execve, __NR_exit,
+	__NR_wait4, __NR_kill, __NR_fcntl, __NR_flock, __NR_fsync,
+	__NR_getdents64, __NR_getcwd, __NR_chdir, __NR_fchdir, __NR_futex,
+	__NR_epoll_ctl, __NR_epoll_pwait, __NR_openat, __NR_mkdirat,
+	__NR_clock_gettime, __NR_exit_group, __NR_tgkill, __NR_ppoll,
+	__NR_gettid, __NR_getppid,
+};
+#define NR_ALLOWED	(sizeof(allowed) / sizeof(allowed[0]))
+
+static const uint64_t vectors[][2] = {
+	{ 0, 0 },
+	{ 1, 2 },
+	{ 0xff, 0xffffffff },
+	{ 0x123456789abcdefull, 42 },
+	{ 0xffffffff00000000ull, 0x80000000 },
+	{ 7, 0xfffffffffffffff9ull },
+};
+#define NR_VECTORS	(sizeof(vectors) / sizeof(vectors[0]))
+
+struct result {
+	int errs[NR_VECTORS];
+	double ns;
+};
+
+static long loops = 1000000;
+static long saved_jit = -1;
+
+static long read_long(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	long val = -1;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%ld", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int write_long(const char *path, long val)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%ld\n", val);
+	return fclose(f);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int install_filter(void)
+{
+	struct sock_filter insns[NR_ALLOWED + 16], *p = insns;
+	struct sock_fprog prog;
+	unsigned int i;
+
+	*p++ = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+			offsetof(struct seccomp_data, nr));
+	*p++ = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+			NR_TARGET, NR_ALLOWED + 2, 0);
+	/* a match jumps to the allow at the end of the list */
+	for (i = 0; i < NR_ALLOWED; i++)
+		*p++ = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				allowed[i], NR_ALLOWED - i, 0);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+			SECCOMP_RET_ERRNO | EPERM);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+			SECCOMP_RET_ALLOW);
+
+	/* errno = ((a0 & 0xff) + a1 ^ a0 >> 32) % 4093 + 1 */
+	*p++ = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+			ARG_LO(0));
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xff);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+			ARG_LO(1));
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+			ARG_HI(0));
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, 4093);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_OR | BPF_K,
+			SECCOMP_RET_ERRNO);
+	*p++ = (struct sock_filter)BPF_STMT(BPF_RET | BPF_A, 0);
+
+	prog.len = p - insns;
+	prog.filter = insns;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)) {
+		perror("PR_SET_NO_NEW_PRIVS");
+		return -1;
+	}
+	if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog)) {
+		perror("PR_SET_SECCOMP");
+		return -1;
+	}
+	return 0;
+}
+
+static void child(int fd, int filtered)
+{
+	struct result res;
+	double start;
+	unsigned int i;
+	long n;
+
+	memset(&res, 0, sizeof(res));
+	if (filtered && install_filter())
+		exit(1);
+
+	if (filtered) {
+		for (i = 0; i < NR_VECTORS; i++) {
+			errno = 0;
+			syscall(NR_TARGET, vectors[i][0], vectors[i][1]);
+			res.errs[i] = errno;
+		}
+	}
+
+	start = now_ns();
+	for (n = 0; n < loops; n++)
+		syscall(__NR_getppid);
+	res.ns = (now_ns() - start) / loops;
+
+	if (write(fd, &res, sizeof(res)) != sizeof(res))
+		exit(1);
+	exit(0);
+}
+
+static int run(int filtered, struct result *res)
+{
+	int fds[2], status;
+	ssize_t len;
+	pid_t pid;
+
+	if (pipe(fds))
+		return -1;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		close(fds[0]);
+		child(fds[1], filtered);
+	}
+
+	close(fds[1]);
+	len = read(fds[0], res, sizeof(*res));
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+
+	if (len != sizeof(*res) || !WIFEXITED(status) ||
+	    WEXITSTATUS(status)) {
+		fprintf(stderr, "child failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-n loops]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct result none, interp, jit;
+	unsigned int i, failed = 0;
+	int opt, ret = 1;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			loops = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (loops <= 0)
+		usage(argv[0]);
+
+	saved_jit = read_long(JIT_ENABLE);
+	if (saved_jit < 0) {
+		fprintf(stderr, "%s: %s\n", JIT_ENABLE, strerror(errno));
+		return 1;
+	}
+
+	if (run(0, &none))
+		goto out;
+	if (write_long(JIT_ENABLE, 0) || run(1, &interp))
+		goto out;
+	if (write_long(JIT_ENABLE, 1) || run(1, &jit))
+		goto out;
+
+	for (i = 0; i < NR_VECTORS; i++) {
+		if (interp.errs[i] != jit.errs[i]) {
+			failed++;
+			printf("vector %u: MISMATCH interp errno %d jit errno %d\n",
+			       i, interp.errs[i], jit.errs[i]);
+		}
+	}
+
+	printf("%zu insn filter, %ld getppid() calls\n",
+	       NR_ALLOWED + 16, loops);
+	printf("no filter   %8.1f ns\n", none.ns);
+	printf("interpreter %8.1f ns (+%.1f)\n", interp.ns, interp.ns - none.ns);
+	printf("jit         %8.1f ns (+%.1f)\n", jit.ns, jit.ns - none.ns);
+	if (jit.ns > none.ns)
+		printf("filter speedup %.2fx\n",
+		       (interp.ns - none.ns) / (jit.ns - none.ns));
+	printf("%u mismatches\n", failed);
+	ret = failed ? 1 : 0;
+out:
+	write_long(JIT_ENABLE, saved_jit);
+	return ret;
+}
@@ -0,0 +1,272 @@
+/*
+ * udpgso_bench.c - UDP transmit cost per datagram over loopback
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Sends equal size datagrams to a receiver thread on 127.0.0.1 for a
+ * fixed time, first with one sendmsg() per datagram, then with batches
+ * of sendmmsg() and last with one send per batch cut into datagrams by
+ * the stack through UDP_SEGMENT.  For each it prints the send calls and
+ * the datagrams received per second, the latter being what matters as
+ * loopback drops what the receiver cannot keep up with.  The receiver
+ * checks every datagram it gets has the expected size.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP		17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT	103
+#endif
+
+/* the kernel's UDP_MAX_SEGMENTS */
+#define MAX_BATCH	64
+/*
+ * largest UDP payload one segmentation offload send can carry: it must
+ * fit a single skb, whose length IPv4 rounds down to a multiple of 8
+ */
+#define MAX_SEND	65504
+
+enum mode {
+	MODE_SENDMSG,
+	MODE_SENDMMSG,
+	MODE_GSO,
+};
+
+static const char * const mode_names[] = {
+	[MODE_SENDMSG]	= "sendmsg",
+	[MODE_SENDMMSG]	= "sendmmsg",
+	[MODE_GSO]	= "UDP_SEGMENT",
+};
+
+struct receiver {
+	int fd;
+	volatile int stop;
+	unsigned long datagrams;
+	unsigned long bad;
+};
+
+static unsigned int payload = 1400;
+static unsigned int batch = 32;
+static int duration = 3;
+
+static char buf[MAX_BATCH * 1500];
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *receive(void *arg)
+{
+	struct receiver *r = arg;
+	static char rbuf[MAX_BATCH][2048];
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iov[MAX_BATCH];
+	int i, n;
+
+	for (i = 0; i < MAX_BATCH; i++) {
+		iov[i].iov_base = rbuf[i];
+		iov[i].iov_len = sizeof(rbuf[i]);
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (!r->stop) {
+		n = recvmmsg(r->fd, msgs, MAX_BATCH, 0, NULL);
+		if (n < 0)
+			continue;	/* SO_RCVTIMEO, check stop */
+		for (i = 0; i < n; i++) {
+			r->datagrams++;
+			if (msgs[i].msg_len != payload)
+				r->bad++;
+		}
+	}
+	return NULL;
+}
+
+static int udp_socket(void)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	int size = 4 << 20;
+
+	if (fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	return fd;
+}
+
+/* returns the send calls made, or -1 if the mode is not supported */
+static long run_sender(int fd, enum mode mode, double end)
+{
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iov[MAX_BATCH];
+	unsigned int i, gso, gso_len;
+	long calls = 0;
+	int ret;
+
+	for (i = 0; i < batch; i++) {
+		iov[i].iov_base = buf + i * payload;
+		iov[i].iov_len = payload;
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	gso = mode == MODE_GSO ? payload : 0;
+	gso_len = payload * batch;
+	if (gso_len > MAX_SEND)
+		gso_len = MAX_SEND / payload * payload;
+	if (setsockopt(fd, SOL_UDP, UDP_SEGMENT, &gso, sizeof(gso))) {
+		if (mode == MODE_GSO)
+			return -1;
+	}
+
+	while (now_s() < end) {
+		for (i = 0; i < 64; i++) {
+			switch (mode) {
+			case MODE_SENDMSG:
+				ret = send(fd, buf, payload, 0);
+				break;
+			case MODE_SENDMMSG:
+				ret = sendmmsg(fd, msgs, batch, 0);
+				break;
+			default:
+				ret = send(fd, buf, gso_len, 0);
+				break;
+			}
+			if (ret < 0 && errno != ENOBUFS && errno != ECONNREFUSED) {
+				perror(mode_names[mode]);
+				exit(1);
+			}
+			calls++;
+		}
+	}
+	return calls;
+}
+
+static void run(enum mode mode, struct sockaddr_in *addr, int rfd)
+{
+	struct receiver r;
+	pthread_t thread;
+	double start, secs;
+	long calls;
+	int fd;
+
+	memset(&r, 0, sizeof(r));
+	r.fd = rfd;
+
+	fd = udp_socket();
+	if (connect(fd, (struct sockaddr *)addr, sizeof(*addr))) {
+		perror("connect");
+		exit(1);
+	}
+
+	if (pthread_create(&thread, NULL, receive, &r)) {
+		fprintf(stderr, "pthread_create failed\n");
+		exit(1);
+	}
+
+	start = now_s();
+	calls = run_sender(fd, mode, start + duration);
+	secs = now_s() - start;
+
+	/* let the receiver drain what is still queued */
+	usleep(200000);
+	r.stop = 1;
+	pthread_join(thread, NULL);
+	close(fd);
+
+	if (calls < 0) {
+		printf("%-12s not supported by this kernel\n", mode_names[mode]);
+		return;
+	}
+	printf("%-12s %10.0f calls/s %10.0f datagrams/s %8.2f Gbit/s%s\n",
+	       mode_names[mode], calls / secs, r.datagrams / secs,
+	       r.datagrams * payload * 8 / secs / 1e9,
+	       r.bad ? " SIZE MISMATCH" : "");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-s payload] [-b batch] [-t seconds]\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	struct timeval tv = { 0, 100000 };
+	int opt, rfd;
+
+	while ((opt = getopt(argc, argv, "s:b:t:")) != -1) {
+		switch (opt) {
+		case 's':
+			payload = atoi(optarg);
+			break;
+		case 'b':
+			batch = atoi(optarg);
+			break;
+		case 't':
+			duration = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!payload || payload > 1472 || !batch || batch > MAX_BATCH ||
+	    duration <= 0)
+		usage(argv[0]);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	rfd = udp_socket();
+	if (bind(rfd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    getsockname(rfd, (struct sockaddr *)&addr, &len)) {
+		perror("bind");
+		return 1;
+	}
+	setsockopt(rfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	printf("%u byte datagrams, batches of %u, %d s each\n",
+	       payload, batch, duration);
+	run(MODE_SENDMSG, &addr, rfd);
+	run(MODE_SENDMMSG, &addr, rfd);
+	run(MODE_GSO, &addr, rfd);
+
+	close(rfd);
+	return 0;
+}
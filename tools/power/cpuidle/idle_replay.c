@@ -0,0 +1,459 @@
+/*
+ * idle_replay.c - replay recorded idle intervals through cpuidle governors
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * The trace is read from stdin or the file given as last argument, one idle
+ * period per line:
+ *
+ *	<busy_us> <next_timer_us> <idle_us> <wake_irq>
+ *
+ * busy_us is the time the CPU ran before going idle, next_timer_us the
+ * sleep length reported by tick_nohz_get_sleep_length(), idle_us the time
+ * actually spent idle and wake_irq the interrupt that ended the idle
+ * period, or -1 for the timer or an IPI.  Lines starting with '#' are
+ * ignored.
+ *
+ * Both the menu and the predict governor selection logic are replicated
+ * here, and for each of them the chosen state is compared with the ideal
+ * one: the deepest state whose target residency fits in idle_us.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+
+#define MAX_STATES	10
+
+struct state {
+	char name[16];
+	unsigned int exit_latency;
+	unsigned int target_residency;
+};
+
+static struct state states[MAX_STATES] = {
+	{ "wfi",		1,	1 },
+	{ "retention",		60,	100 },
+	{ "standalone_pc",	250,	500 },
+	{ "pc",			400,	1500 },
+};
+static int state_count = 4;
+
+struct sample {
+	unsigned int busy_us;
+	unsigned int timer_us;
+	unsigned int idle_us;
+	int irq;
+};
+
+struct result {
+	const char *name;
+	unsigned long picks[MAX_STATES];
+	unsigned long exact;
+	unsigned long too_deep;
+	unsigned long too_shallow;
+	unsigned long long lost_us;
+};
+
+/* menu: correction factor per order of magnitude and repeating intervals */
+
+#define BUCKETS		6
+#define INTERVALS	8
+#define RESOLUTION	1024
+#define DECAY		8
+#define MAX_INTERESTING	50000
+
+struct menu {
+	uint64_t correction_factor[BUCKETS];
+	uint32_t intervals[INTERVALS];
+	int interval_ptr;
+	unsigned int bucket;
+	unsigned int expected_us;
+	uint64_t predicted_us;
+	unsigned int exit_us;
+};
+
+static unsigned int which_bucket(unsigned int duration)
+{
+	if (duration < 10)
+		return 0;
+	if (duration < 100)
+		return 1;
+	if (duration < 1000)
+		return 2;
+	if (duration < 10000)
+		return 3;
+	if (duration < 100000)
+		return 4;
+	return 5;
+}
+
+static void menu_typical_interval(struct menu *m)
+{
+	int64_t thresh = INT64_MAX;
+	uint64_t max, avg, stddev;
+	int i, divisor;
+
+again:
+	max = avg = stddev = divisor = 0;
+	for (i = 0; i < INTERVALS; i++) {
+		int64_t value = m->intervals[i];
+
+		if (value <= thresh) {
+			avg += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+	}
+	avg /= divisor;
+
+	for (i = 0; i < INTERVALS; i++) {
+		int64_t value = m->intervals[i];
+
+		if (value <= thresh) {
+			int64_t diff = value - avg;
+
+			stddev += diff * diff;
+		}
+	}
+	stddev /= divisor;
+	for (i = 0; (uint64_t)i * i < stddev; i++)
+		;
+	stddev = i;
+
+	if (((avg > stddev * 6) && (divisor * 4 >= INTERVALS * 3)) ||
+	    stddev <= 20) {
+		m->predicted_us = avg;
+		return;
+	} else if ((divisor * 4) > INTERVALS * 3) {
+		thresh = max - 1;
+		goto again;
+	}
+}
+
+static int menu_select(struct menu *m, const struct sample *s)
+{
+	int i, idx = 0;
+
+	m->exit_us = 0;
+	m->expected_us = s->timer_us;
+	m->bucket = which_bucket(m->expected_us);
+	if (!m->correction_factor[m->bucket])
+		m->correction_factor[m->bucket] = RESOLUTION * DECAY;
+
+	m->predicted_us = (m->expected_us * m->correction_factor[m->bucket] +
+			   RESOLUTION * DECAY / 2) / (RESOLUTION * DECAY);
+	menu_typical_interval(m);
+
+	for (i = 0; i < state_count; i++) {
+		if (states[i].target_residency > m->predicted_us)
+			continue;
+		if (states[i].exit_latency > m->predicted_us)
+			continue;
+		idx = i;
+		m->exit_us = states[i].exit_latency;
+	}
+
+	return idx;
+}
+
+static void menu_update(struct menu *m, const struct sample *s)
+{
+	unsigned int measured_us = s->idle_us;
+	uint64_t new_factor;
+
+	if (measured_us > m->exit_us)
+		measured_us -= m->exit_us;
+
+	new_factor = m->correction_factor[m->bucket] * (DECAY - 1) / DECAY;
+	if (m->expected_us > 0 && measured_us < MAX_INTERESTING)
+		new_factor += RESOLUTION * measured_us / m->expected_us;
+	else
+		new_factor += RESOLUTION;
+	if (!new_factor)
+		new_factor = 1;
+	m->correction_factor[m->bucket] = new_factor;
+
+	m->intervals[m->interval_ptr++] = s->idle_us;
+	if (m->interval_ptr >= INTERVALS)
+		m->interval_ptr = 0;
+}
+
+/* predict: see drivers/cpuidle/governors/predict.c */
+
+#define NR_SOURCES	8
+#define NR_BINS		20
+#define MIN_SAMPLES	4
+#define HIST_LIMIT	256
+#define EARLY_THRESH	(RESOLUTION / 10)
+
+struct source {
+	int irq;
+	unsigned int samples;
+	uint64_t last_us;
+	uint32_t avg_us;
+	uint32_t dev_us;
+	uint16_t total;
+	uint16_t hist[NR_BINS];
+};
+
+struct predict {
+	unsigned int next_src;
+	struct source src[NR_SOURCES];
+};
+
+static int interval_bin(uint32_t us)
+{
+	int bin = us ? 32 - __builtin_clz(us) : 0;
+
+	return bin < NR_BINS ? bin : NR_BINS - 1;
+}
+
+static uint32_t bin_low(int bin)
+{
+	return bin ? 1U << (bin - 1) : 0;
+}
+
+static uint32_t bin_high(int bin)
+{
+	return bin < NR_BINS - 1 ? 1U << bin : UINT32_MAX;
+}
+
+static void predict_irq(struct predict *p, int irq, uint64_t now_us)
+{
+	struct source *src = NULL;
+	uint32_t interval_us, diff;
+	int i;
+
+	for (i = 0; i < NR_SOURCES; i++) {
+		if (p->src[i].samples && p->src[i].irq == irq) {
+			src = &p->src[i];
+			break;
+		}
+	}
+	if (!src) {
+		src = &p->src[p->next_src];
+		p->next_src = (p->next_src + 1) % NR_SOURCES;
+		memset(src, 0, sizeof(*src));
+		src->irq = irq;
+	}
+
+	if (!src->samples) {
+		src->samples = 1;
+		src->last_us = now_us;
+		return;
+	}
+
+	interval_us = now_us - src->last_us;
+	src->last_us = now_us;
+
+	if (src->total >= HIST_LIMIT) {
+		src->total = 0;
+		for (i = 0; i < NR_BINS; i++) {
+			src->hist[i] >>= 1;
+			src->total += src->hist[i];
+		}
+	}
+	src->hist[interval_bin(interval_us)]++;
+	src->total++;
+
+	if (src->samples == 1) {
+		src->avg_us = interval_us;
+		src->dev_us = interval_us;
+	} else {
+		diff = abs((int32_t)(interval_us - src->avg_us));
+		src->avg_us += (interval_us >> 3) - (src->avg_us >> 3);
+		src->dev_us += (diff >> 3) - (src->dev_us >> 3);
+	}
+
+	if (src->samples < MIN_SAMPLES)
+		src->samples++;
+}
+
+static uint32_t source_early(struct source *src, uint32_t elapsed_us,
+			     uint32_t window_us)
+{
+	uint32_t end_us = elapsed_us + window_us;
+	uint32_t within = 0, beyond = 0;
+	int bin;
+
+	if (src->samples < MIN_SAMPLES)
+		return 0;
+
+	if (src->dev_us * 8 <= src->avg_us &&
+	    elapsed_us <= src->avg_us + 2 * src->dev_us) {
+		uint32_t next_us = src->avg_us -
+			(elapsed_us < src->avg_us ? elapsed_us : src->avg_us);
+
+		return next_us < window_us + 2 * src->dev_us ? RESOLUTION : 0;
+	}
+
+	for (bin = interval_bin(elapsed_us); bin < NR_BINS; bin++) {
+		if (bin_high(bin) <= elapsed_us)
+			continue;
+		if (bin_low(bin) < end_us)
+			within += src->hist[bin];
+		else
+			beyond += src->hist[bin];
+	}
+	if (!within && !beyond)
+		return 0;
+
+	return within * RESOLUTION / (within + beyond);
+}
+
+static int predict_select(struct predict *p, const struct sample *s,
+			  uint64_t now_us)
+{
+	int i, j, idx = 0;
+
+	for (i = 1; i < state_count; i++) {
+		uint32_t quiet = RESOLUTION;
+
+		if (states[i].target_residency > s->timer_us)
+			continue;
+
+		for (j = 0; j < NR_SOURCES && quiet; j++) {
+			struct source *src = &p->src[j];
+
+			if (!src->samples)
+				continue;
+			quiet = quiet * (RESOLUTION -
+				source_early(src, now_us - src->last_us,
+					     states[i].target_residency)) /
+				RESOLUTION;
+		}
+		if (RESOLUTION - quiet > EARLY_THRESH)
+			continue;
+
+		idx = i;
+	}
+
+	return idx;
+}
+
+static int ideal_state(const struct sample *s)
+{
+	int i, idx = 0;
+
+	for (i = 0; i < state_count; i++)
+		if (states[i].target_residency <= s->idle_us)
+			idx = i;
+
+	return idx;
+}
+
+static void account(struct result *r, const struct sample *s, int idx)
+{
+	int ideal = ideal_state(s);
+
+	r->picks[idx]++;
+	if (idx == ideal) {
+		r->exact++;
+	} else if (idx > ideal) {
+		r->too_deep++;
+		r->lost_us += states[idx].target_residency - s->idle_us;
+	} else {
+		r->too_shallow++;
+	}
+}
+
+static void print_result(const struct result *r, unsigned long n)
+{
+	int i;
+
+	printf("%s:\n", r->name);
+	for (i = 0; i < state_count; i++)
+		printf("  %-16s %10lu\n", states[i].name, r->picks[i]);
+	printf("  exact            %10lu (%.1f%%)\n", r->exact,
+	       n ? 100.0 * r->exact / n : 0.0);
+	printf("  too deep         %10lu (%.1f%%), %llu us short of residency\n",
+	       r->too_deep, n ? 100.0 * r->too_deep / n : 0.0, r->lost_us);
+	printf("  too shallow      %10lu (%.1f%%)\n", r->too_shallow,
+	       n ? 100.0 * r->too_shallow / n : 0.0);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-s name:exit_latency:target_residency]... [trace]\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	static struct menu menu;
+	static struct predict predict;
+	struct result rm = { .name = "menu" }, rp = { .name = "predict" };
+	struct sample s;
+	uint64_t now_us = 0;
+	unsigned long n = 0;
+	char line[256];
+	FILE *f = stdin;
+	int custom = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:h")) != -1) {
+		switch (opt) {
+		case 's':
+			if (!custom)
+				state_count = 0;
+			custom = 1;
+			if (state_count == MAX_STATES ||
+			    sscanf(optarg, "%15[^:]:%u:%u",
+				   states[state_count].name,
+				   &states[state_count].exit_latency,
+				   &states[state_count].target_residency) != 3)
+				usage(argv[0]);
+			state_count++;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%u %u %u %d", &s.busy_us, &s.timer_us,
+			   &s.idle_us, &s.irq) != 4)
+			continue;
+
+		now_us += s.busy_us;
+		account(&rm, &s, menu_select(&menu, &s));
+		account(&rp, &s, predict_select(&predict, &s, now_us));
+
+		now_us += s.idle_us;
+		menu_update(&menu, &s);
+		if (s.irq >= 0)
+			predict_irq(&predict, s.irq, now_us);
+		n++;
+	}
+
+	printf("%lu idle periods\n", n);
+	print_result(&rm, n);
+	print_result(&rp, n);
+
+	return 0;
+}
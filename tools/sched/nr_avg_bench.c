@@ -0,0 +1,231 @@
+/*
+ * nr_avg_bench.c - context switch cost with and without nr_running tracking
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Two processes pinned to the same CPU pass a byte back and forth over a
+ * pair of pipes, so every transfer is a wakeup, an enqueue, a dequeue and
+ * a context switch.  The ping-pong is timed alternately with
+ * /proc/sys/kernel/sched_nr_avg set to 1 and to 0, and the median cost of
+ * one switch is reported for each setting.  The original setting is
+ * restored on exit.  Needs root.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/wait.h>
+
+#define KNOB		"/proc/sys/kernel/sched_nr_avg"
+#define MAX_RUNS	100
+
+static int cpu;
+static int loops = 100000;
+static int runs = 10;
+
+static int knob_get(void)
+{
+	FILE *f = fopen(KNOB, "r");
+	int val = -1;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int knob_set(int val)
+{
+	FILE *f = fopen(KNOB, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", val);
+	return fclose(f);
+}
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		perror("sched_setaffinity");
+		exit(1);
+	}
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Returns the average cost of one context switch, in ns */
+static double ping_pong(void)
+{
+	int ping[2], pong[2];
+	uint64_t start, end;
+	pid_t child;
+	char c = 0;
+	int i;
+
+	if (pipe(ping) || pipe(pong)) {
+		perror("pipe");
+		exit(1);
+	}
+
+	child = fork();
+	if (child < 0) {
+		perror("fork");
+		exit(1);
+	}
+
+	if (!child) {
+		pin(cpu);
+		for (i = 0; i < loops; i++) {
+			if (read(ping[0], &c, 1) != 1 ||
+			    write(pong[1], &c, 1) != 1)
+				_exit(1);
+		}
+		_exit(0);
+	}
+
+	start = now_ns();
+	for (i = 0; i < loops; i++) {
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1) {
+			fprintf(stderr, "ping-pong failed\n");
+			exit(1);
+		}
+	}
+	end = now_ns();
+
+	waitpid(child, NULL, 0);
+	close(ping[0]);
+	close(ping[1]);
+	close(pong[0]);
+	close(pong[1]);
+
+	/* two switches per round trip */
+	return (double)(end - start) / loops / 2;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double median(double *v, int n)
+{
+	qsort(v, n, sizeof(*v), cmp_double);
+	return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static int saved = -1;
+
+static void restore(void)
+{
+	if (saved >= 0)
+		knob_set(saved);
+}
+
+static void on_signal(int sig)
+{
+	restore();
+	_exit(1);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-c cpu] [-l loops] [-r runs]\n"
+		"  -c cpu    CPU to run on (default 0)\n"
+		"  -l loops  round trips per run (default 100000)\n"
+		"  -r runs   runs per setting (default 10, max %d)\n",
+		prog, MAX_RUNS);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	double on[MAX_RUNS], off[MAX_RUNS];
+	double m_on, m_off;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "c:l:r:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (loops <= 0 || runs <= 0 || runs > MAX_RUNS)
+		usage(argv[0]);
+
+	saved = knob_get();
+	if (saved < 0) {
+		fprintf(stderr, "cannot read %s\n", KNOB);
+		return 1;
+	}
+	atexit(restore);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	pin(cpu);
+
+	/* warm up caches and the cpu frequency */
+	ping_pong();
+
+	for (i = 0; i < runs; i++) {
+		if (knob_set(1)) {
+			fprintf(stderr, "cannot write %s\n", KNOB);
+			return 1;
+		}
+		on[i] = ping_pong();
+		knob_set(0);
+		off[i] = ping_pong();
+	}
+
+	m_on = median(on, runs);
+	m_off = median(off, runs);
+
+	printf("cpu %d, %d runs of %d round trips\n", cpu, runs, loops);
+	printf("tracking on:  %8.1f ns/switch\n", m_on);
+	printf("tracking off: %8.1f ns/switch\n", m_off);
+	printf("overhead:     %8.1f ns/switch (%.1f%%)\n",
+	       m_on - m_off, m_off ? (m_on - m_off) * 100 / m_off : 0);
+
+	return 0;
+}
@@ -0,0 +1,508 @@
+/*
+ * mtp-bench.c - f_mtp file transfer throughput
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Two halves of a minimal MTP responder and initiator, enough to time
+ * the MTP_SEND_FILE_WITH_HEADER and MTP_RECEIVE_FILE ioctls without a
+ * full MTP stack.  On the gadget, "mtp-bench -d -f file" serves
+ * GetObject from the file and writes SendObject data to "file.in".  On
+ * the host, "mtp-bench /dev/bus/usb/BBB/DDD" claims the MTP interface
+ * through usbfs, keeps several bulk URBs queued and prints MB/s for
+ * each direction.  With dummy_hcd and the android gadget both halves
+ * run on the same machine, which takes the bus out of the numbers and
+ * leaves the CPU cost of the gadget side.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <endian.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/usbdevice_fs.h>
+#include <linux/usb/ch9.h>
+
+/* from include/uapi/linux/usb/f_mtp.h */
+struct mtp_file_range {
+	int		fd;
+	int64_t		offset;
+	int64_t		length;
+	uint16_t	command;
+	uint32_t	transaction_id;
+};
+#define MTP_RECEIVE_FILE		_IOW('M', 1, struct mtp_file_range)
+#define MTP_SEND_FILE_WITH_HEADER	_IOW('M', 4, struct mtp_file_range)
+
+#define MTP_DEV			"/dev/mtp_usb"
+
+#define CONTAINER_COMMAND	1
+#define CONTAINER_DATA		2
+#define CONTAINER_RESPONSE	3
+
+#define OP_GET_OBJECT		0x1009
+#define OP_SEND_OBJECT		0x100D
+#define RESPONSE_OK		0x2001
+#define RESPONSE_ERROR		0x2002
+
+struct container {
+	uint32_t length;
+	uint16_t type;
+	uint16_t code;
+	uint32_t transaction_id;
+	uint32_t params[5];
+} __attribute__((packed));
+#define HDR_SIZE	12
+
+/* the first read of a data phase, at most the f_mtp rx request size */
+#define FIRST_READ	16384
+
+#define URB_LEN		65536
+#define MAX_URBS	32
+
+static int urbs = 8;
+static int iterations = 4;
+static int64_t send_size = 64 << 20;
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_container(struct container *c, int type, int code,
+		uint32_t tid, int nparams, uint32_t length)
+{
+	memset(c, 0, sizeof(*c));
+	if (!length)
+		length = HDR_SIZE + 4 * nparams;
+	c->length = htole32(length);
+	c->type = htole16(type);
+	c->code = htole16(code);
+	c->transaction_id = htole32(tid);
+}
+
+/*-------------------------------------------------------------------------*/
+
+/* gadget side */
+
+static int respond(int mtp, uint32_t tid, int code)
+{
+	struct container c;
+
+	fill_container(&c, CONTAINER_RESPONSE, code, tid, 0, 0);
+	return write(mtp, &c, HDR_SIZE) == HDR_SIZE ? 0 : -1;
+}
+
+static int get_object(int mtp, const char *path, uint32_t tid)
+{
+	struct mtp_file_range mfr;
+	struct stat st;
+	int fd, ret;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		return -1;
+	}
+	mfr.fd = fd;
+	mfr.offset = 0;
+	mfr.length = st.st_size;
+	mfr.command = OP_GET_OBJECT;
+	mfr.transaction_id = tid;
+	ret = ioctl(mtp, MTP_SEND_FILE_WITH_HEADER, &mfr);
+	if (ret)
+		perror("MTP_SEND_FILE_WITH_HEADER");
+	close(fd);
+	return ret;
+}
+
+static int send_object(int mtp, const char *path, int64_t size)
+{
+	struct mtp_file_range mfr;
+	static char buf[FIRST_READ];
+	ssize_t n;
+	int fd, ret = 0;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	/* like an MTP responder: header and first data, then the ioctl */
+	n = read(mtp, buf, sizeof(buf));
+	if (n < HDR_SIZE) {
+		perror("read data header");
+		close(fd);
+		return -1;
+	}
+	n -= HDR_SIZE;
+	if (write(fd, buf + HDR_SIZE, n) != n) {
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	if (size > n) {
+		mfr.fd = fd;
+		mfr.offset = n;
+		mfr.length = size - n;
+		mfr.command = 0;
+		mfr.transaction_id = 0;
+		ret = ioctl(mtp, MTP_RECEIVE_FILE, &mfr);
+		if (ret)
+			perror("MTP_RECEIVE_FILE");
+	}
+	close(fd);
+	return ret;
+}
+
+static int run_device(const char *path)
+{
+	struct container c;
+	char in_path[4096];
+	int mtp, ret;
+	ssize_t n;
+
+	snprintf(in_path, sizeof(in_path), "%s.in", path);
+	mtp = open(MTP_DEV, O_RDWR);
+	if (mtp < 0) {
+		perror(MTP_DEV);
+		return 1;
+	}
+
+	for (;;) {
+		n = read(mtp, &c, sizeof(c));
+		if (n < 0 && errno == ECANCELED)
+			continue;
+		if (n < HDR_SIZE) {
+			perror("read command");
+			break;
+		}
+		if (le16toh(c.type) != CONTAINER_COMMAND)
+			continue;
+
+		switch (le16toh(c.code)) {
+		case OP_GET_OBJECT:
+			ret = get_object(mtp, path, le32toh(c.transaction_id));
+			break;
+		case OP_SEND_OBJECT:
+			ret = send_object(mtp, in_path, le32toh(c.params[0]));
+			break;
+		default:
+			ret = 0;
+			break;
+		}
+		respond(mtp, le32toh(c.transaction_id),
+			ret ? RESPONSE_ERROR : RESPONSE_OK);
+	}
+	close(mtp);
+	return 1;
+}
+
+/*-------------------------------------------------------------------------*/
+
+/* host side */
+
+struct usb_dev {
+	int fd;
+	int intf;
+	unsigned char ep_in, ep_out;
+	int maxpacket;
+};
+
+static struct usbdevfs_urb urb[MAX_URBS];
+static char *urb_buf[MAX_URBS];
+
+/* find the first vendor specific interface with two bulk endpoints */
+static int find_mtp(struct usb_dev *dev)
+{
+	unsigned char desc[4096], *p;
+	int len, intf = -1, found = -1;
+
+	len = read(dev->fd, desc, sizeof(desc));
+	for (p = desc; len >= 2 && p[0] >= 2 && p + p[0] <= desc + len;
+	     p += p[0]) {
+		if (p[1] == USB_DT_INTERFACE) {
+			if (found >= 0)
+				break;
+			intf = -1;
+			dev->ep_in = dev->ep_out = 0;
+			if (p[5] == USB_CLASS_VENDOR_SPEC && p[6] == 0xff &&
+			    p[7] == 0)
+				intf = p[2];
+		} else if (p[1] == USB_DT_ENDPOINT && intf >= 0 &&
+			   (p[3] & USB_ENDPOINT_XFERTYPE_MASK) ==
+			   USB_ENDPOINT_XFER_BULK) {
+			if (p[2] & USB_DIR_IN)
+				dev->ep_in = p[2];
+			else
+				dev->ep_out = p[2];
+			dev->maxpacket = p[4] | (p[5] << 8);
+			if (dev->ep_in && dev->ep_out)
+				found = intf;
+		}
+	}
+	if (found < 0)
+		return -1;
+	dev->intf = found;
+	return ioctl(dev->fd, USBDEVFS_CLAIMINTERFACE, &dev->intf);
+}
+
+static int bulk(struct usb_dev *dev, unsigned char ep, void *buf, int len)
+{
+	struct usbdevfs_bulktransfer bt;
+
+	bt.ep = ep;
+	bt.len = len;
+	bt.timeout = 5000;
+	bt.data = buf;
+	return ioctl(dev->fd, USBDEVFS_BULK, &bt);
+}
+
+static int submit(struct usb_dev *dev, int i, unsigned char ep, int len,
+		int flags)
+{
+	memset(&urb[i], 0, sizeof(urb[i]));
+	urb[i].type = USBDEVFS_URB_TYPE_BULK;
+	urb[i].endpoint = ep;
+	urb[i].buffer = urb_buf[i];
+	urb[i].buffer_length = len;
+	urb[i].flags = flags;
+	urb[i].usercontext = (void *)(long)i;
+	return ioctl(dev->fd, USBDEVFS_SUBMITURB, &urb[i]);
+}
+
+static struct usbdevfs_urb *reap(struct usb_dev *dev)
+{
+	struct usbdevfs_urb *u;
+
+	if (ioctl(dev->fd, USBDEVFS_REAPURB, &u))
+		return NULL;
+	return u;
+}
+
+static int command(struct usb_dev *dev, int code, uint32_t tid,
+		uint32_t param)
+{
+	struct container c;
+
+	fill_container(&c, CONTAINER_COMMAND, code, tid, 1, 0);
+	c.params[0] = htole32(param);
+	return bulk(dev, dev->ep_out, &c, HDR_SIZE + 4) == HDR_SIZE + 4 ?
+		0 : -1;
+}
+
+static int response(struct usb_dev *dev)
+{
+	struct container c;
+	char buf[512];
+
+	if (bulk(dev, dev->ep_in, buf, sizeof(buf)) < HDR_SIZE)
+		return -1;
+	memcpy(&c, buf, HDR_SIZE);
+	if (le16toh(c.type) != CONTAINER_RESPONSE ||
+	    le16toh(c.code) != RESPONSE_OK)
+		return -1;
+	return 0;
+}
+
+/* the data phase of GetObject, returns the object size */
+static int64_t receive_data(struct usb_dev *dev)
+{
+	struct usbdevfs_urb *u;
+	struct container c;
+	int64_t total, queued, done;
+	int i, inflight = 0, len, full;
+
+	/* the header in the first URB tells how much follows */
+	if (submit(dev, 0, dev->ep_in, URB_LEN, 0))
+		return -1;
+	u = reap(dev);
+	if (!u || u->status || u->actual_length < HDR_SIZE)
+		return -1;
+	memcpy(&c, u->buffer, HDR_SIZE);
+	total = le32toh(c.length);
+	done = queued = u->actual_length;
+	full = u->actual_length == u->buffer_length;
+
+	/* never queue past the data, or the response is swallowed */
+	i = 0;
+	while (done < total) {
+		while (inflight < urbs && queued < total) {
+			len = total - queued > URB_LEN ? URB_LEN :
+				total - queued;
+			if (submit(dev, i, dev->ep_in, len, 0))
+				return -1;
+			i = (i + 1) % urbs;
+			inflight++;
+			queued += len;
+		}
+		u = reap(dev);
+		if (!u || u->status)
+			return -1;
+		inflight--;
+		done += u->actual_length;
+		full = u->actual_length == u->buffer_length;
+	}
+	/* a URB that was not filled already got the zero length packet */
+	if (full && !(total % dev->maxpacket))
+		bulk(dev, dev->ep_in, urb_buf[0], dev->maxpacket);
+	return total - HDR_SIZE;
+}
+
+/* the data phase of SendObject */
+static int send_data(struct usb_dev *dev, uint32_t tid)
+{
+	struct usbdevfs_urb *u;
+	struct container c;
+	int64_t total = HDR_SIZE + send_size, queued = 0, done = 0;
+	int i = 0, inflight = 0, len, flags;
+
+	fill_container(&c, CONTAINER_DATA, OP_SEND_OBJECT, tid, 0, total);
+	while (done < total) {
+		while (inflight < urbs && queued < total) {
+			len = total - queued > URB_LEN ? URB_LEN :
+				total - queued;
+			if (!queued)
+				memcpy(urb_buf[i], &c, HDR_SIZE);
+			flags = queued + len == total ?
+				USBDEVFS_URB_ZERO_PACKET : 0;
+			if (submit(dev, i, dev->ep_out, len, flags))
+				return -1;
+			i = (i + 1) % urbs;
+			inflight++;
+			queued += len;
+		}
+		u = reap(dev);
+		if (!u || u->status)
+			return -1;
+		inflight--;
+		done += u->actual_length;
+	}
+	return 0;
+}
+
+static int run_host(const char *path)
+{
+	struct usb_dev dev;
+	double start, get_s = 0, send_s = 0;
+	int64_t size = 0, got;
+	uint32_t tid = 1;
+	int i;
+
+	dev.fd = open(path, O_RDWR);
+	if (dev.fd < 0) {
+		perror(path);
+		return 1;
+	}
+	if (find_mtp(&dev)) {
+		fprintf(stderr, "%s: no MTP interface\n", path);
+		return 1;
+	}
+	for (i = 0; i < urbs; i++) {
+		urb_buf[i] = malloc(URB_LEN);
+		if (!urb_buf[i])
+			return 1;
+		memset(urb_buf[i], 0x5a, URB_LEN);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		start = now_s();
+		if (command(&dev, OP_GET_OBJECT, tid, 0))
+			goto err;
+		got = receive_data(&dev);
+		if (got < 0 || response(&dev))
+			goto err;
+		get_s += now_s() - start;
+		size += got;
+		tid++;
+
+		start = now_s();
+		if (command(&dev, OP_SEND_OBJECT, tid, send_size) ||
+		    send_data(&dev, tid) || response(&dev))
+			goto err;
+		send_s += now_s() - start;
+		tid++;
+	}
+
+	printf("GetObject  %8.1f MB/s (%lld bytes x %d)\n",
+	       size / get_s / 1e6, (long long)(size / iterations), iterations);
+	printf("SendObject %8.1f MB/s (%lld bytes x %d)\n",
+	       send_size * iterations / send_s / 1e6, (long long)send_size,
+	       iterations);
+	ioctl(dev.fd, USBDEVFS_RELEASEINTERFACE, &dev.intf);
+	close(dev.fd);
+	return 0;
+err:
+	fprintf(stderr, "transaction %u failed\n", tid);
+	return 1;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -d -f file\n"
+		"       %s [-n iterations] [-q urbs] [-s send_size] "
+		"/dev/bus/usb/BBB/DDD\n", prog, prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = NULL;
+	int opt, device = 0;
+
+	while ((opt = getopt(argc, argv, "df:n:q:s:")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = 1;
+			break;
+		case 'f':
+			file = optarg;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'q':
+			urbs = atoi(optarg);
+			break;
+		case 's':
+			send_size = atoll(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (iterations <= 0 || urbs <= 0 || urbs > MAX_URBS ||
+	    send_size <= 0 || send_size >= 0xFFFFFFFF - HDR_SIZE)
+		usage(argv[0]);
+
+	if (device) {
+		if (!file)
+			usage(argv[0]);
+		return run_device(file);
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+	return run_host(argv[optind]);
+}
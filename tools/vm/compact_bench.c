@@ -0,0 +1,385 @@
+/*
+ * compact_bench.c - high-order allocation latency with proactive compaction
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Free memory is fragmented by faulting in an anonymous buffer and giving
+ * back every other page of it.  After giving kcompactd some time, jumbo
+ * UDP datagrams are sent over loopback without being received: each one
+ * needs a linear skb, that is a physically contiguous allocation of the
+ * chosen order, and each send is timed.  The runs alternate between
+ * /proc/sys/vm/compaction_proactiveness set to 0 and to the given value,
+ * and report the fragmentation score seen before the sends, the latency
+ * percentiles, the direct compaction stalls and the kcompactd activity.
+ * The original setting is restored on exit.  Needs root.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define KNOB		"/proc/sys/vm/compaction_proactiveness"
+#define PAGE		4096UL
+#define MB		(1024UL * 1024)
+#define MAX_RUNS	100
+
+/* what the datagram leaves of the block for headers and skb_shared_info */
+#define SKB_OVERHEAD	1024
+
+static unsigned long size_mb;
+static int order = 3;
+static int nr_allocs = 256;
+static int wait_secs = 10;
+static int runs = 3;
+static int proactiveness = 20;
+
+static const char * const events[] = {
+	"compact_stall",
+	"compact_daemon_wake",
+	"compact_daemon_success",
+	"compact_daemon_fail",
+	"compact_daemon_migrate_scanned",
+};
+#define NR_EVENTS	(sizeof(events) / sizeof(events[0]))
+
+struct result {
+	uint64_t *lat;		/* ns, one per successful send */
+	unsigned long nr;
+	unsigned long failed;
+	unsigned long score;	/* summed over the runs */
+	unsigned long ev[NR_EVENTS];
+};
+
+static int knob_get(void)
+{
+	FILE *f = fopen(KNOB, "r");
+	int val = -1;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int knob_set(int val)
+{
+	FILE *f = fopen(KNOB, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", val);
+	return fclose(f);
+}
+
+static unsigned long vmstat(const char *name)
+{
+	FILE *f = fopen("/proc/vmstat", "r");
+	char key[64];
+	unsigned long val;
+
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu", key, &val) == 2) {
+		if (!strcmp(key, name)) {
+			fclose(f);
+			return val;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+static unsigned long mem_free_mb(void)
+{
+	FILE *f = fopen("/proc/meminfo", "r");
+	char key[64];
+	unsigned long val = 0;
+
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu kB", key, &val) == 2) {
+		if (!strcmp(key, "MemFree:"))
+			break;
+		val = 0;
+	}
+	fclose(f);
+	return val / 1024;
+}
+
+/*
+ * Percentage of the free memory in blocks below the order, from
+ * /proc/buddyinfo: the kernel's fragmentation score for that order,
+ * over all zones.
+ */
+static unsigned long frag_score(void)
+{
+	FILE *f = fopen("/proc/buddyinfo", "r");
+	unsigned long free = 0, suitable = 0, nr;
+	char line[512], *p;
+	int o, n;
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		p = strstr(line, "zone");
+		if (!p)
+			continue;
+		/* skip "zone" and the zone name */
+		n = 0;
+		if (sscanf(p, "%*s %*s%n", &n) < 0 || !n)
+			continue;
+		p += n;
+		for (o = 0; sscanf(p, "%lu%n", &nr, &n) == 1; o++, p += n) {
+			free += nr << o;
+			if (o >= order)
+				suitable += nr << o;
+		}
+	}
+	fclose(f);
+	return free ? (free - suitable) * 100 / free : 0;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Movable pages with a free page on either side of each */
+static char *fragment(unsigned long pages)
+{
+	unsigned long i;
+	char *buf;
+
+	buf = mmap(NULL, pages * PAGE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	for (i = 0; i < pages; i++)
+		buf[i * PAGE] = 1;
+	for (i = 0; i < pages; i += 2)
+		madvise(buf + i * PAGE, PAGE, MADV_DONTNEED);
+	return buf;
+}
+
+static void run(int knob, struct result *r)
+{
+	unsigned long pages = size_mb * MB / PAGE;
+	size_t len = (PAGE << order) - SKB_OVERHEAD;
+	int rcvbuf = nr_allocs * (PAGE << order) * 2;
+	unsigned long ev[NR_EVENTS];
+	struct sockaddr_in addr;
+	socklen_t alen = sizeof(addr);
+	char *buf, *dgram;
+	unsigned int i;
+	int tx, rx, n;
+
+	if (knob_set(knob)) {
+		fprintf(stderr, "cannot write %s\n", KNOB);
+		exit(1);
+	}
+
+	for (i = 0; i < NR_EVENTS; i++)
+		ev[i] = vmstat(events[i]);
+
+	buf = fragment(pages);
+	sleep(wait_secs);
+	r->score += frag_score();
+
+	dgram = calloc(1, len);
+	rx = socket(AF_INET, SOCK_DGRAM, 0);
+	tx = socket(AF_INET, SOCK_DGRAM, 0);
+	if (!dgram || rx < 0 || tx < 0) {
+		perror("socket");
+		exit(1);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (setsockopt(rx, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf,
+		       sizeof(rcvbuf)) ||
+	    bind(rx, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    getsockname(rx, (struct sockaddr *)&addr, &alen)) {
+		perror("receiver");
+		exit(1);
+	}
+
+	/* nothing is received before the end: every send takes a new block */
+	for (n = 0; n < nr_allocs; n++) {
+		uint64_t start = now_ns();
+
+		if (sendto(tx, dgram, len, 0, (struct sockaddr *)&addr,
+			   sizeof(addr)) < 0) {
+			r->failed++;
+			continue;
+		}
+		r->lat[r->nr++] = now_ns() - start;
+	}
+	while (recv(rx, dgram, len, MSG_DONTWAIT) > 0)
+		;
+
+	for (i = 0; i < NR_EVENTS; i++)
+		r->ev[i] += vmstat(events[i]) - ev[i];
+
+	close(tx);
+	close(rx);
+	free(dgram);
+	munmap(buf, pages * PAGE);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print(int knob, struct result *r)
+{
+	uint64_t total = 0;
+	unsigned long i;
+
+	printf("%-6d %6lu", knob, r->score / runs);
+	if (!r->nr) {
+		printf(" every send failed\n");
+		return;
+	}
+
+	qsort(r->lat, r->nr, sizeof(*r->lat), cmp_u64);
+	for (i = 0; i < r->nr; i++)
+		total += r->lat[i];
+
+	printf(" %8lu %8.2f %8.2f %8.2f %8.2f %8.2f",
+	       r->failed, (double)total / r->nr / 1000,
+	       r->lat[r->nr / 2] / 1000.0,
+	       r->lat[r->nr * 90 / 100] / 1000.0,
+	       r->lat[r->nr * 99 / 100] / 1000.0,
+	       r->lat[r->nr - 1] / 1000.0);
+	for (i = 0; i < NR_EVENTS; i++)
+		printf(" %8lu", r->ev[i]);
+	printf("\n");
+}
+
+static int saved = -1;
+
+static void restore(void)
+{
+	if (saved >= 0)
+		knob_set(saved);
+}
+
+static void on_signal(int sig)
+{
+	restore();
+	_exit(1);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m MB] [-o order] [-n allocs] [-w secs] [-r runs] [-p proactiveness]\n"
+		"  -m MB    memory to fragment (default half of MemFree)\n"
+		"  -o order allocation order, 2 to 4 (default 3)\n"
+		"  -n N     allocations per run (default 256)\n"
+		"  -w secs  time given to kcompactd before allocating (default 10)\n"
+		"  -r runs  runs per setting (default 3, max %d)\n"
+		"  -p N     proactiveness compared against 0 (default 20)\n",
+		prog, MAX_RUNS);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct result off = { 0 }, on = { 0 };
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:o:n:w:r:p:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			size_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			order = atoi(optarg);
+			break;
+		case 'n':
+			nr_allocs = atoi(optarg);
+			break;
+		case 'w':
+			wait_secs = atoi(optarg);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		case 'p':
+			proactiveness = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!size_mb)
+		size_mb = mem_free_mb() / 2;
+	if (!size_mb || order < 2 || order > 4 || nr_allocs <= 0 ||
+	    wait_secs < 0 || runs <= 0 || runs > MAX_RUNS ||
+	    proactiveness <= 0 || proactiveness > 100)
+		usage(argv[0]);
+
+	off.lat = malloc(nr_allocs * runs * sizeof(*off.lat));
+	on.lat = malloc(nr_allocs * runs * sizeof(*on.lat));
+	if (!off.lat || !on.lat) {
+		perror("malloc");
+		return 1;
+	}
+
+	saved = knob_get();
+	if (saved < 0) {
+		fprintf(stderr, "cannot read %s\n", KNOB);
+		return 1;
+	}
+	atexit(restore);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	for (i = 0; i < (unsigned int)runs; i++) {
+		run(0, &off);
+		run(proactiveness, &on);
+	}
+
+	printf("%lu MB fragmented, %d order-%d allocations per run, %d runs, "
+	       "latencies in us\n", size_mb, nr_allocs, order, runs);
+	printf("%-6s %6s %8s %8s %8s %8s %8s %8s", "proact", "score",
+	       "failed", "avg", "p50", "p90", "p99", "max");
+	printf(" %8s %8s %8s %8s %8s\n", "stall", "kcd_wake", "kcd_ok",
+	       "kcd_fail", "kcd_scan");
+	print(0, &off);
+	print(proactiveness, &on);
+
+	return 0;
+}
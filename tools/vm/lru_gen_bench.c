@@ -0,0 +1,399 @@
+/*
+ * lru_gen_bench.c - compare reclaim with and without the multi-gen LRU
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A child process maps an anonymous and a file working set, each with a
+ * small hot part that is touched all the time and a large cold part that
+ * is touched rarely.  The sets should be sized to exceed free memory, so
+ * that the run depends on reclaim keeping the hot parts resident.  The run
+ * is repeated with /sys/kernel/mm/lru_gen/enabled set to 0 and to 1 and
+ * the major faults of the child, the swap-ins and page-ins of the system
+ * and the cpu time of kswapd are reported for each setting.  The original
+ * setting is restored on exit.  Needs root and swap.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define KNOB		"/sys/kernel/mm/lru_gen/enabled"
+#define PAGE		4096UL
+#define MB		(1024UL * 1024)
+
+static unsigned long anon_mb = 512;
+static unsigned long file_mb = 512;
+static int hot_pct = 10;
+static int cold_every = 64;
+static int seconds = 30;
+static const char *file_path = "/data/local/tmp/lru_gen_bench.dat";
+
+struct result {
+	long majflt;
+	unsigned long pswpin;
+	unsigned long pgpgin;
+	unsigned long kswapd_ms;
+	unsigned long aging;
+	unsigned long promoted;
+	unsigned long demoted;
+	unsigned long touches;
+};
+
+static int knob_get(void)
+{
+	FILE *f = fopen(KNOB, "r");
+	int val = -1;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int knob_set(int val)
+{
+	FILE *f = fopen(KNOB, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", val);
+	return fclose(f);
+}
+
+static void drop_caches(void)
+{
+	FILE *f = fopen("/proc/sys/vm/drop_caches", "w");
+
+	if (!f)
+		return;
+	fprintf(f, "3\n");
+	fclose(f);
+}
+
+static unsigned long vmstat(const char *name)
+{
+	FILE *f = fopen("/proc/vmstat", "r");
+	char key[64];
+	unsigned long val;
+
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu", key, &val) == 2) {
+		if (!strcmp(key, name)) {
+			fclose(f);
+			return val;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+/* utime + stime of all kswapd threads, in ms */
+static unsigned long kswapd_ms(void)
+{
+	long hz = sysconf(_SC_CLK_TCK);
+	unsigned long total = 0;
+	struct dirent *de;
+	DIR *dir;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return 0;
+
+	while ((de = readdir(dir))) {
+		unsigned long utime, stime;
+		char path[300], comm[32];
+		FILE *f;
+
+		if (de->d_name[0] < '0' || de->d_name[0] > '9')
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (fscanf(f, "%*d (%31[^)]) %*c %*d %*d %*d %*d %*d %*u "
+			   "%*u %*u %*u %*u %lu %lu", comm, &utime, &stime) == 3 &&
+		    !strncmp(comm, "kswapd", 6))
+			total += utime + stime;
+		fclose(f);
+	}
+	closedir(dir);
+
+	return total * 1000 / hz;
+}
+
+static char *map_file(unsigned long size)
+{
+	char buf[PAGE];
+	unsigned long off;
+	char *p;
+	int fd;
+
+	fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(file_path);
+		_exit(1);
+	}
+
+	memset(buf, 0x5a, sizeof(buf));
+	for (off = 0; off < size; off += PAGE) {
+		if (write(fd, buf, PAGE) != PAGE) {
+			perror("write");
+			_exit(1);
+		}
+	}
+	fsync(fd);
+
+	p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap file");
+		_exit(1);
+	}
+	close(fd);
+	return p;
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Touch one page of a set, hot or cold, and return its first byte */
+static unsigned char touch(char *base, unsigned long pages, int cold,
+			   unsigned int *seed, int write)
+{
+	unsigned long hot = pages * hot_pct / 100;
+	unsigned long idx;
+
+	if (!hot)
+		hot = 1;
+	if (cold && pages > hot)
+		idx = hot + rand_r(seed) % (pages - hot);
+	else
+		idx = rand_r(seed) % hot;
+
+	if (write)
+		base[idx * PAGE]++;
+	return base[idx * PAGE];
+}
+
+/* The workload, run in a child so that every run starts from scratch */
+static void workload(int fd)
+{
+	unsigned long anon_pages = anon_mb * MB / PAGE;
+	unsigned long file_pages = file_mb * MB / PAGE;
+	unsigned long touches = 0, i;
+	unsigned int seed = 1;
+	volatile unsigned char sum = 0;
+	uint64_t end;
+	char *anon = NULL, *file = NULL;
+
+	if (anon_pages) {
+		anon = mmap(NULL, anon_pages * PAGE, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (anon == MAP_FAILED) {
+			perror("mmap anon");
+			_exit(1);
+		}
+		for (i = 0; i < anon_pages; i++)
+			anon[i * PAGE] = i;
+	}
+	if (file_pages) {
+		file = map_file(file_pages * PAGE);
+		for (i = 0; i < file_pages; i++)
+			sum += file[i * PAGE];
+	}
+
+	end = now_ms() + seconds * 1000;
+	while (now_ms() < end) {
+		for (i = 0; i < 1024; i++, touches++) {
+			int cold = !(rand_r(&seed) % cold_every);
+
+			if (anon)
+				sum += touch(anon, anon_pages, cold, &seed, 1);
+			if (file)
+				sum += touch(file, file_pages, cold, &seed, 0);
+		}
+	}
+
+	if (write(fd, &touches, sizeof(touches)) != sizeof(touches))
+		_exit(1);
+	_exit(0);
+}
+
+static void run(int enabled, struct result *r)
+{
+	struct rusage ru;
+	int pipefd[2];
+	pid_t child;
+	unsigned long pswpin, pgpgin, kswapd, aging, promoted, demoted;
+
+	if (knob_set(enabled)) {
+		fprintf(stderr, "cannot write %s\n", KNOB);
+		exit(1);
+	}
+
+	/* start both runs with an empty page cache */
+	sync();
+	drop_caches();
+
+	pswpin = vmstat("pswpin");
+	pgpgin = vmstat("pgpgin");
+	aging = vmstat("lru_gen_aging");
+	promoted = vmstat("lru_gen_promoted");
+	demoted = vmstat("lru_gen_demoted");
+	kswapd = kswapd_ms();
+
+	if (pipe(pipefd)) {
+		perror("pipe");
+		exit(1);
+	}
+
+	child = fork();
+	if (child < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (!child) {
+		close(pipefd[0]);
+		workload(pipefd[1]);
+	}
+	close(pipefd[1]);
+
+	memset(r, 0, sizeof(*r));
+	if (read(pipefd[0], &r->touches, sizeof(r->touches)) !=
+	    sizeof(r->touches))
+		fprintf(stderr, "workload failed\n");
+	close(pipefd[0]);
+
+	if (wait4(child, NULL, 0, &ru) < 0) {
+		perror("wait4");
+		exit(1);
+	}
+	unlink(file_path);
+
+	r->majflt = ru.ru_majflt;
+	r->pswpin = vmstat("pswpin") - pswpin;
+	r->pgpgin = vmstat("pgpgin") - pgpgin;
+	r->aging = vmstat("lru_gen_aging") - aging;
+	r->promoted = vmstat("lru_gen_promoted") - promoted;
+	r->demoted = vmstat("lru_gen_demoted") - demoted;
+	r->kswapd_ms = kswapd_ms() - kswapd;
+}
+
+static void print(const char *name, struct result *r)
+{
+	printf("%-8s %10ld %10lu %10lu %10lu %12lu %8lu %10lu %10lu\n",
+	       name, r->majflt, r->pswpin, r->pgpgin, r->kswapd_ms,
+	       r->touches, r->aging, r->promoted, r->demoted);
+}
+
+static int saved = -1;
+
+static void restore(void)
+{
+	if (saved >= 0)
+		knob_set(saved);
+}
+
+static void on_signal(int sig)
+{
+	restore();
+	_exit(1);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-a MB] [-f MB] [-p pct] [-c n] [-t sec] [-F path]\n"
+		"  -a MB    anonymous working set (default 512)\n"
+		"  -f MB    file working set (default 512)\n"
+		"  -p pct   hot part of each set (default 10)\n"
+		"  -c n     one touch in n goes to the cold part (default 64)\n"
+		"  -t sec   duration of each run (default 30)\n"
+		"  -F path  backing file of the file set\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct result classic, gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "a:f:p:c:t:F:h")) != -1) {
+		switch (opt) {
+		case 'a':
+			anon_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			file_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			hot_pct = atoi(optarg);
+			break;
+		case 'c':
+			cold_every = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'F':
+			file_path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (hot_pct <= 0 || hot_pct > 100 || cold_every <= 0 ||
+	    seconds <= 0 || (!anon_mb && !file_mb))
+		usage(argv[0]);
+
+	saved = knob_get();
+	if (saved < 0) {
+		fprintf(stderr, "cannot read %s\n", KNOB);
+		return 1;
+	}
+	atexit(restore);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	run(0, &classic);
+	run(1, &gen);
+
+	printf("anon %lu MB, file %lu MB, %d%% hot, 1/%d cold, %d s\n",
+	       anon_mb, file_mb, hot_pct, cold_every, seconds);
+	printf("%-8s %10s %10s %10s %10s %12s %8s %10s %10s\n", "mode",
+	       "majflt", "pswpin", "pgpgin", "kswapd_ms", "touches",
+	       "aging", "promoted", "demoted");
+	print("classic", &classic);
+	print("lru_gen", &gen);
+
+	return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * swapin_bench.c - swap-in fault latency with and without the swap cache
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * An anonymous buffer is filled with pages that are half random, half zero,
+ * so that zram has something to compress, and pushed out to swap through
+ * /proc/self/reclaim.  Every page is then faulted back in, in random or
+ * sequential order, and each fault is timed.  The runs alternate between
+ * /sys/kernel/mm/swap/direct_enabled set to 1 and to 0, and the latency
+ * percentiles of each setting are reported together with the number of
+ * swap-ins that skipped the swap cache.  The original setting is restored
+ * on exit.  Needs root, CONFIG_PROCESS_RECLAIM and a zram swap device.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#define KNOB		"/sys/kernel/mm/swap/direct_enabled"
+#define PAGE		4096UL
+#define MB		(1024UL * 1024)
+#define MAX_RUNS	100
+
+static unsigned long size_mb = 64;
+static int runs = 5;
+static int sequential;
+
+struct result {
+	uint64_t *lat;		/* ns, one per swapped out page */
+	unsigned long nr;
+	unsigned long skipped;	/* pages that did not make it to swap */
+	unsigned long direct;
+	unsigned long pswpin;
+};
+
+static int knob_get(void)
+{
+	FILE *f = fopen(KNOB, "r");
+	int val = -1;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+static int knob_set(int val)
+{
+	FILE *f = fopen(KNOB, "w");
+
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", val);
+	return fclose(f);
+}
+
+static unsigned long vmstat(const char *name)
+{
+	FILE *f = fopen("/proc/vmstat", "r");
+	char key[64];
+	unsigned long val;
+
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu", key, &val) == 2) {
+		if (!strcmp(key, name)) {
+			fclose(f);
+			return val;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+static void reclaim_anon(void)
+{
+	FILE *f = fopen("/proc/self/reclaim", "w");
+
+	if (!f) {
+		perror("/proc/self/reclaim");
+		exit(1);
+	}
+	fprintf(f, "anon\n");
+	fclose(f);
+}
+
+/* Bit 62 of a pagemap entry: the page is swapped out */
+static int swapped(int fd, char *addr)
+{
+	uint64_t ent;
+	off_t off = (uintptr_t)addr / PAGE * sizeof(ent);
+
+	if (pread(fd, &ent, sizeof(ent), off) != sizeof(ent))
+		return 0;
+	return !!(ent & (1ULL << 62));
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void shuffle(unsigned long *v, unsigned long n, unsigned int *seed)
+{
+	unsigned long i, j, t;
+
+	for (i = n - 1; i > 0; i--) {
+		j = rand_r(seed) % (i + 1);
+		t = v[i];
+		v[i] = v[j];
+		v[j] = t;
+	}
+}
+
+static void run(int enabled, struct result *r, unsigned int seed)
+{
+	unsigned long pages = size_mb * MB / PAGE;
+	unsigned long *order, i, j;
+	unsigned long direct, pswpin;
+	volatile char sum = 0;
+	char *buf;
+	int fd;
+
+	if (knob_set(enabled)) {
+		fprintf(stderr, "cannot write %s\n", KNOB);
+		exit(1);
+	}
+
+	buf = mmap(NULL, pages * PAGE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	order = malloc(pages * sizeof(*order));
+	if (buf == MAP_FAILED || !order) {
+		perror("alloc");
+		exit(1);
+	}
+
+	for (i = 0; i < pages; i++) {
+		unsigned int *p = (unsigned int *)(buf + i * PAGE);
+
+		for (j = 0; j < PAGE / 2 / sizeof(*p); j++)
+			p[j] = rand_r(&seed);
+		order[i] = i;
+	}
+	if (!sequential)
+		shuffle(order, pages, &seed);
+
+	reclaim_anon();
+
+	fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0) {
+		perror("/proc/self/pagemap");
+		exit(1);
+	}
+
+	direct = vmstat("swap_direct");
+	pswpin = vmstat("pswpin");
+
+	for (i = 0; i < pages; i++) {
+		char *addr = buf + order[i] * PAGE;
+		uint64_t start;
+
+		/* resident or already read ahead, nothing to measure */
+		if (!swapped(fd, addr)) {
+			r->skipped++;
+			continue;
+		}
+		start = now_ns();
+		sum += *addr;
+		r->lat[r->nr++] = now_ns() - start;
+	}
+
+	r->direct += vmstat("swap_direct") - direct;
+	r->pswpin += vmstat("pswpin") - pswpin;
+
+	close(fd);
+	free(order);
+	munmap(buf, pages * PAGE);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print(const char *name, struct result *r)
+{
+	uint64_t total = 0;
+	unsigned long i;
+
+	if (!r->nr) {
+		printf("%-8s no page was swapped out\n", name);
+		return;
+	}
+
+	qsort(r->lat, r->nr, sizeof(*r->lat), cmp_u64);
+	for (i = 0; i < r->nr; i++)
+		total += r->lat[i];
+
+	printf("%-8s %8lu %8lu %8lu %8.2f %8.2f %8.2f %8.2f %10lu\n",
+	       name, r->nr, r->skipped, r->pswpin,
+	       (double)total / r->nr / 1000,
+	       r->lat[r->nr / 2] / 1000.0,
+	       r->lat[r->nr * 90 / 100] / 1000.0,
+	       r->lat[r->nr * 99 / 100] / 1000.0,
+	       r->direct);
+}
+
+static int saved = -1;
+
+static void restore(void)
+{
+	if (saved >= 0)
+		knob_set(saved);
+}
+
+static void on_signal(int sig)
+{
+	restore();
+	_exit(1);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m MB] [-r runs] [-s]\n"
+		"  -m MB    buffer pushed to swap per run (default 64)\n"
+		"  -r runs  runs per setting (default 5, max %d)\n"
+		"  -s       fault in sequentially instead of in random order\n",
+		prog, MAX_RUNS);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct result on = { 0 }, off = { 0 };
+	unsigned long pages;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "m:r:sh")) != -1) {
+		switch (opt) {
+		case 'm':
+			size_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		case 's':
+			sequential = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!size_mb || runs <= 0 || runs > MAX_RUNS)
+		usage(argv[0]);
+
+	pages = size_mb * MB / PAGE;
+	on.lat = malloc(pages * runs * sizeof(*on.lat));
+	off.lat = malloc(pages * runs * sizeof(*off.lat));
+	if (!on.lat || !off.lat) {
+		perror("malloc");
+		return 1;
+	}
+
+	saved = knob_get();
+	if (saved < 0) {
+		fprintf(stderr, "cannot read %s\n", KNOB);
+		return 1;
+	}
+	atexit(restore);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	/* same contents and order for both settings of a run */
+	for (i = 0; i < runs; i++) {
+		run(1, &on, i + 1);
+		run(0, &off, i + 1);
+	}
+
+	printf("%lu MB, %d runs, %s faults, latencies in us\n", size_mb, runs,
+	       sequential ? "sequential" : "random");
+	printf("%-8s %8s %8s %8s %8s %8s %8s %8s %10s\n", "mode",
+	       "faults", "skipped", "pswpin", "avg", "p50", "p90", "p99",
+	       "direct");
+	print("on", &on);
+	print("off", &off);
+
+	return 0;
+}